@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+
+#include "ble_evt_router.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+static ble_evt_router_handler_t m_handlers[BLE_EVT_ROUTER_MAX_HANDLERS];   /**< Registered handlers. */
+static uint8_t                  m_handler_count;                           /**< Number of registered handlers. */
+static uint8_t                  m_table[BLE_EVT_ROUTER_TABLE_SIZE];        /**< Handler bits per event ID. */
+static uint8_t                  m_all_mask;                                /**< Bits of all handlers. */
+
+
+uint32_t ble_evt_router_register(ble_evt_router_handler_t       handler,
+                                 const ble_evt_router_range_t * p_ranges,
+                                 uint8_t                        range_count)
+{
+    uint8_t  bit;
+    uint8_t  i;
+    uint16_t evt_id;
+
+    if ((handler == NULL) || (p_ranges == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (m_handler_count == BLE_EVT_ROUTER_MAX_HANDLERS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    for (i = 0; i < range_count; i++)
+    {
+        if ((p_ranges[i].first > p_ranges[i].last) ||
+            (p_ranges[i].last >= BLE_EVT_ROUTER_TABLE_SIZE))
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    bit = (uint8_t)(1 << m_handler_count);
+
+    for (i = 0; i < range_count; i++)
+    {
+        for (evt_id = p_ranges[i].first; evt_id <= p_ranges[i].last; evt_id++)
+        {
+            m_table[evt_id] |= bit;
+        }
+    }
+
+    m_handlers[m_handler_count++] = handler;
+    m_all_mask                   |= bit;
+
+    return NRF_SUCCESS;
+}
+
+
+void ble_evt_router_dispatch(ble_evt_t * p_ble_evt)
+{
+    uint16_t evt_id = p_ble_evt->header.evt_id;
+    uint8_t  mask;
+    uint8_t  i;
+
+    mask = (evt_id < BLE_EVT_ROUTER_TABLE_SIZE) ? m_table[evt_id] : m_all_mask;
+
+    for (i = 0; mask != 0; i++, mask >>= 1)
+    {
+        if (mask & 1)
+        {
+            m_handlers[i](p_ble_evt);
+        }
+    }
+}
+
+/** @}
+ *  @endcond
+ */
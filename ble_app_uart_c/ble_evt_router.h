@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup ble_evt_router BLE Event Router
+ * @{
+ * @brief    Passes each BLE stack event only to the modules that handle it.
+ *
+ * @details  Each handler is registered with the ranges of event IDs it handles. A table indexed by
+ *           event ID holds one bit per handler, so dispatching an event costs one table lookup
+ *           plus a call per interested handler. Handlers are called in registration order.
+ *           Events with IDs beyond the table are passed to every handler.
+ */
+
+#ifndef BLE_EVT_ROUTER_H__
+#define BLE_EVT_ROUTER_H__
+
+#include <stdint.h>
+#include "ble.h"
+#include "ble_ranges.h"
+
+#define BLE_EVT_ROUTER_MAX_HANDLERS   8                        /**< Maximum number of handlers, one bit each in the table. */
+#define BLE_EVT_ROUTER_TABLE_SIZE     (BLE_L2CAP_EVT_LAST + 1) /**< Number of event IDs in the table. */
+
+/**@brief BLE event handler type. */
+typedef void (* ble_evt_router_handler_t) (ble_evt_t * p_ble_evt);
+
+/**@brief Range of event IDs, both ends included. */
+typedef struct
+{
+    uint16_t first;                                            /**< First event ID. */
+    uint16_t last;                                             /**< Last event ID. */
+} ble_evt_router_range_t;
+
+/**@brief     Function for registering a handler.
+ *
+ * @param[in] handler     Handler.
+ * @param[in] p_ranges    Event ID ranges handled.
+ * @param[in] range_count Number of ranges.
+ *
+ * @retval    NRF_SUCCESS             If the handler was registered.
+ * @retval    NRF_ERROR_NO_MEM        If @ref BLE_EVT_ROUTER_MAX_HANDLERS are registered already.
+ * @retval    NRF_ERROR_INVALID_PARAM If a range is empty or beyond the table.
+ */
+uint32_t ble_evt_router_register(ble_evt_router_handler_t       handler,
+                                 const ble_evt_router_range_t * p_ranges,
+                                 uint8_t                        range_count);
+
+/**@brief     Function for passing a BLE stack event to the handlers registered for it.
+ *
+ * @param[in] p_ble_evt BLE stack event.
+ */
+void ble_evt_router_dispatch(ble_evt_t * p_ble_evt);
+
+#endif // BLE_EVT_ROUTER_H__
+
+/** @} */
@@ -21,15 +21,23 @@
 #include "nordic_common.h"
 #include "nrf_error.h"
 #include "ble_gattc.h"
+#include "ble_hci.h"
 #include "app_util.h"
 #include "app_trace.h"
+#include "app_timer.h"
+#include "buf_pool.h"
 
 #define LOG                    app_trace_log         /**< Debug logger macro that will be used in this file to do logging of important information over UART. */
 
 #define TX_BUFFER_MASK         0x07                  /**< TX Buffer mask, must be a mask of continuous zeroes, followed by continuous sequence of ones: 000...111. */
 #define TX_BUFFER_SIZE         (TX_BUFFER_MASK + 1)  /**< Size of send buffer, which is 1 higher than the mask. */
 
-#define WRITE_MESSAGE_LENGTH   20//BLE_CCCD_VALUE_LEN    /**< Length of the write message for CCCD. */
+#define WRITE_MESSAGE_LENGTH   2//BLE_CCCD_VALUE_LEN     /**< Length of the write message for CCCD. Data writes are held in a @ref buf_pool block. */
+
+#define RTC_COUNTER_MASK       0x00FFFFFF            /**< The app_timer tick counter wraps past this. */
+#define BUCKET_TICKS_MAX       (RTC_COUNTER_MASK / 2) /**< Longest a limited token bucket goes without a refill, well inside a wrap of the tick counter. */
+
+STATIC_ASSERT(BLE_NUS_MAX_DATA_LEN <= BUF_POOL_BLOCK_SIZE);
 
 typedef enum
 {
@@ -37,11 +45,30 @@ typedef enum
     WRITE_REQ  /**< Type identifying that this tx_message is a write request. */
 } tx_request_t;
 
+/**@brief Step of the NUS discovery.
+ */
+typedef enum
+{
+    DISC_IDLE,   /**< No discovery in progress. */
+    DISC_SRV,    /**< Looking up the NUS service by its UUID. */
+    DISC_CHARS,  /**< Reading the characteristics of the service. */
+    DISC_DESCS   /**< Reading the descriptors of the RX characteristic. */
+} disc_state_t;
+
+/**@brief Structure for a write request waiting for its response.
+ */
+typedef struct
+{
+    uint16_t conn_handle;  /**< Link of the request, BLE_CONN_HANDLE_INVALID for a free entry. */
+    uint32_t ticks;        /**< RTC counter when the request was accepted by the SoftDevice. */
+} att_pending_t;
+
 /**@brief Structure for writing a message to the peer, i.e. CCCD.
  */
 typedef struct
 {
-    uint8_t                  gattc_value[WRITE_MESSAGE_LENGTH];  /**< The message to write. */
+    uint8_t                  gattc_value[WRITE_MESSAGE_LENGTH];  /**< The message to write, if it is a CCCD value. */
+    uint8_t                * p_block;                            /**< Block holding the message to write, or NULL. */
     ble_gattc_write_params_t gattc_params;                       /**< GATTC parameters for this message. */
 } write_params_t;
 
@@ -59,82 +86,930 @@ typedef struct
 } tx_message_t;
 
 
-static ble_uart_c_t * mp_ble_uart_c;                 /**< Pointer to the current instance of the uart Client module. The memory for this provided by the application.*/
-static tx_message_t  m_tx_buffer[TX_BUFFER_SIZE];  /**< Transmit buffer for messages to be transmitted to the central. */
-static uint32_t      m_tx_insert_index = 0;        /**< Current index in the transmit buffer where the next message should be inserted. */
-static uint32_t      m_tx_index = 0;               /**< Current index in the transmit buffer from where the next message to be transmitted resides. */
-static  ble_uuid_t uart_uuid;
+static ble_uart_c_t * mp_ble_uart_c;                 /**< Pointer to the current instance of the uart Client module. The memory for this provided by the application.*/
+static tx_message_t  m_tx_buffer[TX_BUFFER_SIZE];  /**< Transmit buffer for messages to be transmitted to the central. */
+static uint32_t      m_tx_insert_index = 0;        /**< Current index in the transmit buffer where the next message should be inserted. */
+static uint32_t      m_tx_index = 0;               /**< Current index in the transmit buffer from where the next message to be transmitted resides. */
+#if BLE_UART_C_QOS_ENABLED
+static uint32_t      m_tick_hz;                    /**< app_timer tick rate, the scale of the token buckets. */
+#endif
+#if BLE_UART_C_WDT_ENABLED
+static uint32_t               m_prescaler;                              /**< RTC1 prescaler of the app_timer module. */
+static app_timer_id_t         m_retry_timer_id;                         /**< Timer trying the head of the queue again. */
+static bool                   m_retry_running;                          /**< m_retry_timer_id is started. */
+static uint32_t               m_retry_delay_ms;                         /**< Delay of the next retry. */
+static uint32_t               m_retry_waited_ms;                        /**< Time the head of the queue has been refused for. */
+static uint32_t               m_retry_err_code;                         /**< Error the head of the queue was last refused with. */
+static app_timer_id_t         m_att_timer_id;                           /**< Timer checking for requests left without a response. */
+static bool                   m_att_running;                            /**< m_att_timer_id is started. */
+static att_pending_t          m_att_pending[BLE_UART_C_WDT_LINKS];      /**< Requests waiting for a response. */
+static ble_uart_c_wdt_stats_t m_wdt_stats;                              /**< Watchdog counters. */
+#endif
+static  ble_uuid_t uart_uuid;
+
+/**@brief Function for reserving the next free message in the transmit buffer.
+ *
+ * @return Pointer to the message, or NULL if the buffer is full.
+ */
+static tx_message_t * tx_buffer_alloc(void)
+{
+    tx_message_t * p_msg;
+
+    if (((m_tx_insert_index + 1) & TX_BUFFER_MASK) == m_tx_index)
+    {
+        return NULL;
+    }
+
+    p_msg              = &m_tx_buffer[m_tx_insert_index++];
+    m_tx_insert_index &= TX_BUFFER_MASK;
+
+    return p_msg;
+}
+
+
+/**@brief Function for releasing the head of the transmit buffer, once sent or dropped.
+ */
+static void tx_buffer_pop(void)
+{
+    tx_message_t * p_msg = &m_tx_buffer[m_tx_index];
+
+    if ((p_msg->type == WRITE_REQ) && (p_msg->req.write_req.p_block != NULL))
+    {
+        buf_pool_free(BUF_POOL_USER_NUS_TX, p_msg->req.write_req.p_block);
+        p_msg->req.write_req.p_block = NULL;
+    }
+    m_tx_index++;
+    m_tx_index &= TX_BUFFER_MASK;
+}
+
+
+#if BLE_UART_C_QOS_ENABLED
+/**@brief Function for setting the rate of a token bucket, and filling it.
+ */
+static void bucket_set(ble_uart_c_bucket_t * p_bucket, uint32_t rate, uint16_t burst)
+{
+    p_bucket->rate   = rate;
+    p_bucket->depth  = burst * m_tick_hz;
+    p_bucket->tokens = p_bucket->depth;
+    UNUSED_VARIABLE(app_timer_cnt_get(&p_bucket->ticks));
+}
+
+
+/**@brief Function for refilling a token bucket for the time since its last refill.
+ *
+ * @details The elapsed time is read from the RTC counter, which wraps after RTC_COUNTER_MASK
+ *          ticks; rx_timer_id refills limited buckets at least every BUCKET_TICKS_MAX ticks, so
+ *          no wrap goes unseen. It is clamped to the time that fills the bucket.
+ */
+static void bucket_refill(ble_uart_c_bucket_t * p_bucket)
+{
+    uint32_t now;
+    uint32_t elapsed;
+    uint32_t fill;
+
+    if (p_bucket->rate == 0)
+    {
+        return;
+    }
+
+    UNUSED_VARIABLE(app_timer_cnt_get(&now));
+    UNUSED_VARIABLE(app_timer_cnt_diff_compute(now, p_bucket->ticks, &elapsed));
+    p_bucket->ticks  = now;
+    fill             = (p_bucket->depth - p_bucket->tokens) / p_bucket->rate + 1;
+    elapsed          = MIN(elapsed, fill);
+    p_bucket->tokens = (uint32_t)MIN((uint64_t)p_bucket->tokens + (uint64_t)elapsed * p_bucket->rate,
+                                     p_bucket->depth);
+}
+
+
+/**@brief Function for charging data to a token bucket according to its class.
+ *
+ * @param[in,out] p_overshoot Incremented by the bytes of control data beyond the budget.
+ *
+ * @return Ticks until the data would pass, 0 if it has been charged.
+ */
+static uint32_t bucket_take(ble_uart_c_bucket_t * p_bucket,
+                            uint16_t              len,
+                            ble_uart_c_qos_t      qos,
+                            uint32_t            * p_overshoot)
+{
+    uint32_t need;
+    uint32_t reserve;
+
+    if (p_bucket->rate == 0)
+    {
+        return 0;
+    }
+
+    bucket_refill(p_bucket);
+    need    = len * m_tick_hz;
+    reserve = (qos == BLE_UART_C_QOS_BULK) ? (p_bucket->depth / 2) : 0;
+
+    if (p_bucket->tokens >= (need + reserve))
+    {
+        p_bucket->tokens -= need;
+        return 0;
+    }
+    if (qos == BLE_UART_C_QOS_CONTROL)
+    {
+        *p_overshoot     += (need - p_bucket->tokens) / m_tick_hz;
+        p_bucket->tokens  = 0;
+        return 0;
+    }
+    return (need + reserve - p_bucket->tokens) / p_bucket->rate + 1;
+}
+
+
+/**@brief Function for giving back the budget of a write the SoftDevice did not take.
+ */
+static void bucket_refund(ble_uart_c_bucket_t * p_bucket, uint16_t len)
+{
+    if (p_bucket->rate != 0)
+    {
+        p_bucket->tokens = MIN(p_bucket->tokens + len * m_tick_hz, p_bucket->depth);
+    }
+}
+
+
+/**@brief Function for reporting that a write refused for the rate limit would now fit.
+ */
+static void retry_timeout_handler(void * p_context)
+{
+    ble_uart_c_t   * p_ble_uart_c = (ble_uart_c_t *)p_context;
+    ble_uart_c_evt_t ble_uart_c_evt;
+
+    p_ble_uart_c->tx_retry = false;
+    if (p_ble_uart_c->conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        ble_uart_c_evt.evt_type = BLE_UART_C_EVT_TX_COMPLETE;
+        p_ble_uart_c->evt_handler(p_ble_uart_c, &ble_uart_c_evt);
+    }
+}
+#endif
+
+
+/**@brief Function for passing a notification of the peer on to the application.
+ */
+static void rx_deliver(ble_uart_c_t * p_ble_uart_c, const ble_uart_t * p_data)
+{
+    ble_uart_c_evt_t ble_uart_c_evt;
+
+    ble_uart_c_evt.evt_type    = BLE_UART_C_EVT_RX_DATA_NOTIFICATION;
+    ble_uart_c_evt.params.uart = *p_data;
+    p_ble_uart_c->evt_handler(p_ble_uart_c, &ble_uart_c_evt);
+}
+
+
+#if BLE_UART_C_QOS_ENABLED
+/**@brief Function for taking the oldest held notification out of the hold queue.
+ */
+static void rx_held_pop(ble_uart_c_t * p_ble_uart_c, ble_uart_t * p_data)
+{
+    *p_data = p_ble_uart_c->rx_held[p_ble_uart_c->rx_held_first];
+    p_ble_uart_c->rx_held_first = (p_ble_uart_c->rx_held_first + 1) % BLE_UART_C_QOS_RX_HOLD;
+    p_ble_uart_c->rx_held_count--;
+}
+
+
+/**@brief Function for passing every held notification on, beyond the budget.
+ */
+static void rx_held_flush(ble_uart_c_t * p_ble_uart_c)
+{
+    ble_uart_t data;
+
+    while (p_ble_uart_c->rx_held_count != 0)
+    {
+        rx_held_pop(p_ble_uart_c, &data);
+        p_ble_uart_c->qos_stats.rx_overshoot += data.len;
+        rx_deliver(p_ble_uart_c, &data);
+    }
+}
+
+
+/**@brief Function for passing held notifications on while the budget covers them.
+ *
+ * @return Ticks until the next one would pass, 0 if none are left.
+ */
+static uint32_t rx_held_release(ble_uart_c_t * p_ble_uart_c)
+{
+    ble_uart_t data;
+    uint32_t   wait;
+
+    while (p_ble_uart_c->rx_held_count != 0)
+    {
+        wait = bucket_take(&p_ble_uart_c->rx_bucket,
+                           p_ble_uart_c->rx_held[p_ble_uart_c->rx_held_first].len,
+                           (ble_uart_c_qos_t)p_ble_uart_c->rx_qos,
+                           &p_ble_uart_c->qos_stats.rx_overshoot);
+        if (wait != 0)
+        {
+            return wait;
+        }
+        rx_held_pop(p_ble_uart_c, &data);
+        rx_deliver(p_ble_uart_c, &data);
+    }
+    return 0;
+}
+
+
+/**@brief Function for starting rx_timer_id: after the given ticks while notifications are held,
+ *        otherwise after BUCKET_TICKS_MAX while a rate is limited, to refill the budgets before
+ *        the tick counter wraps.
+ *
+ * @details If the timer cannot be started, held notifications are passed on at once, beyond the
+ *          budget, rather than waiting for a timer that does not come.
+ */
+static void rx_timer_update(ble_uart_c_t * p_ble_uart_c, uint32_t wait)
+{
+    uint32_t err_code;
+
+    if (wait != 0)
+    {
+        if (p_ble_uart_c->rx_releasing)
+        {
+            return;
+        }
+    }
+    else if (p_ble_uart_c->rx_timer_running ||
+             ((p_ble_uart_c->tx_bucket.rate == 0) && (p_ble_uart_c->rx_bucket.rate == 0)))
+    {
+        return;
+    }
+
+    if (p_ble_uart_c->rx_timer_running)
+    {
+        UNUSED_VARIABLE(app_timer_stop(p_ble_uart_c->rx_timer_id));
+    }
+    err_code = app_timer_start(p_ble_uart_c->rx_timer_id,
+                               MAX(MIN(((wait != 0) ? wait : BUCKET_TICKS_MAX), BUCKET_TICKS_MAX),
+                                   APP_TIMER_MIN_TIMEOUT_TICKS),
+                               p_ble_uart_c);
+    p_ble_uart_c->rx_timer_running = (err_code == NRF_SUCCESS);
+    p_ble_uart_c->rx_releasing     = (err_code == NRF_SUCCESS) && (wait != 0);
+    if (err_code != NRF_SUCCESS)
+    {
+        rx_held_flush(p_ble_uart_c);
+    }
+}
+
+
+/**@brief Function for passing held notifications on as the budget refills, and refilling the
+ *        budgets before the tick counter wraps.
+ */
+static void rx_timeout_handler(void * p_context)
+{
+    ble_uart_c_t * p_ble_uart_c = (ble_uart_c_t *)p_context;
+
+    p_ble_uart_c->rx_timer_running = false;
+    p_ble_uart_c->rx_releasing     = false;
+    bucket_refill(&p_ble_uart_c->tx_bucket);
+    bucket_refill(&p_ble_uart_c->rx_bucket);
+    rx_timer_update(p_ble_uart_c, rx_held_release(p_ble_uart_c));
+}
+
+
+/**@brief Function for charging a notification to the budget of its link, holding it back, in
+ *        order, while the budget does not cover it.
+ */
+static void rx_admit(ble_uart_c_t * p_ble_uart_c, const ble_uart_t * p_data)
+{
+    ble_uart_t oldest;
+    uint32_t   wait = 0;
+
+    if (p_ble_uart_c->rx_held_count == 0)
+    {
+        wait = bucket_take(&p_ble_uart_c->rx_bucket,
+                           p_data->len,
+                           (ble_uart_c_qos_t)p_ble_uart_c->rx_qos,
+                           &p_ble_uart_c->qos_stats.rx_overshoot);
+        if (wait == 0)
+        {
+            rx_deliver(p_ble_uart_c, p_data);
+            return;
+        }
+    }
+
+    if (p_ble_uart_c->rx_held_count == BLE_UART_C_QOS_RX_HOLD)
+    {
+        if (p_ble_uart_c->rx_drop)
+        {
+            p_ble_uart_c->qos_stats.rx_dropped++;
+            return;
+        }
+        rx_held_pop(p_ble_uart_c, &oldest);
+        p_ble_uart_c->qos_stats.rx_overshoot += oldest.len;
+        rx_deliver(p_ble_uart_c, &oldest);
+    }
+    p_ble_uart_c->rx_held[(p_ble_uart_c->rx_held_first + p_ble_uart_c->rx_held_count) %
+                          BLE_UART_C_QOS_RX_HOLD] = *p_data;
+    p_ble_uart_c->rx_held_count++;
+    p_ble_uart_c->qos_stats.rx_held++;
+    if (wait != 0)
+    {
+        rx_timer_update(p_ble_uart_c, wait);
+    }
+}
+#endif
+
+
+/**@brief Function for charging a write to the budget of its link.
+ *
+ * @retval NRF_SUCCESS    If the write may be sent.
+ * @retval NRF_ERROR_BUSY If the write must wait, @ref BLE_UART_C_EVT_TX_COMPLETE follows when it fits.
+ */
+static uint32_t tx_admit(ble_uart_c_t * p_ble_uart_c, uint16_t len, ble_uart_c_qos_t qos)
+{
+#if BLE_UART_C_QOS_ENABLED
+    uint32_t wait = bucket_take(&p_ble_uart_c->tx_bucket, len, qos,
+                                &p_ble_uart_c->qos_stats.tx_overshoot);
+
+    if (wait == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    p_ble_uart_c->qos_stats.tx_limited++;
+    if (!p_ble_uart_c->tx_retry &&
+        (app_timer_start(p_ble_uart_c->retry_timer_id,
+                         MAX(wait, APP_TIMER_MIN_TIMEOUT_TICKS),
+                         p_ble_uart_c) == NRF_SUCCESS))
+    {
+        p_ble_uart_c->tx_retry = true;
+    }
+    return NRF_ERROR_BUSY;
+#else
+    UNUSED_PARAMETER(p_ble_uart_c);
+    UNUSED_PARAMETER(len);
+    UNUSED_PARAMETER(qos);
+    return NRF_SUCCESS;
+#endif
+}
+
+
+/**@brief Function for getting the number of free messages in the transmit buffer.
+ */
+static uint32_t tx_buffer_free_count(void)
+{
+    return (m_tx_index - m_tx_insert_index - 1) & TX_BUFFER_MASK;
+}
+
+
+/**@brief Function for dropping pending messages to a connection that has been lost.
+ */
+static void tx_buffer_conn_flush(uint16_t conn_handle)
+{
+    uint32_t i;
+
+    for (i = m_tx_index; i != m_tx_insert_index; i = (i + 1) & TX_BUFFER_MASK)
+    {
+        if (m_tx_buffer[i].conn_handle == conn_handle)
+        {
+            m_tx_buffer[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+        }
+    }
+}
+
+
+#if BLE_UART_C_WDT_ENABLED
+static att_pending_t * att_pending_find(uint16_t conn_handle)
+{
+    uint32_t i;
+
+    for (i = 0; i < BLE_UART_C_WDT_LINKS; i++)
+    {
+        if (m_att_pending[i].conn_handle == conn_handle)
+        {
+            return &m_att_pending[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief Function for watching a request the SoftDevice has accepted until its response comes.
+ */
+static void att_pending_add(uint16_t conn_handle)
+{
+    att_pending_t * p_entry = att_pending_find(conn_handle);
+
+    if (p_entry == NULL)
+    {
+        p_entry = att_pending_find(BLE_CONN_HANDLE_INVALID);
+    }
+    if (p_entry == NULL)
+    {
+        // More links than entries. The SoftDevice timeout still applies.
+        return;
+    }
+
+    p_entry->conn_handle = conn_handle;
+    UNUSED_VARIABLE(app_timer_cnt_get(&p_entry->ticks));
+    if (!m_att_running &&
+        (app_timer_start(m_att_timer_id,
+                         APP_TIMER_TICKS(BLE_UART_C_WDT_ATT_TIMEOUT_MS, m_prescaler),
+                         NULL) == NRF_SUCCESS))
+    {
+        m_att_running = true;
+    }
+}
+
+
+static void att_pending_remove(uint16_t conn_handle)
+{
+    att_pending_t * p_entry = att_pending_find(conn_handle);
+
+    if (p_entry != NULL)
+    {
+        p_entry->conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
+}
+
+
+/**@brief Function for reporting a request dropped by the watchdog to the application.
+ */
+static void tx_error_send(ble_uart_c_evt_type_t evt_type, uint16_t conn_handle, uint32_t err_code)
+{
+    ble_uart_c_evt_t ble_uart_c_evt;
+
+    if (mp_ble_uart_c == NULL)
+    {
+        return;
+    }
+
+    ble_uart_c_evt.evt_type                    = evt_type;
+    ble_uart_c_evt.params.tx_error.conn_handle = conn_handle;
+    ble_uart_c_evt.params.tx_error.err_code    = err_code;
+    mp_ble_uart_c->evt_handler(mp_ble_uart_c, &ble_uart_c_evt);
+}
+
+
+/**@brief Function for giving up on a link whose request got no response.
+ *
+ * @details The link cannot be used for requests any more, so it is disconnected. Its queued
+ *          messages are dropped once the disconnection is reported.
+ */
+static void att_give_up(uint16_t conn_handle)
+{
+    att_pending_remove(conn_handle);
+    m_wdt_stats.stalls++;
+    LOG("[uart_C]: No response from the peer, disconnecting. Connection Handle = %d\r\n", conn_handle);
+
+    UNUSED_VARIABLE(sd_ble_gap_disconnect(conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION));
+    tx_error_send(BLE_UART_C_EVT_ATT_TIMEOUT, conn_handle, NRF_ERROR_TIMEOUT);
+}
+
+
+static void att_timeout_handler(void * p_context)
+{
+    uint32_t timeout = APP_TIMER_TICKS(BLE_UART_C_WDT_ATT_TIMEOUT_MS, m_prescaler);
+    uint32_t next    = timeout;
+    uint32_t now;
+    uint32_t elapsed;
+    uint32_t i;
+    bool     pending = false;
+
+    UNUSED_PARAMETER(p_context);
+
+    m_att_running = false;
+    UNUSED_VARIABLE(app_timer_cnt_get(&now));
+    for (i = 0; i < BLE_UART_C_WDT_LINKS; i++)
+    {
+        if (m_att_pending[i].conn_handle == BLE_CONN_HANDLE_INVALID)
+        {
+            continue;
+        }
+        UNUSED_VARIABLE(app_timer_cnt_diff_compute(now, m_att_pending[i].ticks, &elapsed));
+        if (elapsed >= timeout)
+        {
+            att_give_up(m_att_pending[i].conn_handle);
+        }
+        else
+        {
+            next    = MIN(next, timeout - elapsed);
+            pending = true;
+        }
+    }
+
+    if (pending &&
+        (app_timer_start(m_att_timer_id, MAX(next, APP_TIMER_MIN_TIMEOUT_TICKS), NULL) == NRF_SUCCESS))
+    {
+        m_att_running = true;
+    }
+}
+
+
+/**@brief Function for scheduling another try of the head of the queue, which was refused.
+ *
+ * @details A request refused because its link still waits for a response is tried again on
+ *          that response. Otherwise nothing would try it again, so the retry timer is started.
+ */
+static void tx_retry_schedule(uint32_t err_code)
+{
+    uint16_t conn_handle = m_tx_buffer[m_tx_index].conn_handle;
+
+    if (m_retry_running ||
+        ((err_code == NRF_ERROR_BUSY) && (att_pending_find(conn_handle) != NULL)))
+    {
+        return;
+    }
+
+    m_retry_err_code = err_code;
+    if (app_timer_start(m_retry_timer_id,
+                        APP_TIMER_TICKS(m_retry_delay_ms, m_prescaler),
+                        NULL) == NRF_SUCCESS)
+    {
+        m_retry_running = true;
+    }
+}
+
+
+/**@brief Function for ending the backoff once the head of the queue has been accepted.
+ */
+static void tx_retry_reset(void)
+{
+    if (m_retry_running)
+    {
+        UNUSED_VARIABLE(app_timer_stop(m_retry_timer_id));
+        m_retry_running = false;
+    }
+    m_retry_delay_ms  = BLE_UART_C_WDT_RETRY_MS;
+    m_retry_waited_ms = 0;
+}
+#endif
+
+
+/**@brief Function for passing any pending request from the buffer to the stack.
+ */
+static void tx_buffer_process(void)
+{
+    // Skip messages to connections that have been lost.
+    while ((m_tx_index != m_tx_insert_index) &&
+           (m_tx_buffer[m_tx_index].conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        tx_buffer_pop();
+    }
+
+    if (m_tx_index != m_tx_insert_index)
+    {
+        uint32_t err_code;
+
+        if (m_tx_buffer[m_tx_index].type == READ_REQ)
+        {
+            err_code = sd_ble_gattc_read(m_tx_buffer[m_tx_index].conn_handle,
+                                         m_tx_buffer[m_tx_index].req.read_handle,
+                                         0);
+        }
+        else
+        {
+            err_code = sd_ble_gattc_write(m_tx_buffer[m_tx_index].conn_handle,
+                                          &m_tx_buffer[m_tx_index].req.write_req.gattc_params);
+        }
+        if (err_code == NRF_SUCCESS)
+        {
+            LOG("[uart_C]: SD Read/Write API returns Success..\r\n");
+#if BLE_UART_C_WDT_ENABLED
+            att_pending_add(m_tx_buffer[m_tx_index].conn_handle);
+            tx_retry_reset();
+#endif
+            tx_buffer_pop();
+        }
+        else
+        {
+            LOG("[uart_C]: SD Read/Write API returns error. This message sending will be "
+                "attempted again..\r\n");
+#if BLE_UART_C_WDT_ENABLED
+            tx_retry_schedule(err_code);
+#endif
+        }
+    }
+}
+
+
+#if BLE_UART_C_WDT_ENABLED
+/**@brief Function for trying the head of the queue again, or dropping it once it has been
+ *        refused for @ref BLE_UART_C_WDT_GIVE_UP_MS.
+ */
+static void tx_retry_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    m_retry_running    = false;
+    m_retry_waited_ms += m_retry_delay_ms;
+    m_retry_delay_ms   = MIN(m_retry_delay_ms * 2, BLE_UART_C_WDT_RETRY_MAX_MS);
+
+    if ((m_retry_waited_ms >= BLE_UART_C_WDT_GIVE_UP_MS) && (m_tx_index != m_tx_insert_index))
+    {
+        tx_message_t * p_msg       = &m_tx_buffer[m_tx_index];
+        uint16_t       conn_handle = p_msg->conn_handle;
+        uint32_t       err_code    = m_retry_err_code;
+
+        tx_buffer_pop();
+        m_wdt_stats.dropped++;
+        m_retry_delay_ms  = BLE_UART_C_WDT_RETRY_MS;
+        m_retry_waited_ms = 0;
+
+        tx_buffer_process();
+        tx_error_send(BLE_UART_C_EVT_TX_ERROR, conn_handle, err_code);
+        return;
+    }
+
+    m_wdt_stats.retries++;
+    tx_buffer_process();
+}
+#endif
+
+
+/**@brief     Function for handling write response events.
+ *
+ * @param[in] p_ble_uart_c Pointer to the UART Client structure.
+ * @param[in] p_ble_evt   Pointer to the BLE event received.
+ */
+static void on_write_rsp(ble_uart_c_t * p_ble_uart_c, const ble_evt_t * p_ble_evt)
+{
+    ble_uart_c_evt_t ble_uart_c_evt;
+
+#if BLE_UART_C_WDT_ENABLED
+    att_pending_remove(p_ble_evt->evt.gattc_evt.conn_handle);
+#endif
+
+    // Check if there is any message to be sent across to the peer and send it.
+    tx_buffer_process();
+
+    if (p_ble_evt->evt.gattc_evt.conn_handle != p_ble_uart_c->conn_handle)
+    {
+        return;
+    }
+
+    if ((p_ble_evt->evt.gattc_evt.params.write_rsp.handle == p_ble_uart_c->RX_cccd_handle) &&
+        (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_SUCCESS))
+    {
+        ble_uart_c_evt.evt_type = BLE_UART_C_EVT_RX_NOTIF_ENABLED;
+        p_ble_uart_c->evt_handler(p_ble_uart_c, &ble_uart_c_evt);
+    }
+
+    ble_uart_c_evt.evt_type = BLE_UART_C_EVT_TX_COMPLETE;
+    p_ble_uart_c->evt_handler(p_ble_uart_c, &ble_uart_c_evt);
+}
+
+
+/**@brief     Function for handling TX complete events.
+ *
+ * @details   Write Commands are released from the SoftDevice TX buffers in bulk. Let the
+ *            application know so that it can push more data.
+ *
+ * @param[in] p_ble_uart_c Pointer to the UART Client structure.
+ * @param[in] p_ble_evt   Pointer to the BLE event received.
+ */
+static void on_tx_complete(ble_uart_c_t * p_ble_uart_c, const ble_evt_t * p_ble_evt)
+{
+    if (p_ble_evt->evt.common_evt.conn_handle == p_ble_uart_c->conn_handle)
+    {
+        ble_uart_c_evt_t ble_uart_c_evt;
+
+        ble_uart_c_evt.evt_type = BLE_UART_C_EVT_TX_COMPLETE;
+        p_ble_uart_c->evt_handler(p_ble_uart_c, &ble_uart_c_evt);
+    }
+}
+
+
+/**@brief     Function for handling Handle Value Notification received from the SoftDevice.
+ *
+ * @details   This function will uses the Handle Value Notification received from the SoftDevice
+ *            and checks if it is a notification of the NUS RX data from the peer. If it is,
+ *            this function will send the RX data to the application.
+ *
+ * @param[in] p_ble_uart_c Pointer to the NUS Client structure.
+ * @param[in] p_ble_evt   Pointer to the BLE event received.
+ */
+static void on_hvx(ble_uart_c_t * p_ble_uart_c, const ble_evt_t * p_ble_evt)
+{
+    // Check if this is an RX data notification.
+    if (p_ble_evt->evt.gattc_evt.params.hvx.handle == p_ble_uart_c->RX_handle)
+    {
+        ble_uart_t data;
+
+        data.len = (uint8_t)MIN(p_ble_evt->evt.gattc_evt.params.hvx.len, sizeof(data.rx_data));
+        memcpy(data.rx_data, p_ble_evt->evt.gattc_evt.params.hvx.data, data.len);
+
+#if BLE_UART_C_QOS_ENABLED
+        rx_admit(p_ble_uart_c, &data);
+#else
+        rx_deliver(p_ble_uart_c, &data);
+#endif
+    }
+}
+
+
+#if BLE_UART_C_FAST_DISC_ENABLED
+/**@brief Function for ending the NUS discovery and reporting whether it found what the client
+ *        needs.
+ */
+static void disc_complete(ble_uart_c_t * p_ble_uart_c)
+{
+    ble_uart_c_evt_t evt;
+
+    p_ble_uart_c->disc_state = DISC_IDLE;
+
+    if ((p_ble_uart_c->RX_handle == BLE_GATT_HANDLE_INVALID) ||
+        (p_ble_uart_c->TX_handle == BLE_GATT_HANDLE_INVALID) ||
+        (p_ble_uart_c->RX_cccd_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        LOG("[uart_C]: Nordic UART service (NUS) incomplete or not found at peer.\r\n");
+        evt.evt_type = BLE_UART_C_EVT_DISCOVERY_FAILED;
+    }
+    else
+    {
+        LOG("[uart_C]: Nordic UART service (NUS) discovered at peer.\r\n");
+        evt.evt_type = BLE_UART_C_EVT_DISCOVERY_COMPLETE;
+    }
+    p_ble_uart_c->evt_handler(p_ble_uart_c, &evt);
+}
+
+
+/**@brief Function for reading the descriptors following the RX characteristic.
+ */
+static void disc_descs_start(ble_uart_c_t * p_ble_uart_c)
+{
+    p_ble_uart_c->disc_range.start_handle = p_ble_uart_c->RX_handle + 1;
+    p_ble_uart_c->disc_range.end_handle   = p_ble_uart_c->rx_desc_end;
+
+    if ((p_ble_uart_c->RX_handle == BLE_GATT_HANDLE_INVALID) ||
+        (p_ble_uart_c->disc_range.start_handle > p_ble_uart_c->disc_range.end_handle))
+    {
+        disc_complete(p_ble_uart_c);
+        return;
+    }
+
+    p_ble_uart_c->disc_state = DISC_DESCS;
+    if (sd_ble_gattc_descriptors_discover(p_ble_uart_c->conn_handle,
+                                          &p_ble_uart_c->disc_range) != NRF_SUCCESS)
+    {
+        disc_complete(p_ble_uart_c);
+    }
+}
+
+
+static void on_srv_disc_rsp(ble_uart_c_t * p_ble_uart_c, const ble_gattc_evt_t * p_gattc_evt)
+{
+    if ((p_gattc_evt->gatt_status != BLE_GATT_STATUS_SUCCESS) ||
+        (p_gattc_evt->params.prim_srvc_disc_rsp.count == 0))
+    {
+        disc_complete(p_ble_uart_c);
+        return;
+    }
+
+    p_ble_uart_c->disc_range  = p_gattc_evt->params.prim_srvc_disc_rsp.services[0].handle_range;
+    p_ble_uart_c->rx_desc_end = p_ble_uart_c->disc_range.end_handle;
+    p_ble_uart_c->disc_state  = DISC_CHARS;
+    if (sd_ble_gattc_characteristics_discover(p_ble_uart_c->conn_handle,
+                                              &p_ble_uart_c->disc_range) != NRF_SUCCESS)
+    {
+        disc_complete(p_ble_uart_c);
+    }
+}
+
 
-/**@brief Function for passing any pending request from the buffer to the stack.
- */
-static void tx_buffer_process(void)
+static void on_char_disc_rsp(ble_uart_c_t * p_ble_uart_c, const ble_gattc_evt_t * p_gattc_evt)
 {
-    if (m_tx_index != m_tx_insert_index)
+    const ble_gattc_char_t * p_chars = p_gattc_evt->params.char_disc_rsp.chars;
+    uint16_t                 count   = p_gattc_evt->params.char_disc_rsp.count;
+    uint16_t                 i;
+
+    if ((p_gattc_evt->gatt_status != BLE_GATT_STATUS_SUCCESS) || (count == 0))
     {
-        uint32_t err_code;
+        // No more characteristics in the service.
+        disc_descs_start(p_ble_uart_c);
+        return;
+    }
 
-        if (m_tx_buffer[m_tx_index].type == READ_REQ)
-        {
-            err_code = sd_ble_gattc_read(m_tx_buffer[m_tx_index].conn_handle,
-                                         m_tx_buffer[m_tx_index].req.read_handle,
-                                         0);
-        }
-        else
+    for (i = 0; i < count; i++)
+    {
+        if (p_chars[i].uuid.type == uart_uuid.type)
         {
-            err_code = sd_ble_gattc_write(m_tx_buffer[m_tx_index].conn_handle,
-                                          &m_tx_buffer[m_tx_index].req.write_req.gattc_params);
+            if (p_chars[i].uuid.uuid == BLE_UUID_NUS_RX_CHARACTERISTIC)
+            {
+                p_ble_uart_c->RX_handle = p_chars[i].handle_value;
+            }
+            else if (p_chars[i].uuid.uuid == BLE_UUID_NUS_TX_CHARACTERISTIC)
+            {
+                p_ble_uart_c->TX_handle = p_chars[i].handle_value;
+            }
         }
-        if (err_code == NRF_SUCCESS)
+        // The descriptors of RX end before the next characteristic.
+        if ((p_ble_uart_c->RX_handle != BLE_GATT_HANDLE_INVALID) &&
+            (p_chars[i].handle_decl > p_ble_uart_c->RX_handle) &&
+            (p_chars[i].handle_decl <= p_ble_uart_c->rx_desc_end))
         {
-            LOG("[uart_C]: SD Read/Write API returns Success..\r\n");
-            m_tx_index++;
-            m_tx_index &= TX_BUFFER_MASK;
+            p_ble_uart_c->rx_desc_end = p_chars[i].handle_decl - 1;
         }
-        else
+    }
+
+    p_ble_uart_c->disc_range.start_handle = p_chars[count - 1].handle_value + 1;
+    if ((p_ble_uart_c->RX_handle != BLE_GATT_HANDLE_INVALID) &&
+        (p_ble_uart_c->TX_handle != BLE_GATT_HANDLE_INVALID))
+    {
+        disc_descs_start(p_ble_uart_c);
+    }
+    else if ((p_ble_uart_c->disc_range.start_handle <= p_ble_uart_c->disc_range.end_handle) &&
+             (p_ble_uart_c->disc_range.start_handle != 0))
+    {
+        if (sd_ble_gattc_characteristics_discover(p_ble_uart_c->conn_handle,
+                                                  &p_ble_uart_c->disc_range) != NRF_SUCCESS)
         {
-            LOG("[uart_C]: SD Read/Write API returns error. This message sending will be "
-                "attempted again..\r\n");
+            disc_complete(p_ble_uart_c);
         }
     }
+    else
+    {
+        disc_descs_start(p_ble_uart_c);
+    }
 }
 
 
-/**@brief     Function for handling write response events.
- *
- * @param[in] p_ble_uart_c Pointer to the UART Client structure.
- * @param[in] p_ble_evt   Pointer to the BLE event received.
- */
-static void on_write_rsp(ble_uart_c_t * p_ble_uart_c, const ble_evt_t * p_ble_evt)
+static void on_desc_disc_rsp(ble_uart_c_t * p_ble_uart_c, const ble_gattc_evt_t * p_gattc_evt)
 {
-    // Check if there is any message to be sent across to the peer and send it.
-    tx_buffer_process();
+    const ble_gattc_desc_t * p_descs = p_gattc_evt->params.desc_disc_rsp.descs;
+    uint16_t                 count   = p_gattc_evt->params.desc_disc_rsp.count;
+    uint16_t                 i;
+
+    if ((p_gattc_evt->gatt_status != BLE_GATT_STATUS_SUCCESS) || (count == 0))
+    {
+        disc_complete(p_ble_uart_c);
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (p_descs[i].uuid.type != BLE_UUID_TYPE_BLE)
+        {
+            continue;
+        }
+        if (p_descs[i].uuid.uuid == BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)
+        {
+            p_ble_uart_c->RX_cccd_handle = p_descs[i].handle;
+            disc_complete(p_ble_uart_c);
+            return;
+        }
+        if ((p_descs[i].uuid.uuid == BLE_UUID_CHARACTERISTIC) ||
+            (p_descs[i].uuid.uuid == BLE_UUID_SERVICE_PRIMARY) ||
+            (p_descs[i].uuid.uuid == BLE_UUID_SERVICE_SECONDARY))
+        {
+            // Past the descriptors of RX.
+            disc_complete(p_ble_uart_c);
+            return;
+        }
+    }
+
+    p_ble_uart_c->disc_range.start_handle = p_descs[count - 1].handle + 1;
+    if ((p_ble_uart_c->disc_range.start_handle > p_ble_uart_c->disc_range.end_handle) ||
+        (p_ble_uart_c->disc_range.start_handle == 0) ||
+        (sd_ble_gattc_descriptors_discover(p_ble_uart_c->conn_handle,
+                                           &p_ble_uart_c->disc_range) != NRF_SUCCESS))
+    {
+        disc_complete(p_ble_uart_c);
+    }
 }
 
 
-/**@brief     Function for handling Handle Value Notification received from the SoftDevice.
- *
- * @details   This function will uses the Handle Value Notification received from the SoftDevice
- *            and checks if it is a notification of the NUS RX data from the peer. If it is,
- *            this function will send the RX data to the application.
- *
- * @param[in] p_ble_uart_c Pointer to the NUS Client structure.
- * @param[in] p_ble_evt   Pointer to the BLE event received.
+/**@brief Function for passing a GATTC discovery response to the step waiting for it.
  */
-static void on_hvx(ble_uart_c_t * p_ble_uart_c, const ble_evt_t * p_ble_evt)
+static void on_disc_rsp(ble_uart_c_t * p_ble_uart_c, const ble_evt_t * p_ble_evt)
 {
-    // Check if this is an RX data notification.
-    if (p_ble_evt->evt.gattc_evt.params.hvx.handle == p_ble_uart_c->RX_handle)
-    {
-        ble_uart_c_evt_t ble_uart_c_evt;
+    const ble_gattc_evt_t * p_gattc_evt = &p_ble_evt->evt.gattc_evt;
 
-        ble_uart_c_evt.evt_type = BLE_UART_C_EVT_RX_DATA_NOTIFICATION;
-				memcpy(ble_uart_c_evt.params.uart.rx_data,p_ble_evt->evt.gattc_evt.params.hvx.data,p_ble_evt->evt.gattc_evt.params.hvx.len);
-				ble_uart_c_evt.params.uart.len = p_ble_evt->evt.gattc_evt.params.hvx.len;
-        p_ble_uart_c->evt_handler(p_ble_uart_c, &ble_uart_c_evt);
+    if (p_gattc_evt->conn_handle != p_ble_uart_c->conn_handle)
+    {
+        return;
     }
-}
 
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+            if (p_ble_uart_c->disc_state == DISC_SRV)
+            {
+                on_srv_disc_rsp(p_ble_uart_c, p_gattc_evt);
+            }
+            break;
+
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+            if (p_ble_uart_c->disc_state == DISC_CHARS)
+            {
+                on_char_disc_rsp(p_ble_uart_c, p_gattc_evt);
+            }
+            break;
+
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+            if (p_ble_uart_c->disc_state == DISC_DESCS)
+            {
+                on_desc_disc_rsp(p_ble_uart_c, p_gattc_evt);
+            }
+            break;
 
+        default:
+            break;
+    }
+}
+#else
 /**@brief     Function for handling events from the database discovery module.
  *
  * @details   This function will handle an event from the database discovery module, and determine
@@ -153,7 +1028,10 @@ static void db_discover_evt_handler(ble_db_discovery_evt_t * p_evt)
         p_evt->params.discovered_db.srv_uuid.uuid == BLE_UUID_NUS_SERVICE &&
         p_evt->params.discovered_db.srv_uuid.type == uart_uuid.type)
     {
-        mp_ble_uart_c->conn_handle = p_evt->conn_handle;
+        mp_ble_uart_c->conn_handle    = p_evt->conn_handle;
+        mp_ble_uart_c->RX_cccd_handle = BLE_GATT_HANDLE_INVALID;
+        mp_ble_uart_c->RX_handle      = BLE_GATT_HANDLE_INVALID;
+        mp_ble_uart_c->TX_handle      = BLE_GATT_HANDLE_INVALID;
 
         // Find the CCCD Handles of the TX/RX data characteristics.
         uint32_t i;
@@ -182,15 +1060,34 @@ static void db_discover_evt_handler(ble_db_discovery_evt_t * p_evt)
 						
         }
 
-        LOG("[uart_C]: Nordic UART service (NUS) discovered at peer.\r\n");
-
         ble_uart_c_evt_t evt;
 
-        evt.evt_type = BLE_UART_C_EVT_DISCOVERY_COMPLETE;
+        if ((mp_ble_uart_c->RX_handle == BLE_GATT_HANDLE_INVALID) ||
+            (mp_ble_uart_c->TX_handle == BLE_GATT_HANDLE_INVALID) ||
+            (mp_ble_uart_c->RX_cccd_handle == BLE_GATT_HANDLE_INVALID))
+        {
+            LOG("[uart_C]: Nordic UART service (NUS) incomplete at peer.\r\n");
+            evt.evt_type = BLE_UART_C_EVT_DISCOVERY_FAILED;
+        }
+        else
+        {
+            LOG("[uart_C]: Nordic UART service (NUS) discovered at peer.\r\n");
+            evt.evt_type = BLE_UART_C_EVT_DISCOVERY_COMPLETE;
+        }
+        mp_ble_uart_c->evt_handler(mp_ble_uart_c, &evt);
+    }
+    else if ((p_evt->evt_type == BLE_DB_DISCOVERY_SRV_NOT_FOUND) ||
+             (p_evt->evt_type == BLE_DB_DISCOVERY_ERROR))
+    {
+        ble_uart_c_evt_t evt;
 
+        LOG("[uart_C]: Nordic UART service (NUS) not found at peer.\r\n");
+        mp_ble_uart_c->conn_handle = p_evt->conn_handle;
+        evt.evt_type               = BLE_UART_C_EVT_DISCOVERY_FAILED;
         mp_ble_uart_c->evt_handler(mp_ble_uart_c, &evt);
     }
 }
+#endif
 
 
 uint32_t ble_uart_c_init(ble_uart_c_t * p_ble_uart_c, ble_uart_c_init_t * p_ble_uart_c_init)
@@ -220,8 +1117,80 @@ uint32_t ble_uart_c_init(ble_uart_c_t * p_ble_uart_c, ble_uart_c_init_t * p_ble_
     mp_ble_uart_c->evt_handler    = p_ble_uart_c_init->evt_handler;
     mp_ble_uart_c->conn_handle    = BLE_CONN_HANDLE_INVALID;
     mp_ble_uart_c->RX_cccd_handle = BLE_GATT_HANDLE_INVALID;
+    mp_ble_uart_c->TX_handle      = BLE_GATT_HANDLE_INVALID;
+
+#if BLE_UART_C_QOS_ENABLED
+    ble_uart_c_qos_cfg_t qos_cfg;
+
+    m_tick_hz        = APP_TIMER_CLOCK_FREQ / (p_ble_uart_c_init->prescaler + 1);
+    qos_cfg.tx_rate  = BLE_UART_C_QOS_TX_RATE;
+    qos_cfg.tx_burst = BLE_UART_C_QOS_TX_BURST;
+    qos_cfg.rx_rate  = BLE_UART_C_QOS_RX_RATE;
+    qos_cfg.rx_burst = BLE_UART_C_QOS_RX_BURST;
+    qos_cfg.rx_qos   = BLE_UART_C_QOS_DATA;
+    qos_cfg.rx_drop  = BLE_UART_C_QOS_RX_DROP;
+
+    memset(&mp_ble_uart_c->qos_stats, 0, sizeof(mp_ble_uart_c->qos_stats));
+    mp_ble_uart_c->tx_retry         = false;
+    mp_ble_uart_c->rx_held_first    = 0;
+    mp_ble_uart_c->rx_held_count    = 0;
+    mp_ble_uart_c->rx_timer_running = false;
+    mp_ble_uart_c->rx_releasing     = false;
+
+    err_code = app_timer_create(&mp_ble_uart_c->retry_timer_id,
+                                APP_TIMER_MODE_SINGLE_SHOT,
+                                retry_timeout_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    err_code = app_timer_create(&mp_ble_uart_c->rx_timer_id,
+                                APP_TIMER_MODE_SINGLE_SHOT,
+                                rx_timeout_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    err_code = ble_uart_c_qos_set(mp_ble_uart_c, &qos_cfg);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+#endif
+
+#if BLE_UART_C_WDT_ENABLED
+    uint32_t i;
+
+    m_prescaler       = p_ble_uart_c_init->prescaler;
+    m_retry_running   = false;
+    m_att_running     = false;
+    m_retry_delay_ms  = BLE_UART_C_WDT_RETRY_MS;
+    m_retry_waited_ms = 0;
+    for (i = 0; i < BLE_UART_C_WDT_LINKS; i++)
+    {
+        m_att_pending[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
+    memset(&m_wdt_stats, 0, sizeof(m_wdt_stats));
+
+    err_code = app_timer_create(&m_retry_timer_id, APP_TIMER_MODE_SINGLE_SHOT, tx_retry_timeout_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    err_code = app_timer_create(&m_att_timer_id, APP_TIMER_MODE_SINGLE_SHOT, att_timeout_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+#endif
 
+#if BLE_UART_C_FAST_DISC_ENABLED
+    mp_ble_uart_c->RX_handle  = BLE_GATT_HANDLE_INVALID;
+    mp_ble_uart_c->disc_state = DISC_IDLE;
+    return NRF_SUCCESS;
+#else
     return ble_db_discovery_evt_register(&uart_uuid, db_discover_evt_handler);
+#endif
 }
 
 
@@ -238,6 +1207,37 @@ void ble_uart_c_on_ble_evt(ble_uart_c_t * p_ble_uart_c, const ble_evt_t * p_ble_
             p_ble_uart_c->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
             break;
 
+        case BLE_GAP_EVT_DISCONNECTED:
+            tx_buffer_conn_flush(p_ble_evt->evt.gap_evt.conn_handle);
+#if BLE_UART_C_WDT_ENABLED
+            att_pending_remove(p_ble_evt->evt.gap_evt.conn_handle);
+#endif
+            if (p_ble_evt->evt.gap_evt.conn_handle == p_ble_uart_c->conn_handle)
+            {
+#if BLE_UART_C_QOS_ENABLED
+                // What the peer sent before the link went down still reaches the application.
+                rx_held_flush(p_ble_uart_c);
+#endif
+                p_ble_uart_c->conn_handle = BLE_CONN_HANDLE_INVALID;
+                p_ble_uart_c->TX_handle   = BLE_GATT_HANDLE_INVALID;
+#if BLE_UART_C_FAST_DISC_ENABLED
+                p_ble_uart_c->disc_state  = DISC_IDLE;
+#endif
+            }
+            break;
+
+#if BLE_UART_C_FAST_DISC_ENABLED
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+            on_disc_rsp(p_ble_uart_c, p_ble_evt);
+            break;
+#endif
+
+        case BLE_EVT_TX_COMPLETE:
+            on_tx_complete(p_ble_uart_c, p_ble_evt);
+            break;
+
         case BLE_GATTC_EVT_HVX:
             on_hvx(p_ble_uart_c, p_ble_evt);
             break;
@@ -246,12 +1246,58 @@ void ble_uart_c_on_ble_evt(ble_uart_c_t * p_ble_uart_c, const ble_evt_t * p_ble_
             on_write_rsp(p_ble_uart_c, p_ble_evt);
             break;
 
+#if BLE_UART_C_WDT_ENABLED
+        case BLE_GATTC_EVT_TIMEOUT:
+            // The SoftDevice has given up on the transaction before the watchdog did.
+            att_give_up(p_ble_evt->evt.gattc_evt.conn_handle);
+            break;
+#endif
+
         default:
             break;
     }
 }
 
 
+void ble_uart_c_wdt_stats_get(ble_uart_c_wdt_stats_t * p_stats)
+{
+#if BLE_UART_C_WDT_ENABLED
+    *p_stats = m_wdt_stats;
+#else
+    memset(p_stats, 0, sizeof(*p_stats));
+#endif
+}
+
+
+uint32_t ble_uart_c_discover(ble_uart_c_t * p_ble_uart_c, uint16_t conn_handle)
+{
+#if BLE_UART_C_FAST_DISC_ENABLED
+    uint32_t err_code;
+
+    if (p_ble_uart_c->disc_state != DISC_IDLE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    p_ble_uart_c->conn_handle    = conn_handle;
+    p_ble_uart_c->RX_cccd_handle = BLE_GATT_HANDLE_INVALID;
+    p_ble_uart_c->RX_handle      = BLE_GATT_HANDLE_INVALID;
+    p_ble_uart_c->TX_handle      = BLE_GATT_HANDLE_INVALID;
+
+    err_code = sd_ble_gattc_primary_services_discover(conn_handle, 0x0001, &uart_uuid);
+    if (err_code == NRF_SUCCESS)
+    {
+        p_ble_uart_c->disc_state = DISC_SRV;
+    }
+    return err_code;
+#else
+    UNUSED_PARAMETER(p_ble_uart_c);
+    UNUSED_PARAMETER(conn_handle);
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+
 /**@brief Function for creating a message for writing to the CCCD.
  */
 static uint32_t cccd_configure(uint16_t conn_handle, uint16_t handle_cccd, bool enable)
@@ -262,12 +1308,16 @@ static uint32_t cccd_configure(uint16_t conn_handle, uint16_t handle_cccd, bool
     tx_message_t * p_msg;
     uint16_t       cccd_val = enable ? BLE_GATT_HVX_NOTIFICATION : 0;
 
-    p_msg              = &m_tx_buffer[m_tx_insert_index++];
-    m_tx_insert_index &= TX_BUFFER_MASK;
+    p_msg = tx_buffer_alloc();
+    if (p_msg == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
 
     p_msg->req.write_req.gattc_params.handle   = handle_cccd;
-    p_msg->req.write_req.gattc_params.len      = 2;//WRITE_MESSAGE_LENGTH;
+    p_msg->req.write_req.gattc_params.len      = WRITE_MESSAGE_LENGTH;
     p_msg->req.write_req.gattc_params.p_value  = p_msg->req.write_req.gattc_value;
+    p_msg->req.write_req.p_block               = NULL;
     p_msg->req.write_req.gattc_params.offset   = 0;
     p_msg->req.write_req.gattc_params.write_op = BLE_GATT_OP_WRITE_REQ;
     p_msg->req.write_req.gattc_value[0]        = LSB(cccd_val);
@@ -307,32 +1357,180 @@ static uint32_t cccd_configure(uint16_t conn_handle, uint16_t handle_cccd, bool
 //}
  uint32_t ble_uart_c_write_string(ble_uart_c_t * p_ble_uart_c, const uint8_t * p_str, uint16_t p_str_len)
  {
-    if (p_ble_uart_c->conn_handle == BLE_CONN_HANDLE_INVALID)
+    return ble_uart_c_write_qos(p_ble_uart_c, p_str, p_str_len, BLE_UART_C_QOS_DATA);
+ }
+
+
+uint32_t ble_uart_c_write_qos(ble_uart_c_t *   p_ble_uart_c,
+                              const uint8_t *  p_str,
+                              uint16_t         p_str_len,
+                              ble_uart_c_qos_t qos)
+ {
+    uint32_t err_code;
+    uint8_t * p_block;
+
+    if ((p_ble_uart_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (p_ble_uart_c->TX_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_str_len > BLE_NUS_MAX_DATA_LEN)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // A full queue is reported before the write is charged to the budget.
+    if (tx_buffer_free_count() == 0)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_block = ble_uart_c_write_reserve(p_ble_uart_c);
+    if (p_block == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    memcpy(p_block,p_str,p_str_len);
+
+    err_code = ble_uart_c_write_commit(p_ble_uart_c, p_block, p_str_len, qos);
+    if (err_code != NRF_SUCCESS)
+    {
+        ble_uart_c_write_cancel(p_block);
+    }
+    return err_code;
+ }
+
+
+uint8_t * ble_uart_c_write_reserve(ble_uart_c_t * p_ble_uart_c)
+{
+    if ((p_ble_uart_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (p_ble_uart_c->TX_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        return NULL;
+    }
+    return buf_pool_alloc(BUF_POOL_USER_NUS_TX);
+}
+
+
+uint32_t ble_uart_c_write_commit(ble_uart_c_t *   p_ble_uart_c,
+                                 uint8_t *        p_data,
+                                 uint16_t         len,
+                                 ble_uart_c_qos_t qos)
+{
+    uint32_t       err_code;
+    tx_message_t * p_msg;
+
+    if ((p_ble_uart_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (p_ble_uart_c->TX_handle == BLE_GATT_HANDLE_INVALID))
     {
         return NRF_ERROR_INVALID_STATE;
     }
+    if (len > BLE_NUS_MAX_DATA_LEN)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
     LOG("[uart_C]: Writing to characteristic Handle = %d, Connection Handle = %d\r\n",
         p_ble_uart_c->TX_handle,p_ble_uart_c->conn_handle);
 
-    tx_message_t * p_msg;
-   
-    p_msg              = &m_tx_buffer[m_tx_insert_index++];
-    m_tx_insert_index &= TX_BUFFER_MASK;
+    // A full queue is reported before the write is charged to the budget.
+    if (tx_buffer_free_count() == 0)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    err_code = tx_admit(p_ble_uart_c, len, qos);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // The data stays where the producer wrote it, and the block goes back to the pool once the
+    // SoftDevice has taken the write.
+    p_msg = tx_buffer_alloc();
 
     p_msg->req.write_req.gattc_params.handle   = p_ble_uart_c->TX_handle;
-    p_msg->req.write_req.gattc_params.len      = p_str_len;
-    p_msg->req.write_req.gattc_params.p_value  = p_msg->req.write_req.gattc_value;
+    p_msg->req.write_req.gattc_params.len      = len;
+    p_msg->req.write_req.gattc_params.p_value  = p_data;
     p_msg->req.write_req.gattc_params.offset   = 0;
     p_msg->req.write_req.gattc_params.write_op = BLE_GATT_OP_WRITE_REQ;
-    memcpy(p_msg->req.write_req.gattc_value,p_str,p_str_len);
-   
+    p_msg->req.write_req.p_block               = p_data;
     p_msg->conn_handle                         = p_ble_uart_c->conn_handle;
     p_msg->type                                = WRITE_REQ;
 
     tx_buffer_process();
-     
+
     return NRF_SUCCESS;
- }
+}
+
+
+void ble_uart_c_write_cancel(uint8_t * p_data)
+{
+    buf_pool_free(BUF_POOL_USER_NUS_TX, p_data);
+}
+
+
+uint32_t ble_uart_c_write_cmd(ble_uart_c_t * p_ble_uart_c, const uint8_t * p_data, uint16_t len)
+{
+    ble_gattc_write_params_t write_params;
+    uint32_t                 err_code;
+
+    if ((p_ble_uart_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (p_ble_uart_c->TX_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (len > BLE_NUS_MAX_DATA_LEN)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    err_code = tx_admit(p_ble_uart_c, len, BLE_UART_C_QOS_DATA);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    write_params.write_op = BLE_GATT_OP_WRITE_CMD;
+    write_params.flags    = 0;
+    write_params.handle   = p_ble_uart_c->TX_handle;
+    write_params.offset   = 0;
+    write_params.len      = len;
+    write_params.p_value  = (uint8_t *)p_data;
+
+    err_code = sd_ble_gattc_write(p_ble_uart_c->conn_handle, &write_params);
+#if BLE_UART_C_QOS_ENABLED
+    if (err_code != NRF_SUCCESS)
+    {
+        bucket_refund(&p_ble_uart_c->tx_bucket, len);
+    }
+#endif
+    return err_code;
+}
+
+
+uint32_t ble_uart_c_qos_set(ble_uart_c_t * p_ble_uart_c, const ble_uart_c_qos_cfg_t * p_cfg)
+{
+#if BLE_UART_C_QOS_ENABLED
+    if ((p_cfg->tx_burst < (2 * BLE_NUS_MAX_DATA_LEN)) ||
+        (p_cfg->rx_burst < (2 * BLE_NUS_MAX_DATA_LEN)) ||
+        (p_cfg->rx_qos > BLE_UART_C_QOS_BULK) ||
+        (p_cfg->rx_drop > 1))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    bucket_set(&p_ble_uart_c->tx_bucket, p_cfg->tx_rate, p_cfg->tx_burst);
+    bucket_set(&p_ble_uart_c->rx_bucket, p_cfg->rx_rate, p_cfg->rx_burst);
+    p_ble_uart_c->rx_qos  = p_cfg->rx_qos;
+    p_ble_uart_c->rx_drop = (p_cfg->rx_drop != 0);
+    rx_timer_update(p_ble_uart_c, rx_held_release(p_ble_uart_c));
+    return NRF_SUCCESS;
+#else
+    UNUSED_PARAMETER(p_ble_uart_c);
+    UNUSED_PARAMETER(p_cfg);
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+
 uint32_t ble_uart_c_rx_notif_enable(ble_uart_c_t * p_ble_uart_c)
 {
     if (p_ble_uart_c == NULL)
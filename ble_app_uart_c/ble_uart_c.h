@@ -21,6 +21,10 @@
  * @note     The application must propagate BLE stack events to this module by calling
  *           ble_uart_c_on_ble_evt().
  *
+ * @note     The client has one instance and one write queue, so it serves a single link. Writing
+ *           one payload to several links at once (fan-out) is not implemented; it needs the
+ *           instance and its queue to be kept per link first.
+ *
  */
 
 #ifndef BLE_UART_C_H__
@@ -32,7 +36,10 @@
 #define BLE_NUS_MAX_DATA_LEN (GATT_MTU_SIZE_DEFAULT - 3) /**< Maximum length of data (in bytes) that can be transmitted to the peer by the Nordic UART service module. */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "ble.h"
+#include "app_timer.h"
+#include "ble_uart_c_cnfg.h"
 
 /**
  * @defgroup uart_c_enums Enumerations
@@ -43,9 +50,22 @@
 typedef enum
 {
     BLE_UART_C_EVT_DISCOVERY_COMPLETE = 1,  /**< Event indicating that the Nordic UART Service (NUS) has been discovered at the peer. */
-    BLE_UART_C_EVT_RX_DATA_NOTIFICATION     /**< Event indicating that a notification of the NUS RX data characteristic has been received from the peer. */
+    BLE_UART_C_EVT_RX_DATA_NOTIFICATION,    /**< Event indicating that a notification of the NUS RX data characteristic has been received from the peer. */
+    BLE_UART_C_EVT_TX_COMPLETE,             /**< Event indicating that a write has completed and more data can be sent to the peer. */
+    BLE_UART_C_EVT_RX_NOTIF_ENABLED,        /**< Event indicating that the peer has accepted the request to enable notification of the RX characteristic. */
+    BLE_UART_C_EVT_TX_ERROR,                /**< Event indicating that a queued write request was dropped because the SoftDevice did not accept it in time. */
+    BLE_UART_C_EVT_ATT_TIMEOUT,             /**< Event indicating that a write request got no response in time and its link is being disconnected. */
+    BLE_UART_C_EVT_DISCOVERY_FAILED         /**< Event indicating that the peer does not have the NUS service, or that its TX or RX characteristic or the CCCD of RX was not found. */
 } ble_uart_c_evt_type_t;
 
+/**@brief QoS class, deciding which traffic gets through when the budget of a link is exhausted. */
+typedef enum
+{
+    BLE_UART_C_QOS_CONTROL,                 /**< Always passes. Bytes beyond the budget are counted as overshoot. */
+    BLE_UART_C_QOS_DATA,                    /**< Passes while the budget covers it. */
+    BLE_UART_C_QOS_BULK                     /**< Passes while the budget covers it with half the burst to spare, leaving that half to data. */
+} ble_uart_c_qos_t;
+
 /** @} */
 
 /**
@@ -60,6 +80,13 @@ typedef struct
     uint8_t len; 
 } ble_uart_t;
 
+/**@brief Structure describing a write request the queue gave up on. */
+typedef struct
+{
+    uint16_t conn_handle;  /**< Link of the request. */
+    uint32_t err_code;     /**< Last error from the SoftDevice, or NRF_ERROR_TIMEOUT if the response did not come. */
+} ble_uart_c_tx_error_t;
+
 /**@brief NUS Event structure. */
 typedef struct
 {
@@ -68,9 +95,48 @@ typedef struct
 	 {
 		 
 			ble_uart_t 						uart;  /**< UART measurement received. This will be filled if the evt_type is @ref BLE_UART_C_EVT_HRM_NOTIFICATION. */
+        ble_uart_c_tx_error_t tx_error;  /**< Request given up on, for @ref BLE_UART_C_EVT_TX_ERROR and @ref BLE_UART_C_EVT_ATT_TIMEOUT. */
    } params;
 } ble_uart_c_evt_t;
 
+/**@brief Rate limits and QoS of a link. */
+typedef struct
+{
+    uint32_t         tx_rate;               /**< Bytes per second written to the peer. 0 for no limit. */
+    uint16_t         tx_burst;              /**< Bytes that can be written to the peer at once. */
+    uint32_t         rx_rate;               /**< Bytes per second notified by the peer. 0 for no limit. */
+    uint16_t         rx_burst;              /**< Bytes that can be notified by the peer at once. */
+    uint8_t          rx_qos;                /**< Class of the notifications of the peer, see @ref ble_uart_c_qos_t. */
+    uint8_t          rx_drop;               /**< 1 to drop notifications beyond the budget once the hold queue is full, 0 to pass the oldest held one on as overshoot. */
+} ble_uart_c_qos_cfg_t;
+
+/**@brief Token bucket. */
+typedef struct
+{
+    uint32_t rate;                          /**< Bytes per second, 0 for no limit. */
+    uint32_t depth;                         /**< Burst in bytes, scaled by the tick rate. */
+    uint32_t tokens;                        /**< Budget in bytes, scaled by the tick rate. */
+    uint32_t ticks;                         /**< RTC counter at the last refill. */
+} ble_uart_c_bucket_t;
+
+/**@brief Rate limit counters of a link. */
+typedef struct
+{
+    uint32_t tx_limited;                    /**< Writes refused because the budget was exhausted. */
+    uint32_t tx_overshoot;                  /**< Bytes of control writes sent beyond the budget. */
+    uint32_t rx_held;                       /**< Notifications held back until the budget covered them. */
+    uint32_t rx_dropped;                    /**< Notifications dropped because the hold queue was full and ble_uart_c_qos_cfg_t::rx_drop set. */
+    uint32_t rx_overshoot;                  /**< Bytes of notifications passed beyond the budget: of control class, or pushed out of a full hold queue. */
+} ble_uart_c_qos_stats_t;
+
+/**@brief Write request queue watchdog counters. */
+typedef struct
+{
+    uint32_t retries;                       /**< Requests tried again from the retry timer. */
+    uint32_t dropped;                       /**< Requests dropped because the SoftDevice did not accept them in time. */
+    uint32_t stalls;                        /**< Requests left without a response, whose link was disconnected. */
+} ble_uart_c_wdt_stats_t;
+
 /** @} */
 
 /**
@@ -104,6 +170,26 @@ typedef struct ble_uart_c_s
     uint16_t                RX_handle;       /**< Handle of the RX characteristic as provided by the SoftDevice. */
 	uint16_t                TX_handle;       /**< Handle of the TX characteristic as provided by the SoftDevice. */
     ble_uart_c_evt_handler_t evt_handler;      /**< Application event handler to be called when there is an event related to the UART service. */
+#if BLE_UART_C_QOS_ENABLED
+    ble_uart_c_bucket_t     tx_bucket;       /**< Budget of the writes to the peer. */
+    ble_uart_c_bucket_t     rx_bucket;       /**< Budget of the notifications from the peer. */
+    uint8_t                 rx_qos;          /**< Class of the notifications of the peer. */
+    bool                    rx_drop;         /**< Whether notifications are dropped when rx_held is full. */
+    ble_uart_t              rx_held[BLE_UART_C_QOS_RX_HOLD]; /**< Notifications waiting for the budget, oldest at rx_held_first. */
+    uint8_t                 rx_held_first;   /**< Index of the oldest held notification. */
+    uint8_t                 rx_held_count;   /**< Notifications held. */
+    bool                    tx_retry;        /**< Whether a write was refused and retry_timer_id is started. */
+    app_timer_id_t          retry_timer_id;  /**< Timer reporting @ref BLE_UART_C_EVT_TX_COMPLETE once a refused write fits the budget. */
+    app_timer_id_t          rx_timer_id;     /**< Timer passing held notifications on, and refilling the budgets before the RTC counter wraps. */
+    bool                    rx_timer_running; /**< Whether rx_timer_id is started. */
+    bool                    rx_releasing;    /**< Whether rx_timer_id is started for held notifications, not only for a refill. */
+    ble_uart_c_qos_stats_t  qos_stats;       /**< Rate limit counters. */
+#endif
+#if BLE_UART_C_FAST_DISC_ENABLED
+    uint8_t                 disc_state;      /**< Step of the NUS discovery in progress. */
+    ble_gattc_handle_range_t disc_range;     /**< Handles left to search in the current step. */
+    uint16_t                rx_desc_end;     /**< Last handle that can be a descriptor of the RX characteristic. */
+#endif
 } ble_uart_c_t;
 
 /**@brief UART Client initialization structure.
@@ -111,6 +197,7 @@ typedef struct ble_uart_c_s
 typedef struct
 {
     ble_uart_c_evt_handler_t evt_handler;  /**< Event handler to be called by the UART Client module whenever there is an event related to the UART Service. */
+    uint32_t                 prescaler;    /**< RTC1 prescaler of the app_timer module, for the rate limits. */
 } ble_uart_c_init_t;
 
 /** @} */
@@ -125,13 +212,114 @@ typedef struct
  *
  * @param   p_ble_uart_c Pointer to the UART client structure.
  *
- * @retval  NRF_SUCCESS If the SoftDevice has been requested to write to the TX Characteristic of the peer.
- *                      Otherwise, an error code. This function propagates the error code returned 
- *                      by the SoftDevice API @ref sd_ble_gattc_write.
+ * @retval  NRF_SUCCESS             If the write has been queued for the TX Characteristic of the peer.
+ * @retval  NRF_ERROR_INVALID_STATE If there is no connection or the service is not discovered.
+ * @retval  NRF_ERROR_BUSY          If the rate limit of the link does not allow the write yet.
+ * @retval  NRF_ERROR_NO_MEM        If the write queue is full, or no @ref buf_pool block is
+ *                                  free. Wait for @ref BLE_UART_C_EVT_TX_COMPLETE and try again.
+ * @retval  NRF_ERROR_INVALID_PARAM If the data is longer than @ref BLE_NUS_MAX_DATA_LEN.
  */
 uint32_t ble_uart_c_write_string(ble_uart_c_t * p_ble_uart_c, const uint8_t * p_str, uint16_t p_str_len);
 
-/* write a dummy data */
+/**@brief   Function for writing data to the peer TX Characteristic in a QoS class.
+ *
+ * @details @ref ble_uart_c_write_string writes in @ref BLE_UART_C_QOS_DATA. A write refused
+ *          for the rate limit is followed by @ref BLE_UART_C_EVT_TX_COMPLETE once it would fit.
+ *
+ * @param   p_ble_uart_c Pointer to the UART client structure.
+ * @param   p_data       Data to be written.
+ * @param   len          Length of the data.
+ * @param   qos          Class of the data.
+ *
+ * @retval  NRF_SUCCESS             If the write has been queued for the TX Characteristic of the peer.
+ * @retval  NRF_ERROR_INVALID_STATE If there is no connection or the service is not discovered.
+ * @retval  NRF_ERROR_BUSY          If the rate limit of the link does not allow the write yet.
+ * @retval  NRF_ERROR_NO_MEM        If the write queue is full, or no @ref buf_pool block is
+ *                                  free. Wait for @ref BLE_UART_C_EVT_TX_COMPLETE and try again.
+ * @retval  NRF_ERROR_INVALID_PARAM If the data is longer than @ref BLE_NUS_MAX_DATA_LEN.
+ */
+uint32_t ble_uart_c_write_qos(ble_uart_c_t *   p_ble_uart_c,
+                              const uint8_t *  p_data,
+                              uint16_t         len,
+                              ble_uart_c_qos_t qos);
+
+/**@brief   Function for reserving the buffer of a write, for the data to be produced in place.
+ *
+ * @details The producer writes the data into the buffer and passes it to
+ *          @ref ble_uart_c_write_commit, which queues it without copying it. The buffer is a
+ *          @ref buf_pool block that stays reserved until it is committed or cancelled.
+ *
+ * @param   p_ble_uart_c Pointer to the UART client structure.
+ *
+ * @return  Buffer of @ref BLE_NUS_MAX_DATA_LEN bytes, or NULL if there is no connection, the
+ *          service is not discovered or no block is free.
+ */
+uint8_t * ble_uart_c_write_reserve(ble_uart_c_t * p_ble_uart_c);
+
+/**@brief   Function for queueing a write whose data is in a reserved buffer.
+ *
+ * @details On success the buffer belongs to the client. Otherwise it stays reserved, and may be
+ *          committed again or cancelled.
+ *
+ * @param   p_ble_uart_c Pointer to the UART client structure.
+ * @param   p_data       Buffer from @ref ble_uart_c_write_reserve holding the data.
+ * @param   len          Length of the data.
+ * @param   qos          Class of the data.
+ *
+ * @retval  NRF_SUCCESS             If the write has been queued for the TX Characteristic of the peer.
+ * @retval  NRF_ERROR_INVALID_STATE If there is no connection or the service is not discovered.
+ * @retval  NRF_ERROR_BUSY          If the rate limit of the link does not allow the write yet.
+ * @retval  NRF_ERROR_NO_MEM        If the write queue is full. Wait for
+ *                                  @ref BLE_UART_C_EVT_TX_COMPLETE and try again.
+ * @retval  NRF_ERROR_INVALID_PARAM If the data is longer than @ref BLE_NUS_MAX_DATA_LEN.
+ */
+uint32_t ble_uart_c_write_commit(ble_uart_c_t *   p_ble_uart_c,
+                                 uint8_t *        p_data,
+                                 uint16_t         len,
+                                 ble_uart_c_qos_t qos);
+
+/**@brief   Function for giving back a reserved buffer that is not committed.
+ *
+ * @param   p_data Buffer from @ref ble_uart_c_write_reserve.
+ */
+void ble_uart_c_write_cancel(uint8_t * p_data);
+
+/**@brief   Function for setting the rate limits and QoS of a link.
+ *
+ * @details Writes beyond the rate are refused according to their class. Notifications cannot be
+ *          refused, so those beyond the rate are held, in order, and passed on as the budget
+ *          refills. When the hold queue is full, the oldest held notification is passed on beyond
+ *          the budget, or, with ble_uart_c_qos_cfg_t::rx_drop set, the new one is dropped. Both
+ *          are counted in ble_uart_c_t::qos_stats. The budgets start full.
+ *
+ * @param   p_ble_uart_c Pointer to the UART client structure.
+ * @param   p_cfg        Rate limits and QoS.
+ *
+ * @retval  NRF_SUCCESS             On success.
+ * @retval  NRF_ERROR_INVALID_PARAM If a burst is too small for two writes, or the class or drop policy is unknown.
+ * @retval  NRF_ERROR_NOT_SUPPORTED If @ref BLE_UART_C_QOS_ENABLED is not set.
+ */
+uint32_t ble_uart_c_qos_set(ble_uart_c_t * p_ble_uart_c, const ble_uart_c_qos_cfg_t * p_cfg);
+
+/**@brief   Function for writing data to the peer TX Characteristic without response.
+ *
+ * @details The data is handed directly to the SoftDevice as a Write Command, bypassing the
+ *          write request queue. Several Write Commands can be in flight per connection event,
+ *          but delivery is only acknowledged at the link layer. When the SoftDevice runs out of
+ *          TX buffers, the caller must retry after @ref BLE_UART_C_EVT_TX_COMPLETE.
+ *
+ * @param   p_ble_uart_c Pointer to the UART client structure.
+ * @param   p_data       Data to be written.
+ * @param   len          Length of the data, at most @ref BLE_NUS_MAX_DATA_LEN.
+ *
+ * @retval  NRF_SUCCESS              If the Write Command was queued in the SoftDevice.
+ * @retval  NRF_ERROR_INVALID_STATE  If there is no connection or the service is not discovered.
+ * @retval  NRF_ERROR_BUSY           If the rate limit of the link does not allow the write yet.
+ * @retval  BLE_ERROR_NO_TX_BUFFERS  If the SoftDevice has no free TX buffers.
+ *                                   Otherwise, an error code propagated from @ref sd_ble_gattc_write.
+ */
+uint32_t ble_uart_c_write_cmd(ble_uart_c_t * p_ble_uart_c, const uint8_t * p_data, uint16_t len);
+
 
 
 /**@brief     Function for initializing the UART client module.
@@ -139,7 +327,9 @@ uint32_t ble_uart_c_write_string(ble_uart_c_t * p_ble_uart_c, const uint8_t * p_
  * @details   This function will register with the DB Discovery module. There it
  *            registers for the UART Service. Doing so will make the DB Discovery
  *            module look for the presence of a UART Service instance at the peer when a
- *            discovery is started.
+ *            discovery is started. With @ref BLE_UART_C_FAST_DISC_ENABLED, the client does
+ *            not use the DB Discovery module, and the discovery is started with
+ *            @ref ble_uart_c_discover.
  *
  * @param[in] p_ble_uart_c      Pointer to the UART client structure.
  * @param[in] p_ble_uart_c_init Pointer to the UART initialization structure containing the
@@ -162,6 +352,33 @@ uint32_t ble_uart_c_init(ble_uart_c_t * p_ble_uart_c, ble_uart_c_init_t * p_ble_
  */
 void ble_uart_c_on_ble_evt(ble_uart_c_t * p_ble_uart_c, const ble_evt_t * p_ble_evt);
 
+/**@brief     Function for discovering the NUS service of a peer.
+ *
+ * @details   The service is looked up by its UUID, its characteristics are read until TX and
+ *            RX are found, and the descriptors following RX are read until its CCCD is found.
+ *            Nothing outside the service is discovered. @ref BLE_UART_C_EVT_DISCOVERY_COMPLETE
+ *            follows once TX, RX and the CCCD of RX are all found, and
+ *            @ref BLE_UART_C_EVT_DISCOVERY_FAILED if the peer does not have the service, one of
+ *            them is missing or the discovery could not go on. The client must be passed the
+ *            GATTC discovery events.
+ *
+ * @param[in] p_ble_uart_c Pointer to the UART client structure.
+ * @param[in] conn_handle  Connection to the peer.
+ *
+ * @retval    NRF_SUCCESS             If the discovery has started.
+ * @retval    NRF_ERROR_BUSY          If a discovery is in progress.
+ * @retval    NRF_ERROR_NOT_SUPPORTED If @ref BLE_UART_C_FAST_DISC_ENABLED is not set.
+ * @return    Otherwise an error code propagated from
+ *            @ref sd_ble_gattc_primary_services_discover.
+ */
+uint32_t ble_uart_c_discover(ble_uart_c_t * p_ble_uart_c, uint16_t conn_handle);
+
+/**@brief     Function for getting the counters of the write request queue watchdog.
+ *
+ * @param[out] p_stats Counters since initialization, zero if @ref BLE_UART_C_WDT_ENABLED is not set.
+ */
+void ble_uart_c_wdt_stats_get(ble_uart_c_wdt_stats_t * p_stats);
+
 
 /**@brief   Function for requesting the peer to start sending notification of RX characteristic.
  *
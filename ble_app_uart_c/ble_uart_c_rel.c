@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ble_uart_c_rel.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+#include "app_util.h"
+#include "app_trace.h"
+
+#define LOG                    app_trace_log                     /**< Debug logger macro that will be used in this file to do logging of important information over UART. */
+
+#define FRAME_INDEX_MASK       (BLE_UART_C_REL_MAX_WINDOW - 1)   /**< Mask for mapping a sequence number to a slot in the retained send buffer. */
+#define SACK_BITS              8                                 /**< Number of frames covered by the selective acknowledgement bitmap. */
+
+#define FRAME_FLAG_NEED_TX     0x01                              /**< Frame must be (re)transmitted. */
+#define FRAME_FLAG_SACKED      0x02                              /**< Frame has been selectively acknowledged. */
+
+STATIC_ASSERT(IS_POWER_OF_TWO(BLE_UART_C_REL_MAX_WINDOW));
+STATIC_ASSERT(BLE_UART_C_REL_MAX_WINDOW <= SACK_BITS);
+
+
+/**@brief Function for getting the retained frame holding a sequence number.
+ */
+static ble_uart_c_rel_frame_t * frame_get(ble_uart_c_rel_t * p_rel, uint8_t seq)
+{
+    return &p_rel->frames[seq & FRAME_INDEX_MASK];
+}
+
+
+/**@brief Function for getting the number of unacknowledged frames.
+ */
+static uint8_t frames_outstanding(const ble_uart_c_rel_t * p_rel)
+{
+    return (uint8_t)(p_rel->next_seq - p_rel->base);
+}
+
+
+/**@brief Function for (re)starting the retransmission timer, or stopping it if there is nothing
+ *        left to acknowledge.
+ */
+static void rto_timer_restart(ble_uart_c_rel_t * p_rel)
+{
+    uint32_t err_code;
+
+    if (p_rel->timer_running)
+    {
+        err_code = app_timer_stop(p_rel->timer_id);
+        APP_ERROR_CHECK(err_code);
+        p_rel->timer_running = false;
+    }
+
+    if ((frames_outstanding(p_rel) != 0) &&
+        (p_rel->p_ble_uart_c->conn_handle != BLE_CONN_HANDLE_INVALID))
+    {
+        err_code = app_timer_start(p_rel->timer_id, p_rel->rto_ticks, p_rel);
+        APP_ERROR_CHECK(err_code);
+        p_rel->timer_running = true;
+    }
+}
+
+
+/**@brief Function for passing frames marked for transmission to the SoftDevice.
+ *
+ * @details Stops at the first frame the SoftDevice does not accept. Transmission is resumed on
+ *          the next TX complete event or when a new link is started.
+ */
+static void frames_transmit(ble_uart_c_rel_t * p_rel)
+{
+    uint8_t seq;
+
+    for (seq = p_rel->base; seq != p_rel->next_seq; seq++)
+    {
+        ble_uart_c_rel_frame_t * p_frame = frame_get(p_rel, seq);
+
+        if ((p_frame->flags & FRAME_FLAG_NEED_TX) == 0)
+        {
+            continue;
+        }
+
+        if (ble_uart_c_write_cmd(p_rel->p_ble_uart_c, p_frame->data, p_frame->len) != NRF_SUCCESS)
+        {
+            break;
+        }
+
+        p_frame->flags   &= (uint8_t)~FRAME_FLAG_NEED_TX;
+        p_frame->tx_stamp = p_rel->tx_stamp++;
+    }
+}
+
+
+/**@brief Function for marking every frame that has not been acknowledged for transmission.
+ */
+static void frames_mark_all(ble_uart_c_rel_t * p_rel)
+{
+    uint8_t seq;
+
+    for (seq = p_rel->base; seq != p_rel->next_seq; seq++)
+    {
+        ble_uart_c_rel_frame_t * p_frame = frame_get(p_rel, seq);
+
+        if ((p_frame->flags & FRAME_FLAG_SACKED) == 0)
+        {
+            p_frame->flags |= FRAME_FLAG_NEED_TX;
+        }
+    }
+}
+
+
+/**@brief Function for handling the retransmission timeout.
+ */
+static void rto_timeout_handler(void * p_context)
+{
+    ble_uart_c_rel_t * p_rel = (ble_uart_c_rel_t *)p_context;
+
+    p_rel->timer_running = false;
+
+    if (frames_outstanding(p_rel) == 0)
+    {
+        return;
+    }
+
+    LOG("[rel]: Retransmission timeout, base %d.\r\n", p_rel->base);
+    p_rel->stats.tx_timeouts++;
+
+    frames_mark_all(p_rel);
+    frames_transmit(p_rel);
+    rto_timer_restart(p_rel);
+}
+
+
+/**@brief Function for processing the acknowledgement header of a notification from the peer.
+ *
+ * @return Number of frames newly acknowledged.
+ */
+static uint8_t ack_process(ble_uart_c_rel_t * p_rel, uint8_t ack, uint8_t sack)
+{
+    uint8_t acked = (uint8_t)(ack - p_rel->base);
+    uint8_t max_stamp = 0;
+    bool    sacked_any = false;
+    uint8_t seq;
+    uint8_t i;
+
+    if (acked > frames_outstanding(p_rel))
+    {
+        p_rel->stats.rx_bad_ack++;
+        return 0;
+    }
+
+    for (seq = p_rel->base; seq != ack; seq++)
+    {
+        frame_get(p_rel, seq)->flags = 0;
+    }
+    p_rel->base           = ack;
+    p_rel->stats.tx_acked += acked;
+
+    // Record which frames the peer holds out of order, and which of those was sent last.
+    for (i = 0; i < SACK_BITS; i++)
+    {
+        ble_uart_c_rel_frame_t * p_frame;
+
+        seq = (uint8_t)(ack + 1 + i);
+        if ((uint8_t)(seq - p_rel->base) >= frames_outstanding(p_rel))
+        {
+            break;
+        }
+        if ((sack & (1 << i)) == 0)
+        {
+            continue;
+        }
+
+        p_frame         = frame_get(p_rel, seq);
+        p_frame->flags  = FRAME_FLAG_SACKED;
+        if (!sacked_any || ((int8_t)(p_frame->tx_stamp - max_stamp) > 0))
+        {
+            max_stamp  = p_frame->tx_stamp;
+            sacked_any = true;
+        }
+    }
+
+    // A frame is lost if a frame transmitted after it has arrived.
+    if (sacked_any)
+    {
+        for (seq = p_rel->base; seq != p_rel->next_seq; seq++)
+        {
+            ble_uart_c_rel_frame_t * p_frame = frame_get(p_rel, seq);
+
+            if ((p_frame->flags == 0) && ((int8_t)(max_stamp - p_frame->tx_stamp) > 0))
+            {
+                p_frame->flags |= FRAME_FLAG_NEED_TX;
+                p_rel->stats.tx_retransmits++;
+            }
+        }
+    }
+
+    return acked;
+}
+
+
+/**@brief Function for handling a notification from the peer.
+ */
+static void on_rx_data(ble_uart_c_rel_t * p_rel, const ble_uart_t * p_uart)
+{
+    ble_uart_c_rel_evt_t evt;
+    uint8_t              acked;
+
+    if (p_uart->len < BLE_UART_C_REL_RX_HDR_LEN)
+    {
+        p_rel->stats.rx_bad_ack++;
+        return;
+    }
+    p_rel->stats.rx_frames++;
+
+    acked = ack_process(p_rel, p_uart->rx_data[0], p_uart->rx_data[1]);
+    frames_transmit(p_rel);
+    if (acked != 0)
+    {
+        rto_timer_restart(p_rel);
+    }
+
+    if (p_uart->len > BLE_UART_C_REL_RX_HDR_LEN)
+    {
+        evt.evt_type                = BLE_UART_C_REL_EVT_RX_DATA;
+        evt.params.rx_data.p_data   = &p_uart->rx_data[BLE_UART_C_REL_RX_HDR_LEN];
+        evt.params.rx_data.len      = p_uart->len - BLE_UART_C_REL_RX_HDR_LEN;
+        p_rel->evt_handler(p_rel, &evt);
+    }
+
+    if (acked != 0)
+    {
+        evt.evt_type           = BLE_UART_C_REL_EVT_TX_ACKED;
+        evt.params.acked_count = acked;
+        p_rel->evt_handler(p_rel, &evt);
+    }
+}
+
+
+uint32_t ble_uart_c_rel_init(ble_uart_c_rel_t * p_rel, const ble_uart_c_rel_init_t * p_rel_init)
+{
+    if ((p_rel == NULL) || (p_rel_init == NULL) || (p_rel_init->p_ble_uart_c == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if ((p_rel_init->window_size == 0) || (p_rel_init->window_size > BLE_UART_C_REL_MAX_WINDOW))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    memset(p_rel, 0, sizeof(*p_rel));
+
+    p_rel->p_ble_uart_c = p_rel_init->p_ble_uart_c;
+    p_rel->evt_handler  = p_rel_init->evt_handler;
+    p_rel->window_size  = p_rel_init->window_size;
+    p_rel->rto_ticks    = MAX(p_rel_init->rto_ticks, APP_TIMER_MIN_TIMEOUT_TICKS);
+
+    return app_timer_create(&p_rel->timer_id, APP_TIMER_MODE_SINGLE_SHOT, rto_timeout_handler);
+}
+
+
+uint32_t ble_uart_c_rel_send(ble_uart_c_rel_t * p_rel, const uint8_t * p_data, uint16_t len)
+{
+    ble_uart_c_rel_frame_t * p_frame;
+
+    if (len > BLE_UART_C_REL_MAX_PAYLOAD)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (frames_outstanding(p_rel) >= p_rel->window_size)
+    {
+        p_rel->stats.tx_window_full++;
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_frame          = frame_get(p_rel, p_rel->next_seq);
+    p_frame->data[0] = p_rel->next_seq;
+    memcpy(&p_frame->data[BLE_UART_C_REL_TX_HDR_LEN], p_data, len);
+    p_frame->len     = (uint8_t)(len + BLE_UART_C_REL_TX_HDR_LEN);
+    p_frame->flags   = FRAME_FLAG_NEED_TX;
+
+    p_rel->next_seq++;
+    p_rel->stats.tx_frames++;
+
+    frames_transmit(p_rel);
+    if (!p_rel->timer_running)
+    {
+        rto_timer_restart(p_rel);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+void ble_uart_c_rel_on_uart_c_evt(ble_uart_c_rel_t * p_rel, const ble_uart_c_evt_t * p_uart_c_evt)
+{
+    switch (p_uart_c_evt->evt_type)
+    {
+        case BLE_UART_C_EVT_RX_DATA_NOTIFICATION:
+            on_rx_data(p_rel, &p_uart_c_evt->params.uart);
+            break;
+
+        case BLE_UART_C_EVT_TX_COMPLETE:
+            frames_transmit(p_rel);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void ble_uart_c_rel_link_start(ble_uart_c_rel_t * p_rel)
+{
+    uint8_t seq;
+
+    for (seq = p_rel->base; seq != p_rel->next_seq; seq++)
+    {
+        frame_get(p_rel, seq)->flags = FRAME_FLAG_NEED_TX;
+    }
+
+    frames_transmit(p_rel);
+    rto_timer_restart(p_rel);
+}
+
+
+uint8_t ble_uart_c_rel_window_free(const ble_uart_c_rel_t * p_rel)
+{
+    return (uint8_t)(p_rel->window_size - frames_outstanding(p_rel));
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup ble_uart_c_rel   NUS Client Reliability Layer
+ * @{
+ * @ingroup  ble_sdk_srv_uart_c
+ * @brief    Sequenced delivery of UART data over Write Commands.
+ *
+ * @details  This module sends data to the peer as Write Commands, which are not acknowledged at
+ *           the ATT layer, and recovers frames that are lost above the link layer, e.g. across a
+ *           disconnect. Every frame written to the peer carries a sequence number, and every
+ *           notification from the peer carries a cumulative acknowledgement and a selective
+ *           acknowledgement bitmap:
+ *
+ *           Central to peer (TX Characteristic):  | seq | payload (0..19) |
+ *           Peer to central (RX Characteristic):  | ack | sack | payload (0..18) |
+ *
+ *           @c ack is the next sequence number the peer expects. Bit @c n of @c sack is set if
+ *           frame <tt>ack + 1 + n</tt> has been received out of order. The peer should send an
+ *           acknowledgement (with an empty payload if it has no data) at least once per
+ *           connection event in which it received frames. After notifications have been
+ *           enabled on a new link, the peer takes the sequence number of the first frame it
+ *           receives as the next one to expect.
+ *
+ *           Sent frames are retained until acknowledged. A frame is sent again when a frame that
+ *           was transmitted after it has been selectively acknowledged, or when no
+ *           acknowledgement progress has been made for the retransmission timeout.
+ *
+ * @note     The application must propagate @ref BLE_UART_C_EVT_RX_DATA_NOTIFICATION and
+ *           @ref BLE_UART_C_EVT_TX_COMPLETE events from the UART Client to this module.
+ */
+
+#ifndef BLE_UART_C_REL_H__
+#define BLE_UART_C_REL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_uart_c.h"
+#include "app_timer.h"
+#include "ble_uart_c_rel_cnfg.h"
+
+#define BLE_UART_C_REL_TX_HDR_LEN       1                                            /**< Length of the header of a frame sent to the peer. */
+#define BLE_UART_C_REL_RX_HDR_LEN       2                                            /**< Length of the header of a notification received from the peer. */
+#define BLE_UART_C_REL_MAX_PAYLOAD      (BLE_NUS_MAX_DATA_LEN - BLE_UART_C_REL_TX_HDR_LEN) /**< Maximum payload of a frame sent to the peer. */
+
+/**@brief Reliability layer event type. */
+typedef enum
+{
+    BLE_UART_C_REL_EVT_RX_DATA,   /**< Payload received from the peer. */
+    BLE_UART_C_REL_EVT_TX_ACKED   /**< Frames were acknowledged by the peer and window space is available. */
+} ble_uart_c_rel_evt_type_t;
+
+/**@brief Reliability layer event. */
+typedef struct
+{
+    ble_uart_c_rel_evt_type_t evt_type;      /**< Type of the event. */
+    union
+    {
+        struct
+        {
+            const uint8_t * p_data;          /**< Payload received from the peer. */
+            uint8_t         len;             /**< Length of the payload. */
+        } rx_data;                           /**< Parameters for @ref BLE_UART_C_REL_EVT_RX_DATA. */
+        uint8_t             acked_count;     /**< Number of frames acknowledged, for @ref BLE_UART_C_REL_EVT_TX_ACKED. */
+    } params;
+} ble_uart_c_rel_evt_t;
+
+/**@brief Reliability layer statistics. */
+typedef struct
+{
+    uint32_t tx_frames;        /**< Frames accepted from the application. */
+    uint32_t tx_acked;         /**< Frames acknowledged by the peer. */
+    uint32_t tx_retransmits;   /**< Frames sent again after a selective acknowledgement hole. */
+    uint32_t tx_timeouts;      /**< Retransmission timeouts. */
+    uint32_t tx_window_full;   /**< Send attempts rejected because the window was full. */
+    uint32_t rx_frames;        /**< Notifications received from the peer. */
+    uint32_t rx_bad_ack;       /**< Acknowledgements outside the current window. */
+} ble_uart_c_rel_stats_t;
+
+// Forward declaration of the ble_uart_c_rel_t type.
+typedef struct ble_uart_c_rel_s ble_uart_c_rel_t;
+
+/**@brief Reliability layer event handler type. */
+typedef void (* ble_uart_c_rel_evt_handler_t) (ble_uart_c_rel_t * p_rel, ble_uart_c_rel_evt_t * p_evt);
+
+/**@brief Retained frame. Internal to the module. */
+typedef struct
+{
+    uint8_t data[BLE_NUS_MAX_DATA_LEN];  /**< Header and payload, as written to the peer. */
+    uint8_t len;                         /**< Length of the frame including the header. */
+    uint8_t tx_stamp;                    /**< Transmission order of the last transmission of this frame. */
+    uint8_t flags;                       /**< Frame state flags. */
+} ble_uart_c_rel_frame_t;
+
+/**@brief Reliability layer structure. The memory is provided by the application. */
+struct ble_uart_c_rel_s
+{
+    ble_uart_c_t *               p_ble_uart_c;                          /**< UART Client used to reach the peer. */
+    ble_uart_c_rel_evt_handler_t evt_handler;                           /**< Application event handler. */
+    app_timer_id_t               timer_id;                              /**< Retransmission timer. */
+    uint32_t                     rto_ticks;                             /**< Retransmission timeout in timer ticks. */
+    uint8_t                      window_size;                           /**< Maximum number of unacknowledged frames. */
+    uint8_t                      base;                                  /**< Oldest unacknowledged sequence number. */
+    uint8_t                      next_seq;                              /**< Sequence number of the next new frame. */
+    uint8_t                      tx_stamp;                              /**< Transmission counter. */
+    bool                         timer_running;                         /**< Whether the retransmission timer is running. */
+    ble_uart_c_rel_frame_t       frames[BLE_UART_C_REL_MAX_WINDOW];     /**< Retained send buffer, indexed by sequence number. */
+    ble_uart_c_rel_stats_t       stats;                                 /**< Statistics. */
+};
+
+/**@brief Reliability layer initialization structure. */
+typedef struct
+{
+    ble_uart_c_t *               p_ble_uart_c;  /**< Initialized UART Client. */
+    ble_uart_c_rel_evt_handler_t evt_handler;   /**< Application event handler. */
+    uint8_t                      window_size;   /**< Window size, 1 to @ref BLE_UART_C_REL_MAX_WINDOW. */
+    uint32_t                     rto_ticks;     /**< Retransmission timeout in app_timer ticks. */
+} ble_uart_c_rel_init_t;
+
+/**@brief     Function for initializing the reliability layer.
+ *
+ * @param[out] p_rel      Reliability layer instance.
+ * @param[in]  p_rel_init Initialization parameters.
+ *
+ * @retval    NRF_SUCCESS On success. Otherwise an error code propagated from
+ *                        @ref app_timer_create.
+ */
+uint32_t ble_uart_c_rel_init(ble_uart_c_rel_t * p_rel, const ble_uart_c_rel_init_t * p_rel_init);
+
+/**@brief     Function for sending data reliably to the peer.
+ *
+ * @details   The data is copied into the retained send buffer and written to the peer as soon as
+ *            the SoftDevice has TX buffers available.
+ *
+ * @param[in] p_rel  Reliability layer instance.
+ * @param[in] p_data Data to send.
+ * @param[in] len    Length of the data, at most @ref BLE_UART_C_REL_MAX_PAYLOAD.
+ *
+ * @retval    NRF_SUCCESS             If the data was accepted.
+ * @retval    NRF_ERROR_NO_MEM        If the window is full.
+ * @retval    NRF_ERROR_INVALID_PARAM If the data is too long.
+ */
+uint32_t ble_uart_c_rel_send(ble_uart_c_rel_t * p_rel, const uint8_t * p_data, uint16_t len);
+
+/**@brief     Function for handling UART Client events.
+ *
+ * @param[in] p_rel        Reliability layer instance.
+ * @param[in] p_uart_c_evt Event received from the UART Client.
+ */
+void ble_uart_c_rel_on_uart_c_evt(ble_uart_c_rel_t * p_rel, const ble_uart_c_evt_t * p_uart_c_evt);
+
+/**@brief     Function for restarting transmission on a new link.
+ *
+ * @details   Call this when notifications have been enabled on a new connection. All frames
+ *            that have not been acknowledged are sent again.
+ *
+ * @param[in] p_rel Reliability layer instance.
+ */
+void ble_uart_c_rel_link_start(ble_uart_c_rel_t * p_rel);
+
+/**@brief     Function for getting the number of frames that can be sent before the window is full.
+ *
+ * @param[in] p_rel Reliability layer instance.
+ *
+ * @return    Free window space, in frames.
+ */
+uint8_t ble_uart_c_rel_window_free(const ble_uart_c_rel_t * p_rel);
+
+#endif // BLE_UART_C_REL_H__
+
+/** @} */
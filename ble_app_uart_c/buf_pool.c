@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "buf_pool.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+#define BLOCK_WORDS        (BUF_POOL_BLOCK_SIZE / sizeof(uint32_t))  /**< Words of a block. */
+
+STATIC_ASSERT((BUF_POOL_BLOCK_SIZE % sizeof(uint32_t)) == 0);
+STATIC_ASSERT(BUF_POOL_BLOCK_SIZE >= sizeof(void *));
+STATIC_ASSERT((BUF_POOL_BLOCK_COUNT >= 2) && (BUF_POOL_BLOCK_COUNT <= 255));
+STATIC_ASSERT((BUF_POOL_QUOTA_NUS_RX + BUF_POOL_QUOTA_STORE_FWD) < BUF_POOL_BLOCK_COUNT);
+
+/**@brief Block of the pool. A free block holds the next free block. */
+typedef union
+{
+    void     * p_next;
+    uint32_t   words[BLOCK_WORDS];
+} block_t;
+
+static block_t          m_blocks[BUF_POOL_BLOCK_COUNT];  /**< Blocks of the pool. */
+static block_t        * mp_free;                         /**< First free block, NULL if the pool is empty. */
+static buf_pool_stats_t m_stats;                         /**< Pool statistics, also holding the quotas and blocks in use. */
+
+
+void buf_pool_init(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < (BUF_POOL_BLOCK_COUNT - 1); i++)
+    {
+        m_blocks[i].p_next = &m_blocks[i + 1];
+    }
+    m_blocks[BUF_POOL_BLOCK_COUNT - 1].p_next = NULL;
+    mp_free = &m_blocks[0];
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.free                                   = BUF_POOL_BLOCK_COUNT;
+    m_stats.free_low_water                         = BUF_POOL_BLOCK_COUNT;
+    m_stats.users[BUF_POOL_USER_NUS_TX].quota      = BUF_POOL_QUOTA_NUS_TX;
+    m_stats.users[BUF_POOL_USER_NUS_RX].quota      = BUF_POOL_QUOTA_NUS_RX;
+    m_stats.users[BUF_POOL_USER_STORE_FWD].quota   = BUF_POOL_QUOTA_STORE_FWD;
+}
+
+
+void * buf_pool_alloc(buf_pool_user_t user)
+{
+    buf_pool_user_stats_t * p_user = &m_stats.users[user];
+    block_t               * p_block;
+
+    CRITICAL_REGION_ENTER();
+    p_block = mp_free;
+    if (p_user->in_use >= p_user->quota)
+    {
+        p_user->quota_fails++;
+        p_block = NULL;
+    }
+    else if (p_block == NULL)
+    {
+        p_user->empty_fails++;
+    }
+    else
+    {
+        mp_free = p_block->p_next;
+        m_stats.free--;
+        if (m_stats.free < m_stats.free_low_water)
+        {
+            m_stats.free_low_water = m_stats.free;
+        }
+        p_user->allocs++;
+        p_user->in_use++;
+        if (p_user->in_use > p_user->high_water)
+        {
+            p_user->high_water = p_user->in_use;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    return p_block;
+}
+
+
+void buf_pool_free(buf_pool_user_t user, void * p_block)
+{
+    block_t * p = (block_t *)p_block;
+
+    CRITICAL_REGION_ENTER();
+    p->p_next = mp_free;
+    mp_free   = p;
+    m_stats.free++;
+    m_stats.users[user].in_use--;
+    CRITICAL_REGION_EXIT();
+}
+
+
+uint32_t buf_pool_quota_set(buf_pool_user_t user, uint8_t quota)
+{
+    if ((user >= BUF_POOL_USER_COUNT) || (quota == 0) || (quota > BUF_POOL_BLOCK_COUNT))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (quota < m_stats.users[user].in_use)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    m_stats.users[user].quota = quota;
+    return NRF_SUCCESS;
+}
+
+
+void buf_pool_stats_get(buf_pool_stats_t * p_stats)
+{
+    CRITICAL_REGION_ENTER();
+    *p_stats = m_stats;
+    CRITICAL_REGION_EXIT();
+}
+
+/** @}
+ *  @endcond
+ */
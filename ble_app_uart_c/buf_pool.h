@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup buf_pool Buffer Pool
+ * @{
+ * @brief    Fixed-size blocks shared by the stages of the data path.
+ *
+ * @details  The NUS client TX queue, the data from the peer waiting for the UART and the
+ *           store-and-forward records in RAM all take their buffers from one pool of
+ *           @ref BUF_POOL_BLOCK_COUNT blocks, so the RAM goes to the direction that is busy.
+ *           Each stage has a quota, which keeps one stage from starving the others.
+ *
+ *           Free blocks are kept in a list threaded through the blocks themselves, so allocating
+ *           and freeing take constant time. Both run in a critical region and may be called from
+ *           any interrupt priority.
+ */
+
+#ifndef BUF_POOL_H__
+#define BUF_POOL_H__
+
+#include <stdint.h>
+#include "buf_pool_cnfg.h"
+
+/**@brief Stages taking blocks from the pool. */
+typedef enum
+{
+    BUF_POOL_USER_NUS_TX,                /**< Writes queued by the NUS client. */
+    BUF_POOL_USER_NUS_RX,                /**< Data from the peer waiting for room in the UART TX FIFO. */
+    BUF_POOL_USER_STORE_FWD,             /**< Store-and-forward records in RAM. */
+    BUF_POOL_USER_COUNT                  /**< Number of stages. */
+} buf_pool_user_t;
+
+/**@brief Statistics of a stage. */
+typedef struct
+{
+    uint8_t  quota;                      /**< Most blocks the stage may hold. */
+    uint8_t  in_use;                     /**< Blocks the stage holds. */
+    uint8_t  high_water;                 /**< Most blocks the stage has held. */
+    uint32_t allocs;                     /**< Blocks allocated. */
+    uint32_t quota_fails;                /**< Allocations refused for the quota. */
+    uint32_t empty_fails;                /**< Allocations refused with the pool empty. */
+} buf_pool_user_stats_t;
+
+/**@brief Statistics of the pool. */
+typedef struct
+{
+    uint8_t               free;                       /**< Free blocks. */
+    uint8_t               free_low_water;             /**< Fewest free blocks there have been. */
+    buf_pool_user_stats_t users[BUF_POOL_USER_COUNT]; /**< Statistics per stage, indexed by @ref buf_pool_user_t. */
+} buf_pool_stats_t;
+
+/**@brief     Function for initializing the pool, with every block free and the quotas from
+ *            @ref buf_pool_cnfg.
+ */
+void buf_pool_init(void);
+
+/**@brief     Function for taking a block from the pool.
+ *
+ * @param[in] user Stage taking the block.
+ *
+ * @return    Block of @ref BUF_POOL_BLOCK_SIZE bytes, word aligned, or NULL if the stage is at its
+ *            quota or the pool is empty.
+ */
+void * buf_pool_alloc(buf_pool_user_t user);
+
+/**@brief     Function for giving a block back to the pool.
+ *
+ * @param[in] user    Stage that took the block.
+ * @param[in] p_block Block from @ref buf_pool_alloc.
+ */
+void buf_pool_free(buf_pool_user_t user, void * p_block);
+
+/**@brief     Function for changing the quota of a stage.
+ *
+ * @param[in] user  Stage.
+ * @param[in] quota Most blocks the stage may hold.
+ *
+ * @retval    NRF_SUCCESS             On success.
+ * @retval    NRF_ERROR_INVALID_PARAM If the stage does not exist, or the quota is 0 or larger
+ *                                    than the pool.
+ * @retval    NRF_ERROR_INVALID_STATE If the stage holds more blocks than the new quota. The
+ *                                    quota is not changed.
+ */
+uint32_t buf_pool_quota_set(buf_pool_user_t user, uint8_t quota);
+
+/**@brief     Function for getting the pool statistics.
+ *
+ * @param[out] p_stats Statistics since initialization.
+ */
+void buf_pool_stats_get(buf_pool_stats_t * p_stats);
+
+#endif // BUF_POOL_H__
+
+/** @} */
@@ -0,0 +1,159 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file ble_uart_c_cnfg.h
+ *
+ * @cond
+ * @defgroup ble_uart_c_cnfg NUS Client Configuration
+ * @ingroup ble_sdk_srv_uart_c
+ * @{
+ *
+ * @brief Defines application specific configuration for the NUS Client.
+ */
+
+
+#ifndef BLE_UART_C_CNFG_H__
+#define BLE_UART_C_CNFG_H__
+
+/**
+ * @brief Enables per-link rate limits and QoS classes.
+ *
+ * @details Each link gets a token bucket for the writes sent to the peer and one for the
+ *          notifications received from it, see @ref ble_uart_c_qos_set.
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : Uses two app_timers per client instance.
+ */
+#define BLE_UART_C_QOS_ENABLED           1
+
+/**
+ * @brief Default rate of the data written to a peer, in bytes per second. 0 for no limit.
+ *
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_QOS_TX_RATE           0
+
+/**
+ * @brief Default burst of the data written to a peer, in bytes.
+ *
+ *          Minimum value : 2 * @ref BLE_NUS_MAX_DATA_LEN
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_QOS_TX_BURST          240
+
+/**
+ * @brief Default rate of the data notified by a peer, in bytes per second. 0 for no limit.
+ *
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_QOS_RX_RATE           0
+
+/**
+ * @brief Default burst of the data notified by a peer, in bytes.
+ *
+ *          Minimum value : 2 * @ref BLE_NUS_MAX_DATA_LEN
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_QOS_RX_BURST          240
+
+/**
+ * @brief Notifications held back per link while its notified rate is over the budget.
+ *
+ * @details Each takes 21 bytes of RAM in the client instance.
+ *          Minimum value : 1
+ *          Maximum value : 255
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_QOS_RX_HOLD           8
+
+/**
+ * @brief Default policy for a notification beyond the budget when the hold queue is full.
+ *
+ * @details 0 passes the oldest held notification on beyond the budget, so nothing is lost.
+ *          1 drops the new notification.
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_QOS_RX_DROP           0
+
+/**
+ * @brief Enables the NUS discovery of the client, instead of the DB Discovery module.
+ *
+ * @details Only the NUS service is looked up, only its handle range is searched for
+ *          characteristics, and the search stops once the TX and RX characteristics and the
+ *          CCCD of RX are found, see @ref ble_uart_c_discover.
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_FAST_DISC_ENABLED     1
+
+/**
+ * @brief Enables the watchdog of the write request queue.
+ *
+ * @details A request the SoftDevice does not accept is retried from a timer, with backoff,
+ *          instead of waiting for a response that may never come, and a request left without
+ *          a response disconnects its link.
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : Uses two app_timers.
+ */
+#define BLE_UART_C_WDT_ENABLED           1
+
+/**
+ * @brief First delay before a request the SoftDevice did not accept is tried again, in milliseconds.
+ *
+ * @details The delay doubles with every retry of the same request, up to
+ *          @ref BLE_UART_C_WDT_RETRY_MAX_MS.
+ *          Minimum value : 1
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_WDT_RETRY_MS          10
+
+/**
+ * @brief Longest delay between retries, in milliseconds.
+ *
+ *          Minimum value : @ref BLE_UART_C_WDT_RETRY_MS
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_WDT_RETRY_MAX_MS      500
+
+/**
+ * @brief Time after which a request the SoftDevice keeps refusing is dropped, in milliseconds.
+ *
+ *          Minimum value : @ref BLE_UART_C_WDT_RETRY_MS
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_WDT_GIVE_UP_MS        5000
+
+/**
+ * @brief Time after which a link with a request left without a response is disconnected, in milliseconds.
+ *
+ * @details The SoftDevice gives up on the transaction only after 30 seconds.
+ *          Minimum value : Several connection intervals times (1 + slave latency).
+ *          Maximum value : 30000
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_WDT_ATT_TIMEOUT_MS    10000
+
+/**
+ * @brief Number of links whose requests are watched at the same time.
+ *
+ *          Minimum value : 1
+ *          Dependencies  : Need not exceed the central links of the SoftDevice.
+ */
+#define BLE_UART_C_WDT_LINKS             3
+
+/** @} */
+/** @endcond */
+#endif // BLE_UART_C_CNFG_H__
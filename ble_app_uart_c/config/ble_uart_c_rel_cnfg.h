@@ -0,0 +1,70 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file ble_uart_c_rel_cnfg.h
+ *
+ * @cond
+ * @defgroup ble_uart_c_rel_cnfg NUS Client Reliability Layer Configuration
+ * @ingroup ble_uart_c_rel
+ * @{
+ *
+ * @brief Defines application specific configuration for the NUS Client reliability layer.
+ */
+
+#ifndef BLE_UART_C_REL_CNFG_H__
+#define BLE_UART_C_REL_CNFG_H__
+
+/**
+ * @brief Enables the reliability layer on the UART to BLE data path.
+ *
+ * @details When enabled, UART data is sent to the peer as sequenced Write Commands and the
+ *          peer must run the matching protocol (see @ref ble_uart_c_rel). When disabled, data
+ *          is sent as plain Write Requests.
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_REL_ENABLED           0
+
+/**
+ * @brief Size of the retained send buffer, in frames.
+ *
+ * @details Upper bound for the window size given at initialization. Every slot costs
+ *          @ref BLE_NUS_MAX_DATA_LEN + 4 bytes of RAM.
+ *          Minimum value : 1
+ *          Maximum value : 8
+ *          Dependencies  : Must be a power of two.
+ */
+#define BLE_UART_C_REL_MAX_WINDOW        8
+
+/**
+ * @brief Default window size, in frames.
+ *
+ * @details Number of frames that may be unacknowledged at any time.
+ *          Minimum value : 1
+ *          Maximum value : @ref BLE_UART_C_REL_MAX_WINDOW
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_REL_WINDOW_SIZE       8
+
+/**
+ * @brief Retransmission timeout, in milliseconds.
+ *
+ * @details Time without acknowledgement progress after which all outstanding frames are
+ *          sent again. Should be a few connection intervals.
+ *          Dependencies  : None.
+ */
+#define BLE_UART_C_REL_RTO_MS            200
+
+/** @} */
+/** @endcond */
+#endif // BLE_UART_C_REL_CNFG_H__
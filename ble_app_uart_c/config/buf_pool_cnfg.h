@@ -0,0 +1,78 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file buf_pool_cnfg.h
+ *
+ * @cond
+ * @defgroup buf_pool_cnfg Buffer Pool Configuration
+ * @ingroup buf_pool
+ * @{
+ *
+ * @brief Defines application specific configuration for the buffer pool of the data path.
+ */
+
+#ifndef BUF_POOL_CNFG_H__
+#define BUF_POOL_CNFG_H__
+
+/**
+ * @brief Size of a block in bytes.
+ *
+ * @details A block holds one NUS packet, or one store-and-forward record.
+ *          Minimum value : 24
+ *          Dependencies  : Multiple of 4.
+ */
+#define BUF_POOL_BLOCK_SIZE              24
+
+/**
+ * @brief Number of blocks in the pool.
+ *
+ * @details The pool costs BUF_POOL_BLOCK_COUNT * BUF_POOL_BLOCK_SIZE bytes of RAM. The quotas
+ *          may add up to more than the pool, which then goes to whichever stage is busy.
+ *          Minimum value : 2
+ *          Maximum value : 255
+ *          Dependencies  : None.
+ */
+#define BUF_POOL_BLOCK_COUNT             28
+
+/**
+ * @brief Most blocks holding writes queued by the NUS client.
+ *
+ *          Minimum value : 1
+ *          Maximum value : @ref BUF_POOL_BLOCK_COUNT
+ *          Dependencies  : More than the NUS client has TX messages is never used.
+ */
+#define BUF_POOL_QUOTA_NUS_TX            7
+
+/**
+ * @brief Most blocks holding data from the peer that waits for room in the UART TX FIFO.
+ *
+ *          Minimum value : 1
+ *          Maximum value : @ref BUF_POOL_BLOCK_COUNT
+ *          Dependencies  : BUF_POOL_QUOTA_NUS_RX + BUF_POOL_QUOTA_STORE_FWD below
+ *                          @ref BUF_POOL_BLOCK_COUNT, so the NUS client always gets a block and
+ *                          the writes it completes keep the data moving.
+ */
+#define BUF_POOL_QUOTA_NUS_RX            10
+
+/**
+ * @brief Most blocks holding store-and-forward records in RAM.
+ *
+ *          Minimum value : 2
+ *          Maximum value : @ref BUF_POOL_BLOCK_COUNT
+ *          Dependencies  : See @ref BUF_POOL_QUOTA_NUS_RX. More than @ref STORE_FWD_RAM_RECORDS
+ *                          is never used.
+ */
+#define BUF_POOL_QUOTA_STORE_FWD         16
+
+/** @} */
+/** @endcond */
+#endif // BUF_POOL_CNFG_H__
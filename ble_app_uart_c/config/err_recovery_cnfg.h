@@ -0,0 +1,67 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file err_recovery_cnfg.h
+ *
+ * @cond
+ * @defgroup err_recovery_cnfg Error Recovery Configuration
+ * @ingroup err_recovery
+ * @{
+ *
+ * @brief Defines application specific configuration for the error recovery module.
+ */
+
+#ifndef ERR_RECOVERY_CNFG_H__
+#define ERR_RECOVERY_CNFG_H__
+
+/**
+ * @brief Delay, in milliseconds, before the first retry of an operation that failed with a
+ *        transient error.
+ *
+ * @details The delay doubles with every retry.
+ *          Minimum value : 1
+ *          Dependencies  : None.
+ */
+#define ERR_RECOVERY_RETRY_MS            20
+
+/**
+ * @brief Longest delay, in milliseconds, between two retries.
+ *
+ *          Minimum value : @ref ERR_RECOVERY_RETRY_MS
+ *          Dependencies  : None.
+ */
+#define ERR_RECOVERY_RETRY_MAX_MS        1000
+
+/**
+ * @brief Retries after which a transient error is handled as a link failure, or as a fault when
+ *        the operation is not bound to a link.
+ *
+ *          Minimum value : 1
+ *          Maximum value : 255
+ *          Dependencies  : None.
+ */
+#define ERR_RECOVERY_MAX_RETRIES         10
+
+/**
+ * @brief Number of operations that can wait for a retry at the same time.
+ *
+ * @details Each entry costs 20 bytes of RAM. An operation that finds no free entry is handled as
+ *          if it had run out of retries.
+ *          Minimum value : 1
+ *          Maximum value : 255
+ *          Dependencies  : Uses one app_timer.
+ */
+#define ERR_RECOVERY_MAX_PENDING         6
+
+/** @} */
+/** @endcond */
+#endif // ERR_RECOVERY_CNFG_H__
@@ -0,0 +1,55 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file evt_trace_cnfg.h
+ *
+ * @cond
+ * @defgroup evt_trace_cnfg Event Trace Configuration
+ * @ingroup evt_trace
+ * @{
+ *
+ * @brief Defines application specific configuration for the event trace recorder.
+ */
+
+#ifndef EVT_TRACE_CNFG_H__
+#define EVT_TRACE_CNFG_H__
+
+/**
+ * @brief Enables recording of the events handed to the application.
+ *
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : None.
+ */
+#define EVT_TRACE_ENABLED                0
+
+/**
+ * @brief Size, in bytes, of the RAM trace buffer, including its header.
+ *
+ * @details Recording stops when the buffer is full.
+ *          Minimum value : 64
+ *          Maximum value : 65535
+ *          Dependencies  : Multiple of 4.
+ */
+#define EVT_TRACE_BUF_SIZE               2048
+
+/**
+ * @brief Longest gap, in app_timer ticks, between two UART bytes recorded in the same record.
+ *
+ * @details Bytes arriving back to back share one record. The default is about 1 ms.
+ *          Dependencies  : None.
+ */
+#define EVT_TRACE_UART_MERGE_TICKS       33
+
+/** @} */
+/** @endcond */
+#endif // EVT_TRACE_CNFG_H__
@@ -0,0 +1,74 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file flash_sched_cnfg.h
+ *
+ * @cond
+ * @defgroup flash_sched_cnfg Flash Scheduler Configuration
+ * @ingroup flash_sched
+ * @{
+ *
+ * @brief Defines application specific configuration for the flash job scheduler.
+ */
+
+#ifndef FLASH_SCHED_CNFG_H__
+#define FLASH_SCHED_CNFG_H__
+
+/**
+ * @brief Maximum number of flash jobs waiting or in progress.
+ *
+ *          Minimum value : 1
+ *          Maximum value : 255
+ *          Dependencies  : None.
+ */
+#define FLASH_SCHED_QUEUE_SIZE           8
+
+/**
+ * @brief Maximum number of jobs handed to pstorage at a time.
+ *
+ * @details The device manager shares the pstorage command queue.
+ *          Minimum value : 1
+ *          Maximum value : PSTORAGE_CMD_QUEUE_SIZE - 1
+ *          Dependencies  : None.
+ */
+#define FLASH_SCHED_BATCH_SIZE           4
+
+/**
+ * @brief Maximum number of pstorage users registered through the scheduler.
+ *
+ *          Minimum value : 1
+ *          Maximum value : PSTORAGE_MAX_APPLICATIONS
+ *          Dependencies  : None.
+ */
+#define FLASH_SCHED_MAX_CLIENTS          2
+
+/**
+ * @brief Longest time, in milliseconds, a deferrable job waits for an idle window.
+ *
+ *          Dependencies  : None.
+ */
+#define FLASH_SCHED_MAX_DEFER_MS         10000
+
+/**
+ * @brief Highest scan duty cycle, in percent, used while flash work is pending.
+ *
+ * @details The SoftDevice runs flash operations between radio events, so the scanner leaves
+ *          part of each scan interval free instead of being held back until flash is idle.
+ *          Minimum value : 1
+ *          Maximum value : 99
+ *          Dependencies  : None.
+ */
+#define FLASH_SCHED_SCAN_DUTY_PERCENT    50
+
+/** @} */
+/** @endcond */
+#endif // FLASH_SCHED_CNFG_H__
@@ -0,0 +1,82 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file kv_store_cnfg.h
+ *
+ * @cond
+ * @defgroup kv_store_cnfg Key-Value Store Configuration
+ * @ingroup kv_store
+ * @{
+ *
+ * @brief Defines application specific configuration for the key-value store.
+ */
+
+#ifndef KV_STORE_CNFG_H__
+#define KV_STORE_CNFG_H__
+
+/**
+ * @brief Enables the key-value store for bridge state.
+ *
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : None.
+ */
+#define KV_STORE_ENABLED                 1
+
+/**
+ * @brief Number of flash pages used for the log.
+ *
+ * @details One page is always kept erased for compaction. More pages spread the erases wider.
+ *          Minimum value : 2
+ *          Maximum value : 254
+ *          Dependencies  : Increases the pstorage area, see pstorage_platform.h.
+ */
+#define KV_STORE_PAGES                   2
+
+/**
+ * @brief Number of keys. Keys are numbered from 0.
+ *
+ *          Minimum value : 1
+ *          Maximum value : 254
+ *          Dependencies  : All values must fit in one page, see @ref KV_STORE_MAX_VALUE_LEN.
+ */
+#define KV_STORE_MAX_KEYS                16
+
+/**
+ * @brief Maximum length of a value in bytes.
+ *
+ * @details Each value is stored with a 4 byte header and padded to a whole word.
+ *          Minimum value : 4
+ *          Maximum value : 252
+ *          Dependencies  : @ref KV_STORE_MAX_KEYS.
+ */
+#define KV_STORE_MAX_VALUE_LEN           32
+
+/**
+ * @brief Number of writes held in RAM until they are in flash.
+ *
+ * @details A write to a key that is already waiting replaces the waiting value.
+ *          Minimum value : 1
+ *          Maximum value : 255
+ *          Dependencies  : None.
+ */
+#define KV_STORE_QUEUE_SIZE              4
+
+/** @brief Flash pages claimed from pstorage. */
+#define KV_STORE_PSTORAGE_PAGES          ((KV_STORE_ENABLED) ? (KV_STORE_PAGES) : 0)
+
+/** @brief pstorage applications claimed. */
+#define KV_STORE_PSTORAGE_APPS           ((KV_STORE_ENABLED) ? 1 : 0)
+
+/** @} */
+/** @endcond */
+#endif // KV_STORE_CNFG_H__
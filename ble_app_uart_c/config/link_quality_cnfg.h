@@ -0,0 +1,112 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file link_quality_cnfg.h
+ *
+ * @cond
+ * @defgroup link_quality_cnfg Link Quality Configuration
+ * @ingroup link_quality
+ * @{
+ *
+ * @brief Defines application specific configuration for the link quality telemetry.
+ */
+
+#ifndef LINK_QUALITY_CNFG_H__
+#define LINK_QUALITY_CNFG_H__
+
+/**
+ * @brief Builds in the link quality telemetry and the adaptive TX power policy.
+ *
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : Uses one app_timer.
+ */
+#define LINK_QUALITY_ENABLED             1
+
+/**
+ * @brief Number of links tracked at the same time.
+ *
+ * @details Each link costs 20 bytes of RAM and 17 bytes of every report.
+ *          Minimum value : 1
+ *          Maximum value : 12
+ *          Dependencies  : None.
+ */
+#define LINK_QUALITY_MAX_LINKS           3
+
+/**
+ * @brief Smallest change of the RSSI, in dB, the SoftDevice reports.
+ *
+ *          Minimum value : 1
+ *          Dependencies  : None.
+ */
+#define LINK_QUALITY_RSSI_THRESHOLD_DB   2
+
+/**
+ * @brief Number of RSSI samples that must differ by @ref LINK_QUALITY_RSSI_THRESHOLD_DB before
+ *        the SoftDevice reports a change.
+ *
+ *          Minimum value : 0
+ *          Dependencies  : None.
+ */
+#define LINK_QUALITY_RSSI_SKIP_COUNT     2
+
+/**
+ * @brief Weight of a new RSSI sample in the average, as a power of two: the new sample counts
+ *        1/2^n.
+ *
+ *          Minimum value : 0
+ *          Maximum value : 7
+ *          Dependencies  : None.
+ */
+#define LINK_QUALITY_RSSI_AVG_SHIFT      3
+
+/**
+ * @brief Time between two reports, and between two TX power decisions, in milliseconds.
+ *
+ *          Minimum value : 100
+ *          Dependencies  : None.
+ */
+#define LINK_QUALITY_REPORT_MS           1000
+
+/**
+ * @brief TX power, in dBm, assumed for the peers when estimating the path loss from the RSSI.
+ *
+ *          Dependencies  : None.
+ */
+#define LINK_QUALITY_PEER_TX_POWER_DBM   0
+
+/**
+ * @brief RSSI, in dBm, the adaptive TX power policy aims for at the peer.
+ *
+ * @details About 20 dB above the receiver sensitivity leaves room for fading.
+ *          Dependencies  : None.
+ */
+#define LINK_QUALITY_TARGET_RSSI_DBM     (-70)
+
+/**
+ * @brief Margin, in dB, the path loss must improve by before the TX power is lowered again.
+ *
+ *          Minimum value : 0
+ *          Dependencies  : None.
+ */
+#define LINK_QUALITY_TX_POWER_HYST_DB    4
+
+/**
+ * @brief TX power, in dBm, used while the adaptive policy is off and while there is no link.
+ *
+ *          Dependencies  : One of -40, -30, -20, -16, -12, -8, -4, 0 and 4.
+ */
+#define LINK_QUALITY_TX_POWER_DEFAULT    0
+
+/** @} */
+/** @endcond */
+#endif // LINK_QUALITY_CNFG_H__
@@ -0,0 +1,92 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file lzss_cnfg.h
+ *
+ * @cond
+ * @defgroup lzss_cnfg LZSS Compression Configuration
+ * @ingroup lzss
+ * @{
+ *
+ * @brief Defines application specific configuration for the LZSS compression of NUS data.
+ */
+
+#ifndef LZSS_CNFG_H__
+#define LZSS_CNFG_H__
+
+/**
+ * @brief Builds in the compression of the data exchanged with the peer. It is switched on at
+ *        runtime, and the peer must decompress and compress with the same settings.
+ *
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : None.
+ */
+#define LZSS_ENABLED                     1
+
+/**
+ * @brief Size of the window matches are searched in, as a power of two.
+ *
+ * @details Each direction of a link keeps a window of 2^n bytes in RAM. A larger window finds
+ *          more matches, see @ref LZSS_CHAIN_MAX for the time the encoder spends on them. This and
+ *          @ref LZSS_LENGTH_BITS may be set on the compiler command line, as the host checks do.
+ *          Minimum value : 4
+ *          Maximum value : 12
+ *          Dependencies  : LZSS_WINDOW_BITS + LZSS_LENGTH_BITS from 8 up to 16.
+ */
+#ifndef LZSS_WINDOW_BITS
+#define LZSS_WINDOW_BITS                 8
+#endif
+
+/**
+ * @brief Bits of the match length, which sets the longest match: 2^n + 1 bytes.
+ *
+ *          Minimum value : 2
+ *          Maximum value : 8
+ *          Dependencies  : LZSS_WINDOW_BITS + LZSS_LENGTH_BITS from 8 up to 16.
+ */
+#ifndef LZSS_LENGTH_BITS
+#define LZSS_LENGTH_BITS                 4
+#endif
+
+/**
+ * @brief Bits of the hash of the two bytes a match starts with, which the encoder looks matches
+ *        up by.
+ *
+ * @details The encoder keeps, per direction, the last position of each hash and a chain from
+ *          every window position to the one before it with the same hash, 2 * (2^n +
+ *          2^LZSS_WINDOW_BITS) bytes beyond the window. Fewer bits share chains between more
+ *          byte pairs, which only costs search time. The encoder also keeps a table of 2^n
+ *          positions on the stack.
+ *          Minimum value : 1
+ *          Maximum value : 8
+ *          Dependencies  : None.
+ */
+#ifndef LZSS_HASH_BITS
+#define LZSS_HASH_BITS                   6
+#endif
+
+/**
+ * @brief Most window positions the encoder tries for each match, newest first.
+ *
+ * @details Bounds the time spent on a byte. The longest match is taken as soon as it is found.
+ *          Minimum value : 1
+ *          Maximum value : 2^LZSS_WINDOW_BITS
+ *          Dependencies  : None.
+ */
+#ifndef LZSS_CHAIN_MAX
+#define LZSS_CHAIN_MAX                   16
+#endif
+
+/** @} */
+/** @endcond */
+#endif // LZSS_CNFG_H__
@@ -21,6 +21,8 @@
 
 #include <stdint.h>
 #include "nrf.h"
+#include "store_fwd_cnfg.h"
+#include "kv_store_cnfg.h"
 
 static __INLINE uint16_t pstorage_flash_page_size()
 {
@@ -40,11 +42,11 @@ static __INLINE uint32_t pstorage_flash_page_end()
 
 #define PSTORAGE_FLASH_PAGE_END pstorage_flash_page_end()
 
-#define PSTORAGE_NUM_OF_PAGES       1                                                           /**< Number of flash pages allocated for the pstorage module excluding the swap page, configurable based on system requirements. */
-#define PSTORAGE_MAX_APPLICATIONS   1                                                           /**< Maximum number of applications that can be registered with the module, configurable based on system requirements. */
+#define PSTORAGE_NUM_OF_PAGES       (1 + STORE_FWD_PSTORAGE_PAGES + KV_STORE_PSTORAGE_PAGES)    /**< Number of flash pages allocated for the pstorage module excluding the swap page, configurable based on system requirements. One page for the device manager plus the store-and-forward spill area and the key-value log. */
+#define PSTORAGE_MAX_APPLICATIONS   (1 + STORE_FWD_PSTORAGE_APPS + KV_STORE_PSTORAGE_APPS)      /**< Maximum number of applications that can be registered with the module, configurable based on system requirements. */
 #define PSTORAGE_MIN_BLOCK_SIZE     0x0010                                                      /**< Minimum size of block that can be registered with the module. Should be configured based on system requirements, recommendation is not have this value to be at least size of word. */
 
-#define PSTORAGE_DATA_START_ADDR    ((PSTORAGE_FLASH_PAGE_END - PSTORAGE_MAX_APPLICATIONS - 1) \
+#define PSTORAGE_DATA_START_ADDR    ((PSTORAGE_FLASH_PAGE_END - PSTORAGE_NUM_OF_PAGES - 1) \
                                     * PSTORAGE_FLASH_PAGE_SIZE)                                 /**< Start address for persistent data, configurable according to system requirements. */
 #define PSTORAGE_DATA_END_ADDR      ((PSTORAGE_FLASH_PAGE_END - 1) * PSTORAGE_FLASH_PAGE_SIZE)  /**< End address for persistent data, configurable according to system requirements. */
 #define PSTORAGE_SWAP_ADDR          PSTORAGE_DATA_END_ADDR                                      /**< Top-most page is used as swap area for clear and update. */
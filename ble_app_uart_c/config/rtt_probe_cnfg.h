@@ -0,0 +1,87 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file rtt_probe_cnfg.h
+ *
+ * @cond
+ * @defgroup rtt_probe_cnfg Round Trip Probe Configuration
+ * @ingroup rtt_probe
+ * @{
+ *
+ * @brief Defines application specific configuration for the round trip latency probe.
+ */
+
+#ifndef RTT_PROBE_CNFG_H__
+#define RTT_PROBE_CNFG_H__
+
+/**
+ * @brief Builds in the round trip latency probe. It is switched on at runtime.
+ *
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : Uses one app_timer.
+ */
+#define RTT_PROBE_ENABLED                1
+
+/**
+ * @brief Default time between two probes, in milliseconds.
+ *
+ *          Minimum value : @ref RTT_PROBE_INTERVAL_MIN_MS
+ *          Dependencies  : None.
+ */
+#define RTT_PROBE_INTERVAL_MS            100
+
+/**
+ * @brief Shortest time between two probes, in milliseconds.
+ *
+ *          Minimum value : 1
+ *          Dependencies  : None.
+ */
+#define RTT_PROBE_INTERVAL_MIN_MS        5
+
+/**
+ * @brief Width of a round trip time histogram bin, in milliseconds.
+ *
+ *          Minimum value : 1
+ *          Dependencies  : None.
+ */
+#define RTT_PROBE_BIN_MS                 5
+
+/**
+ * @brief Number of round trip time histogram bins. The last one also counts longer round trips.
+ *
+ * @details Each bin costs 4 bytes of RAM and 2 bytes of every report.
+ *          Minimum value : 2
+ *          Maximum value : 32
+ *          Dependencies  : None.
+ */
+#define RTT_PROBE_BINS                   16
+
+/**
+ * @brief Number of the most recent probes waited for. An older probe without an echo is lost.
+ *
+ *          Minimum value : 1
+ *          Maximum value : 32
+ *          Dependencies  : None.
+ */
+#define RTT_PROBE_WINDOW                 32
+
+/**
+ * @brief Time between two reports on the UART while the probe runs, in milliseconds.
+ *
+ *          Dependencies  : None.
+ */
+#define RTT_PROBE_REPORT_MS              1000
+
+/** @} */
+/** @endcond */
+#endif // RTT_PROBE_CNFG_H__
@@ -0,0 +1,79 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file scan_gw_cnfg.h
+ *
+ * @cond
+ * @defgroup scan_gw_cnfg Scanner Gateway Configuration
+ * @ingroup scan_gw
+ * @{
+ *
+ * @brief Defines application specific configuration for the scanner gateway.
+ */
+
+#ifndef SCAN_GW_CNFG_H__
+#define SCAN_GW_CNFG_H__
+
+/**
+ * @brief Builds in the scanner gateway. It is switched on at runtime.
+ *
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : Uses one app_timer.
+ */
+#define SCAN_GW_ENABLED                  1
+
+/**
+ * @brief Largest batch of records sent in one frame, in bytes.
+ *
+ * @details A record takes 13 bytes plus the advertising data.
+ *          Minimum value : 44
+ *          Maximum value : 255
+ *          Dependencies  : None.
+ */
+#define SCAN_GW_BATCH_SIZE               240
+
+/**
+ * @brief Longest time, in milliseconds, a record waits for its batch to fill up.
+ *
+ *          Dependencies  : None.
+ */
+#define SCAN_GW_FLUSH_MS                 50
+
+/**
+ * @brief Default deduplication window, in milliseconds. 0 reports every advertisement.
+ *
+ *          Dependencies  : None.
+ */
+#define SCAN_GW_DEDUP_MS                 1000
+
+/**
+ * @brief Number of recent devices remembered for deduplication.
+ *
+ * @details Each entry costs 12 bytes of RAM.
+ *          Minimum value : 1
+ *          Dependencies  : None.
+ */
+#define SCAN_GW_DEDUP_ENTRIES            32
+
+/**
+ * @brief Most bytes the gateway writes to the UART in a burst.
+ *
+ * @details Output beyond the UART rate is limited to this, so it must not exceed the UART TX FIFO.
+ *          Minimum value : @ref SCAN_GW_BATCH_SIZE + 5
+ *          Dependencies  : UART_TX_BUF_SIZE in main.c.
+ */
+#define SCAN_GW_BURST_BYTES              256
+
+/** @} */
+/** @endcond */
+#endif // SCAN_GW_CNFG_H__
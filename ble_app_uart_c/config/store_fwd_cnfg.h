@@ -0,0 +1,80 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file store_fwd_cnfg.h
+ *
+ * @cond
+ * @defgroup store_fwd_cnfg Store-and-Forward Configuration
+ * @ingroup store_fwd
+ * @{
+ *
+ * @brief Defines application specific configuration for the UART store-and-forward buffer.
+ */
+
+#ifndef STORE_FWD_CNFG_H__
+#define STORE_FWD_CNFG_H__
+
+/**
+ * @brief Enables buffering of UART data while the link to the peer is down.
+ *
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : None.
+ */
+#define STORE_FWD_ENABLED                1
+
+/**
+ * @brief Number of records held in RAM.
+ *
+ * @details Each record holds one UART packet in a @ref buf_pool block, and costs a pointer of
+ *          RAM while it is not in use.
+ *          Minimum value : 2
+ *          Maximum value : 255
+ *          Dependencies  : Up to @ref BUF_POOL_QUOTA_STORE_FWD records are held.
+ */
+#define STORE_FWD_RAM_RECORDS            16
+
+/**
+ * @brief Number of free RAM records below which the oldest records are moved to flash.
+ *
+ * @details Flash writes take time to complete, so spilling starts before RAM is full.
+ *          Minimum value : 1
+ *          Maximum value : @ref STORE_FWD_RAM_RECORDS - 1
+ *          Dependencies  : @ref STORE_FWD_FLASH_PAGES > 0.
+ */
+#define STORE_FWD_SPILL_HEADROOM         4
+
+/**
+ * @brief Number of flash pages reserved for records spilled from RAM.
+ *
+ * @details Set to 0 to keep records in RAM only. Each 1 kB page holds 42 records.
+ *          Minimum value : 0
+ *          Dependencies  : Increases the pstorage area, see pstorage_platform.h.
+ */
+#define STORE_FWD_FLASH_PAGES            2
+
+/**
+ * @brief Default policy when both RAM and flash are full, see @ref store_fwd_policy_t.
+ *
+ *          Dependencies  : None.
+ */
+#define STORE_FWD_DEFAULT_POLICY         STORE_FWD_POLICY_DROP_OLDEST_RAM
+
+/** @brief Flash pages claimed from pstorage. */
+#define STORE_FWD_PSTORAGE_PAGES         ((STORE_FWD_ENABLED) ? (STORE_FWD_FLASH_PAGES) : 0)
+
+/** @brief pstorage applications claimed. */
+#define STORE_FWD_PSTORAGE_APPS          ((STORE_FWD_PSTORAGE_PAGES) > 0 ? 1 : 0)
+
+/** @} */
+/** @endcond */
+#endif // STORE_FWD_CNFG_H__
@@ -0,0 +1,67 @@
+/* Copyright (C) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+ /**
+ * @file uart_cmd_cnfg.h
+ *
+ * @cond
+ * @defgroup uart_cmd_cnfg UART Command Channel Configuration
+ * @ingroup uart_cmd
+ * @{
+ *
+ * @brief Defines application specific configuration for the UART command channel.
+ */
+
+#ifndef UART_CMD_CNFG_H__
+#define UART_CMD_CNFG_H__
+
+/**
+ * @brief Enables the command channel on the UART.
+ *
+ * @details The channel is closed at reset, and data passes through it untouched until the host
+ *          opens it, see @ref uart_cmd. While it is open, the escape byte is doubled in both
+ *          directions wherever it is data.
+ *          Minimum value : 0
+ *          Maximum value : 1
+ *          Dependencies  : None.
+ */
+#define UART_CMD_ENABLED                 1
+
+/**
+ * @brief Byte that starts a command or response frame.
+ *
+ * @details DLE is rare in text, so a terminal session is not affected.
+ *          Dependencies  : None.
+ */
+#define UART_CMD_ESC                     0x10
+
+/**
+ * @brief Silence on the UART before an OPEN request, in milliseconds.
+ *
+ * @details An OPEN request is only taken when nothing has been received for this long, or
+ *          since reset, so that data holding the same bytes is passed on as data.
+ *          Minimum value : 1
+ *          Dependencies  : None.
+ */
+#define UART_CMD_GUARD_MS                500
+
+/**
+ * @brief Longest parameter value, in bytes.
+ *
+ *          Minimum value : 4
+ *          Maximum value : 255
+ *          Dependencies  : None.
+ */
+#define UART_CMD_MAX_VALUE_LEN           16
+
+/** @} */
+/** @endcond */
+#endif // UART_CMD_CNFG_H__
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "err_recovery.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "ble.h"
+#include "ble_hci.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+STATIC_ASSERT(ERR_RECOVERY_RETRY_MAX_MS >= ERR_RECOVERY_RETRY_MS);
+
+/**@brief Operation waiting for a retry. */
+typedef struct
+{
+    err_recovery_op_t op;                /**< Function running the operation. */
+    const uint8_t   * p_file_name;       /**< File of the first failure, reported for a fault. */
+    uint32_t          line_num;          /**< Line of the first failure, reported for a fault. */
+    uint32_t          due;               /**< When the retry is due, on the m_clock scale. */
+    uint16_t          conn_handle;       /**< Link the operation is bound to. */
+    uint8_t           retries;           /**< Retries run so far. */
+} pending_t;
+
+static err_recovery_init_t  m_init;                                /**< Copy of the initialization parameters. */
+static err_recovery_stats_t m_stats;                               /**< Statistics. */
+static app_timer_id_t       m_timer_id;                            /**< Retry timer. */
+static uint32_t             m_clock;                               /**< Ticks since initialization, wider than the RTC counter. */
+static uint32_t             m_cnt_last;                            /**< RTC counter when m_clock was last updated. */
+static pending_t            m_pending[ERR_RECOVERY_MAX_PENDING];   /**< Operations waiting for a retry. */
+static uint8_t              m_pending_count;                       /**< Entries of m_pending in use. */
+
+static void clock_update(void)
+{
+    uint32_t cnt;
+    uint32_t diff;
+
+    UNUSED_VARIABLE(app_timer_cnt_get(&cnt));
+    UNUSED_VARIABLE(app_timer_cnt_diff_compute(cnt, m_cnt_last, &diff));
+    m_clock   += diff;
+    m_cnt_last = cnt;
+}
+
+
+static pending_t * pending_find(err_recovery_op_t op, uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < m_pending_count; i++)
+    {
+        if ((m_pending[i].op == op) && (m_pending[i].conn_handle == conn_handle))
+        {
+            return &m_pending[i];
+        }
+    }
+    return NULL;
+}
+
+
+static void pending_remove(pending_t * p_pending)
+{
+    *p_pending = m_pending[--m_pending_count];
+}
+
+
+/**@brief Function for starting the timer for the earliest retry, if there is one.
+ */
+static void timer_start(void)
+{
+    uint32_t ticks = UINT32_MAX;
+    uint32_t err_code;
+    uint8_t  i;
+
+    UNUSED_VARIABLE(app_timer_stop(m_timer_id));
+    if (m_pending_count == 0)
+    {
+        return;
+    }
+
+    clock_update();
+    for (i = 0; i < m_pending_count; i++)
+    {
+        int32_t left = (int32_t)(m_pending[i].due - m_clock);
+
+        ticks = MIN(ticks, (left > 0) ? (uint32_t)left : 0);
+    }
+    // Nothing else would run the retries, so a timer that cannot be started is a fault.
+    err_code = app_timer_start(m_timer_id, MAX(ticks, APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+static void link_teardown(uint16_t conn_handle)
+{
+    m_stats.link++;
+    err_recovery_link_down(conn_handle);
+
+    // The link may already be going down, in which case there is nothing more to do.
+    UNUSED_VARIABLE(sd_ble_gap_disconnect(conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION));
+}
+
+
+/**@brief Function for scheduling the next retry of an operation.
+ *
+ * @return false if the operation has run out of retries, or there is no room for it.
+ */
+static bool retry_schedule(err_recovery_op_t op,
+                           uint16_t          conn_handle,
+                           uint32_t          line_num,
+                           const uint8_t   * p_file_name)
+{
+    pending_t * p_pending = pending_find(op, conn_handle);
+    uint32_t    delay_ms;
+
+    if (p_pending == NULL)
+    {
+        if (m_pending_count == ERR_RECOVERY_MAX_PENDING)
+        {
+            return false;
+        }
+        p_pending              = &m_pending[m_pending_count++];
+        p_pending->op          = op;
+        p_pending->conn_handle = conn_handle;
+        p_pending->line_num    = line_num;
+        p_pending->p_file_name = p_file_name;
+        p_pending->retries     = 0;
+    }
+    else if (p_pending->retries >= ERR_RECOVERY_MAX_RETRIES)
+    {
+        pending_remove(p_pending);
+        return false;
+    }
+
+    delay_ms = ERR_RECOVERY_RETRY_MS << MIN(p_pending->retries, 16);
+    delay_ms = MIN(delay_ms, ERR_RECOVERY_RETRY_MAX_MS);
+
+    clock_update();
+    p_pending->due = m_clock + APP_TIMER_TICKS(delay_ms, m_init.prescaler);
+    return true;
+}
+
+
+static void error_handle(uint32_t          err_code,
+                         err_recovery_op_t op,
+                         uint16_t          conn_handle,
+                         uint32_t          line_num,
+                         const uint8_t   * p_file_name)
+{
+    pending_t * p_pending;
+
+    switch (err_recovery_classify(err_code, conn_handle))
+    {
+        case ERR_RECOVERY_CLASS_NONE:
+            p_pending = pending_find(op, conn_handle);
+            if (p_pending != NULL)
+            {
+                pending_remove(p_pending);
+            }
+            break;
+
+        case ERR_RECOVERY_CLASS_TRANSIENT:
+            m_stats.transient++;
+            if ((op == NULL) || retry_schedule(op, conn_handle, line_num, p_file_name))
+            {
+                break;
+            }
+            m_stats.exhausted++;
+            if (conn_handle == BLE_CONN_HANDLE_INVALID)
+            {
+                app_error_handler(err_code, line_num, p_file_name);
+                break;
+            }
+            link_teardown(conn_handle);
+            break;
+
+        case ERR_RECOVERY_CLASS_LINK:
+            link_teardown(conn_handle);
+            break;
+
+        default:
+            app_error_handler(err_code, line_num, p_file_name);
+            break;
+    }
+}
+
+
+static void retry_timeout_handler(void * p_context)
+{
+    uint32_t err_code;
+    uint8_t  i;
+
+    UNUSED_PARAMETER(p_context);
+
+    clock_update();
+    i = 0;
+    while (i < m_pending_count)
+    {
+        pending_t pending = m_pending[i];
+
+        if ((int32_t)(pending.due - m_clock) > 0)
+        {
+            i++;
+            continue;
+        }
+
+        // The entry stays in place, so that a failure finds it with its retry count.
+        m_pending[i].retries++;
+        m_stats.retries++;
+        err_code = pending.op(pending.conn_handle);
+        if (err_code == NRF_SUCCESS)
+        {
+            m_stats.recovered++;
+        }
+        error_handle(err_code, pending.op, pending.conn_handle, pending.line_num, pending.p_file_name);
+        // Entries may have moved, so start over.
+        i = 0;
+    }
+    timer_start();
+}
+
+
+uint32_t err_recovery_init(const err_recovery_init_t * p_init)
+{
+    if (p_init->uart_resync == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_init          = *p_init;
+    m_clock         = 0;
+    m_pending_count = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+    UNUSED_VARIABLE(app_timer_cnt_get(&m_cnt_last));
+
+    return app_timer_create(&m_timer_id, APP_TIMER_MODE_SINGLE_SHOT, retry_timeout_handler);
+}
+
+
+err_recovery_class_t err_recovery_classify(uint32_t err_code, uint16_t conn_handle)
+{
+    switch (err_code)
+    {
+        case NRF_SUCCESS:
+            return ERR_RECOVERY_CLASS_NONE;
+
+        case NRF_ERROR_BUSY:
+        case NRF_ERROR_NO_MEM:
+        case NRF_ERROR_INVALID_STATE:
+        case BLE_ERROR_NO_TX_BUFFERS:
+            return ERR_RECOVERY_CLASS_TRANSIENT;
+
+        case NRF_ERROR_TIMEOUT:
+        case NRF_ERROR_INVALID_PARAM:
+        case BLE_ERROR_INVALID_CONN_HANDLE:
+            return (conn_handle != BLE_CONN_HANDLE_INVALID) ? ERR_RECOVERY_CLASS_LINK :
+                                                              ERR_RECOVERY_CLASS_FAULT;
+
+        default:
+            return ERR_RECOVERY_CLASS_FAULT;
+    }
+}
+
+
+void err_recovery_check(uint32_t          err_code,
+                        err_recovery_op_t op,
+                        uint16_t          conn_handle,
+                        uint32_t          line_num,
+                        const uint8_t   * p_file_name)
+{
+    uint8_t pending_count = m_pending_count;
+
+    error_handle(err_code, op, conn_handle, line_num, p_file_name);
+    if (m_pending_count != pending_count)
+    {
+        timer_start();
+    }
+}
+
+
+void err_recovery_uart_error(uint32_t err_code)
+{
+    UNUSED_PARAMETER(err_code);
+
+    m_stats.uart++;
+    m_init.uart_resync();
+}
+
+
+void err_recovery_link_down(uint16_t conn_handle)
+{
+    uint8_t i = 0;
+
+    while (i < m_pending_count)
+    {
+        if (m_pending[i].conn_handle == conn_handle)
+        {
+            pending_remove(&m_pending[i]);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+
+void err_recovery_stats_get(err_recovery_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup err_recovery Error Recovery
+ * @{
+ * @brief    Handles errors on the data path by class instead of resetting on every one.
+ *
+ * @details  An error returned by an operation is sorted into one of these classes:
+ *
+ *           - Transient: the SoftDevice is out of buffers or busy with another procedure
+ *             (NRF_ERROR_BUSY, NRF_ERROR_NO_MEM, BLE_ERROR_NO_TX_BUFFERS, NRF_ERROR_INVALID_STATE).
+ *             The operation is run again from a timer, with the delay doubling from
+ *             @ref ERR_RECOVERY_RETRY_MS up to @ref ERR_RECOVERY_RETRY_MAX_MS, until it succeeds
+ *             or runs out of retries.
+ *           - Link: the failure only concerns one link (BLE_ERROR_INVALID_CONN_HANDLE,
+ *             NRF_ERROR_TIMEOUT, NRF_ERROR_INVALID_PARAM on an operation bound to a link, or a
+ *             transient error that outlived its retries). The link is disconnected, and the
+ *             application reconnects it as after any other disconnection.
+ *           - Fault: anything else, and a transient error of an operation that is not bound to
+ *             a link once it has run out of retries. It is passed to app_error_handler.
+ *
+ *           UART errors form a class of their own: the application is asked to drop the line
+ *           the error damaged and to resynchronize, and the UART keeps running.
+ */
+
+#ifndef ERR_RECOVERY_H__
+#define ERR_RECOVERY_H__
+
+#include <stdint.h>
+#include "err_recovery_cnfg.h"
+
+/**@brief Error class. */
+typedef enum
+{
+    ERR_RECOVERY_CLASS_NONE,             /**< No error. */
+    ERR_RECOVERY_CLASS_TRANSIENT,        /**< Retried after a delay. */
+    ERR_RECOVERY_CLASS_LINK,             /**< The link is disconnected. */
+    ERR_RECOVERY_CLASS_FAULT             /**< Passed to app_error_handler. */
+} err_recovery_class_t;
+
+/**@brief Operation that can be retried.
+ *
+ * @param[in] conn_handle Link the operation is bound to, or BLE_CONN_HANDLE_INVALID.
+ *
+ * @return    NRF_SUCCESS, or the error code of the SoftDevice or module call that failed.
+ */
+typedef uint32_t (* err_recovery_op_t) (uint16_t conn_handle);
+
+/**@brief Function for dropping partial UART input and resynchronizing after a UART error. */
+typedef void (* err_recovery_uart_resync_t) (void);
+
+/**@brief Error recovery initialization structure. */
+typedef struct
+{
+    err_recovery_uart_resync_t uart_resync; /**< Function called on a UART error. */
+    uint32_t                   prescaler;   /**< RTC1 prescaler of the app_timer module. */
+} err_recovery_init_t;
+
+/**@brief Error recovery statistics. */
+typedef struct
+{
+    uint32_t transient;                  /**< Transient errors. */
+    uint32_t retries;                    /**< Operations run again. */
+    uint32_t recovered;                  /**< Operations that succeeded on a retry. */
+    uint32_t exhausted;                  /**< Transient errors that outlived their retries. */
+    uint32_t link;                       /**< Links disconnected. */
+    uint32_t uart;                       /**< UART errors. */
+} err_recovery_stats_t;
+
+/**@brief Macro for handling the result of an operation, in place of APP_ERROR_CHECK.
+ *
+ * @param[in] ERR_CODE    Result of the operation.
+ * @param[in] OP          Function running the operation again, or NULL if it is not to be retried.
+ * @param[in] CONN_HANDLE Link the operation is bound to, or BLE_CONN_HANDLE_INVALID.
+ */
+#define ERR_RECOVERY_CHECK(ERR_CODE, OP, CONN_HANDLE)                                           \
+    err_recovery_check((ERR_CODE), (OP), (CONN_HANDLE), __LINE__, (const uint8_t *)__FILE__)
+
+/**@brief     Function for initializing the error recovery module.
+ *
+ * @param[in] p_init Initialization parameters.
+ *
+ * @retval    NRF_SUCCESS    On success.
+ * @retval    NRF_ERROR_NULL If the resync function is missing.
+ * @return    Otherwise an error code propagated from @ref app_timer_create.
+ */
+uint32_t err_recovery_init(const err_recovery_init_t * p_init);
+
+/**@brief     Function for getting the class of an error.
+ *
+ * @param[in] err_code    Error code.
+ * @param[in] conn_handle Link the failed operation is bound to, or BLE_CONN_HANDLE_INVALID.
+ *
+ * @return    Class of the error.
+ */
+err_recovery_class_t err_recovery_classify(uint32_t err_code, uint16_t conn_handle);
+
+/**@brief     Function for handling the result of an operation. Use @ref ERR_RECOVERY_CHECK.
+ *
+ * @details   Success cancels a pending retry of the same operation on the same link. A transient
+ *            error of an operation without a retry function is only counted, and the caller
+ *            drops the data or waits for the peer to repeat its request.
+ *
+ * @param[in] err_code    Result of the operation.
+ * @param[in] op          Function running the operation again, or NULL.
+ * @param[in] conn_handle Link the operation is bound to, or BLE_CONN_HANDLE_INVALID.
+ * @param[in] line_num    Line reported to app_error_handler for a fault.
+ * @param[in] p_file_name File reported to app_error_handler for a fault.
+ */
+void err_recovery_check(uint32_t          err_code,
+                        err_recovery_op_t op,
+                        uint16_t          conn_handle,
+                        uint32_t          line_num,
+                        const uint8_t   * p_file_name);
+
+/**@brief     Function for handling a UART communication or FIFO error.
+ *
+ * @param[in] err_code ERRORSRC of the UART, or the error code of the FIFO.
+ */
+void err_recovery_uart_error(uint32_t err_code);
+
+/**@brief     Function for cancelling the retries of a link that has gone down.
+ *
+ * @param[in] conn_handle Link that has gone down.
+ */
+void err_recovery_link_down(uint16_t conn_handle);
+
+/**@brief     Function for getting the error recovery statistics.
+ *
+ * @param[out] p_stats Statistics since initialization.
+ */
+void err_recovery_stats_get(err_recovery_stats_t * p_stats);
+
+#endif // ERR_RECOVERY_H__
+
+/** @} */
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "evt_trace.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "nordic_common.h"
+
+#define RECORDS_SIZE            (EVT_TRACE_BUF_SIZE - sizeof(evt_trace_header_t))  /**< Room for records. */
+#define REC_DELTA_MAX           0xFFFF                                                /**< Longest gap a record header holds. */
+
+STATIC_ASSERT((EVT_TRACE_BUF_SIZE % sizeof(uint32_t)) == 0);
+STATIC_ASSERT(sizeof(evt_trace_header_t) == 16);
+
+static uint32_t             m_buffer[EVT_TRACE_BUF_SIZE / sizeof(uint32_t)];  /**< Trace, word aligned for the header. */
+static evt_trace_header_t * mp_header = (evt_trace_header_t *)m_buffer;
+static uint8_t            * mp_records = (uint8_t *)m_buffer + sizeof(evt_trace_header_t);
+static uint32_t             m_rec_ticks;     /**< Time of the last record. */
+static uint32_t             m_byte_ticks;    /**< Time of the last UART byte. */
+static uint32_t             m_uart_rec;      /**< Offset of the last record if it holds UART bytes that more can be added to. */
+static bool                 m_uart_open;     /**< m_uart_rec is valid. */
+
+
+static uint32_t ticks_get(void)
+{
+    uint32_t ticks;
+
+    UNUSED_VARIABLE(app_timer_cnt_get(&ticks));
+    return ticks;
+}
+
+
+static uint32_t ticks_diff(uint32_t to, uint32_t from)
+{
+    uint32_t diff;
+
+    UNUSED_VARIABLE(app_timer_cnt_diff_compute(to, from, &diff));
+    return diff;
+}
+
+
+static void header_put(uint8_t * p_dst, evt_trace_rec_type_t type, uint16_t delta, uint16_t len)
+{
+    p_dst[0] = (uint8_t)type;
+    UNUSED_VARIABLE(uint16_encode(delta, &p_dst[1]));
+    UNUSED_VARIABLE(uint16_encode(len, &p_dst[3]));
+}
+
+
+/**@brief Function for appending a record.
+ *
+ * @return Where to write the payload, or NULL if the record does not fit.
+ */
+static uint8_t * record_alloc(evt_trace_rec_type_t type, uint16_t len, uint32_t now)
+{
+    uint32_t  delta = ticks_diff(now, m_rec_ticks);
+    uint32_t  need  = EVT_TRACE_REC_HDR_SIZE + len;
+    uint8_t * p_rec;
+
+    if (delta > REC_DELTA_MAX)
+    {
+        need += EVT_TRACE_REC_HDR_SIZE + sizeof(uint32_t);
+    }
+    if ((mp_header->magic != EVT_TRACE_MAGIC) || ((mp_header->length + need) > RECORDS_SIZE))
+    {
+        mp_header->dropped++;
+        return NULL;
+    }
+
+    p_rec = &mp_records[mp_header->length];
+    if (delta > REC_DELTA_MAX)
+    {
+        header_put(p_rec, EVT_TRACE_REC_TIME, 0, sizeof(uint32_t));
+        UNUSED_VARIABLE(uint32_encode(delta, &p_rec[EVT_TRACE_REC_HDR_SIZE]));
+        p_rec += EVT_TRACE_REC_HDR_SIZE + sizeof(uint32_t);
+        delta  = 0;
+    }
+    header_put(p_rec, type, (uint16_t)delta, len);
+
+    mp_header->length += need;
+    m_rec_ticks        = now;
+    m_uart_open        = false;
+    return p_rec + EVT_TRACE_REC_HDR_SIZE;
+}
+
+
+void evt_trace_init(uint32_t prescaler)
+{
+    memset(m_buffer, 0, sizeof(m_buffer));
+    mp_header->magic   = EVT_TRACE_MAGIC;
+    mp_header->version = EVT_TRACE_VERSION;
+    mp_header->tick_hz = (uint16_t)(APP_TIMER_CLOCK_FREQ / (prescaler + 1));
+    m_rec_ticks        = ticks_get();
+    m_uart_open        = false;
+}
+
+
+void evt_trace_ble(const ble_evt_t * p_ble_evt)
+{
+    uint16_t  len   = (uint16_t)(sizeof(ble_evt_hdr_t) + p_ble_evt->header.evt_len);
+    uint8_t * p_rec = record_alloc(EVT_TRACE_REC_BLE, len, ticks_get());
+
+    if (p_rec != NULL)
+    {
+        memcpy(p_rec, p_ble_evt, len);
+    }
+}
+
+
+void evt_trace_sys(uint32_t sys_evt)
+{
+    uint8_t * p_rec = record_alloc(EVT_TRACE_REC_SYS, sizeof(uint32_t), ticks_get());
+
+    if (p_rec != NULL)
+    {
+        UNUSED_VARIABLE(uint32_encode(sys_evt, p_rec));
+    }
+}
+
+
+void evt_trace_uart_rx(uint8_t byte)
+{
+    uint32_t  now = ticks_get();
+    uint8_t * p_rec;
+
+    // Bytes arriving back to back are added to the last record if nothing came in between.
+    if (m_uart_open && (ticks_diff(now, m_byte_ticks) <= EVT_TRACE_UART_MERGE_TICKS) &&
+        (mp_header->length < RECORDS_SIZE))
+    {
+        p_rec = &mp_records[m_uart_rec];
+        mp_records[mp_header->length++] = byte;
+        UNUSED_VARIABLE(uint16_encode(uint16_decode(&p_rec[3]) + 1, &p_rec[3]));
+        m_byte_ticks = now;
+        return;
+    }
+
+    p_rec = record_alloc(EVT_TRACE_REC_UART_RX, 1, now);
+    if (p_rec != NULL)
+    {
+        *p_rec       = byte;
+        m_uart_rec   = (uint32_t)(p_rec - EVT_TRACE_REC_HDR_SIZE - mp_records);
+        m_uart_open  = true;
+        m_byte_ticks = now;
+    }
+}
+
+
+const evt_trace_header_t * evt_trace_buffer_get(void)
+{
+    return mp_header;
+}
+
+/** @}
+ *  @endcond
+ */
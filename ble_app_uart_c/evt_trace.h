@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup evt_trace Event Trace Recorder
+ * @{
+ * @brief    Records the BLE events, SoC events and UART input the application handles.
+ *
+ * @details  Each record has a timestamp, so a trace captured on site can be replayed through the
+ *           application's handlers on a workstation (see ble_app_uart_c/host). Records are
+ *           appended to a RAM buffer that starts with an @ref evt_trace_header_t. Read the buffer
+ *           out with a debugger, from the address of @ref evt_trace_buffer_get for the length in
+ *           its header. Recording stops when the buffer is full and the records that did not fit
+ *           are counted.
+ *
+ *           Trace layout, all fields little endian:
+ *           - @ref evt_trace_header_t.
+ *           - Records, each a 5 byte header followed by its payload: type (@ref evt_trace_rec_type_t),
+ *             app_timer ticks since the previous record (uint16_t) and payload length (uint16_t).
+ *
+ *           Payloads:
+ *           - @ref EVT_TRACE_REC_TIME: uint32_t ticks to add to the time of the next record, for
+ *             gaps that do not fit the record header.
+ *           - @ref EVT_TRACE_REC_BLE: the ble_evt_t, header.evt_len + header bytes.
+ *           - @ref EVT_TRACE_REC_SYS: the uint32_t SoC event.
+ *           - @ref EVT_TRACE_REC_UART_RX: bytes read from the UART RX FIFO.
+ *
+ * @note     BLE events are stored as the SoftDevice delivers them. ble_evt_t has no pointers and
+ *           the same layout on any little endian target with natural alignment.
+ */
+
+#ifndef EVT_TRACE_H__
+#define EVT_TRACE_H__
+
+#include <stdint.h>
+#include "ble.h"
+#include "evt_trace_cnfg.h"
+
+#define EVT_TRACE_MAGIC          0x52545645      /**< "EVTR". */
+#define EVT_TRACE_VERSION        1               /**< Version of the trace layout. */
+#define EVT_TRACE_REC_HDR_SIZE   5               /**< Size of a record header. */
+
+/**@brief Record type. */
+typedef enum
+{
+    EVT_TRACE_REC_TIME,           /**< Time gap. */
+    EVT_TRACE_REC_BLE,            /**< BLE stack event. */
+    EVT_TRACE_REC_SYS,            /**< SoC event. */
+    EVT_TRACE_REC_UART_RX         /**< UART input. */
+} evt_trace_rec_type_t;
+
+/**@brief Trace header. */
+typedef struct
+{
+    uint32_t magic;               /**< @ref EVT_TRACE_MAGIC. */
+    uint16_t version;             /**< @ref EVT_TRACE_VERSION. */
+    uint16_t tick_hz;             /**< Ticks per second of the record timestamps. */
+    uint32_t length;              /**< Bytes of records following the header. */
+    uint32_t dropped;             /**< Records that did not fit. */
+} evt_trace_header_t;
+
+/**@brief     Function for starting a new trace.
+ *
+ * @param[in] prescaler  RTC1 prescaler of the app_timer module.
+ */
+void evt_trace_init(uint32_t prescaler);
+
+/**@brief     Function for recording a BLE stack event.
+ *
+ * @param[in] p_ble_evt  Event, as handed to the application.
+ */
+void evt_trace_ble(const ble_evt_t * p_ble_evt);
+
+/**@brief     Function for recording a SoC event.
+ *
+ * @param[in] sys_evt  Event, as handed to the application.
+ */
+void evt_trace_sys(uint32_t sys_evt);
+
+/**@brief     Function for recording a byte read from the UART.
+ *
+ * @param[in] byte  Byte.
+ */
+void evt_trace_uart_rx(uint8_t byte);
+
+/**@brief     Function for getting the trace buffer.
+ *
+ * @return    Header of the trace, followed by header.length bytes of records.
+ */
+const evt_trace_header_t * evt_trace_buffer_get(void);
+
+#endif // EVT_TRACE_H__
+
+/** @} */
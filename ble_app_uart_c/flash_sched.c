@@ -0,0 +1,546 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "flash_sched.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "app_timer.h"
+
+#define JOB_FLAG_SUBMITTED     0x01                  /**< The job has been handed to pstorage. */
+#define JOB_FLAG_DEFERRABLE    0x02                  /**< The job may wait for an idle window. */
+
+STATIC_ASSERT(FLASH_SCHED_BATCH_SIZE <= FLASH_SCHED_QUEUE_SIZE);
+STATIC_ASSERT(FLASH_SCHED_BATCH_SIZE < PSTORAGE_CMD_QUEUE_SIZE);
+
+/**@brief Flash job. */
+typedef struct
+{
+    uint8_t           op_code;                       /**< pstorage operation code. */
+    uint8_t           flags;                         /**< Job flags. */
+    pstorage_size_t   size;                          /**< Size of the operation. */
+    pstorage_size_t   offset;                        /**< Offset within the block. */
+    uint8_t         * p_src;                         /**< Source data, NULL for clear. */
+    pstorage_handle_t handle;                        /**< Target block. */
+} flash_job_t;
+
+/**@brief Registered pstorage user. */
+typedef struct
+{
+    uint32_t          module_id;                     /**< pstorage module identifier. */
+    pstorage_ntf_cb_t cb;                            /**< Callback of the user. */
+} flash_client_t;
+
+static flash_job_t               m_jobs[FLASH_SCHED_QUEUE_SIZE];       /**< Jobs, oldest first. */
+static uint8_t                   m_job_count;                          /**< Number of jobs in the queue. */
+static uint8_t                   m_in_flight;                          /**< Number of jobs handed to pstorage. */
+static flash_client_t            m_clients[FLASH_SCHED_MAX_CLIENTS];   /**< Registered pstorage users. */
+static uint8_t                   m_client_count;                       /**< Number of registered users. */
+static bool                      m_defer;                              /**< Whether deferrable jobs are held. */
+static bool                      m_defer_expired;                      /**< Whether the deferral timeout has passed. */
+static bool                      m_defer_running;                      /**< Whether the deferral timer is running. */
+static bool                      m_busy;                               /**< Busy state last reported. */
+static app_timer_id_t            m_defer_timer_id;                     /**< Deferral timeout timer. */
+static uint32_t                  m_max_defer_ticks;                    /**< Deferral timeout. */
+static flash_sched_evt_handler_t m_evt_handler;                        /**< Application event handler. */
+static flash_sched_stats_t       m_stats;                              /**< Statistics. */
+
+
+/**@brief Function for passing an event to the application.
+ */
+static void evt_send(flash_sched_evt_type_t evt_type)
+{
+    flash_sched_evt_t evt;
+
+    if (m_evt_handler == NULL)
+    {
+        return;
+    }
+
+    evt.evt_type = evt_type;
+    evt.pending  = m_job_count;
+    m_evt_handler(&evt);
+}
+
+
+/**@brief Function for reporting the idle state once all flash work is done.
+ */
+static void idle_check(void)
+{
+    if (m_busy && !flash_sched_is_busy())
+    {
+        m_busy = false;
+        evt_send(FLASH_SCHED_EVT_IDLE);
+    }
+}
+
+
+/**@brief Function for finding the callback of a registered pstorage user.
+ */
+static pstorage_ntf_cb_t client_cb_get(uint32_t module_id)
+{
+    uint8_t i;
+
+    for (i = 0; i < m_client_count; i++)
+    {
+        if (m_clients[i].module_id == module_id)
+        {
+            return m_clients[i].cb;
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief Function for checking whether a job may be handed to pstorage now.
+ *
+ * @details Jobs of one pstorage user are submitted in order, so a job waits for every earlier
+ *          job of the same user.
+ */
+static bool job_ready(uint8_t index)
+{
+    uint8_t i;
+
+    if ((m_jobs[index].flags & JOB_FLAG_DEFERRABLE) && m_defer && !m_defer_expired)
+    {
+        return false;
+    }
+
+    for (i = 0; i < index; i++)
+    {
+        if (!(m_jobs[i].flags & JOB_FLAG_SUBMITTED) &&
+            (m_jobs[i].handle.module_id == m_jobs[index].handle.module_id))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**@brief Function for removing a job from the queue.
+ */
+static void job_remove(uint8_t index)
+{
+    m_job_count--;
+    memmove(&m_jobs[index], &m_jobs[index + 1], (m_job_count - index) * sizeof(flash_job_t));
+}
+
+
+/**@brief Function for handing waiting jobs to pstorage, up to a batch at a time.
+ */
+static void jobs_submit(void)
+{
+    uint8_t       i = 0;
+    uint32_t      err_code;
+    flash_job_t * p_job;
+
+    while ((i < m_job_count) && (m_in_flight < FLASH_SCHED_BATCH_SIZE))
+    {
+        p_job = &m_jobs[i];
+        if ((p_job->flags & JOB_FLAG_SUBMITTED) || !job_ready(i))
+        {
+            i++;
+            continue;
+        }
+
+        switch (p_job->op_code)
+        {
+            case PSTORAGE_STORE_OP_CODE:
+                err_code = pstorage_store(&p_job->handle, p_job->p_src, p_job->size, p_job->offset);
+                break;
+
+            case PSTORAGE_UPDATE_OP_CODE:
+                err_code = pstorage_update(&p_job->handle, p_job->p_src, p_job->size, p_job->offset);
+                break;
+
+            default:
+                err_code = pstorage_clear(&p_job->handle, p_job->size);
+                break;
+        }
+
+        if (err_code == NRF_ERROR_NO_MEM)
+        {
+            // The pstorage queue is full of device manager commands. Try again on completion.
+            break;
+        }
+
+        if (err_code != NRF_SUCCESS)
+        {
+            pstorage_handle_t handle  = p_job->handle;
+            uint8_t           op_code = p_job->op_code;
+            pstorage_ntf_cb_t cb      = client_cb_get(handle.module_id);
+
+            m_stats.failed++;
+            job_remove(i);
+            if (cb != NULL)
+            {
+                cb(&handle, op_code, err_code, NULL, 0);
+            }
+            continue;
+        }
+
+        p_job->flags |= JOB_FLAG_SUBMITTED;
+        m_in_flight++;
+        m_stats.submitted++;
+        i++;
+    }
+}
+
+
+/**@brief Function for handling pstorage events for all registered users.
+ */
+static void flash_cb_handler(pstorage_handle_t * p_handle,
+                             uint8_t             op_code,
+                             uint32_t            result,
+                             uint8_t           * p_data,
+                             uint32_t            data_len)
+{
+    pstorage_ntf_cb_t cb = client_cb_get(p_handle->module_id);
+    uint8_t           i;
+
+    // pstorage completes commands in order, so this is the oldest submitted job of the user.
+    for (i = 0; i < m_job_count; i++)
+    {
+        if ((m_jobs[i].flags & JOB_FLAG_SUBMITTED)                 &&
+            (m_jobs[i].handle.module_id == p_handle->module_id)    &&
+            (m_jobs[i].op_code == op_code))
+        {
+            job_remove(i);
+            m_in_flight--;
+            if (result == NRF_SUCCESS)
+            {
+                m_stats.completed++;
+            }
+            else
+            {
+                m_stats.failed++;
+            }
+            break;
+        }
+    }
+
+    if (cb != NULL)
+    {
+        cb(p_handle, op_code, result, p_data, data_len);
+    }
+
+    jobs_submit();
+    evt_send(FLASH_SCHED_EVT_PROGRESS);
+}
+
+
+/**@brief Function for counting the deferrable jobs not yet handed to pstorage.
+ */
+static uint8_t deferrable_count(void)
+{
+    uint8_t count = 0;
+    uint8_t i;
+
+    for (i = 0; i < m_job_count; i++)
+    {
+        if ((m_jobs[i].flags & (JOB_FLAG_DEFERRABLE | JOB_FLAG_SUBMITTED)) == JOB_FLAG_DEFERRABLE)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+/**@brief Function for starting the deferral timeout.
+ *
+ * @details Deferrable jobs are held only while the timeout runs. If it cannot be started, they
+ *          are released as if it had passed, rather than held with nothing to release them.
+ */
+static void defer_timer_start(void)
+{
+    m_defer_running = (app_timer_start(m_defer_timer_id, m_max_defer_ticks, NULL) == NRF_SUCCESS);
+    m_defer_expired = !m_defer_running;
+    if (m_defer_expired)
+    {
+        m_stats.defer_expired++;
+    }
+}
+
+
+/**@brief Function for handling the deferral timeout.
+ */
+static void defer_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (!m_defer_running)
+    {
+        // Stopped after it had fired, or its stop did not make it into the queue.
+        return;
+    }
+    m_defer_running = false;
+    m_defer_expired = true;
+    m_stats.defer_expired++;
+    jobs_submit();
+}
+
+
+/**@brief Function for queueing a job.
+ */
+static uint32_t job_add(uint8_t             op_code,
+                        pstorage_handle_t * p_dest,
+                        uint8_t           * p_src,
+                        pstorage_size_t     size,
+                        pstorage_size_t     offset,
+                        flash_sched_prio_t  prio)
+{
+    flash_job_t * p_job;
+    uint8_t       i;
+
+    if (p_dest == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    // Merge with a waiting job for the same area. Writes to erased flash are never merged.
+    if (op_code != PSTORAGE_STORE_OP_CODE)
+    {
+        for (i = 0; i < m_job_count; i++)
+        {
+            p_job = &m_jobs[i];
+            if (!(p_job->flags & JOB_FLAG_SUBMITTED)                 &&
+                (p_job->op_code == op_code)                          &&
+                (p_job->handle.module_id == p_dest->module_id)       &&
+                (p_job->handle.block_id == p_dest->block_id)         &&
+                (p_job->size == size)                                &&
+                (p_job->offset == offset))
+            {
+                p_job->p_src = p_src;
+                if (prio == FLASH_SCHED_PRIO_URGENT)
+                {
+                    p_job->flags &= (uint8_t)~JOB_FLAG_DEFERRABLE;
+                }
+                m_stats.coalesced++;
+                jobs_submit();
+                return NRF_SUCCESS;
+            }
+        }
+    }
+
+    if (m_job_count == FLASH_SCHED_QUEUE_SIZE)
+    {
+        m_stats.rejected++;
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_job          = &m_jobs[m_job_count++];
+    p_job->op_code = op_code;
+    p_job->flags   = (prio == FLASH_SCHED_PRIO_DEFERRABLE) ? JOB_FLAG_DEFERRABLE : 0;
+    p_job->size    = size;
+    p_job->offset  = offset;
+    p_job->p_src   = p_src;
+    p_job->handle  = *p_dest;
+
+    if (m_job_count > m_stats.queue_high_water)
+    {
+        m_stats.queue_high_water = m_job_count;
+    }
+
+    // The timeout runs from the first deferrable job queued while deferred, whatever urgent jobs
+    // are ahead of it. Restarting it for every job would let a steady trickle of jobs wait
+    // forever.
+    if ((prio == FLASH_SCHED_PRIO_DEFERRABLE) && m_defer && !m_defer_running &&
+        (deferrable_count() == 1))
+    {
+        defer_timer_start();
+    }
+
+    m_busy = true;
+    jobs_submit();
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t flash_sched_init(flash_sched_evt_handler_t evt_handler, uint32_t max_defer_ticks)
+{
+    memset(m_jobs, 0, sizeof(m_jobs));
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    m_job_count       = 0;
+    m_in_flight       = 0;
+    m_client_count    = 0;
+    m_defer           = false;
+    m_defer_expired   = false;
+    m_defer_running   = false;
+    m_busy            = false;
+    m_evt_handler     = evt_handler;
+    m_max_defer_ticks = max_defer_ticks;
+
+    return app_timer_create(&m_defer_timer_id, APP_TIMER_MODE_SINGLE_SHOT, defer_timeout_handler);
+}
+
+
+uint32_t flash_sched_register(pstorage_module_param_t * p_module_param, pstorage_handle_t * p_block_id)
+{
+    pstorage_module_param_t param;
+    uint32_t                err_code;
+
+    if ((p_module_param == NULL) || (p_block_id == NULL) || (p_module_param->cb == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (m_client_count == FLASH_SCHED_MAX_CLIENTS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    param    = *p_module_param;
+    param.cb = flash_cb_handler;
+
+    err_code = pstorage_register(&param, p_block_id);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_clients[m_client_count].module_id = p_block_id->module_id;
+    m_clients[m_client_count].cb        = p_module_param->cb;
+    m_client_count++;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t flash_sched_store(pstorage_handle_t * p_dest,
+                           uint8_t           * p_src,
+                           pstorage_size_t     size,
+                           pstorage_size_t     offset,
+                           flash_sched_prio_t  prio)
+{
+    if (p_src == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return job_add(PSTORAGE_STORE_OP_CODE, p_dest, p_src, size, offset, prio);
+}
+
+
+uint32_t flash_sched_update(pstorage_handle_t * p_dest,
+                            uint8_t           * p_src,
+                            pstorage_size_t     size,
+                            pstorage_size_t     offset,
+                            flash_sched_prio_t  prio)
+{
+    if (p_src == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return job_add(PSTORAGE_UPDATE_OP_CODE, p_dest, p_src, size, offset, prio);
+}
+
+
+uint32_t flash_sched_clear(pstorage_handle_t * p_dest, pstorage_size_t size, flash_sched_prio_t prio)
+{
+    return job_add(PSTORAGE_CLEAR_OP_CODE, p_dest, NULL, size, 0, prio);
+}
+
+
+void flash_sched_defer_set(bool defer)
+{
+    if (defer == m_defer)
+    {
+        return;
+    }
+
+    m_defer = defer;
+    if (!defer)
+    {
+        (void)app_timer_stop(m_defer_timer_id);
+        m_defer_running = false;
+        m_defer_expired = false;
+        jobs_submit();
+    }
+    else if (deferrable_count() != 0)
+    {
+        defer_timer_start();
+        jobs_submit();
+    }
+}
+
+
+bool flash_sched_is_busy(void)
+{
+    uint32_t count = 0;
+
+    if (m_job_count != 0)
+    {
+        return true;
+    }
+
+    // Also covers the flash operations of the device manager.
+    if ((pstorage_access_status_get(&count) == NRF_SUCCESS) && (count != 0))
+    {
+        return true;
+    }
+    return false;
+}
+
+
+bool flash_sched_scan_params_adjust(ble_gap_scan_params_t * p_scan_params)
+{
+    uint32_t max_window;
+
+    if (!flash_sched_is_busy())
+    {
+        return false;
+    }
+
+    m_busy     = true;
+    max_window = ((uint32_t)p_scan_params->interval * FLASH_SCHED_SCAN_DUTY_PERCENT) / 100;
+    if (p_scan_params->window <= max_window)
+    {
+        return false;
+    }
+
+    p_scan_params->window = (uint16_t)max_window;
+    return true;
+}
+
+
+void flash_sched_on_sys_evt(uint32_t sys_evt)
+{
+    switch (sys_evt)
+    {
+        case NRF_EVT_FLASH_OPERATION_SUCCESS:
+        case NRF_EVT_FLASH_OPERATION_ERROR:
+            // Device manager operations do not pass through this module.
+            jobs_submit();
+            idle_check();
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+const flash_sched_stats_t * flash_sched_stats_get(void)
+{
+    return &m_stats;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup flash_sched Flash Job Scheduler
+ * @{
+ * @brief    Queues application flash writes and runs them when the radio is not busy.
+ *
+ * @details  Application modules register with pstorage and submit their flash jobs through this
+ *           module. Jobs are handed to pstorage in batches. Urgent jobs are submitted right away.
+ *           Deferrable jobs are held while the application has deferral switched on, for instance
+ *           while it is scanning for a peer, or until @ref FLASH_SCHED_MAX_DEFER_MS has passed.
+ *           An update or clear job that targets the same area as one that has not been submitted
+ *           yet is merged into it, and only one completion is reported for the merged job. Jobs
+ *           of one pstorage user always complete in the order they were submitted.
+ *
+ *           Scanning no longer has to wait for flash to be idle. While flash work is pending, use
+ *           @ref flash_sched_scan_params_adjust to leave radio time for the SoftDevice to run it,
+ *           and restart scanning with full parameters on @ref FLASH_SCHED_EVT_IDLE.
+ *
+ * @note     Flash operations started by the device manager go to pstorage directly. They are
+ *           included in the busy state, but are not batched or deferred.
+ */
+
+#ifndef FLASH_SCHED_H__
+#define FLASH_SCHED_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pstorage.h"
+#include "ble_gap.h"
+#include "flash_sched_cnfg.h"
+
+/**@brief Job priority. */
+typedef enum
+{
+    FLASH_SCHED_PRIO_URGENT,      /**< Submit as soon as possible, e.g. to avoid losing data. */
+    FLASH_SCHED_PRIO_DEFERRABLE   /**< Submit in an idle window. */
+} flash_sched_prio_t;
+
+/**@brief Scheduler event type. */
+typedef enum
+{
+    FLASH_SCHED_EVT_PROGRESS,     /**< A job has completed. */
+    FLASH_SCHED_EVT_IDLE          /**< All flash work, including that of the device manager, is done. */
+} flash_sched_evt_type_t;
+
+/**@brief Scheduler event. */
+typedef struct
+{
+    flash_sched_evt_type_t evt_type;   /**< Type of the event. */
+    uint8_t                pending;    /**< Jobs waiting or in progress. */
+} flash_sched_evt_t;
+
+/**@brief Scheduler event handler type. */
+typedef void (* flash_sched_evt_handler_t) (const flash_sched_evt_t * p_evt);
+
+/**@brief Scheduler statistics. */
+typedef struct
+{
+    uint32_t submitted;         /**< Jobs handed to pstorage. */
+    uint32_t completed;         /**< Jobs completed successfully. */
+    uint32_t failed;            /**< Jobs that completed with an error. */
+    uint32_t coalesced;         /**< Jobs merged into a waiting job. */
+    uint32_t rejected;          /**< Jobs rejected because the queue was full. */
+    uint32_t defer_expired;     /**< Times deferrable jobs were released by the deferral timeout. */
+    uint8_t  queue_high_water;  /**< Highest number of jobs in the queue. */
+} flash_sched_stats_t;
+
+/**@brief     Function for initializing the flash scheduler.
+ *
+ * @param[in] evt_handler      Event handler, or NULL.
+ * @param[in] max_defer_ticks  Longest deferral of a deferrable job, in app_timer ticks.
+ *
+ * @retval    NRF_SUCCESS On success. Otherwise an error code propagated from app_timer.
+ */
+uint32_t flash_sched_init(flash_sched_evt_handler_t evt_handler, uint32_t max_defer_ticks);
+
+/**@brief     Function for registering a pstorage user whose jobs go through the scheduler.
+ *
+ * @details   Same as @ref pstorage_register. The callback in @p p_module_param receives the
+ *            pstorage completion events for the jobs of this user.
+ */
+uint32_t flash_sched_register(pstorage_module_param_t * p_module_param, pstorage_handle_t * p_block_id);
+
+/**@brief     Function for scheduling a write to erased flash, see @ref pstorage_store.
+ *
+ * @details   @p p_src must stay valid until the completion is reported.
+ *
+ * @retval    NRF_SUCCESS      If the job was queued.
+ * @retval    NRF_ERROR_NO_MEM If the queue is full.
+ */
+uint32_t flash_sched_store(pstorage_handle_t * p_dest,
+                           uint8_t           * p_src,
+                           pstorage_size_t     size,
+                           pstorage_size_t     offset,
+                           flash_sched_prio_t  prio);
+
+/**@brief     Function for scheduling an update of written flash, see @ref pstorage_update.
+ *
+ * @details   Merged with a waiting update of the same area, in which case the newer @p p_src
+ *            is written.
+ */
+uint32_t flash_sched_update(pstorage_handle_t * p_dest,
+                            uint8_t           * p_src,
+                            pstorage_size_t     size,
+                            pstorage_size_t     offset,
+                            flash_sched_prio_t  prio);
+
+/**@brief     Function for scheduling an erase, see @ref pstorage_clear.
+ *
+ * @details   Merged with a waiting erase of the same area.
+ */
+uint32_t flash_sched_clear(pstorage_handle_t * p_dest, pstorage_size_t size, flash_sched_prio_t prio);
+
+/**@brief     Function for holding back or releasing deferrable jobs.
+ *
+ * @param[in] defer true while the radio is busy with latency critical work.
+ */
+void flash_sched_defer_set(bool defer);
+
+/**@brief     Function for checking whether any flash work is waiting or in progress.
+ */
+bool flash_sched_is_busy(void);
+
+/**@brief     Function for limiting scan parameters while flash work is pending.
+ *
+ * @param[in,out] p_scan_params Scan parameters to adjust.
+ *
+ * @return    true if the scan window was reduced.
+ */
+bool flash_sched_scan_params_adjust(ble_gap_scan_params_t * p_scan_params);
+
+/**@brief     Function for handling system events. Call after @ref pstorage_sys_event_handler.
+ */
+void flash_sched_on_sys_evt(uint32_t sys_evt);
+
+/**@brief     Function for getting the scheduler statistics.
+ */
+const flash_sched_stats_t * flash_sched_stats_get(void);
+
+#endif // FLASH_SCHED_H__
+
+/** @} */
@@ -0,0 +1,1385 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @brief Host daemon owning the serial port of the bridge.
+ *
+ * @details Reads the serial port in large blocks with epoll, splits the output of the bridge into
+ *          channels, and hands each channel to a pty and/or the clients of a Unix stream socket.
+ *          Data written by the consumers of a channel goes the other way.
+ *
+ *          The bridge writes the data of its link to the peer as it is, until the command channel
+ *          of the bridge is open (see uart_cmd.h). While it is open, a DLE data byte comes as
+ *          DLE DLE, and frames DLE op b2 b3 len payload[len] are mixed in: command responses,
+ *          scanner gateway batches (op 0xC0), probe reports (op 0xC1) and link quality reports
+ *          (op 0xC2). With --command, the daemon opens the channel and serves each kind of frame
+ *          on its own channel, whole, as the bridge wrote it:
+ *          - data:  the data of the link, with DLE DLE undone.
+ *          - cmd:   command responses. Consumers write request frames, which are sent whole.
+ *          - gw:    scanner gateway batches.
+ *          - probe: round trip probe reports.
+ *          - lq:    link quality reports.
+ *
+ *          Framings of the data channel:
+ *          - raw:  the byte stream.
+ *          - line: newline terminated lines. Consumers get and send whole lines, so several
+ *                  writers never interleave within a line.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+#define CLIENTS_MAX         32                   /**< Most socket clients over all channels. */
+#define EVENTS_MAX          64
+#define FRAME_MAX           1024                 /**< Longest line; longer ones are cut. Also holds any frame of the bridge. */
+#define QUEUE_MAX           (256 * 1024)         /**< Most bytes waiting for a slow consumer or the serial port. */
+#define PATH_MAX_LEN        108                  /**< Room for a socket path. */
+
+#define ESC                 0x10                 /**< UART_CMD_ESC of the bridge. */
+#define OP_OPEN             0x05                 /**< UART_CMD_OP_OPEN. */
+#define OP_CLOSE            0x06                 /**< UART_CMD_OP_CLOSE. */
+#define OP_RESPONSE         0x80                 /**< UART_CMD_OP_RESPONSE, set in the op of a response. */
+#define OP_GW               0xC0                 /**< SCAN_GW_FRAME_OP. */
+#define OP_PROBE            0xC1                 /**< RTT_PROBE_FRAME_OP. */
+#define OP_LQ               0xC2                 /**< LINK_QUALITY_FRAME_OP. */
+#define REQUEST_HEADER_LEN  4                    /**< ESC, op, id and len of a request. */
+#define FRAME_HEADER_LEN    5                    /**< ESC, op and three bytes, the last the payload length, of a frame of the bridge. */
+#define OPEN_DELAY_MS       600                  /**< Silence towards the bridge before the OPEN request, longer than UART_CMD_GUARD_MS. Also how long its response is waited for. */
+
+/**@brief Channel of the bridge output, each served on its own pty and/or socket. */
+typedef enum
+{
+    CHANNEL_DATA,                                /**< Data of the link to the peer. */
+    CHANNEL_CMD,                                 /**< Command requests and responses. */
+    CHANNEL_GW,                                  /**< Scanner gateway batches. */
+    CHANNEL_PROBE,                               /**< Round trip probe reports. */
+    CHANNEL_LQ,                                  /**< Link quality reports. */
+    CHANNEL_COUNT
+} channel_t;
+
+/**@brief Framing of the data channel. */
+typedef enum
+{
+    FRAMING_RAW,
+    FRAMING_LINE
+} framing_t;
+
+/**@brief State of the command channel of the bridge, as far as the daemon can tell. */
+typedef enum
+{
+    CMD_CLOSED,                                  /**< Everything from the bridge is data. */
+    CMD_OPENING,                                 /**< An OPEN request has been sent, and its response is looked for in the data. */
+    CMD_OPEN                                     /**< Frames are mixed into the data. */
+} cmd_state_t;
+
+/**@brief Parser state of the bridge output while the command channel is open, named after the
+ *        byte expected next. */
+typedef enum
+{
+    RX_DATA,                                     /**< Data, or ESC. */
+    RX_OP,                                       /**< Op of a frame, or ESC for an escaped data byte. */
+    RX_HEADER,                                   /**< Rest of the frame header. */
+    RX_PAYLOAD                                   /**< Payload of the frame. */
+} rx_state_t;
+
+/**@brief Kind of file descriptor in the epoll set. */
+typedef enum
+{
+    FD_DEVICE,
+    FD_PTY,
+    FD_LISTEN,
+    FD_CLIENT,
+    FD_SIGNAL,
+    FD_TIMER,
+    FD_OPEN_TIMER
+} fd_kind_t;
+
+/**@brief Byte queue, consumed from the front. */
+typedef struct
+{
+    uint8_t * p_data;
+    size_t    head;                              /**< Offset of the first byte. */
+    size_t    len;                               /**< Bytes queued. */
+    size_t    size;
+} queue_t;
+
+/**@brief Frame or line being assembled. */
+typedef struct
+{
+    uint8_t data[FRAME_MAX];
+    size_t  len;
+    bool    overflow;                            /**< Bytes have been cut from this line. */
+} frame_t;
+
+/**@brief Channel counters. */
+typedef struct
+{
+    uint64_t down_bytes;                         /**< Bytes from the bridge handed to consumers. */
+    uint64_t down_frames;                        /**< Frames or lines from the bridge. */
+    uint64_t down_dropped;                       /**< Bytes from the bridge no consumer could take. */
+    uint64_t up_bytes;                           /**< Bytes from consumers queued for the bridge. */
+    uint64_t up_frames;                          /**< Frames or lines from consumers. */
+    uint64_t up_dropped;                         /**< Bytes from consumers that did not fit in the serial port queue, or that the channel does not take. */
+    uint64_t cut_frames;                         /**< Lines longer than FRAME_MAX. */
+} channel_stats_t;
+
+/**@brief Consumer end of a channel: the pty master or a socket client. */
+typedef struct
+{
+    int       fd;
+    fd_kind_t kind;
+    uint8_t   channel;
+    queue_t   out;                               /**< Bytes waiting to be written to the consumer. */
+    frame_t   in;                                /**< Line or request being read from the consumer. */
+} endpoint_t;
+
+/**@brief Channel. */
+typedef struct
+{
+    endpoint_t      pty;                         /**< fd is -1 without --pty. */
+    int             pty_slave;                   /**< Kept open so the master does not hang up. */
+    char            pty_link[PATH_MAX_LEN];      /**< Symbolic link to the pty, or empty. */
+    int             listen_fd;                   /**< -1 without --socket. */
+    char            socket_path[PATH_MAX_LEN];
+    channel_stats_t stats;
+} channel_info_t;
+
+/**@brief Serial port counters. */
+typedef struct
+{
+    uint64_t reads;
+    uint64_t read_bytes;
+    uint64_t writes;
+    uint64_t write_bytes;
+    uint64_t bad_frames;                         /**< Frames from the bridge with an unknown op, and requests from consumers that do not start with ESC. */
+} device_stats_t;
+
+/**@brief Tag of an epoll entry. */
+typedef struct
+{
+    fd_kind_t    kind;
+    void       * p_object;
+} tag_t;
+
+static const char * const m_channel_names[CHANNEL_COUNT] = {"data", "cmd", "gw", "probe", "lq"};
+static const uint8_t      m_open_req[REQUEST_HEADER_LEN] = {ESC, OP_OPEN, 0x00, 0x00};
+static const uint8_t      m_close_req[REQUEST_HEADER_LEN] = {ESC, OP_CLOSE, 0x00, 0x00};
+static const uint8_t      m_open_rsp[FRAME_HEADER_LEN]   = {ESC, OP_OPEN | OP_RESPONSE, 0x00, 0x00, 0x00};
+
+static framing_t      m_framing       = FRAMING_LINE;
+static uint32_t       m_baud          = 38400;
+static bool           m_flow          = true;
+static bool           m_command;                 /**< Whether the command channel is opened and its frames served. */
+static uint32_t       m_channel_count = 1;
+static size_t         m_read_size     = 65536;
+static const char   * mp_device_path;
+static const char   * mp_pty_path;
+static const char   * mp_socket_path;
+static uint32_t       m_stats_interval;
+
+static int            m_epoll_fd;
+static int            m_device_fd;
+static queue_t        m_device_out;              /**< Bytes waiting to be written to the serial port. */
+static bool           m_device_out_full;         /**< Consumers are not read until the queue drains. */
+static device_stats_t m_device_stats;
+static cmd_state_t    m_cmd_state;
+static uint64_t       m_up_ms;                   /**< When bytes were last queued for the bridge. */
+static rx_state_t     m_rx_state;
+static frame_t        m_rx_frame;                /**< Frame from the bridge being assembled, or the start of an OPEN response. */
+static frame_t        m_data;                    /**< Data from the bridge not yet handed out: a line, or a block in raw framing. */
+static channel_info_t m_channels[CHANNEL_COUNT];
+static endpoint_t     m_clients[CLIENTS_MAX];
+static uint8_t      * mp_read_buf;
+static bool           m_running = true;
+
+static tag_t          m_device_tag     = {FD_DEVICE,     NULL};
+static tag_t          m_signal_tag     = {FD_SIGNAL,     NULL};
+static tag_t          m_timer_tag      = {FD_TIMER,      NULL};
+static tag_t          m_open_timer_tag = {FD_OPEN_TIMER, NULL};
+static tag_t          m_listen_tags[CHANNEL_COUNT];
+static tag_t          m_pty_tags[CHANNEL_COUNT];
+static tag_t          m_client_tags[CLIENTS_MAX];
+
+
+static void queue_drop(queue_t * p_queue, size_t len)
+{
+    p_queue->head += len;
+    p_queue->len  -= len;
+    if (p_queue->len == 0)
+    {
+        p_queue->head = 0;
+    }
+}
+
+
+/**@brief Function for queueing bytes.
+ *
+ * @return false if they do not fit under QUEUE_MAX, in which case nothing is queued.
+ */
+static bool queue_put(queue_t * p_queue, const uint8_t * p_data, size_t len)
+{
+    if ((p_queue->len + len) > QUEUE_MAX)
+    {
+        return false;
+    }
+    if ((p_queue->head + p_queue->len + len) > p_queue->size)
+    {
+        memmove(p_queue->p_data, p_queue->p_data + p_queue->head, p_queue->len);
+        p_queue->head = 0;
+    }
+    if ((p_queue->len + len) > p_queue->size)
+    {
+        size_t    size   = (p_queue->size != 0) ? p_queue->size : 4096;
+        uint8_t * p_grown;
+
+        while (size < (p_queue->len + len))
+        {
+            size *= 2;
+        }
+        p_grown = realloc(p_queue->p_data, size);
+        if (p_grown == NULL)
+        {
+            return false;
+        }
+        p_queue->p_data = p_grown;
+        p_queue->size   = size;
+    }
+    memcpy(p_queue->p_data + p_queue->head + p_queue->len, p_data, len);
+    p_queue->len += len;
+    return true;
+}
+
+
+/**@brief Function for writing as much of a queue as the descriptor takes.
+ *
+ * @return Bytes written, or -1 on an error other than EAGAIN.
+ */
+static ssize_t queue_flush(queue_t * p_queue, int fd)
+{
+    ssize_t total = 0;
+
+    while (p_queue->len != 0)
+    {
+        ssize_t n = write(fd, p_queue->p_data + p_queue->head, p_queue->len);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? total : -1;
+        }
+        queue_drop(p_queue, (size_t)n);
+        total += n;
+    }
+    return total;
+}
+
+
+static void epoll_set(int fd, tag_t * p_tag, uint32_t events, bool add)
+{
+    struct epoll_event evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.events   = events;
+    evt.data.ptr = p_tag;
+    if (epoll_ctl(m_epoll_fd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &evt) != 0)
+    {
+        perror("epoll_ctl");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+/**@brief Function for updating what an endpoint is polled for: input unless the serial port queue
+ *        is full, output while it has bytes queued.
+ */
+static void endpoint_poll_update(endpoint_t * p_ep, tag_t * p_tag)
+{
+    uint32_t events = (m_device_out_full ? 0 : EPOLLIN) | ((p_ep->out.len != 0) ? EPOLLOUT : 0);
+
+    epoll_set(p_ep->fd, p_tag, events, false);
+}
+
+
+static void endpoints_poll_update(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < m_channel_count; i++)
+    {
+        if (m_channels[i].pty.fd >= 0)
+        {
+            endpoint_poll_update(&m_channels[i].pty, &m_pty_tags[i]);
+        }
+    }
+    for (i = 0; i < CLIENTS_MAX; i++)
+    {
+        if (m_clients[i].fd >= 0)
+        {
+            endpoint_poll_update(&m_clients[i], &m_client_tags[i]);
+        }
+    }
+}
+
+
+static void device_poll_update(void)
+{
+    bool full = (m_device_out.len >= (QUEUE_MAX / 2));
+
+    epoll_set(m_device_fd, &m_device_tag, EPOLLIN | ((m_device_out.len != 0) ? EPOLLOUT : 0), false);
+    if (full != m_device_out_full)
+    {
+        m_device_out_full = full;
+        endpoints_poll_update();
+    }
+}
+
+
+static void client_close(endpoint_t * p_client)
+{
+    close(p_client->fd);
+    free(p_client->out.p_data);
+    memset(p_client, 0, sizeof(*p_client));
+    p_client->fd = -1;
+}
+
+
+/**@brief Function for handing output of the bridge to every consumer of a channel. */
+static void channel_deliver(uint8_t channel, const uint8_t * p_data, size_t len)
+{
+    channel_info_t * p_channel = &m_channels[channel];
+    bool             delivered = false;
+    uint32_t         i;
+
+    if (len == 0)
+    {
+        return;
+    }
+    p_channel->stats.down_frames++;
+
+    if (p_channel->pty.fd >= 0)
+    {
+        bool idle = (p_channel->pty.out.len == 0);
+
+        if (queue_put(&p_channel->pty.out, p_data, len))
+        {
+            delivered = true;
+            if (idle)
+            {
+                endpoint_poll_update(&p_channel->pty, &m_pty_tags[channel]);
+            }
+        }
+    }
+    for (i = 0; i < CLIENTS_MAX; i++)
+    {
+        endpoint_t * p_client = &m_clients[i];
+        bool         idle     = (p_client->out.len == 0);
+
+        if ((p_client->fd < 0) || (p_client->channel != channel))
+        {
+            continue;
+        }
+        if (queue_put(&p_client->out, p_data, len))
+        {
+            delivered = true;
+            if (idle)
+            {
+                endpoint_poll_update(p_client, &m_client_tags[i]);
+            }
+        }
+    }
+
+    if (delivered)
+    {
+        p_channel->stats.down_bytes += len;
+    }
+    else
+    {
+        p_channel->stats.down_dropped += len;
+    }
+}
+
+
+static void frame_add(frame_t * p_frame, uint8_t byte)
+{
+    if (p_frame->len < FRAME_MAX)
+    {
+        p_frame->data[p_frame->len++] = byte;
+    }
+    else
+    {
+        p_frame->overflow = true;
+    }
+}
+
+
+/**@brief Function for handing out what is left of the data, in raw framing. */
+static void data_flush(void)
+{
+    if (m_framing == FRAMING_RAW)
+    {
+        channel_deliver(CHANNEL_DATA, m_data.data, m_data.len);
+        m_data.len = 0;
+    }
+}
+
+
+/**@brief Function for adding a byte to the data from the bridge, handing out whole lines or, in
+ *        raw framing, full blocks. */
+static void data_add(uint8_t byte)
+{
+    frame_add(&m_data, byte);
+    if (m_data.len < FRAME_MAX)
+    {
+        if ((m_framing == FRAMING_RAW) || (byte != '\n'))
+        {
+            return;
+        }
+    }
+    else if ((m_framing == FRAMING_LINE) && (byte != '\n'))
+    {
+        m_channels[CHANNEL_DATA].stats.cut_frames++;
+    }
+    channel_deliver(CHANNEL_DATA, m_data.data, m_data.len);
+    m_data.len = 0;
+}
+
+
+/**@brief Function for getting the channel of a frame from the op after its ESC.
+ *
+ * @return The channel, or CHANNEL_DATA if the op is not one of a frame.
+ */
+static channel_t frame_channel(uint8_t op)
+{
+    switch (op)
+    {
+        case OP_GW:    return CHANNEL_GW;
+        case OP_PROBE: return CHANNEL_PROBE;
+        case OP_LQ:    return CHANNEL_LQ;
+        default:
+            return ((op & OP_RESPONSE) && (op < OP_GW)) ? CHANNEL_CMD : CHANNEL_DATA;
+    }
+}
+
+
+/**@brief Function for handing out a complete frame from the bridge, and following the state of
+ *        the command channel from the responses to OPEN and CLOSE. */
+static void frame_deliver(void)
+{
+    uint8_t op = m_rx_frame.data[1];
+
+    data_flush();
+    channel_deliver(frame_channel(op), m_rx_frame.data, m_rx_frame.len);
+    if (op == (OP_CLOSE | OP_RESPONSE))
+    {
+        m_cmd_state = CMD_CLOSED;
+        fprintf(stderr, "command channel closed\n");
+    }
+    m_rx_frame.len = 0;
+}
+
+
+/**@brief Function for looking for the response to an OPEN request in the output of the bridge,
+ *        which is all data until then.
+ *
+ * @details The bytes of a partial match are held back, and handed out as data once they turn out
+ *          not to be the response.
+ */
+static void opening_process(uint8_t byte)
+{
+    size_t i;
+
+    if (byte == m_open_rsp[m_rx_frame.len])
+    {
+        m_rx_frame.data[m_rx_frame.len++] = byte;
+        if (m_rx_frame.len == FRAME_HEADER_LEN)
+        {
+            m_cmd_state = CMD_OPEN;
+            m_rx_state  = RX_DATA;
+            fprintf(stderr, "command channel open\n");
+            frame_deliver();
+        }
+        return;
+    }
+
+    for (i = 0; i < m_rx_frame.len; i++)
+    {
+        data_add(m_rx_frame.data[i]);
+    }
+    if ((m_rx_frame.len != 0) && (byte == m_open_rsp[0]))
+    {
+        m_rx_frame.data[0] = byte;
+        m_rx_frame.len     = 1;
+        return;
+    }
+    m_rx_frame.len = 0;
+    data_add(byte);
+}
+
+
+/**@brief Function for splitting the output of the bridge, while its command channel is open,
+ *        into data and frames. */
+static void open_process(uint8_t byte)
+{
+    switch (m_rx_state)
+    {
+        case RX_DATA:
+            if (byte == ESC)
+            {
+                m_rx_frame.data[0] = byte;
+                m_rx_frame.len     = 1;
+                m_rx_state         = RX_OP;
+                return;
+            }
+            data_add(byte);
+            return;
+
+        case RX_OP:
+            if (byte == ESC)
+            {
+                m_rx_state = RX_DATA;
+                data_add(ESC);
+                return;
+            }
+            if (frame_channel(byte) == CHANNEL_DATA)
+            {
+                // Not something the bridge sends. Passed on as it came.
+                m_device_stats.bad_frames++;
+                m_rx_state = RX_DATA;
+                data_add(ESC);
+                data_add(byte);
+                return;
+            }
+            m_rx_frame.data[m_rx_frame.len++] = byte;
+            m_rx_state                        = RX_HEADER;
+            return;
+
+        case RX_HEADER:
+            m_rx_frame.data[m_rx_frame.len++] = byte;
+            if (m_rx_frame.len == FRAME_HEADER_LEN)
+            {
+                m_rx_state = RX_PAYLOAD;
+                if (byte == 0)
+                {
+                    m_rx_state = RX_DATA;
+                    frame_deliver();
+                }
+            }
+            return;
+
+        case RX_PAYLOAD:
+            m_rx_frame.data[m_rx_frame.len++] = byte;
+            if (m_rx_frame.len == (FRAME_HEADER_LEN + (size_t)m_rx_frame.data[FRAME_HEADER_LEN - 1]))
+            {
+                m_rx_state = RX_DATA;
+                frame_deliver();
+            }
+            return;
+    }
+}
+
+
+/**@brief Function for splitting the output of the bridge into channels. */
+static void device_data_process(const uint8_t * p_data, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        switch (m_cmd_state)
+        {
+            case CMD_CLOSED:
+                data_add(p_data[i]);
+                break;
+
+            case CMD_OPENING:
+                opening_process(p_data[i]);
+                break;
+
+            case CMD_OPEN:
+                open_process(p_data[i]);
+                break;
+        }
+    }
+    data_flush();
+}
+
+
+/**@brief Function for queueing bytes for the bridge, with ESC doubled if they are data and the
+ *        command channel is open.
+ *
+ * @return false if they do not fit, in which case nothing is queued.
+ */
+static bool device_put(const uint8_t * p_data, size_t len, bool escape)
+{
+    uint8_t buf[2 * FRAME_MAX];
+    size_t  n = 0;
+    size_t  i;
+
+    if (!escape || (m_cmd_state == CMD_CLOSED) || (memchr(p_data, ESC, len) == NULL))
+    {
+        return queue_put(&m_device_out, p_data, len);
+    }
+    for (i = 0; i < len; i++)
+    {
+        if (n == sizeof(buf))
+        {
+            if (!queue_put(&m_device_out, buf, n))
+            {
+                return false;
+            }
+            n = 0;
+        }
+        if (p_data[i] == ESC)
+        {
+            buf[n++] = ESC;
+        }
+        buf[n++] = p_data[i];
+    }
+    return queue_put(&m_device_out, buf, n);
+}
+
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000) + ((uint64_t)ts.tv_nsec / 1000000);
+}
+
+
+/**@brief Function for queueing what a consumer wrote for the bridge. */
+static void device_send(uint8_t channel, const uint8_t * p_data, size_t len)
+{
+    channel_stats_t * p_stats = &m_channels[channel].stats;
+
+    if (channel == CHANNEL_CMD)
+    {
+        if ((m_cmd_state == CMD_CLOSED) && (len == sizeof(m_open_req)) &&
+            (memcmp(p_data, m_open_req, len) == 0))
+        {
+            m_cmd_state    = CMD_OPENING;
+            m_rx_frame.len = 0;
+        }
+    }
+
+    if (device_put(p_data, len, channel == CHANNEL_DATA))
+    {
+        m_up_ms = now_ms();
+        p_stats->up_bytes += len;
+        p_stats->up_frames++;
+    }
+    else
+    {
+        p_stats->up_dropped += len;
+    }
+    device_poll_update();
+}
+
+
+/**@brief Function for taking the request frames out of what a consumer of the command channel
+ *        wrote, so that each is sent whole. */
+static void endpoint_requests_take(endpoint_t * p_ep, const uint8_t * p_data, size_t len)
+{
+    frame_t * p_req = &p_ep->in;
+    size_t    i;
+
+    for (i = 0; i < len; i++)
+    {
+        if ((p_req->len == 0) && (p_data[i] != ESC))
+        {
+            m_device_stats.bad_frames++;
+            m_channels[CHANNEL_CMD].stats.up_dropped++;
+            continue;
+        }
+        p_req->data[p_req->len++] = p_data[i];
+        if ((p_req->len >= REQUEST_HEADER_LEN) &&
+            (p_req->len == (REQUEST_HEADER_LEN + (size_t)p_req->data[REQUEST_HEADER_LEN - 1])))
+        {
+            device_send(CHANNEL_CMD, p_req->data, p_req->len);
+            p_req->len = 0;
+        }
+    }
+}
+
+
+/**@brief Function for reading what a consumer has written. */
+static bool endpoint_read(endpoint_t * p_ep)
+{
+    ssize_t n = read(p_ep->fd, mp_read_buf, (m_framing == FRAMING_RAW) ? m_read_size : FRAME_MAX);
+    ssize_t i;
+
+    if (n <= 0)
+    {
+        return (n < 0) && ((errno == EAGAIN) || (errno == EINTR));
+    }
+
+    if (p_ep->channel == CHANNEL_CMD)
+    {
+        endpoint_requests_take(p_ep, mp_read_buf, (size_t)n);
+        return true;
+    }
+    if (p_ep->channel != CHANNEL_DATA)
+    {
+        // Reports only go from the bridge to the host.
+        m_channels[p_ep->channel].stats.up_dropped += (uint64_t)n;
+        return true;
+    }
+    if (m_framing == FRAMING_RAW)
+    {
+        device_send(p_ep->channel, mp_read_buf, (size_t)n);
+        return true;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        frame_add(&p_ep->in, mp_read_buf[i]);
+        if ((mp_read_buf[i] == '\n') || (p_ep->in.len == FRAME_MAX))
+        {
+            device_send(p_ep->channel, p_ep->in.data, p_ep->in.len);
+            p_ep->in.len = 0;
+        }
+    }
+    return true;
+}
+
+
+static void device_read(void)
+{
+    for (;;)
+    {
+        ssize_t n = read(m_device_fd, mp_read_buf, m_read_size);
+
+        if (n < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+            {
+                return;
+            }
+            perror(mp_device_path);
+            m_running = false;
+            return;
+        }
+        if (n == 0)
+        {
+            return;
+        }
+        m_device_stats.reads++;
+        m_device_stats.read_bytes += (uint64_t)n;
+        device_data_process(mp_read_buf, (size_t)n);
+        if ((size_t)n < m_read_size)
+        {
+            return;
+        }
+    }
+}
+
+
+static void device_write(void)
+{
+    ssize_t n = queue_flush(&m_device_out, m_device_fd);
+
+    if (n < 0)
+    {
+        perror(mp_device_path);
+        m_running = false;
+        return;
+    }
+    if (n > 0)
+    {
+        m_device_stats.writes++;
+        m_device_stats.write_bytes += (uint64_t)n;
+    }
+    device_poll_update();
+}
+
+
+/**@brief Function for (re)trying to open the command channel, called every OPEN_DELAY_MS.
+ *
+ * @details The OPEN request is only sent after OPEN_DELAY_MS without bytes towards the bridge, as
+ *          the bridge takes it as data otherwise. If no response came in OPEN_DELAY_MS, that is
+ *          what happened, and the request is sent again.
+ */
+static void cmd_open(void)
+{
+    size_t i;
+
+    if (m_cmd_state == CMD_OPEN)
+    {
+        return;
+    }
+    if (m_cmd_state == CMD_OPENING)
+    {
+        for (i = 0; i < m_rx_frame.len; i++)
+        {
+            data_add(m_rx_frame.data[i]);
+        }
+        data_flush();
+        m_rx_frame.len = 0;
+        m_cmd_state    = CMD_CLOSED;
+    }
+    if ((now_ms() - m_up_ms) < OPEN_DELAY_MS)
+    {
+        return;
+    }
+    if (queue_put(&m_device_out, m_open_req, sizeof(m_open_req)))
+    {
+        m_cmd_state = CMD_OPENING;
+        m_up_ms     = now_ms();
+        device_poll_update();
+    }
+}
+
+
+/**@brief Function for closing the command channel on the way out, so that tools used after the
+ *        daemon get the data as it is. */
+static void cmd_close(void)
+{
+    int flags = fcntl(m_device_fd, F_GETFL);
+
+    if (m_cmd_state == CMD_CLOSED)
+    {
+        return;
+    }
+    if (queue_put(&m_device_out, m_close_req, sizeof(m_close_req)) && (flags >= 0) &&
+        (fcntl(m_device_fd, F_SETFL, flags & ~O_NONBLOCK) == 0))
+    {
+        (void)queue_flush(&m_device_out, m_device_fd);
+        (void)tcdrain(m_device_fd);
+    }
+}
+
+
+static speed_t baud_to_speed(uint32_t baud)
+{
+    switch (baud)
+    {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+        case 460800:  return B460800;
+        case 921600:  return B921600;
+        case 1000000: return B1000000;
+        default:      return B0;
+    }
+}
+
+
+static int device_open(void)
+{
+    struct termios tio;
+
+    m_device_fd = open(mp_device_path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (m_device_fd < 0)
+    {
+        perror(mp_device_path);
+        return -1;
+    }
+    if (!isatty(m_device_fd))
+    {
+        return 0;
+    }
+    if (tcgetattr(m_device_fd, &tio) != 0)
+    {
+        perror(mp_device_path);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    if (m_flow)
+    {
+        tio.c_cflag |= CRTSCTS;
+    }
+    else
+    {
+        tio.c_cflag &= ~CRTSCTS;
+    }
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, baud_to_speed(m_baud));
+    cfsetospeed(&tio, baud_to_speed(m_baud));
+    if (tcsetattr(m_device_fd, TCSANOW, &tio) != 0)
+    {
+        perror(mp_device_path);
+        return -1;
+    }
+    (void)tcflush(m_device_fd, TCIOFLUSH);
+    return 0;
+}
+
+
+/**@brief Function for giving the path of a channel's pty or socket: the path itself for the data,
+ *        the path with the channel name appended otherwise.
+ */
+static int channel_path_get(const char * p_base, uint32_t channel, char * p_path)
+{
+    int n = (channel == CHANNEL_DATA) ? snprintf(p_path, PATH_MAX_LEN, "%s", p_base)
+                                      : snprintf(p_path, PATH_MAX_LEN, "%s.%s", p_base, m_channel_names[channel]);
+
+    return ((n > 0) && (n < PATH_MAX_LEN)) ? 0 : -1;
+}
+
+
+static int pty_open(uint32_t channel)
+{
+    channel_info_t * p_channel = &m_channels[channel];
+    struct termios   tio;
+    const char     * p_name;
+
+    p_channel->pty.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if ((p_channel->pty.fd < 0) || (grantpt(p_channel->pty.fd) != 0) || (unlockpt(p_channel->pty.fd) != 0) ||
+        ((p_name = ptsname(p_channel->pty.fd)) == NULL))
+    {
+        perror("pty");
+        return -1;
+    }
+    p_channel->pty_slave = open(p_name, O_RDWR | O_NOCTTY);
+    if ((p_channel->pty_slave < 0) || (tcgetattr(p_channel->pty_slave, &tio) != 0))
+    {
+        perror(p_name);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    (void)tcsetattr(p_channel->pty_slave, TCSANOW, &tio);
+
+    if (channel_path_get(mp_pty_path, channel, p_channel->pty_link) != 0)
+    {
+        return -1;
+    }
+    (void)unlink(p_channel->pty_link);
+    if (symlink(p_name, p_channel->pty_link) != 0)
+    {
+        perror(p_channel->pty_link);
+        return -1;
+    }
+    p_channel->pty.kind    = FD_PTY;
+    p_channel->pty.channel = (uint8_t)channel;
+    m_pty_tags[channel]    = (tag_t){FD_PTY, &p_channel->pty};
+    epoll_set(p_channel->pty.fd, &m_pty_tags[channel], EPOLLIN, true);
+    fprintf(stderr, "%s: %s -> %s\n", m_channel_names[channel], p_channel->pty_link, p_name);
+    return 0;
+}
+
+
+static int socket_open(uint32_t channel)
+{
+    channel_info_t   * p_channel = &m_channels[channel];
+    struct sockaddr_un addr;
+
+    if (channel_path_get(mp_socket_path, channel, p_channel->socket_path) != 0)
+    {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, p_channel->socket_path, sizeof(addr.sun_path) - 1);
+    (void)unlink(p_channel->socket_path);
+
+    p_channel->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ((p_channel->listen_fd < 0) ||
+        (bind(p_channel->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+        (listen(p_channel->listen_fd, 8) != 0))
+    {
+        perror(p_channel->socket_path);
+        return -1;
+    }
+    m_listen_tags[channel] = (tag_t){FD_LISTEN, p_channel};
+    epoll_set(p_channel->listen_fd, &m_listen_tags[channel], EPOLLIN, true);
+    fprintf(stderr, "%s: %s\n", m_channel_names[channel], p_channel->socket_path);
+    return 0;
+}
+
+
+static void client_accept(channel_info_t * p_channel)
+{
+    int      fd = accept4(p_channel->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    uint32_t i;
+
+    if (fd < 0)
+    {
+        return;
+    }
+    for (i = 0; i < CLIENTS_MAX; i++)
+    {
+        if (m_clients[i].fd < 0)
+        {
+            m_clients[i].fd      = fd;
+            m_clients[i].kind    = FD_CLIENT;
+            m_clients[i].channel = (uint8_t)(p_channel - m_channels);
+            m_client_tags[i]     = (tag_t){FD_CLIENT, &m_clients[i]};
+            epoll_set(fd, &m_client_tags[i], m_device_out_full ? 0 : EPOLLIN, true);
+            return;
+        }
+    }
+    close(fd);
+}
+
+
+static void stats_print(FILE * p_file)
+{
+    uint32_t i;
+
+    fprintf(p_file, "device reads=%llu read_bytes=%llu writes=%llu write_bytes=%llu bad_frames=%llu queued=%zu open=%u\n",
+            (unsigned long long)m_device_stats.reads, (unsigned long long)m_device_stats.read_bytes,
+            (unsigned long long)m_device_stats.writes, (unsigned long long)m_device_stats.write_bytes,
+            (unsigned long long)m_device_stats.bad_frames, m_device_out.len,
+            (unsigned)(m_cmd_state == CMD_OPEN));
+    for (i = 0; i < m_channel_count; i++)
+    {
+        const channel_stats_t * p_stats = &m_channels[i].stats;
+        uint32_t                clients = 0;
+        uint32_t                j;
+
+        for (j = 0; j < CLIENTS_MAX; j++)
+        {
+            clients += ((m_clients[j].fd >= 0) && (m_clients[j].channel == i)) ? 1 : 0;
+        }
+        fprintf(p_file, "channel=%s down_bytes=%llu down_frames=%llu down_dropped=%llu up_bytes=%llu "
+                "up_frames=%llu up_dropped=%llu cut_frames=%llu clients=%u\n", m_channel_names[i],
+                (unsigned long long)p_stats->down_bytes, (unsigned long long)p_stats->down_frames,
+                (unsigned long long)p_stats->down_dropped, (unsigned long long)p_stats->up_bytes,
+                (unsigned long long)p_stats->up_frames, (unsigned long long)p_stats->up_dropped,
+                (unsigned long long)p_stats->cut_frames,
+                (unsigned)clients);
+    }
+    fflush(p_file);
+}
+
+
+/**@brief Function for handling an event on a pty master or socket client. */
+static void endpoint_event(endpoint_t * p_ep, tag_t * p_tag, uint32_t events)
+{
+    bool ok = true;
+
+    if (events & EPOLLIN)
+    {
+        ok = endpoint_read(p_ep);
+    }
+    if (ok && (events & EPOLLOUT))
+    {
+        ok = (queue_flush(&p_ep->out, p_ep->fd) >= 0);
+        if (ok)
+        {
+            endpoint_poll_update(p_ep, p_tag);
+        }
+    }
+    if (ok && (events & (EPOLLHUP | EPOLLERR)) && !(events & EPOLLIN))
+    {
+        ok = false;
+    }
+
+    if (!ok)
+    {
+        if (p_ep->kind == FD_CLIENT)
+        {
+            client_close(p_ep);
+        }
+        else
+        {
+            // Nothing holds the other end of the pty; what was queued cannot be delivered.
+            m_channels[p_ep->channel].stats.down_dropped += p_ep->out.len;
+            queue_drop(&p_ep->out, p_ep->out.len);
+            endpoint_poll_update(p_ep, p_tag);
+        }
+    }
+}
+
+
+/**@brief Function for starting a timer that expires every interval. */
+static int timer_open(tag_t * p_tag, uint32_t ms)
+{
+    struct itimerspec its;
+    int               timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec  = ms / 1000;
+    its.it_value.tv_nsec = (long)(ms % 1000) * 1000000L;
+    its.it_interval      = its.it_value;
+    if ((timer_fd < 0) || (timerfd_settime(timer_fd, 0, &its, NULL) != 0))
+    {
+        perror("timerfd");
+        return -1;
+    }
+    p_tag->p_object = (void *)(intptr_t)timer_fd;
+    epoll_set(timer_fd, p_tag, EPOLLIN, true);
+    return 0;
+}
+
+
+static int signals_open(void)
+{
+    sigset_t mask;
+    int      fd;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("signalfd");
+        return -1;
+    }
+    epoll_set(fd, &m_signal_tag, EPOLLIN, true);
+
+    if ((m_stats_interval != 0) && (timer_open(&m_timer_tag, m_stats_interval * 1000) != 0))
+    {
+        return -1;
+    }
+    if (m_command && (timer_open(&m_open_timer_tag, OPEN_DELAY_MS) != 0))
+    {
+        return -1;
+    }
+    return fd;
+}
+
+
+static void usage(const char * p_name)
+{
+    printf("Usage: %s --device PATH [options]\n", p_name);
+    printf("Owns the serial port of the bridge and serves its channels on ptys and/or Unix sockets.\n");
+    printf("  --%-20s %s\n", "device PATH",    "serial port of the bridge, or one end of a pty pair");
+    printf("  --%-20s %s\n", "baud BPS",       "serial rate, 9600 to 1000000 (38400)");
+    printf("  --%-20s %s\n", "no-flow",        "no RTS/CTS flow control");
+    printf("  --%-20s %s\n", "framing FRAMING", "raw or line, for the data (line)");
+    printf("  --%-20s %s\n", "command",        "open the command channel of the bridge and serve cmd, gw, probe and lq");
+    printf("  --%-20s %s\n", "pty PATH",       "serve the data on a pty linked from PATH, the others from PATH.NAME");
+    printf("  --%-20s %s\n", "socket PATH",    "serve the data on a Unix stream socket at PATH, the others at PATH.NAME");
+    printf("  --%-20s %s\n", "read-size N",    "bytes per read (65536)");
+    printf("  --%-20s %s\n", "stats S",        "print the counters every S seconds; SIGUSR1 prints them too");
+}
+
+
+int main(int argc, char ** argv)
+{
+    static const struct option options[] =
+    {
+        {"device",    required_argument, NULL, 'd'},
+        {"baud",      required_argument, NULL, 'b'},
+        {"no-flow",   no_argument,       NULL, 'n'},
+        {"framing",   required_argument, NULL, 'f'},
+        {"command",   no_argument,       NULL, 'c'},
+        {"pty",       required_argument, NULL, 'p'},
+        {"socket",    required_argument, NULL, 's'},
+        {"read-size", required_argument, NULL, 'r'},
+        {"stats",     required_argument, NULL, 't'},
+        {"help",      no_argument,       NULL, 'h'},
+        {NULL,        0,                 NULL, 0}
+    };
+    struct epoll_event events[EVENTS_MAX];
+    int                signal_fd;
+    uint32_t           i;
+    int                opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'd': mp_device_path   = optarg;                                  break;
+            case 'b': m_baud           = (uint32_t)strtoul(optarg, NULL, 0);      break;
+            case 'n': m_flow           = false;                                   break;
+            case 'c': m_command        = true;                                    break;
+            case 'p': mp_pty_path      = optarg;                                  break;
+            case 's': mp_socket_path   = optarg;                                  break;
+            case 'r': m_read_size      = (size_t)strtoul(optarg, NULL, 0);        break;
+            case 't': m_stats_interval = (uint32_t)strtoul(optarg, NULL, 0);      break;
+
+            case 'f':
+                if (strcmp(optarg, "raw") == 0)
+                {
+                    m_framing = FRAMING_RAW;
+                }
+                else if (strcmp(optarg, "line") == 0)
+                {
+                    m_framing = FRAMING_LINE;
+                }
+                else
+                {
+                    fprintf(stderr, "unknown framing '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((mp_device_path == NULL) || ((mp_pty_path == NULL) && (mp_socket_path == NULL)))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (baud_to_speed(m_baud) == B0)
+    {
+        fprintf(stderr, "unsupported baud rate %u\n", (unsigned)m_baud);
+        return EXIT_FAILURE;
+    }
+    m_channel_count = m_command ? CHANNEL_COUNT : 1;
+    m_read_size     = (m_read_size < FRAME_MAX) ? FRAME_MAX : m_read_size;
+    mp_read_buf     = malloc(m_read_size);
+
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if ((mp_read_buf == NULL) || (m_epoll_fd < 0) || (device_open() != 0))
+    {
+        return EXIT_FAILURE;
+    }
+    epoll_set(m_device_fd, &m_device_tag, EPOLLIN, true);
+
+    for (i = 0; i < CLIENTS_MAX; i++)
+    {
+        m_clients[i].fd = -1;
+    }
+    for (i = 0; i < m_channel_count; i++)
+    {
+        m_channels[i].pty.fd    = -1;
+        m_channels[i].pty_slave = -1;
+        m_channels[i].listen_fd = -1;
+        if (((mp_pty_path != NULL) && (pty_open(i) != 0)) ||
+            ((mp_socket_path != NULL) && (socket_open(i) != 0)))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    signal_fd = signals_open();
+    if (signal_fd < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    while (m_running)
+    {
+        int n = epoll_wait(m_epoll_fd, events, EVENTS_MAX, -1);
+        int e;
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (e = 0; e < n; e++)
+        {
+            tag_t    * p_tag = events[e].data.ptr;
+            uint32_t   evts  = events[e].events;
+
+            switch (p_tag->kind)
+            {
+                case FD_DEVICE:
+                    if (evts & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    {
+                        device_read();
+                    }
+                    if (evts & EPOLLOUT)
+                    {
+                        device_write();
+                    }
+                    break;
+
+                case FD_PTY:
+                case FD_CLIENT:
+                    endpoint_event(p_tag->p_object, p_tag, evts);
+                    break;
+
+                case FD_LISTEN:
+                    client_accept(p_tag->p_object);
+                    break;
+
+                case FD_SIGNAL:
+                {
+                    struct signalfd_siginfo info;
+
+                    while (read(signal_fd, &info, sizeof(info)) == sizeof(info))
+                    {
+                        if (info.ssi_signo == SIGUSR1)
+                        {
+                            stats_print(stderr);
+                        }
+                        else
+                        {
+                            m_running = false;
+                        }
+                    }
+                    break;
+                }
+
+                case FD_TIMER:
+                case FD_OPEN_TIMER:
+                {
+                    uint64_t expirations;
+
+                    if (read((int)(intptr_t)p_tag->p_object, &expirations, sizeof(expirations)) <= 0)
+                    {
+                        break;
+                    }
+                    if (p_tag->kind == FD_OPEN_TIMER)
+                    {
+                        cmd_open();
+                    }
+                    else
+                    {
+                        stats_print(stderr);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    cmd_close();
+    stats_print(stderr);
+    for (i = 0; i < m_channel_count; i++)
+    {
+        if (m_channels[i].pty_link[0] != '\0')
+        {
+            (void)unlink(m_channels[i].pty_link);
+        }
+        if (m_channels[i].socket_path[0] != '\0')
+        {
+            (void)unlink(m_channels[i].socket_path);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @brief Check of the host daemon against the UART output of the bridge.
+ *
+ * @details Runs the daemon with --command on one end of a pty pair, plays the UART output of a
+ *          simulated run (bridge_sim --uart-out) into the other end in chunks of random size, and
+ *          checks what comes out of each channel against the counts the simulation reported:
+ *          - data:  as many echoed lines as the host of the simulation got, and ESC DLE undone.
+ *          - cmd:   one well formed response per request of the script.
+ *          - gw, probe and lq: as many well formed frames as the simulation got.
+ *          Then checks that data written to the daemon reaches the bridge with ESC doubled, that a
+ *          request does as it is, and that the daemon closes the command channel when it exits.
+ *
+ *          Usage: bridged_check DAEMON UART_OUT RESULTS CMD_RESPONSES
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define ESC                 0x10
+#define OP_OPEN             0x05
+#define OP_CLOSE            0x06
+#define OP_GET              0x01
+#define OP_RESPONSE         0x80
+#define OP_GW               0xC0
+#define OP_PROBE            0xC1
+#define OP_LQ               0xC2
+#define FRAME_HEADER_LEN    5
+#define LINE_LEN            20                   /**< Length of the lines of the simulated host, --line-len. */
+#define CHUNK_MAX           64                   /**< Most bytes played into the pty at once. */
+#define IDLE_MS             500                  /**< Silence taken as the end of the output. */
+#define START_MS            3000                 /**< Longest wait for the daemon to come up. */
+
+/**@brief Channels of the daemon, as it names them. */
+typedef enum
+{
+    CHANNEL_DATA,
+    CHANNEL_CMD,
+    CHANNEL_GW,
+    CHANNEL_PROBE,
+    CHANNEL_LQ,
+    CHANNEL_COUNT
+} channel_t;
+
+/**@brief Bytes read from a descriptor. */
+typedef struct
+{
+    uint8_t * p_data;
+    size_t    len;
+    size_t    size;
+} buf_t;
+
+static const char * const m_channel_names[CHANNEL_COUNT] = {"data", "cmd", "gw", "probe", "lq"};
+static const uint8_t      m_open_req[]  = {ESC, OP_OPEN, 0x00, 0x00};
+static const uint8_t      m_close_req[] = {ESC, OP_CLOSE, 0x00, 0x00};
+static const uint8_t      m_up_line[]   = "up\x10line\n";
+static const uint8_t      m_up_bridge[] = "up\x10\x10line\n";
+static const uint8_t      m_get_req[]   = {ESC, OP_GET, 0x09, 0x01, 0x07};
+
+static int      m_master = -1;
+static int      m_sockets[CHANNEL_COUNT];
+static buf_t    m_out[CHANNEL_COUNT];             /**< What each channel handed out. */
+static buf_t    m_bridge;                         /**< What the daemon wrote to the bridge. */
+static uint32_t m_failures;
+
+
+static void buf_add(buf_t * p_buf, const uint8_t * p_data, size_t len)
+{
+    if ((p_buf->len + len) > p_buf->size)
+    {
+        p_buf->size   = (p_buf->len + len) * 2;
+        p_buf->p_data = realloc(p_buf->p_data, p_buf->size);
+        if (p_buf->p_data == NULL)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(p_buf->p_data + p_buf->len, p_data, len);
+    p_buf->len += len;
+}
+
+
+static void check(bool ok, const char * p_what)
+{
+    printf("%s: %s\n", ok ? "ok  " : "FAIL", p_what);
+    m_failures += ok ? 0 : 1;
+}
+
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000) + ((uint64_t)ts.tv_nsec / 1000000);
+}
+
+
+/**@brief Function for reading the pty and the sockets, until they have been silent for the given
+ *        milliseconds. A descriptor is closed once its other end is. */
+static void drain(uint32_t idle_ms)
+{
+    struct pollfd fds[CHANNEL_COUNT + 1];
+    uint8_t       buf[4096];
+    uint32_t      i;
+
+    for (;;)
+    {
+        fds[0].fd     = m_master;
+        fds[0].events = POLLIN;
+        for (i = 0; i < CHANNEL_COUNT; i++)
+        {
+            fds[i + 1].fd     = m_sockets[i];
+            fds[i + 1].events = POLLIN;
+        }
+        if (poll(fds, CHANNEL_COUNT + 1, (int)idle_ms) <= 0)
+        {
+            return;
+        }
+        for (i = 0; i <= CHANNEL_COUNT; i++)
+        {
+            ssize_t n;
+
+            if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+            {
+                continue;
+            }
+            n = read(fds[i].fd, buf, sizeof(buf));
+            if (n > 0)
+            {
+                buf_add((i == 0) ? &m_bridge : &m_out[i - 1], buf, (size_t)n);
+            }
+            else if ((n == 0) || (errno != EINTR))
+            {
+                close(fds[i].fd);
+                *((i == 0) ? &m_master : &m_sockets[i - 1]) = -1;
+            }
+        }
+    }
+}
+
+
+/**@brief Function for waiting for the daemon to write the given bytes to the bridge.
+ *
+ * @return true if they came before the timeout. They are taken out of what was read.
+ */
+static bool bridge_wait(const uint8_t * p_data, size_t len, uint32_t timeout_ms)
+{
+    uint64_t end = now_ms() + timeout_ms;
+
+    for (;;)
+    {
+        uint8_t * p_at = memmem(m_bridge.p_data, m_bridge.len, p_data, len);
+
+        if (p_at != NULL)
+        {
+            memmove(p_at, p_at + len, m_bridge.len - (size_t)(p_at - m_bridge.p_data) - len);
+            m_bridge.len -= len;
+            return true;
+        }
+        if (now_ms() >= end)
+        {
+            return false;
+        }
+        drain(50);
+    }
+}
+
+
+static bool read_file(const char * p_path, buf_t * p_buf)
+{
+    FILE  * p_file = fopen(p_path, "rb");
+    uint8_t block[4096];
+    size_t  n;
+
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        return false;
+    }
+    while ((n = fread(block, 1, sizeof(block), p_file)) != 0)
+    {
+        buf_add(p_buf, block, n);
+    }
+    fclose(p_file);
+    return true;
+}
+
+
+/**@brief Function for getting a counter from the key=value lines of the simulation results. */
+static uint32_t result_get(const buf_t * p_results, const char * p_key)
+{
+    char     pattern[64];
+    char   * p_text = strndup((const char *)p_results->p_data, p_results->len);
+    char   * p_at;
+    uint32_t value  = UINT32_MAX;
+
+    snprintf(pattern, sizeof(pattern), "\n%s=", p_key);
+    p_at = strstr(p_text, pattern);
+    if (p_at != NULL)
+    {
+        value = (uint32_t)strtoul(strchr(p_at, '=') + 1, NULL, 10);
+    }
+    free(p_text);
+    return value;
+}
+
+
+/**@brief Function for counting the frames a channel handed out.
+ *
+ * @return The number of frames, or -1 if the channel did not hand out whole frames of the op.
+ */
+static int32_t frames_count(const buf_t * p_buf, uint8_t op, uint8_t op_mask)
+{
+    size_t  pos   = 0;
+    int32_t count = 0;
+
+    while (pos < p_buf->len)
+    {
+        const uint8_t * p_frame = &p_buf->p_data[pos];
+
+        if (((p_buf->len - pos) < FRAME_HEADER_LEN) || (p_frame[0] != ESC) ||
+            ((p_frame[1] & op_mask) != op) ||
+            ((p_buf->len - pos) < (FRAME_HEADER_LEN + (size_t)p_frame[FRAME_HEADER_LEN - 1])))
+        {
+            return -1;
+        }
+        pos += FRAME_HEADER_LEN + p_frame[FRAME_HEADER_LEN - 1];
+        count++;
+    }
+    return count;
+}
+
+
+/**@brief Function for counting the lines of the data channel the simulated host wrote and the
+ *        peer echoed, and the other lines with the given text. */
+static uint32_t lines_count(const buf_t * p_buf, const char * p_text, uint32_t * p_text_count)
+{
+    uint32_t count = 0;
+    size_t   start = 0;
+    size_t   pos;
+
+    *p_text_count = 0;
+    for (pos = 0; pos < p_buf->len; pos++)
+    {
+        const char * p_line = (const char *)&p_buf->p_data[start];
+        size_t       len    = pos + 1 - start;
+        unsigned     seq;
+        char         colon;
+
+        if (p_buf->p_data[pos] != '\n')
+        {
+            continue;
+        }
+        if ((len == LINE_LEN) && (sscanf(p_line, "L%5u%c", &seq, &colon) == 2) && (colon == ':'))
+        {
+            count++;
+        }
+        else if ((len == strlen(p_text)) && (memcmp(p_line, p_text, len) == 0))
+        {
+            (*p_text_count)++;
+        }
+        start = pos + 1;
+    }
+    return count;
+}
+
+
+static int socket_connect(const char * p_path)
+{
+    struct sockaddr_un addr;
+    uint64_t           end = now_ms() + START_MS;
+    int                fd  = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", p_path);
+    while (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        if (now_ms() >= end)
+        {
+            perror(p_path);
+            exit(EXIT_FAILURE);
+        }
+        usleep(10000);
+    }
+    return fd;
+}
+
+
+int main(int argc, char ** argv)
+{
+    char       dir[]     = "/tmp/bridged_check.XXXXXX";
+    char       base[64];
+    char       path[108];
+    buf_t      uart_out  = {0};
+    buf_t      results   = {0};
+    uint32_t   responses;
+    uint32_t   expected;
+    uint32_t   text_count;
+    size_t     pos;
+    pid_t      pid;
+    int        status;
+    uint32_t   i;
+
+    if ((argc != 5) || !read_file(argv[2], &uart_out) || !read_file(argv[3], &results))
+    {
+        fprintf(stderr, "usage: %s DAEMON UART_OUT RESULTS CMD_RESPONSES\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    responses = (uint32_t)strtoul(argv[4], NULL, 0);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    m_master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if ((m_master < 0) || (grantpt(m_master) != 0) || (unlockpt(m_master) != 0) ||
+        (mkdtemp(dir) == NULL))
+    {
+        perror("pty");
+        return EXIT_FAILURE;
+    }
+    snprintf(base, sizeof(base), "%s/bridge", dir);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        execl(argv[1], argv[1], "--device", ptsname(m_master), "--no-flow", "--command",
+              "--socket", base, (char *)NULL);
+        perror(argv[1]);
+        _exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < CHANNEL_COUNT; i++)
+    {
+        if (i == CHANNEL_DATA)
+        {
+            snprintf(path, sizeof(path), "%s", base);
+        }
+        else
+        {
+            snprintf(path, sizeof(path), "%s.%s", base, m_channel_names[i]);
+        }
+        m_sockets[i] = socket_connect(path);
+    }
+
+    // The daemon opens the command channel of the bridge first.
+    check(bridge_wait(m_open_req, sizeof(m_open_req), START_MS), "daemon sends OPEN");
+
+    srand(1);
+    for (pos = 0; pos < uart_out.len; )
+    {
+        size_t  len = 1 + ((size_t)rand() % CHUNK_MAX);
+        ssize_t n   = write(m_master, &uart_out.p_data[pos], (len < (uart_out.len - pos)) ? len : (uart_out.len - pos));
+
+        if (n > 0)
+        {
+            pos += (size_t)n;
+        }
+        else if (errno != EINTR)
+        {
+            perror("pty");
+            return EXIT_FAILURE;
+        }
+        drain(0);
+    }
+    drain(IDLE_MS);
+
+    expected = result_get(&results, "lines_echoed");
+    check(lines_count(&m_out[CHANNEL_DATA], "esc\x10" "data\n", &text_count) == expected,
+          "data: echoed lines");
+    check(text_count == 1, "data: ESC ESC undone");
+    check(frames_count(&m_out[CHANNEL_CMD], OP_RESPONSE, OP_RESPONSE) == (int32_t)responses,
+          "cmd: responses");
+    expected = result_get(&results, "gw_batches");
+    check((expected != 0) && (frames_count(&m_out[CHANNEL_GW], OP_GW, 0xFF) == (int32_t)expected),
+          "gw: batches");
+    expected = result_get(&results, "probe_reports");
+    check((expected != 0) && (frames_count(&m_out[CHANNEL_PROBE], OP_PROBE, 0xFF) == (int32_t)expected),
+          "probe: reports");
+    expected = result_get(&results, "lq_reports");
+    check((expected != 0) && (frames_count(&m_out[CHANNEL_LQ], OP_LQ, 0xFF) == (int32_t)expected),
+          "lq: reports");
+
+    // The other way: data with ESC doubled, and a request as it is.
+    m_bridge.len = 0;
+    (void)write(m_sockets[CHANNEL_DATA], m_up_line, sizeof(m_up_line) - 1);
+    (void)write(m_sockets[CHANNEL_CMD], m_get_req, 2);
+    usleep(50000);
+    (void)write(m_sockets[CHANNEL_CMD], &m_get_req[2], sizeof(m_get_req) - 2);
+    check(bridge_wait(m_up_bridge, sizeof(m_up_bridge) - 1, IDLE_MS), "data: ESC doubled to the bridge");
+    check(bridge_wait(m_get_req, sizeof(m_get_req), IDLE_MS), "cmd: request to the bridge");
+
+    // On the way out, the daemon closes the command channel again.
+    (void)kill(pid, SIGTERM);
+    check(bridge_wait(m_close_req, sizeof(m_close_req), START_MS), "daemon sends CLOSE");
+    (void)waitpid(pid, &status, 0);
+    check(WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS), "daemon exits");
+
+    (void)rmdir(dir);
+    printf("%u failed\n", (unsigned)m_failures);
+    return (m_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
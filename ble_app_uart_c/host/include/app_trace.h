@@ -0,0 +1,14 @@
+#ifndef __DEBUG_H_
+#define __DEBUG_H_
+#include <stdint.h>
+#include <stdio.h>
+#ifdef ENABLE_DEBUG_LOG_SUPPORT
+void app_trace_init(void);
+#define app_trace_log printf
+void app_trace_dump(uint8_t * p_buffer, uint32_t len);
+#else
+#define app_trace_init()
+#define app_trace_log(...)
+#define app_trace_dump(...)
+#endif
+#endif
@@ -0,0 +1,20 @@
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+#include <stdint.h>
+#include "compiler_abstraction.h"
+#include "nrf.h"
+typedef enum
+{
+    APP_IRQ_PRIORITY_HIGH = 1,
+    APP_IRQ_PRIORITY_LOW  = 3
+} app_irq_priority_t;
+void app_util_critical_region_enter(uint8_t * p_nested);
+void app_util_critical_region_exit(uint8_t nested);
+#define CRITICAL_REGION_ENTER()                                                             \
+    {                                                                                       \
+        uint8_t IS_NESTED_CRITICAL_REGION = 0;                                              \
+        app_util_critical_region_enter(&IS_NESTED_CRITICAL_REGION);
+#define CRITICAL_REGION_EXIT()                                                              \
+        app_util_critical_region_exit(IS_NESTED_CRITICAL_REGION);                           \
+    }
+#endif
@@ -0,0 +1,69 @@
+#ifndef BLE_H__
+#define BLE_H__
+#include <stdint.h>
+#include "ble_ranges.h"
+#include "ble_types.h"
+#include "ble_gap.h"
+#include "ble_gatt.h"
+#include "ble_gattc.h"
+#include "ble_gatts.h"
+#include "ble_err.h"
+
+enum BLE_COMMON_EVTS
+{
+  BLE_EVT_TX_COMPLETE  = BLE_EVT_BASE,
+  BLE_EVT_USER_MEM_REQUEST,
+  BLE_EVT_USER_MEM_RELEASE
+};
+
+#define BLE_EVTS_PTR_ALIGNMENT    4
+
+typedef struct
+{
+  uint16_t evt_id;
+  uint16_t evt_len;
+} ble_evt_hdr_t;
+
+typedef struct
+{
+  uint8_t count;
+} ble_evt_tx_complete_t;
+
+typedef struct
+{
+  uint16_t conn_handle;
+  union
+  {
+    ble_evt_tx_complete_t tx_complete;
+  } params;
+} ble_common_evt_t;
+
+typedef struct
+{
+  ble_evt_hdr_t header;
+  union
+  {
+    ble_common_evt_t  common_evt;
+    ble_gap_evt_t     gap_evt;
+    ble_gattc_evt_t   gattc_evt;
+  } evt;
+} ble_evt_t;
+
+typedef struct
+{
+  uint8_t role;
+} ble_gap_enable_params_t;
+
+typedef struct
+{
+  ble_gatts_enable_params_t  gatts_enable_params;
+  ble_gap_enable_params_t    gap_enable_params;
+} ble_enable_params_t;
+
+#define BLE_EVT_LEN_MAX(ATT_MTU)  (sizeof(ble_evt_t) + (ATT_MTU))
+
+uint32_t sd_ble_enable(ble_enable_params_t * p_ble_enable_params);
+uint32_t sd_ble_evt_get(uint8_t * p_dest, uint16_t * p_len);
+uint32_t sd_ble_tx_buffer_count_get(uint8_t * p_count);
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * const p_vs_uuid, uint8_t * const p_uuid_type);
+#endif
@@ -0,0 +1,4 @@
+#ifndef BLE_ADVDATA_PARSER_H__
+#define BLE_ADVDATA_PARSER_H__
+#include "ble_gap.h"
+#endif
@@ -0,0 +1,59 @@
+#ifndef BLE_DB_DISCOVERY_H__
+#define BLE_DB_DISCOVERY_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gattc.h"
+#include "ble.h"
+#include "nrf_error.h"
+#include "ble_srv_common.h"
+#define BLE_DB_DISCOVERY_MAX_SRV          2
+#define BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV 4
+typedef enum
+{
+    BLE_DB_DISCOVERY_COMPLETE,
+    BLE_DB_DISCOVERY_ERROR,
+    BLE_DB_DISCOVERY_SRV_NOT_FOUND
+} ble_db_discovery_evt_type_t;
+typedef struct
+{
+    ble_gattc_char_t characteristic;
+    uint16_t         cccd_handle;
+} ble_db_discovery_char_t;
+typedef struct
+{
+    ble_uuid_t               srv_uuid;
+    uint8_t                  char_count;
+    ble_gattc_handle_range_t handle_range;
+    ble_db_discovery_char_t  charateristics[BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV];
+} ble_db_discovery_srv_t;
+typedef struct
+{
+    ble_db_discovery_evt_type_t evt_type;
+    uint16_t                    conn_handle;
+    union
+    {
+        ble_db_discovery_srv_t discovered_db;
+        uint32_t               err_code;
+    } params;
+} ble_db_discovery_evt_t;
+typedef void (* ble_db_discovery_evt_handler_t)(ble_db_discovery_evt_t * p_evt);
+typedef struct
+{
+    ble_db_discovery_srv_t services[BLE_DB_DISCOVERY_MAX_SRV];
+    uint16_t               conn_handle;
+    uint8_t                srv_count;
+    uint8_t                curr_char_ind;
+    uint8_t                curr_srv_ind;
+    bool                   discovery_in_progress;
+    bool                   discovery_pending;
+    uint8_t                discoveries_count;
+} ble_db_discovery_t;
+uint32_t ble_db_discovery_init(void);
+uint32_t ble_db_discovery_close(void);
+uint32_t ble_db_discovery_evt_register(const ble_uuid_t * const             p_uuid,
+                                       const ble_db_discovery_evt_handler_t evt_handler);
+uint32_t ble_db_discovery_start(ble_db_discovery_t * p_db_discovery,
+                                uint16_t             conn_handle);
+void ble_db_discovery_on_ble_evt(ble_db_discovery_t * const p_db_discovery,
+                                 const ble_evt_t * const    p_ble_evt);
+#endif
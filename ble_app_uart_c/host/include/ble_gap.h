@@ -0,0 +1,240 @@
+#ifndef BLE_GAP_H__
+#define BLE_GAP_H__
+#include <stdint.h>
+#include "ble_types.h"
+#include "ble_ranges.h"
+#include "ble_err.h"
+
+enum BLE_GAP_EVTS
+{
+  BLE_GAP_EVT_CONNECTED  = BLE_GAP_EVT_BASE,
+  BLE_GAP_EVT_DISCONNECTED,
+  BLE_GAP_EVT_CONN_PARAM_UPDATE,
+  BLE_GAP_EVT_SEC_PARAMS_REQUEST,
+  BLE_GAP_EVT_SEC_INFO_REQUEST,
+  BLE_GAP_EVT_PASSKEY_DISPLAY,
+  BLE_GAP_EVT_AUTH_KEY_REQUEST,
+  BLE_GAP_EVT_AUTH_STATUS,
+  BLE_GAP_EVT_CONN_SEC_UPDATE,
+  BLE_GAP_EVT_TIMEOUT,
+  BLE_GAP_EVT_RSSI_CHANGED,
+  BLE_GAP_EVT_ADV_REPORT,
+  BLE_GAP_EVT_SEC_REQUEST,
+  BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST,
+  BLE_GAP_EVT_SCAN_REQ_REPORT,
+};
+
+#define BLE_GAP_ROLE_INVALID     0x0
+#define BLE_GAP_ROLE_PERIPH      0x1
+#define BLE_GAP_ROLE_CENTRAL     0x2
+
+#define BLE_GAP_TIMEOUT_SRC_ADVERTISING      0x00
+#define BLE_GAP_TIMEOUT_SRC_SECURITY_REQUEST 0x01
+#define BLE_GAP_TIMEOUT_SRC_SCAN             0x02
+#define BLE_GAP_TIMEOUT_SRC_CONN             0x03
+
+#define BLE_GAP_ADDR_TYPE_PUBLIC                        0x00
+#define BLE_GAP_ADDR_TYPE_RANDOM_STATIC                 0x01
+#define BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_RESOLVABLE     0x02
+#define BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_NON_RESOLVABLE 0x03
+#define BLE_GAP_ADDR_LEN            6
+
+#define BLE_GAP_AD_TYPE_FLAGS                               0x01
+#define BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE   0x02
+#define BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE         0x03
+#define BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_MORE_AVAILABLE   0x04
+#define BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_COMPLETE         0x05
+#define BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE  0x06
+#define BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE        0x07
+#define BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME                    0x08
+#define BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME                 0x09
+#define BLE_GAP_AD_TYPE_TX_POWER_LEVEL                      0x0A
+#define BLE_GAP_AD_TYPE_SERVICE_DATA                        0x16
+#define BLE_GAP_AD_TYPE_APPEARANCE                          0x19
+#define BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA          0xFF
+
+#define BLE_GAP_ADV_TYPE_ADV_IND          0x00
+#define BLE_GAP_ADV_TYPE_ADV_DIRECT_IND   0x01
+#define BLE_GAP_ADV_TYPE_ADV_SCAN_IND     0x02
+#define BLE_GAP_ADV_TYPE_ADV_NONCONN_IND  0x03
+
+#define BLE_GAP_ADV_MAX_SIZE              31
+#define BLE_GAP_WHITELIST_ADDR_MAX_COUNT  (8)
+#define BLE_GAP_WHITELIST_IRK_MAX_COUNT   (8)
+#define BLE_GAP_SCAN_INTERVAL_MIN         0x0004
+#define BLE_GAP_SCAN_INTERVAL_MAX         0x4000
+#define BLE_GAP_SCAN_WINDOW_MIN           0x0004
+#define BLE_GAP_SCAN_WINDOW_MAX           0x4000
+#define BLE_GAP_SCAN_TIMEOUT_MIN          0x0001
+#define BLE_GAP_SCAN_TIMEOUT_MAX          0xFFFF
+#define BLE_GAP_CP_MIN_CONN_INTVL_MIN     0x0006
+#define BLE_GAP_CP_MAX_CONN_INTVL_MAX     0x0C80
+#define BLE_GAP_CP_SLAVE_LATENCY_MAX      0x01F3
+#define BLE_GAP_CP_CONN_SUP_TIMEOUT_MIN   0x000A
+#define BLE_GAP_CP_CONN_SUP_TIMEOUT_MAX   0x0C80
+
+#define BLE_GAP_IO_CAPS_DISPLAY_ONLY      0x00
+#define BLE_GAP_IO_CAPS_DISPLAY_YESNO     0x01
+#define BLE_GAP_IO_CAPS_KEYBOARD_ONLY     0x02
+#define BLE_GAP_IO_CAPS_NONE              0x03
+#define BLE_GAP_IO_CAPS_KEYBOARD_DISPLAY  0x04
+#define BLE_GAP_SEC_KEY_LEN               16
+
+typedef struct
+{
+  uint8_t addr_type;
+  uint8_t addr[BLE_GAP_ADDR_LEN];
+} ble_gap_addr_t;
+
+typedef struct
+{
+  uint16_t min_conn_interval;
+  uint16_t max_conn_interval;
+  uint16_t slave_latency;
+  uint16_t conn_sup_timeout;
+} ble_gap_conn_params_t;
+
+typedef struct
+{
+  uint8_t irk[BLE_GAP_SEC_KEY_LEN];
+} ble_gap_irk_t;
+
+typedef struct
+{
+  ble_gap_addr_t    **pp_addrs;
+  uint8_t             addr_count;
+  ble_gap_irk_t     **pp_irks;
+  uint8_t             irk_count;
+} ble_gap_whitelist_t;
+
+typedef struct
+{
+  uint8_t                 active      : 1;
+  uint8_t                 selective   : 1;
+  ble_gap_whitelist_t *   p_whitelist;
+  uint16_t                interval;
+  uint16_t                window;
+  uint16_t                timeout;
+} ble_gap_scan_params_t;
+
+typedef struct
+{
+  uint8_t enc     : 1;
+  uint8_t id      : 1;
+  uint8_t sign    : 1;
+} ble_gap_sec_kdist_t;
+
+typedef struct
+{
+  uint8_t               bond    : 1;
+  uint8_t               mitm    : 1;
+  uint8_t               io_caps : 3;
+  uint8_t               oob     : 1;
+  uint8_t               min_key_size;
+  uint8_t               max_key_size;
+  ble_gap_sec_kdist_t   kdist_periph;
+  ble_gap_sec_kdist_t   kdist_central;
+} ble_gap_sec_params_t;
+
+typedef struct
+{
+  ble_gap_addr_t        peer_addr;
+  ble_gap_addr_t        own_addr;
+  uint8_t               role;
+  uint8_t               irk_match :1;
+  uint8_t               irk_match_idx  :7;
+  ble_gap_conn_params_t conn_params;
+} ble_gap_evt_connected_t;
+
+typedef struct
+{
+  uint8_t reason;
+} ble_gap_evt_disconnected_t;
+
+typedef struct
+{
+  ble_gap_conn_params_t conn_params;
+} ble_gap_evt_conn_param_update_t;
+
+typedef struct
+{
+  ble_gap_conn_params_t conn_params;
+} ble_gap_evt_conn_param_update_request_t;
+
+typedef struct
+{
+  uint8_t src;
+} ble_gap_evt_timeout_t;
+
+typedef struct
+{
+  int8_t  rssi;
+} ble_gap_evt_rssi_changed_t;
+
+typedef struct
+{
+  ble_gap_addr_t peer_addr;
+  int8_t         rssi;
+  uint8_t        scan_rsp : 1;
+  uint8_t        type     : 2;
+  uint8_t        dlen     : 5;
+  uint8_t        data[BLE_GAP_ADV_MAX_SIZE];
+} ble_gap_evt_adv_report_t;
+
+#define BLE_GAP_SEC_STATUS_SUCCESS        0x00
+#define BLE_GAP_SEC_STATUS_TIMEOUT        0x01
+
+typedef struct
+{
+  uint8_t sm;
+  uint8_t lv;
+} ble_gap_conn_sec_mode_t;
+
+typedef struct
+{
+  ble_gap_conn_sec_mode_t sec_mode;
+  uint8_t                 encr_key_size;
+} ble_gap_conn_sec_t;
+
+typedef struct
+{
+  ble_gap_conn_sec_t conn_sec;
+} ble_gap_evt_conn_sec_update_t;
+
+typedef struct
+{
+  uint8_t auth_status;
+  uint8_t error_src : 2;
+  uint8_t bonded : 1;
+} ble_gap_evt_auth_status_t;
+
+typedef struct
+{
+  uint16_t conn_handle;
+  union
+  {
+    ble_gap_evt_connected_t                   connected;
+    ble_gap_evt_disconnected_t                disconnected;
+    ble_gap_evt_conn_param_update_t           conn_param_update;
+    ble_gap_evt_auth_status_t                 auth_status;
+    ble_gap_evt_conn_sec_update_t             conn_sec_update;
+    ble_gap_evt_timeout_t                     timeout;
+    ble_gap_evt_rssi_changed_t                rssi_changed;
+    ble_gap_evt_adv_report_t                  adv_report;
+    ble_gap_evt_conn_param_update_request_t   conn_param_update_request;
+  } params;
+} ble_gap_evt_t;
+
+uint32_t sd_ble_gap_address_get(ble_gap_addr_t * p_addr);
+uint32_t sd_ble_gap_scan_start(ble_gap_scan_params_t const * p_scan_params);
+uint32_t sd_ble_gap_scan_stop(void);
+uint32_t sd_ble_gap_connect(ble_gap_addr_t const * p_peer_addr, ble_gap_scan_params_t const * p_scan_params, ble_gap_conn_params_t const * p_conn_params);
+uint32_t sd_ble_gap_connect_cancel(void);
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code);
+uint32_t sd_ble_gap_authenticate(uint16_t conn_handle, ble_gap_sec_params_t const * p_sec_params);
+uint32_t sd_ble_gap_tx_power_set(int8_t tx_power);
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const * p_conn_params);
+uint32_t sd_ble_gap_rssi_start(uint16_t conn_handle, uint8_t threshold_dbm, uint8_t skip_count);
+uint32_t sd_ble_gap_rssi_stop(uint16_t conn_handle);
+uint32_t sd_ble_gap_rssi_get(uint16_t conn_handle, int8_t * p_rssi);
+#endif
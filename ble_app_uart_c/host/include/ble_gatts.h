@@ -0,0 +1,9 @@
+#ifndef BLE_GATTS_H__
+#define BLE_GATTS_H__
+#include <stdint.h>
+typedef struct
+{
+  uint8_t   service_changed:1;
+  uint32_t  attr_tab_size;
+} ble_gatts_enable_params_t;
+#endif
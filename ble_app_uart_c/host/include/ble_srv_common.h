@@ -0,0 +1,11 @@
+#ifndef BLE_SRV_COMMON_H__
+#define BLE_SRV_COMMON_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_types.h"
+#include "app_util.h"
+#include "ble.h"
+#include "ble_gap.h"
+#include "ble_gatt.h"
+#define BLE_CCCD_VALUE_LEN 2
+#endif
@@ -0,0 +1,18 @@
+#ifndef BOARDS_H
+#define BOARDS_H
+#define LEDS_NUMBER    4
+#define LED_1          21
+#define LED_2          22
+#define LED_3          23
+#define LED_4          24
+#define BUTTONS_NUMBER 4
+#define BUTTON_1       17
+#define BUTTON_2       18
+#define BUTTON_3       19
+#define BUTTON_4       20
+#define RX_PIN_NUMBER  11
+#define TX_PIN_NUMBER  9
+#define CTS_PIN_NUMBER 10
+#define RTS_PIN_NUMBER 8
+#define HWFC           true
+#endif
@@ -0,0 +1,12 @@
+#ifndef BSP_H__
+#define BSP_H__
+#include <stdint.h>
+#include "boards.h"
+#define BSP_INIT_NONE    0
+#define BSP_INIT_LED     (1 << 0)
+#define BSP_INIT_BUTTONS (1 << 1)
+#define BSP_INIT_UART    (1 << 2)
+typedef uint8_t bsp_event_t;
+typedef void (* bsp_event_callback_t)(bsp_event_t);
+uint32_t bsp_init(uint32_t type, uint32_t ticks_per_100ms, bsp_event_callback_t callback);
+#endif
@@ -0,0 +1,15 @@
+#ifndef COMPILER_ABSTRACTION_H
+#define COMPILER_ABSTRACTION_H
+#ifndef __INLINE
+#define __INLINE inline
+#endif
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE static inline
+#endif
+#ifndef __ALIGN
+#define __ALIGN(n) __attribute__((aligned(n)))
+#endif
+#ifndef __WEAK
+#define __WEAK __attribute__((weak))
+#endif
+#endif
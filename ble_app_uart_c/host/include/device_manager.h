@@ -0,0 +1,69 @@
+#ifndef DEVICE_MANAGER_H__
+#define DEVICE_MANAGER_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "ble.h"
+#include "ble_gap.h"
+#include "device_manager_cnfg.h"
+#define DM_INVALID_ID                  0xFF
+#define DM_PROTOCOL_CNTXT_NONE         0x00
+#define DM_PROTOCOL_CNTXT_GATT_SRVR_ID 0x01
+#define DM_PROTOCOL_CNTXT_GATT_CLI_ID  0x02
+#define DM_PROTOCOL_CNTXT_ALL          (DM_PROTOCOL_CNTXT_GATT_SRVR_ID | DM_PROTOCOL_CNTXT_GATT_CLI_ID)
+#define DM_EVT_RFU                     0x00
+#define DM_EVT_CONNECTION              0x11
+#define DM_EVT_DISCONNECTION           0x12
+#define DM_EVT_SECURITY_SETUP          0x13
+#define DM_EVT_SECURITY_SETUP_COMPLETE 0x14
+#define DM_EVT_LINK_SECURED            0x15
+#define DM_EVT_SECURITY_SETUP_REFRESH  0x16
+#define DM_EVT_DEVICE_CONTEXT_LOADED   0x21
+#define DM_EVT_DEVICE_CONTEXT_STORED   0x22
+#define DM_EVT_DEVICE_CONTEXT_DELETED  0x23
+#define DM_EVT_SERVICE_CONTEXT_LOADED  0x31
+#define DM_EVT_SERVICE_CONTEXT_STORED  0x32
+#define DM_EVT_SERVICE_CONTEXT_DELETED 0x33
+typedef uint8_t dm_application_instance_t;
+typedef uint8_t dm_connection_instance_t;
+typedef uint8_t dm_device_instance_t;
+typedef uint8_t service_type_t;
+typedef struct device_handle
+{
+    dm_application_instance_t    appl_id;
+    dm_connection_instance_t     connection_id;
+    dm_device_instance_t         device_id;
+    uint8_t                      service_id;
+} dm_handle_t;
+typedef union event_param
+{
+    ble_gap_evt_t * p_gap_param;
+} event_param_t;
+typedef struct dm_event
+{
+    uint8_t        event_id;
+    uint8_t        event_paramlen;
+    event_param_t  event_param;
+} dm_event_t;
+typedef ret_code_t (*dm_event_cb_t)(dm_handle_t const * p_handle,
+                                    dm_event_t const  * p_event,
+                                    ret_code_t          event_result);
+typedef struct
+{
+    bool clear_persistent_data;
+} dm_init_param_t;
+typedef struct
+{
+    dm_event_cb_t        evt_handler;
+    uint8_t              service_type;
+    ble_gap_sec_params_t sec_param;
+} dm_application_param_t;
+ret_code_t dm_init(dm_init_param_t const * p_init_param);
+ret_code_t dm_register(dm_application_instance_t    * p_appl_instance,
+                       dm_application_param_t const * p_appl_param);
+void       dm_ble_evt_handler(ble_evt_t * p_ble_evt);
+ret_code_t dm_security_setup_req(dm_handle_t * p_handle);
+ret_code_t dm_whitelist_create(dm_application_instance_t const * p_handle,
+                               ble_gap_whitelist_t             * p_whitelist);
+ret_code_t dm_peer_addr_get(dm_handle_t const * p_handle, ble_gap_addr_t * p_addr);
+#endif
@@ -0,0 +1,16 @@
+#ifndef NORDIC_COMMON_H__
+#define NORDIC_COMMON_H__
+#include <stddef.h>
+#define MSB(a)                   (((a) & 0xFF00) >> 8)
+#define LSB(a)                   ((a) & 0x00FF)
+#define UNUSED_VARIABLE(X)       ((void)(X))
+#define UNUSED_PARAMETER(X)      UNUSED_VARIABLE(X)
+#define UNUSED_RETURN_VALUE(X)   UNUSED_VARIABLE(X)
+#ifndef MIN
+#define MIN(a, b)                ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                ((a) < (b) ? (b) : (a))
+#endif
+
+#endif
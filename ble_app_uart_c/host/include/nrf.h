@@ -0,0 +1,52 @@
+#ifndef NRF_H
+#define NRF_H
+#include <stdint.h>
+#ifndef __INLINE
+#define __INLINE inline
+#endif
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE static inline
+#endif
+#define __I  volatile const
+#define __O  volatile
+#define __IO volatile
+typedef struct
+{
+  __I  uint32_t CODEPAGESIZE;
+  __I  uint32_t CODESIZE;
+} NRF_FICR_Type;
+typedef struct
+{
+  __IO uint32_t BOOTLOADERADDR;
+} NRF_UICR_Type;
+typedef struct
+{
+  __O  uint32_t TASKS_STARTRX;
+  __O  uint32_t TASKS_STOPRX;
+  __O  uint32_t TASKS_STARTTX;
+  __O  uint32_t TASKS_STOPTX;
+  __IO uint32_t EVENTS_CTS;
+  __IO uint32_t EVENTS_NCTS;
+  __IO uint32_t EVENTS_RXDRDY;
+  __IO uint32_t EVENTS_TXDRDY;
+  __IO uint32_t EVENTS_ERROR;
+  __IO uint32_t EVENTS_RXTO;
+  __IO uint32_t ERRORSRC;
+  __IO uint32_t ENABLE;
+  __IO uint32_t PSELRTS;
+  __IO uint32_t PSELTXD;
+  __IO uint32_t PSELCTS;
+  __IO uint32_t PSELRXD;
+  __I  uint32_t RXD;
+  __O  uint32_t TXD;
+  __IO uint32_t BAUDRATE;
+  __IO uint32_t CONFIG;
+} NRF_UART_Type;
+extern NRF_FICR_Type   sim_nrf_ficr;
+extern NRF_UICR_Type   sim_nrf_uicr;
+extern NRF_UART_Type   sim_nrf_uart0;
+#define NRF_FICR   (&sim_nrf_ficr)
+#define NRF_UICR   (&sim_nrf_uicr)
+#define NRF_UART0  (&sim_nrf_uart0)
+#include "nrf51_bitfields.h"
+#endif
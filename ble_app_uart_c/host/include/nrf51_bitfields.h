@@ -0,0 +1,19 @@
+#ifndef NRF51_BITFIELDS_H
+#define NRF51_BITFIELDS_H
+#define UART_BAUDRATE_BAUDRATE_Baud1200   (0x0004F000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud2400   (0x0009D000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud4800   (0x0013B000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud9600   (0x00275000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud14400  (0x003B0000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud19200  (0x004EA000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud28800  (0x0075F000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud38400  (0x009D5000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud57600  (0x00EBF000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud76800  (0x013A9000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud115200 (0x01D7E000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud230400 (0x03AFB000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud250000 (0x04000000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud460800 (0x075F7000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud921600 (0x0EBEDFA4UL)
+#define UART_BAUDRATE_BAUDRATE_Baud1M     (0x10000000UL)
+#endif
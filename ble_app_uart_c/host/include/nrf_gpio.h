@@ -0,0 +1,10 @@
+#ifndef NRF_GPIO_H__
+#define NRF_GPIO_H__
+#include <stdint.h>
+void     nrf_gpio_cfg_output(uint32_t pin_number);
+void     nrf_gpio_cfg_input(uint32_t pin_number, uint32_t pull_config);
+void     nrf_gpio_pin_set(uint32_t pin_number);
+void     nrf_gpio_pin_clear(uint32_t pin_number);
+void     nrf_gpio_pin_toggle(uint32_t pin_number);
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+#endif
@@ -0,0 +1,18 @@
+#ifndef NRF_SDM_H__
+#define NRF_SDM_H__
+#include <stdint.h>
+#include "nrf_error.h"
+enum NRF_CLOCK_LFCLKSRCS
+{
+  NRF_CLOCK_LFCLKSRC_SYNTH_250_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_500_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_250_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_150_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_100_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_75_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_50_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_30_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_20_PPM,
+};
+typedef uint32_t nrf_clock_lfclksrc_t;
+#endif
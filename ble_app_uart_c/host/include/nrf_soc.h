@@ -0,0 +1,21 @@
+#ifndef NRF_SOC_H__
+#define NRF_SOC_H__
+#include <stdint.h>
+#include "nrf_error.h"
+enum NRF_SOC_EVTS
+{
+  NRF_EVT_HFCLKSTARTED,
+  NRF_EVT_POWER_FAILURE_WARNING,
+  NRF_EVT_FLASH_OPERATION_SUCCESS,
+  NRF_EVT_FLASH_OPERATION_ERROR,
+  NRF_EVT_RADIO_BLOCKED,
+  NRF_EVT_RADIO_CANCELED,
+  NRF_EVT_RADIO_SIGNAL_CALLBACK_INVALID_RETURN,
+  NRF_EVT_RADIO_SESSION_IDLE,
+  NRF_EVT_RADIO_SESSION_CLOSED,
+  NRF_EVT_NUMBER_OF_EVTS
+};
+uint32_t sd_app_evt_wait(void);
+uint32_t sd_nvic_SystemReset(void);
+uint32_t sd_rand_application_vector_get(uint8_t * p_buff, uint8_t length);
+#endif
@@ -0,0 +1,6 @@
+#ifndef SDK_ERRORS_H__
+#define SDK_ERRORS_H__
+#include <stdint.h>
+#include "nrf_error.h"
+typedef uint32_t ret_code_t;
+#endif
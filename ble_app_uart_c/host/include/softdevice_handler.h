@@ -0,0 +1,33 @@
+#ifndef SOFTDEVICE_HANDLER_H__
+#define SOFTDEVICE_HANDLER_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "nordic_common.h"
+#include "nrf_sdm.h"
+#include "nrf_soc.h"
+#include "app_error.h"
+#include "app_util.h"
+#include "ble.h"
+#define SOFTDEVICE_SCHED_EVT_SIZE 0
+typedef uint32_t (*softdevice_evt_schedule_func_t) (void);
+typedef void (*ble_evt_handler_t) (ble_evt_t * p_ble_evt);
+typedef void (*sys_evt_handler_t) (uint32_t evt_id);
+#define SOFTDEVICE_HANDLER_INIT(CLOCK_SOURCE, EVT_HANDLER)                                        \
+    do                                                                                             \
+    {                                                                                              \
+        static uint32_t BLE_EVT_BUFFER[CEIL_DIV(BLE_EVT_LEN_MAX(GATT_MTU_SIZE_DEFAULT), sizeof(uint32_t))]; \
+        uint32_t ERR_CODE;                                                                         \
+        ERR_CODE = softdevice_handler_init((CLOCK_SOURCE),                                         \
+                                           BLE_EVT_BUFFER,                                         \
+                                           sizeof(BLE_EVT_BUFFER),                                 \
+                                           EVT_HANDLER);                                           \
+        APP_ERROR_CHECK(ERR_CODE);                                                                 \
+    } while (0)
+uint32_t softdevice_handler_init(nrf_clock_lfclksrc_t           clock_source,
+                                 void *                         p_ble_evt_buffer,
+                                 uint16_t                       ble_evt_buffer_size,
+                                 softdevice_evt_schedule_func_t evt_schedule_func);
+uint32_t softdevice_handler_sd_disable(void);
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler);
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler);
+#endif
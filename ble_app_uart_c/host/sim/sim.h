@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup sim Host Simulation
+ * @{
+ * @brief    Virtual-time stand-in for the SoftDevice, the radio and the SDK modules the bridge uses.
+ *
+ * @details  The application sources are compiled unmodified for the host and linked against the
+ *           modules in this directory. Time only advances when the application waits for an event
+ *           in sd_app_evt_wait(), which runs the next due simulation event. Simulation events stand
+ *           in for interrupts: radio activity, UART bytes, timer expiry and flash completion. They
+ *           all run to completion in time order, as the application's handlers do on the chip where
+ *           they share one interrupt priority.
+ *
+ *           The radio is modelled at link layer packet level. A connection event exchanges up to
+ *           @ref sim_config_t::pkts_per_event packet pairs, each lost with probability
+ *           @ref sim_config_t::loss, and a lost packet ends the event. The peer is a scripted NUS
+ *           peripheral with its own ATT server.
+ *
+ *           All randomness comes from one seeded generator, so a run is fully determined by its
+ *           configuration.
+ */
+
+#ifndef SIM_H__
+#define SIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "ble.h"
+#include "evt_trace.h"
+#include "softdevice_handler.h"
+
+#define SIM_MAX_PEERS           8                    /**< Maximum number of simulated advertisers, including noise. */
+#define SIM_MAX_CONNS           8                    /**< Maximum number of simultaneous links. */
+#define SIM_ATT_MTU             GATT_MTU_SIZE_DEFAULT /**< ATT MTU of all links. */
+#define SIM_EVT_BUF_SIZE        256                  /**< Room for one BLE event, including variable length arrays. */
+
+#define SIM_MS(MS)              ((uint64_t)(MS) * 1000)  /**< Milliseconds to simulation time. */
+
+/**@brief Outcome of a simulation run. */
+typedef enum
+{
+    SIM_RESULT_OK,                /**< Ran for the configured duration. */
+    SIM_RESULT_APP_ERROR,         /**< The application called app_error_handler(). */
+    SIM_RESULT_DEADLOCK,          /**< The application spun in a handler waiting for something that needs another handler. */
+    SIM_RESULT_RESET,             /**< The application requested a system reset. */
+    SIM_RESULT_IDLE               /**< Nothing left to simulate. */
+} sim_result_t;
+
+/**@brief Behaviour of the simulated NUS peripherals. */
+typedef enum
+{
+    SIM_PEER_ECHO,                /**< Notify every byte written to the TX characteristic back. */
+    SIM_PEER_SINK,                /**< Accept writes, send nothing. */
+    SIM_PEER_SOURCE               /**< Accept writes, and notify generated lines at a fixed rate. */
+} sim_peer_mode_t;
+
+/**@brief Simulation configuration. Set from the command line before the run. */
+typedef struct
+{
+    uint64_t        duration_us;        /**< Length of the run. */
+    uint64_t        seed;               /**< Seed of the random generator. */
+
+    uint32_t        baud;               /**< UART baud rate, 0 to use the rate the application configures. */
+
+    uint32_t        conn_interval_us;   /**< Interval of new links, 0 to use the minimum the application asks for. */
+    uint8_t         pkts_per_event;     /**< Maximum packet pairs per connection event. */
+    uint8_t         tx_buffers;         /**< SoftDevice TX buffers for Write Commands. */
+    double          loss;               /**< Probability that a packet is lost. */
+    uint16_t        pairing_events;     /**< Connection events the security procedure takes. */
+
+    uint8_t         peer_count;         /**< Number of NUS peripherals. */
+    uint8_t         adv_noise;          /**< Number of other advertisers in range. */
+    uint32_t        adv_interval_us;    /**< Advertising interval of the peripherals. */
+    sim_peer_mode_t peer_mode;          /**< Behaviour of the NUS peripherals. */
+    uint32_t        source_bps;         /**< Notified bytes per second in @ref SIM_PEER_SOURCE mode. */
+    uint16_t        source_len;         /**< Length of the generated lines in @ref SIM_PEER_SOURCE mode. */
+
+    uint64_t        uart_start_us;      /**< Time the host starts writing lines to the UART. */
+    uint32_t        line_count;         /**< Lines the host writes. */
+    uint16_t        line_len;           /**< Length of each line, including the newline. */
+    uint32_t        line_gap_us;        /**< Time between the starts of two lines. 0 to write back to back. */
+
+    const char    * p_script;           /**< Scenario script, or NULL. */
+    const char    * p_record;           /**< File to record the events handed to the application to, or NULL. */
+    const char    * p_uart_out;         /**< File to write the UART output of the application to, or NULL. */
+    bool            replay;             /**< Events come from a trace, the radio model only accepts calls. */
+    bool            profile;            /**< Measure the host CPU time of the application's event handlers. */
+    bool            verbose;            /**< Trace simulation events on stderr. */
+    bool            console;            /**< Copy the UART output of the application to stdout. */
+} sim_config_t;
+
+/**@brief Buffer for one BLE event, with room for the variable length arrays at its end. */
+typedef union
+{
+    ble_evt_t evt;                      /**< Event. */
+    uint32_t  words[SIM_EVT_BUF_SIZE / sizeof(uint32_t)];
+} sim_ble_evt_buf_t;
+
+/**@brief Simulation event handler type. */
+typedef void (* sim_handler_t)(void * p_context, uint32_t arg);
+
+/**@brief ATT PDU as carried in one link layer packet. */
+typedef struct
+{
+    uint16_t len;                       /**< Length of the PDU, including the opcode. */
+    uint8_t  data[SIM_ATT_MTU];         /**< PDU, starting with the ATT opcode. */
+} sim_pdu_t;
+
+/**@brief Radio statistics. */
+typedef struct
+{
+    uint32_t adv_events;                /**< Advertising events sent by all advertisers. */
+    uint32_t adv_reports;               /**< Advertising reports given to the application. */
+    uint32_t connections;               /**< Links established. */
+    uint32_t disconnections;            /**< Links lost or closed. */
+    uint32_t sup_timeouts;              /**< Links lost to a supervision timeout. */
+    uint32_t conn_events;               /**< Connection events held. */
+    uint32_t conn_events_blocked;       /**< Connection events skipped because flash held the radio. */
+    uint32_t packets_sent;              /**< Packets sent by either side, including empty ones. */
+    uint32_t packets_lost;              /**< Packets lost. */
+    uint32_t central_pdus;              /**< ATT PDUs delivered to peers. */
+    uint32_t peer_pdus;                 /**< ATT PDUs delivered to the application. */
+    uint32_t tx_queue_high_water;       /**< Most ATT PDUs queued for one link by the application. */
+    int32_t  tx_power;                  /**< TX power set last, in dBm. */
+    uint32_t tx_power_changes;          /**< Times the TX power was changed. */
+} sim_radio_stats_t;
+
+/**@brief UART statistics, from the point of view of the host at the other end of the UART. */
+typedef struct
+{
+    uint32_t host_tx_bytes;             /**< Bytes the host has sent. */
+    uint32_t rx_overflows;              /**< Bytes lost because the RX FIFO was full. */
+    uint32_t rx_errors;                 /**< Bytes lost to injected line errors. */
+    uint32_t host_rx_bytes;             /**< Bytes the host has received. */
+    uint32_t put_retries;               /**< app_uart_put() calls that found the TX FIFO full. */
+    uint32_t rts_stops;                 /**< Times the application stopped the receiver, deasserting RTS. */
+    uint64_t rts_stopped_us;            /**< Time the host spent waiting on RTS. */
+    uint16_t rx_fifo_high_water;        /**< Most bytes in the RX FIFO. */
+    uint16_t tx_fifo_high_water;        /**< Most bytes in the TX FIFO. */
+} sim_uart_stats_t;
+
+/**@brief NUS peripheral statistics. */
+typedef struct
+{
+    uint32_t rx_writes;                 /**< Writes to the TX characteristic. */
+    uint32_t rx_bytes;                  /**< Bytes written to the TX characteristic. */
+    uint32_t tx_notifications;          /**< Notifications sent. */
+    uint32_t tx_bytes;                  /**< Bytes notified. */
+    uint32_t tx_dropped;                /**< Bytes not notified because the peer's queue was full. */
+    uint32_t att_ignored;               /**< ATT requests left without a response while stalled. */
+} sim_peer_stats_t;
+
+/**@brief Hooks for observing the data path. Any of them may be NULL. */
+typedef struct
+{
+    void (* host_rx)(uint8_t byte);                                     /**< The host has received a byte from the UART. */
+    void (* host_tx)(uint8_t byte);                                     /**< The host has sent a byte to the UART. */
+    void (* peer_rx)(uint8_t peer, const uint8_t * p_data, uint16_t len); /**< A peer has received a write. */
+    void (* peer_tx)(uint8_t peer, const uint8_t * p_data, uint16_t len); /**< A peer has sent a notification. */
+    void (* central_tx)(uint16_t conn_handle, const uint8_t * p_data, uint16_t len); /**< The application has queued an ATT PDU. */
+} sim_hooks_t;
+
+/**@brief Source of the events the application handles, for profiling. */
+typedef enum
+{
+    SIM_PROF_BLE,                 /**< BLE stack events, by event ID. */
+    SIM_PROF_SYS,                 /**< SoC events, by event number. */
+    SIM_PROF_UART,                /**< app_uart events, by event type. */
+    SIM_PROF_TIMER,               /**< app_timer timeouts, by timer. */
+    SIM_PROF_SRC_COUNT
+} sim_prof_src_t;
+
+#define SIM_PROF_IDS            256                  /**< Event IDs profiled per source. */
+
+/**@brief Host CPU time spent in the application's handler for one kind of event. */
+typedef struct
+{
+    uint32_t count;                     /**< Events handled. */
+    uint64_t total_ns;                  /**< Time spent in the handler. */
+    uint64_t max_ns;                    /**< Longest time spent handling one event. */
+} sim_prof_entry_t;
+
+/**@brief Output format of run results. */
+typedef enum
+{
+    SIM_HOST_FORMAT_KV,           /**< One name=value line per result. */
+    SIM_HOST_FORMAT_JSON,         /**< Members of a JSON object, without the braces. */
+    SIM_HOST_FORMAT_CSV           /**< One CSV row, see sim_host_results_header_print(). */
+} sim_host_format_t;
+
+/**@brief Results of a run, as measured by the simulated host and peers. */
+typedef struct
+{
+    sim_result_t      result;                 /**< How the run ended. */
+    double            time_ms;                /**< Simulated time at the end of the run. */
+    uint32_t          lines_sent;             /**< Lines the host wrote to the UART. */
+    uint32_t          lines_delivered;        /**< Host lines received whole by a peer. */
+    uint32_t          lines_echoed;           /**< Host lines received back by the host. */
+    uint32_t          lines_lost;             /**< Host lines never delivered, not counting the ones still in flight. */
+    uint64_t          up_bytes;               /**< Bytes of host lines delivered to peers. */
+    double            up_bps;                 /**< Uplink throughput, from the first line written to the last byte delivered. */
+    double            up_latency_ms[3];       /**< 50th and 99th percentile and maximum time from writing a line to a peer receiving it. */
+    double            rtt_ms[3];              /**< Same, to the host receiving the echoed line. */
+    uint64_t          down_bytes;             /**< Bytes received by the host after the first notification. */
+    double            down_bps;               /**< Downlink throughput, from the first notification to the last byte received. */
+    uint32_t          down_lines;             /**< Generated peer lines received by the host. */
+    double            down_latency_ms[3];     /**< Percentiles of the time from notifying a generated line to the host receiving it. */
+    uint32_t          peer_tx_dropped;        /**< Bytes the peers could not notify. */
+    uint32_t          host_queue_high_water;  /**< Most bytes waiting to be sent by the host. */
+    sim_uart_stats_t  uart;                   /**< UART statistics. */
+    sim_radio_stats_t radio;                  /**< Radio statistics. */
+    uint32_t          gw_batches;             /**< Scanner gateway batches received by the host. */
+    uint32_t          gw_records;             /**< Records in them. */
+    uint32_t          gw_dropped;             /**< Records the batches report as dropped. */
+    uint32_t          gw_errors;              /**< Batches whose records do not add up to their length or count, and malformed probe reports. */
+    uint32_t          probe_reports;          /**< Round trip probe reports received by the host. */
+    uint32_t          probe_sent;             /**< Probes sent, from the last report. */
+    uint32_t          probe_received;         /**< Echoes received, from the last report. */
+    uint32_t          probe_lost;             /**< Probes lost, from the last report. */
+    uint32_t          probe_busy;             /**< Probes refused by the TX queue, from the last report. */
+    uint32_t          probe_rtt_mean_us;      /**< Mean round trip time, from the last report. */
+    uint32_t          probe_rtt_max_us;       /**< Longest round trip time, from the last report. */
+    uint32_t          lq_reports;             /**< Link quality reports received by the host. */
+    uint32_t          lq_disc_sup_timeout;    /**< Supervision timeouts, from the last report. */
+    int32_t           lq_tx_power;            /**< TX power in dBm, from the last report. */
+    uint32_t          lq_links;               /**< Links in the last report. */
+    int32_t           lq_rssi_avg;            /**< Average RSSI of the first link in the last report. */
+    uint32_t          lq_rssi_samples;        /**< RSSI samples of that link. */
+    uint32_t          lq_tx_failed;           /**< Failed writes of that link. */
+    uint32_t          lq_tx_retries;          /**< Retried writes of that link. */
+} sim_host_results_t;
+
+/* sim_core.c */
+sim_config_t * sim_config_get(void);
+sim_hooks_t  * sim_hooks_get(void);
+uint64_t       sim_now(void);
+uint32_t       sim_schedule(uint64_t time_us, sim_handler_t handler, void * p_context, uint32_t arg);
+void           sim_cancel(uint32_t id);
+uint32_t       sim_rand(void);
+bool           sim_chance(double probability);
+void           sim_log(const char * p_fmt, ...) __attribute__((format(printf, 1, 2)));
+void           sim_abort(sim_result_t result, const char * p_fmt, ...) __attribute__((noreturn, format(printf, 2, 3)));
+sim_result_t   sim_run(int (* app_main)(void), const char ** pp_reason);
+uint64_t       sim_prof_start(void);
+void           sim_prof_end(sim_prof_src_t src, uint32_t id, uint64_t start);
+const sim_prof_entry_t * sim_prof_get(sim_prof_src_t src, uint32_t id);
+
+/* sim_sd.c */
+void           sim_sd_ble_evt_raise(const sim_ble_evt_buf_t * p_buf);
+void           sim_sd_sys_evt_raise(uint32_t sys_evt);
+ble_evt_handler_t sim_sd_ble_evt_handler_get(void);
+bool           sim_sd_uuid_decode(const uint8_t * p_uuid128, ble_uuid_t * p_uuid);
+bool           sim_sd_uuid_encode(const ble_uuid_t * p_uuid, uint8_t * p_uuid128);
+uint32_t       sim_sd_flash_op(uint32_t duration_us, void (* apply)(void * p_context), void * p_context);
+
+/* sim_radio.c */
+void                      sim_radio_init(void);
+uint32_t                  sim_radio_central_send(uint16_t conn_handle, const sim_pdu_t * p_pdu, bool write_cmd);
+uint32_t                  sim_radio_peer_send(uint16_t conn_handle, const sim_pdu_t * p_pdu);
+uint8_t                   sim_radio_peer_queue_free(uint16_t conn_handle);
+void                      sim_radio_peer_disconnect(uint16_t conn_handle, uint8_t reason);
+void                      sim_radio_peer_conn_param_request(uint16_t conn_handle, const ble_gap_conn_params_t * p_params);
+void                      sim_radio_drop(uint64_t duration_us);
+void                      sim_radio_replay_evt(const ble_evt_t * p_ble_evt);
+uint64_t                  sim_radio_flash_reserve(uint32_t duration_us);
+const sim_radio_stats_t * sim_radio_stats_get(void);
+
+/* sim_gattc.c */
+void           sim_gattc_on_connect(uint16_t conn_handle);
+void           sim_gattc_on_disconnect(uint16_t conn_handle);
+void           sim_gattc_on_rx(uint16_t conn_handle, const sim_pdu_t * p_pdu);
+
+/* sim_peer.c */
+void                     sim_peer_init(void);
+uint8_t                  sim_peer_count(void);
+bool                     sim_peer_is_nus(uint8_t peer);
+bool                     sim_peer_advertising(uint8_t peer);
+void                     sim_peer_adv_set(uint8_t peer, bool on);
+void                     sim_peer_stall(uint8_t peer, uint64_t duration_us);
+void                     sim_peer_addr_get(uint8_t peer, ble_gap_addr_t * p_addr);
+uint8_t                  sim_peer_adv_data_get(uint8_t peer, uint8_t * p_data);
+int8_t                   sim_peer_rssi_get(uint8_t peer);
+void                     sim_peer_on_connect(uint8_t peer, uint16_t conn_handle);
+void                     sim_peer_on_disconnect(uint8_t peer);
+void                     sim_peer_on_rx(uint8_t peer, const sim_pdu_t * p_pdu);
+bool                     sim_peer_notify(uint8_t peer, const uint8_t * p_data, uint16_t len);
+uint16_t                 sim_peer_conn_handle(uint8_t peer);
+const sim_peer_stats_t * sim_peer_stats_get(uint8_t peer);
+
+/* sim_uart.c */
+void                     sim_uart_host_write(const uint8_t * p_data, uint32_t len);
+void                     sim_uart_rx_error(uint32_t count);
+uint32_t                 sim_uart_host_pending(void);
+const sim_uart_stats_t * sim_uart_stats_get(void);
+void                     sim_uart_tasks_process(void);
+
+/* sim_timer.c */
+uint64_t       sim_timer_ticks_to_us(uint32_t ticks);
+
+/* sim_host.c */
+int            sim_host_option_set(const char * p_name, const char * p_value);
+bool           sim_host_option_get(uint32_t index, const char ** pp_name, bool * p_has_arg);
+void           sim_host_options_print(FILE * p_file);
+int            sim_host_init(void);
+void           sim_host_results_get(sim_result_t result, sim_host_results_t * p_results);
+void           sim_host_results_print(FILE * p_file, sim_host_format_t format, const sim_host_results_t * p_results);
+void           sim_host_results_header_print(FILE * p_file);
+
+/* sim_trace.c */
+void           sim_trace_record_start(void);
+void           sim_trace_on_ble_evt(const ble_evt_t * p_ble_evt);
+void           sim_trace_on_sys_evt(uint32_t sys_evt);
+void           sim_trace_on_uart_rx(uint8_t byte);
+int            sim_trace_save(const char * p_path);
+int            sim_trace_load(const char * p_path);
+const evt_trace_header_t * sim_trace_header_get(void);
+uint64_t       sim_trace_replay_start(void);
+
+/* sim_board.c */
+int            sim_printf(const char * p_fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif // SIM_H__
+
+/** @} */
@@ -0,0 +1,794 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <getopt.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include "sim.h"
+#include "nordic_common.h"
+
+#define MIXES_MAX           8
+#define STACK_SIZE          (256 * 1024)         /**< Stack the handler runs on while its depth is measured. */
+#define STACK_PAINT         0xA5                 /**< Fill of the unused stack. */
+#define BENCH_START_US      SIM_MS(2000)         /**< Time the benchmark starts, with the application scanning. */
+#define UUID128_FIELD_LEN   17                   /**< Length byte value of an AD field with one 128-bit UUID. */
+
+int fw_main(void);
+
+extern uint8_t nus_service_uuid[16];
+
+/**@brief Kind of advertiser in the realistic mix. */
+typedef enum
+{
+    DEV_NUS,                      /**< NUS peripheral, the UUID after the flags. */
+    DEV_BEACON,                   /**< iBeacon style manufacturer data filling the report. */
+    DEV_EDDYSTONE,                /**< 16-bit UUID list and service data. */
+    DEV_SENSOR,                   /**< 16-bit UUIDs, short name and TX power. */
+    DEV_UUID128,                  /**< Another 128-bit service. */
+    DEV_PHONE,                    /**< Manufacturer data only, no flags. */
+    DEV_KIND_COUNT
+} dev_kind_t;
+
+/**@brief Mix of advertising reports. */
+typedef struct
+{
+    const char * p_name;
+    const char * p_description;
+    void      (* generate)(uint32_t index, ble_gap_evt_adv_report_t * p_report);
+} mix_t;
+
+/**@brief What the reference parser expects of a report. */
+typedef struct
+{
+    bool match;                   /**< A well formed field holds the NUS UUID first. */
+    bool overread;                /**< The application's parser reads past the end of the data. */
+} expect_t;
+
+/**@brief Results of one mix. */
+typedef struct
+{
+    const char * p_mix;
+    uint32_t     reports;
+    double       ns_mean;
+    double       ns_p50;
+    double       ns_p99;
+    double       ns_max;
+    uint32_t     matches;         /**< Reports the application connected to. */
+    uint32_t     expected;        /**< Reports the reference parser matches. */
+    uint32_t     false_matches;   /**< Matches the reference parser rejects. */
+    uint32_t     missed;          /**< Reference matches the application ignored. */
+    uint32_t     overreads;       /**< Reports the application parses past their end. */
+    uint32_t     stack_bytes;     /**< Most stack used by the handler. */
+    long         heap_bytes;      /**< Heap in use after handling the reports, less before. */
+} mix_result_t;
+
+static void gen_realistic(uint32_t index, ble_gap_evt_adv_report_t * p_report);
+static void gen_long(uint32_t index, ble_gap_evt_adv_report_t * p_report);
+static void gen_truncated(uint32_t index, ble_gap_evt_adv_report_t * p_report);
+static void gen_mixed(uint32_t index, ble_gap_evt_adv_report_t * p_report);
+
+static const mix_t m_mixes[] =
+{
+    {"realistic", "thousands of advertisers: beacons, phones, sensors, a few NUS peripherals", gen_realistic},
+    {"long",      "reports packed with short AD fields, the longest walk through the parser",  gen_long},
+    {"truncated", "malformed reports: fields past the end, empty fields, short UUID fields",  gen_truncated},
+    {"mixed",     "realistic with one report in ten long or truncated",                       gen_mixed},
+};
+
+static uint32_t         m_report_count = 20000;
+static uint32_t         m_address_count = 4096;
+static double           m_nus_share     = 0.01;
+static uint32_t         m_passes        = 5;
+static const char     * mp_mix_names[MIXES_MAX];
+static uint32_t         m_mix_name_count;
+static mix_result_t     m_results[MIXES_MAX];
+static uint32_t         m_result_count;
+
+static uint8_t        * mp_dev_kinds;            /**< Kind of each address. */
+static sim_ble_evt_buf_t * mp_events;            /**< Reports of the mix being run, with room past the data. */
+static expect_t       * mp_expect;
+static uint64_t       * mp_samples;              /**< Time to handle each report, in nanoseconds. */
+static ble_evt_handler_t m_handler;              /**< The application's BLE event handler. */
+static ble_gap_scan_params_t m_scan_params;
+static ucontext_t       m_main_ctx;
+static ucontext_t       m_bench_ctx;
+static uint8_t        * mp_stack;
+
+
+static uint64_t ns_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+static uint32_t rand_below(uint32_t limit)
+{
+    return (limit != 0) ? (sim_rand() % limit) : 0;
+}
+
+
+static void rand_fill(uint8_t * p_data, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        p_data[i] = (uint8_t)sim_rand();
+    }
+}
+
+
+/**@brief Function for appending an AD field.
+ *
+ * @return false if it does not fit.
+ */
+static bool field_add(ble_gap_evt_adv_report_t * p_report, uint8_t type, const uint8_t * p_data, uint8_t len)
+{
+    if ((p_report->dlen + 2 + len) > BLE_GAP_ADV_MAX_SIZE)
+    {
+        return false;
+    }
+    p_report->data[p_report->dlen]     = (uint8_t)(len + 1);
+    p_report->data[p_report->dlen + 1] = type;
+    if (p_data != NULL)
+    {
+        memcpy(&p_report->data[p_report->dlen + 2], p_data, len);
+    }
+    else
+    {
+        rand_fill(&p_report->data[p_report->dlen + 2], len);
+    }
+    p_report->dlen += 2 + len;
+    return true;
+}
+
+
+static void flags_add(ble_gap_evt_adv_report_t * p_report)
+{
+    static const uint8_t flags = 0x06;
+
+    (void)field_add(p_report, BLE_GAP_AD_TYPE_FLAGS, &flags, 1);
+}
+
+
+/**@brief Function for picking an advertiser and filling in the report fields that do not depend
+ *        on the data.
+ */
+static dev_kind_t address_pick(ble_gap_evt_adv_report_t * p_report)
+{
+    uint32_t address = rand_below(m_address_count);
+
+    p_report->peer_addr.addr_type = (address & 1) ? BLE_GAP_ADDR_TYPE_RANDOM_STATIC : BLE_GAP_ADDR_TYPE_PUBLIC;
+    UNUSED_VARIABLE(uint32_encode(address * 2654435761u, &p_report->peer_addr.addr[0]));
+    p_report->peer_addr.addr[4] = (uint8_t)(address >> 8);
+    p_report->peer_addr.addr[5] = 0xC0 | (uint8_t)address;
+    p_report->rssi              = (int8_t)(-40 - (int)rand_below(55));
+    p_report->type              = BLE_GAP_ADV_TYPE_ADV_IND;
+    p_report->scan_rsp          = 0;
+    p_report->dlen              = 0;
+    return (dev_kind_t)mp_dev_kinds[address];
+}
+
+
+static void gen_realistic(uint32_t index, ble_gap_evt_adv_report_t * p_report)
+{
+    dev_kind_t kind = address_pick(p_report);
+    uint8_t    data[BLE_GAP_ADV_MAX_SIZE];
+
+    UNUSED_PARAMETER(index);
+
+    // Scannable advertisers answer an active scanner with a name, or nothing.
+    if ((kind != DEV_BEACON) && (kind != DEV_PHONE) && (rand_below(10) < 3))
+    {
+        p_report->scan_rsp = 1;
+        if (rand_below(4) != 0)
+        {
+            memcpy(data, "Sensor-0000000000000000", 23);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME, data, (uint8_t)(6 + rand_below(18)));
+        }
+        return;
+    }
+
+    switch (kind)
+    {
+        case DEV_NUS:
+            flags_add(p_report);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE, nus_service_uuid, 16);
+            break;
+
+        case DEV_BEACON:
+            flags_add(p_report);
+            data[0] = 0x4C;
+            data[1] = 0x00;
+            data[2] = 0x02;
+            data[3] = 0x15;
+            rand_fill(&data[4], 21);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, data, 25);
+            break;
+
+        case DEV_EDDYSTONE:
+            flags_add(p_report);
+            data[0] = 0xAA;
+            data[1] = 0xFE;
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE, data, 2);
+            rand_fill(&data[2], 18);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_SERVICE_DATA, data, (uint8_t)(12 + rand_below(9)));
+            break;
+
+        case DEV_SENSOR:
+            flags_add(p_report);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE, NULL, (uint8_t)(2 * (1 + rand_below(3))));
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME, NULL, (uint8_t)(4 + rand_below(6)));
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_TX_POWER_LEVEL, NULL, 1);
+            break;
+
+        case DEV_UUID128:
+            flags_add(p_report);
+            (void)field_add(p_report, (rand_below(4) == 0) ? BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE
+                                                           : BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE,
+                            NULL, 16);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME, NULL, (uint8_t)(1 + rand_below(8)));
+            break;
+
+        default:
+            p_report->type = BLE_GAP_ADV_TYPE_ADV_NONCONN_IND;
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, NULL, (uint8_t)(8 + rand_below(19)));
+            break;
+    }
+}
+
+
+static void gen_long(uint32_t index, ble_gap_evt_adv_report_t * p_report)
+{
+    uint8_t type;
+
+    (void)address_pick(p_report);
+
+    // Fields without data, two bytes each, so both parses walk the whole report.
+    while (p_report->dlen < (BLE_GAP_ADV_MAX_SIZE - 2 - ((index % 4) == 0 ? 18 : 0)))
+    {
+        do
+        {
+            type = (uint8_t)sim_rand();
+        } while ((type == BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE) ||
+                 (type == BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE));
+        (void)field_add(p_report, type, NULL, 0);
+    }
+    // Every fourth report ends with a 128-bit UUID, NUS in some of them.
+    if ((index % 4) == 0)
+    {
+        (void)field_add(p_report, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE,
+                        (rand_below(1000) < (uint32_t)(m_nus_share * 4000.0)) ? nus_service_uuid : NULL, 16);
+    }
+}
+
+
+static void gen_truncated(uint32_t index, ble_gap_evt_adv_report_t * p_report)
+{
+    uint8_t  data[BLE_GAP_ADV_MAX_SIZE];
+    uint32_t len;
+
+    (void)address_pick(p_report);
+    switch (index % 6)
+    {
+        case 0:
+            // Last field claims more data than the report holds.
+            flags_add(p_report);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE, NULL, 4);
+            len = 4 + rand_below(10);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, NULL, (uint8_t)len);
+            p_report->data[p_report->dlen - len - 2] = (uint8_t)(len + 1 + 1 + rand_below(200));
+            break;
+
+        case 1:
+            // Zero length bytes, each a field of its own to the application's parser.
+            p_report->dlen = (uint8_t)(16 + rand_below(BLE_GAP_ADV_MAX_SIZE - 15));
+            memset(p_report->data, 0, p_report->dlen);
+            break;
+
+        case 2:
+            // Well formed NUS report, followed by the same cut short.
+            flags_add(p_report);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE, nus_service_uuid, 16);
+            break;
+
+        case 3:
+            // NUS UUID cut by the end of the report. The bytes past the end are left from the
+            // report before, so they complete the UUID.
+            flags_add(p_report);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE, nus_service_uuid, 16);
+            p_report->dlen = (uint8_t)(p_report->dlen - 1 - rand_below(15));
+            break;
+
+        case 4:
+            // 128-bit UUID field too short for a UUID, followed by bytes that complete the NUS UUID.
+            data[0] = nus_service_uuid[0];
+            data[1] = nus_service_uuid[1];
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE, data, 2);
+            memcpy(&p_report->data[p_report->dlen], &nus_service_uuid[2], 14);
+            p_report->dlen += 14;
+            break;
+
+        default:
+            // Length byte as the last byte of the report.
+            flags_add(p_report);
+            (void)field_add(p_report, BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME, NULL, (uint8_t)rand_below(20));
+            p_report->data[p_report->dlen++] = (uint8_t)(1 + rand_below(30));
+            break;
+    }
+}
+
+
+static void gen_mixed(uint32_t index, ble_gap_evt_adv_report_t * p_report)
+{
+    switch (rand_below(20))
+    {
+        case 0:
+            gen_long(index, p_report);
+            break;
+
+        case 1:
+            gen_truncated(index, p_report);
+            break;
+
+        default:
+            gen_realistic(index, p_report);
+            break;
+    }
+}
+
+
+/**@brief Function for finding what the application should make of a report, without reading
+ *        past its end, and whether the application's parser reads past its end.
+ */
+static expect_t report_check(const ble_gap_evt_adv_report_t * p_report)
+{
+    static const uint8_t types[] = {BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE,
+                                    BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE};
+    expect_t expect = {false, false};
+    uint32_t t;
+
+    for (t = 0; t < sizeof(types); t++)
+    {
+        uint32_t index = 0;
+        bool     found = false;
+
+        // Same walk as the application's parser, checking each access.
+        while (index < p_report->dlen)
+        {
+            uint8_t field_length = p_report->data[index];
+
+            if ((index + 1) >= p_report->dlen)
+            {
+                expect.overread = true;
+                break;
+            }
+            if (p_report->data[index + 1] == types[t])
+            {
+                found = true;
+                if ((index + 2 + 16) > p_report->dlen)
+                {
+                    expect.overread = true;
+                }
+                if (((index + 1 + field_length) <= p_report->dlen) && (field_length >= UUID128_FIELD_LEN) &&
+                    (memcmp(&p_report->data[index + 2], nus_service_uuid, 16) == 0))
+                {
+                    expect.match = true;
+                }
+                break;
+            }
+            index += field_length + 1;
+        }
+        if (found)
+        {
+            break;
+        }
+    }
+    return expect;
+}
+
+
+static void mix_generate(const mix_t * p_mix)
+{
+    uint32_t i;
+
+    for (i = 0; i < m_report_count; i++)
+    {
+        sim_ble_evt_buf_t        * p_evt = &mp_events[i];
+        ble_gap_evt_adv_report_t * p_report;
+
+        // The SoftDevice reuses its event buffer, so the bytes past the data are left from the
+        // report before.
+        if (i != 0)
+        {
+            *p_evt = mp_events[i - 1];
+        }
+        else
+        {
+            memset(p_evt, 0, sizeof(*p_evt));
+        }
+        p_evt->evt.header.evt_id            = BLE_GAP_EVT_ADV_REPORT;
+        p_evt->evt.header.evt_len           = sizeof(ble_evt_t) - sizeof(ble_evt_hdr_t);
+        p_evt->evt.evt.gap_evt.conn_handle  = BLE_CONN_HANDLE_INVALID;
+
+        p_report = &p_evt->evt.evt.gap_evt.params.adv_report;
+        p_mix->generate(i, p_report);
+        mp_expect[i] = report_check(p_report);
+    }
+}
+
+
+/**@brief Function for handing a report to the application.
+ *
+ * @return true if the application started connecting to the advertiser.
+ */
+static bool report_handle(sim_ble_evt_buf_t * p_evt)
+{
+    m_handler(&p_evt->evt);
+
+    // The application stops scanning and connects on a match. Put the scanner back.
+    if (sd_ble_gap_connect_cancel() == NRF_SUCCESS)
+    {
+        (void)sd_ble_gap_scan_start(&m_scan_params);
+        return true;
+    }
+    return false;
+}
+
+
+/**@brief Function for handling every report of the mix once on the painted stack, checking the
+ *        application's decisions against the reference parser.
+ */
+static void stack_pass(void)
+{
+    mix_result_t * p_result = &m_results[m_result_count];
+    uint32_t       i;
+
+    for (i = 0; i < m_report_count; i++)
+    {
+        bool match = report_handle(&mp_events[i]);
+
+        p_result->matches       += match ? 1 : 0;
+        p_result->expected      += mp_expect[i].match ? 1 : 0;
+        p_result->false_matches += (match && !mp_expect[i].match) ? 1 : 0;
+        p_result->missed        += (!match && mp_expect[i].match) ? 1 : 0;
+        p_result->overreads     += mp_expect[i].overread ? 1 : 0;
+    }
+}
+
+
+static int sample_compare(const void * p_a, const void * p_b)
+{
+    uint64_t a = *(const uint64_t *)p_a;
+    uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+
+/**@brief Function for finding the cost of reading the clock twice, to take off the samples. */
+static uint64_t clock_overhead_get(void)
+{
+    uint64_t best = UINT64_MAX;
+    uint32_t i;
+
+    for (i = 0; i < 1000; i++)
+    {
+        uint64_t start = ns_now();
+        uint64_t end   = ns_now();
+
+        best = MIN(best, end - start);
+    }
+    return best;
+}
+
+
+static void mix_run(const mix_t * p_mix)
+{
+    mix_result_t   * p_result = &m_results[m_result_count];
+    uint64_t         overhead = clock_overhead_get();
+    uint64_t         total    = 0;
+    uint32_t         count    = m_report_count * m_passes;
+    struct mallinfo2 before;
+    struct mallinfo2 after;
+    uint32_t         pass;
+    uint32_t         i;
+
+    memset(p_result, 0, sizeof(*p_result));
+    p_result->p_mix   = p_mix->p_name;
+    p_result->reports = m_report_count;
+    mix_generate(p_mix);
+
+    before = mallinfo2();
+
+    memset(mp_stack, STACK_PAINT, STACK_SIZE);
+    getcontext(&m_bench_ctx);
+    m_bench_ctx.uc_stack.ss_sp   = mp_stack;
+    m_bench_ctx.uc_stack.ss_size = STACK_SIZE;
+    m_bench_ctx.uc_link          = &m_main_ctx;
+    makecontext(&m_bench_ctx, stack_pass, 0);
+    swapcontext(&m_main_ctx, &m_bench_ctx);
+    for (i = 0; (i < STACK_SIZE) && (mp_stack[i] == STACK_PAINT); i++)
+    {
+    }
+    p_result->stack_bytes = STACK_SIZE - i;
+
+    for (pass = 0; pass < m_passes; pass++)
+    {
+        for (i = 0; i < m_report_count; i++)
+        {
+            uint64_t start = ns_now();
+            uint64_t ns;
+
+            m_handler(&mp_events[i].evt);
+            ns = ns_now() - start;
+            ns = (ns > overhead) ? (ns - overhead) : 0;
+            mp_samples[pass * m_report_count + i] = ns;
+            total += ns;
+
+            if (sd_ble_gap_connect_cancel() == NRF_SUCCESS)
+            {
+                (void)sd_ble_gap_scan_start(&m_scan_params);
+            }
+        }
+    }
+
+    after                = mallinfo2();
+    p_result->heap_bytes = (long)after.uordblks - (long)before.uordblks;
+
+    qsort(mp_samples, count, sizeof(mp_samples[0]), sample_compare);
+    p_result->ns_mean = (double)total / count;
+    p_result->ns_p50  = (double)mp_samples[count / 2];
+    p_result->ns_p99  = (double)mp_samples[(uint32_t)((uint64_t)count * 99 / 100)];
+    p_result->ns_max  = (double)mp_samples[count - 1];
+    m_result_count++;
+}
+
+
+/**@brief Function for running the benchmark from the application's main loop, once it scans. */
+static void bench_run(void * p_context, uint32_t arg)
+{
+    uint32_t i;
+    uint32_t j;
+
+    UNUSED_PARAMETER(p_context);
+    UNUSED_PARAMETER(arg);
+
+    m_handler = sim_sd_ble_evt_handler_get();
+    if (m_handler == NULL)
+    {
+        sim_abort(SIM_RESULT_APP_ERROR, "no BLE event handler");
+    }
+
+    // Advertiser kinds, NUS ones first so the share holds for any address count.
+    for (i = 0; i < m_address_count; i++)
+    {
+        mp_dev_kinds[i] = (i < (uint32_t)(m_nus_share * m_address_count))
+                          ? DEV_NUS : (uint8_t)(DEV_BEACON + rand_below(DEV_KIND_COUNT - 1));
+    }
+
+    // Take over the scanner with parameters of our own, so matches can be undone.
+    (void)sd_ble_gap_scan_stop();
+    (void)sd_ble_gap_connect_cancel();
+    m_scan_params.active   = 1;
+    m_scan_params.interval = 0x00A0;
+    m_scan_params.window   = 0x0050;
+    if (sd_ble_gap_scan_start(&m_scan_params) != NRF_SUCCESS)
+    {
+        sim_abort(SIM_RESULT_APP_ERROR, "could not start scanning");
+    }
+
+    for (i = 0; i < sizeof(m_mixes) / sizeof(m_mixes[0]); i++)
+    {
+        bool selected = (m_mix_name_count == 0);
+
+        for (j = 0; j < m_mix_name_count; j++)
+        {
+            selected = selected || (strcmp(mp_mix_names[j], m_mixes[i].p_name) == 0);
+        }
+        if (selected && (m_result_count < MIXES_MAX))
+        {
+            mix_run(&m_mixes[i]);
+        }
+    }
+    sim_abort(SIM_RESULT_OK, "benchmark done");
+}
+
+
+static void results_print(sim_host_format_t format)
+{
+    uint32_t i;
+
+    if (format == SIM_HOST_FORMAT_CSV)
+    {
+        printf("mix,reports,ns_mean,ns_p50,ns_p99,ns_max,reports_per_s,matches,expected_matches,"
+               "false_matches,missed_matches,overreads,stack_bytes,heap_bytes\n");
+    }
+    else if (format == SIM_HOST_FORMAT_JSON)
+    {
+        printf("{\"mixes\": [");
+    }
+
+    for (i = 0; i < m_result_count; i++)
+    {
+        const mix_result_t * p_r   = &m_results[i];
+        double               rate  = (p_r->ns_mean > 0.0) ? (1e9 / p_r->ns_mean) : 0.0;
+
+        switch (format)
+        {
+            case SIM_HOST_FORMAT_CSV:
+                printf("%s,%u,%.1f,%.0f,%.0f,%.0f,%.0f,%u,%u,%u,%u,%u,%u,%ld\n",
+                       p_r->p_mix, (unsigned)p_r->reports, p_r->ns_mean, p_r->ns_p50, p_r->ns_p99,
+                       p_r->ns_max, rate, (unsigned)p_r->matches, (unsigned)p_r->expected,
+                       (unsigned)p_r->false_matches, (unsigned)p_r->missed, (unsigned)p_r->overreads,
+                       (unsigned)p_r->stack_bytes, p_r->heap_bytes);
+                break;
+
+            case SIM_HOST_FORMAT_JSON:
+                printf("%s{\"mix\": \"%s\", \"reports\": %u, \"ns_mean\": %.1f, \"ns_p50\": %.0f, "
+                       "\"ns_p99\": %.0f, \"ns_max\": %.0f, \"reports_per_s\": %.0f, \"matches\": %u, "
+                       "\"expected_matches\": %u, \"false_matches\": %u, \"missed_matches\": %u, "
+                       "\"overreads\": %u, \"stack_bytes\": %u, \"heap_bytes\": %ld}",
+                       (i == 0) ? "" : ", ", p_r->p_mix, (unsigned)p_r->reports, p_r->ns_mean,
+                       p_r->ns_p50, p_r->ns_p99, p_r->ns_max, rate, (unsigned)p_r->matches,
+                       (unsigned)p_r->expected, (unsigned)p_r->false_matches, (unsigned)p_r->missed,
+                       (unsigned)p_r->overreads, (unsigned)p_r->stack_bytes, p_r->heap_bytes);
+                break;
+
+            default:
+                printf("mix=%s reports=%u ns_mean=%.1f ns_p50=%.0f ns_p99=%.0f ns_max=%.0f "
+                       "reports_per_s=%.0f matches=%u expected_matches=%u false_matches=%u "
+                       "missed_matches=%u overreads=%u stack_bytes=%u heap_bytes=%ld\n",
+                       p_r->p_mix, (unsigned)p_r->reports, p_r->ns_mean, p_r->ns_p50, p_r->ns_p99,
+                       p_r->ns_max, rate, (unsigned)p_r->matches, (unsigned)p_r->expected,
+                       (unsigned)p_r->false_matches, (unsigned)p_r->missed, (unsigned)p_r->overreads,
+                       (unsigned)p_r->stack_bytes, p_r->heap_bytes);
+                break;
+        }
+    }
+
+    if (format == SIM_HOST_FORMAT_JSON)
+    {
+        printf("]}\n");
+    }
+}
+
+
+static void usage(const char * p_name)
+{
+    uint32_t i;
+
+    printf("Usage: %s [options]\n", p_name);
+    printf("Hands generated advertising reports to the application's BLE event handler and reports\n"
+           "the time per report, the stack it takes and how its matches compare to a checked parser.\n");
+    printf("  --%-20s %s\n", "mix NAME",      "run this mix, repeatable (all)");
+    printf("  --%-20s %s\n", "reports N",     "reports per mix (20000)");
+    printf("  --%-20s %s\n", "addresses N",   "distinct advertisers (4096)");
+    printf("  --%-20s %s\n", "nus F",         "share of advertisers with the NUS UUID (0.01)");
+    printf("  --%-20s %s\n", "passes N",      "timed passes over the reports (5)");
+    printf("  --%-20s %s\n", "seed N",        "random seed (1)");
+    printf("  --%-20s %s\n", "format FMT",    "report as kv, json or csv (kv)");
+    printf("Mixes:\n");
+    for (i = 0; i < sizeof(m_mixes) / sizeof(m_mixes[0]); i++)
+    {
+        printf("  %-22s %s\n", m_mixes[i].p_name, m_mixes[i].p_description);
+    }
+}
+
+
+int main(int argc, char ** argv)
+{
+    static const struct option options[] =
+    {
+        {"mix",       required_argument, NULL, 'm'},
+        {"reports",   required_argument, NULL, 'r'},
+        {"addresses", required_argument, NULL, 'a'},
+        {"nus",       required_argument, NULL, 'n'},
+        {"passes",    required_argument, NULL, 'p'},
+        {"seed",      required_argument, NULL, 's'},
+        {"format",    required_argument, NULL, 'f'},
+        {"help",      no_argument,       NULL, 'h'},
+        {NULL,        0,                 NULL, 0},
+    };
+    sim_config_t    * p_cfg  = sim_config_get();
+    sim_host_format_t format = SIM_HOST_FORMAT_KV;
+    const char      * p_reason;
+    sim_result_t      result;
+    int               opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                if (m_mix_name_count < MIXES_MAX)
+                {
+                    mp_mix_names[m_mix_name_count++] = optarg;
+                }
+                break;
+
+            case 'r':
+                m_report_count = (uint32_t)MAX(atoi(optarg), 1);
+                break;
+
+            case 'a':
+                m_address_count = (uint32_t)MAX(atoi(optarg), 1);
+                break;
+
+            case 'n':
+                m_nus_share = atof(optarg);
+                break;
+
+            case 'p':
+                m_passes = (uint32_t)MAX(atoi(optarg), 1);
+                break;
+
+            case 's':
+                p_cfg->seed = strtoull(optarg, NULL, 0);
+                break;
+
+            case 'f':
+                format = (strcmp(optarg, "csv") == 0)  ? SIM_HOST_FORMAT_CSV :
+                         (strcmp(optarg, "json") == 0) ? SIM_HOST_FORMAT_JSON : SIM_HOST_FORMAT_KV;
+                break;
+
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    mp_dev_kinds = malloc(m_address_count);
+    mp_events    = malloc(sizeof(mp_events[0]) * m_report_count);
+    mp_expect    = malloc(sizeof(mp_expect[0]) * m_report_count);
+    mp_samples   = malloc(sizeof(mp_samples[0]) * m_report_count * m_passes);
+    mp_stack     = malloc(STACK_SIZE);
+    if ((mp_dev_kinds == NULL) || (mp_events == NULL) || (mp_expect == NULL) ||
+        (mp_samples == NULL) || (mp_stack == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    // The radio stays quiet; the reports come from the generator.
+    p_cfg->peer_count  = 0;
+    p_cfg->adv_noise   = 0;
+    p_cfg->line_count  = 0;
+    p_cfg->duration_us = BENCH_START_US + SIM_MS(1000);
+    (void)sim_schedule(BENCH_START_US, bench_run, NULL, 0);
+
+    result = sim_run(fw_main, &p_reason);
+    if (m_result_count == 0)
+    {
+        fprintf(stderr, "no results: %s\n", p_reason);
+        return EXIT_FAILURE;
+    }
+    results_print(format);
+
+    return (result == SIM_RESULT_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "sim.h"
+
+#define SETTINGS_MAX        24                   /**< Most --set options. */
+#define AXES_MAX            4                    /**< Most --sweep axes. */
+#define AXIS_VALUES_MAX     16                   /**< Most values of one axis. */
+#define PARAM_LEN_MAX       256                  /**< Longest parameter description of a run. */
+#define REASON_LEN_MAX      160
+
+int fw_main(void);
+
+/**@brief Benchmark suite. Every combination of the sweep axes is one run on top of the settings. */
+typedef struct
+{
+    const char * p_name;
+    const char * p_description;
+    const char * settings[SETTINGS_MAX];         /**< name=value pairs, NULL terminated. */
+    const char * axes[AXES_MAX];                 /**< name=value,value,... sweeps, NULL terminated. */
+} suite_t;
+
+/**@brief Sweep axis. */
+typedef struct
+{
+    char   name[32];
+    char * values[AXIS_VALUES_MAX];
+    int    count;
+} axis_t;
+
+/**@brief What a run sends back to the runner. */
+typedef struct
+{
+    sim_host_results_t results;
+    char               reason[REASON_LEN_MAX];
+} run_report_t;
+
+static const suite_t m_suites[] =
+{
+    {
+        "payload", "uplink throughput against line length, host writing back to back",
+        {"peer-mode=sink", "line-gap=0", "lines=100000", NULL},
+        {"line-len=8,20,40,64,128,200", NULL},
+    },
+    {
+        "interval", "uplink throughput against connection interval",
+        {"peer-mode=sink", "line-gap=0", "lines=100000", NULL},
+        {"ci=7.5,15,30,50,100", NULL},
+    },
+    {
+        "baud", "uplink throughput against UART rate",
+        {"peer-mode=sink", "line-gap=0", "lines=100000", NULL},
+        {"baud=9600,38400,115200", NULL},
+    },
+    {
+        "latency", "round trip latency of paced lines through an echoing peer",
+        {"peer-mode=echo", "line-gap=100", "lines=80", NULL},
+        {"line-len=8,20,64", "ci=7.5,30", NULL},
+    },
+    {
+        "downlink", "downlink throughput and latency against notification rate",
+        {"peer-mode=source", "lines=0", NULL},
+        {"source-bps=1000,2000,4000,8000", "ci=7.5,30", NULL},
+    },
+    {
+        "loss", "delivery and latency against packet loss",
+        {"peer-mode=echo", "line-gap=50", "lines=150", NULL},
+        {"loss=0,0.01,0.05,0.1,0.2", NULL},
+    },
+};
+
+static const char * m_settings[SETTINGS_MAX];    /**< --set options of the command line. */
+static int          m_setting_count;
+static axis_t       m_axes[AXES_MAX];            /**< Sweep axes of the suite being run. */
+static int          m_axis_count;
+static bool         m_first_run = true;
+
+
+static int setting_apply(const char * p_setting)
+{
+    char         name[32];
+    const char * p_value = strchr(p_setting, '=');
+
+    if ((p_value == NULL) || ((size_t)(p_value - p_setting) >= sizeof(name)))
+    {
+        return sim_host_option_set(p_setting, NULL);
+    }
+    memcpy(name, p_setting, p_value - p_setting);
+    name[p_value - p_setting] = '\0';
+    return sim_host_option_set(name, p_value + 1);
+}
+
+
+static int axis_parse(const char * p_spec, axis_t * p_axis)
+{
+    const char * p_values = strchr(p_spec, '=');
+    char       * p_copy;
+    char       * p_save;
+    char       * p_tok;
+
+    if ((p_values == NULL) || ((size_t)(p_values - p_spec) >= sizeof(p_axis->name)))
+    {
+        return -1;
+    }
+    memcpy(p_axis->name, p_spec, p_values - p_spec);
+    p_axis->name[p_values - p_spec] = '\0';
+    p_axis->count = 0;
+
+    p_copy = strdup(p_values + 1);
+    for (p_tok = strtok_r(p_copy, ",", &p_save);
+         (p_tok != NULL) && (p_axis->count < AXIS_VALUES_MAX);
+         p_tok = strtok_r(NULL, ",", &p_save))
+    {
+        p_axis->values[p_axis->count++] = p_tok;
+    }
+    return (p_axis->count != 0) ? 0 : -1;
+}
+
+
+/**@brief Function for running one configuration in a child process, so every run starts from
+ *        the application's initial state.
+ */
+static void run_one(const int * p_index, run_report_t * p_report)
+{
+    int   fds[2];
+    pid_t pid;
+    int   status;
+
+    memset(p_report, 0, sizeof(*p_report));
+    if (pipe(fds) != 0)
+    {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    fflush(stdout);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        const char * p_reason = "bad configuration";
+        sim_result_t result   = SIM_RESULT_APP_ERROR;
+        int          i;
+        bool         ok       = true;
+
+        close(fds[0]);
+        for (i = 0; i < m_setting_count; i++)
+        {
+            ok = ok && (setting_apply(m_settings[i]) == 0);
+        }
+        for (i = 0; i < m_axis_count; i++)
+        {
+            ok = ok && (sim_host_option_set(m_axes[i].name, m_axes[i].values[p_index[i]]) == 0);
+        }
+        if (ok && (sim_host_init() == 0))
+        {
+            // The application prints over the UART, keep the runner's output clean.
+            if (freopen("/dev/null", "w", stdout) == NULL)
+            {
+                _exit(EXIT_FAILURE);
+            }
+            result = sim_run(fw_main, &p_reason);
+        }
+        sim_host_results_get(result, &p_report->results);
+        snprintf(p_report->reason, sizeof(p_report->reason), "%s", p_reason);
+        if (write(fds[1], p_report, sizeof(*p_report)) != sizeof(*p_report))
+        {
+            _exit(EXIT_FAILURE);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(fds[1]);
+    if ((pid < 0) || (read(fds[0], p_report, sizeof(*p_report)) != sizeof(*p_report)))
+    {
+        memset(p_report, 0, sizeof(*p_report));
+        p_report->results.result = SIM_RESULT_APP_ERROR;
+        snprintf(p_report->reason, sizeof(p_report->reason), "run did not report");
+    }
+    close(fds[0]);
+    if ((pid > 0) && (waitpid(pid, &status, 0) == pid) && WIFSIGNALED(status))
+    {
+        p_report->results.result = SIM_RESULT_APP_ERROR;
+        snprintf(p_report->reason, sizeof(p_report->reason), "killed by signal %d", WTERMSIG(status));
+    }
+}
+
+
+static void params_format(const int * p_index, char * p_params, size_t size, bool json)
+{
+    size_t len = 0;
+    int    i;
+
+    p_params[0] = '\0';
+    for (i = 0; (i < m_axis_count) && (len < size); i++)
+    {
+        len += snprintf(&p_params[len], size - len, json ? "%s\"%s\": \"%s\"" : "%s%s=%s",
+                        (i == 0) ? "" : (json ? ", " : ";"), m_axes[i].name, m_axes[i].values[p_index[i]]);
+    }
+}
+
+
+static void report_print(const char * p_suite, const int * p_index, const run_report_t * p_report,
+                         sim_host_format_t format)
+{
+    char params[PARAM_LEN_MAX];
+
+    params_format(p_index, params, sizeof(params), format == SIM_HOST_FORMAT_JSON);
+    if (format == SIM_HOST_FORMAT_JSON)
+    {
+        printf("%s\n    {\"suite\": \"%s\", \"params\": {%s}, \"reason\": \"%s\", ",
+               m_first_run ? "" : ",", p_suite, params, p_report->reason);
+        sim_host_results_print(stdout, format, &p_report->results);
+        printf("}");
+    }
+    else
+    {
+        if (m_first_run)
+        {
+            printf("suite,params,");
+            sim_host_results_header_print(stdout);
+            printf("\n");
+        }
+        printf("%s,%s,", p_suite, params);
+        sim_host_results_print(stdout, format, &p_report->results);
+        printf("\n");
+    }
+    m_first_run = false;
+}
+
+
+/**@brief Function for running every combination of the sweep axes.
+ */
+static void suite_run(const char * p_suite, sim_host_format_t format)
+{
+    int index[AXES_MAX] = {0};
+
+    for (;;)
+    {
+        run_report_t report;
+        int          i;
+
+        run_one(index, &report);
+        report_print(p_suite, index, &report, format);
+
+        for (i = m_axis_count - 1; i >= 0; i--)
+        {
+            if (++index[i] < m_axes[i].count)
+            {
+                break;
+            }
+            index[i] = 0;
+        }
+        if (i < 0)
+        {
+            return;
+        }
+    }
+}
+
+
+static void usage(const char * p_name)
+{
+    uint32_t i;
+
+    printf("Usage: %s [--suite NAME]... [--set NAME=VALUE]... [--sweep NAME=V1,V2,...]... [--format json|csv]\n"
+           "\n"
+           "Runs every combination of the sweep axes as a separate simulation and reports the results\n"
+           "of each. Without --sweep, runs the named suites, or all of them. --set applies on top of\n"
+           "the suite settings. NAME is any option of bridge_sim without the dashes.\n"
+           "\n"
+           "Suites:\n",
+           p_name);
+    for (i = 0; i < sizeof(m_suites) / sizeof(m_suites[0]); i++)
+    {
+        printf("  %-10s %s\n", m_suites[i].p_name, m_suites[i].p_description);
+    }
+}
+
+
+int main(int argc, char ** argv)
+{
+    static const struct option options[] =
+    {
+        {"suite",  required_argument, NULL, 'S'},
+        {"set",    required_argument, NULL, 's'},
+        {"sweep",  required_argument, NULL, 'w'},
+        {"format", required_argument, NULL, 'f'},
+        {"help",   no_argument,       NULL, 'h'},
+        {NULL,     0,                 NULL, 0},
+    };
+    const char      * suites[sizeof(m_suites) / sizeof(m_suites[0])];
+    const char      * sweeps[AXES_MAX];
+    const char      * user_settings[SETTINGS_MAX];
+    int               suite_count   = 0;
+    int               sweep_count   = 0;
+    int               setting_count = 0;
+    sim_host_format_t format        = SIM_HOST_FORMAT_JSON;
+    uint32_t          i;
+    int               j;
+    int               opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'S':
+                if (suite_count < (int)(sizeof(suites) / sizeof(suites[0])))
+                {
+                    suites[suite_count++] = optarg;
+                }
+                break;
+
+            case 's':
+                if (setting_count < SETTINGS_MAX / 2)
+                {
+                    user_settings[setting_count++] = optarg;
+                }
+                break;
+
+            case 'w':
+                if (sweep_count < AXES_MAX)
+                {
+                    sweeps[sweep_count++] = optarg;
+                }
+                break;
+
+            case 'f':
+                format = (strcmp(optarg, "csv") == 0) ? SIM_HOST_FORMAT_CSV : SIM_HOST_FORMAT_JSON;
+                break;
+
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (format == SIM_HOST_FORMAT_JSON)
+    {
+        printf("{\"runs\": [");
+    }
+
+    if (sweep_count != 0)
+    {
+        for (j = 0; j < setting_count; j++)
+        {
+            m_settings[m_setting_count++] = user_settings[j];
+        }
+        for (j = 0; j < sweep_count; j++)
+        {
+            if (axis_parse(sweeps[j], &m_axes[m_axis_count++]) != 0)
+            {
+                fprintf(stderr, "bad sweep '%s'\n", sweeps[j]);
+                return EXIT_FAILURE;
+            }
+        }
+        suite_run("custom", format);
+    }
+    else
+    {
+        for (i = 0; i < sizeof(m_suites) / sizeof(m_suites[0]); i++)
+        {
+            const suite_t * p_suite = &m_suites[i];
+            bool            wanted  = (suite_count == 0);
+
+            for (j = 0; j < suite_count; j++)
+            {
+                wanted = wanted || (strcmp(suites[j], p_suite->p_name) == 0);
+            }
+            if (!wanted)
+            {
+                continue;
+            }
+
+            m_setting_count = 0;
+            m_axis_count    = 0;
+            for (j = 0; p_suite->settings[j] != NULL; j++)
+            {
+                m_settings[m_setting_count++] = p_suite->settings[j];
+            }
+            for (j = 0; j < setting_count; j++)
+            {
+                m_settings[m_setting_count++] = user_settings[j];
+            }
+            for (j = 0; p_suite->axes[j] != NULL; j++)
+            {
+                (void)axis_parse(p_suite->axes[j], &m_axes[m_axis_count++]);
+            }
+            suite_run(p_suite->p_name, format);
+        }
+    }
+
+    if (format == SIM_HOST_FORMAT_JSON)
+    {
+        printf("\n]}\n");
+    }
+    return EXIT_SUCCESS;
+}
+
+/** @}
+ *  @endcond
+ */
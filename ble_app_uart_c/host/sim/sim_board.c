@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "sim.h"
+#include "nrf.h"
+#include "bsp.h"
+#include "nrf_gpio.h"
+#include "app_error.h"
+#include "app_uart.h"
+#include "app_util_platform.h"
+#include "nordic_common.h"
+
+#define GPIO_PIN_COUNT      32
+
+NRF_FICR_Type sim_nrf_ficr =
+{
+    .CODEPAGESIZE = 1024,
+    .CODESIZE     = 256,
+};
+
+NRF_UICR_Type sim_nrf_uicr =
+{
+    .BOOTLOADERADDR = 0xFFFFFFFF,
+};
+
+NRF_UART_Type sim_nrf_uart0;
+
+static uint32_t m_gpio_out;
+
+
+uint32_t bsp_init(uint32_t type, uint32_t ticks_per_100ms, bsp_event_callback_t callback)
+{
+    UNUSED_PARAMETER(type);
+    UNUSED_PARAMETER(ticks_per_100ms);
+    UNUSED_PARAMETER(callback);
+    return NRF_SUCCESS;
+}
+
+
+void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+    UNUSED_PARAMETER(pin_number);
+}
+
+
+void nrf_gpio_cfg_input(uint32_t pin_number, uint32_t pull_config)
+{
+    UNUSED_PARAMETER(pin_number);
+    UNUSED_PARAMETER(pull_config);
+}
+
+
+void nrf_gpio_pin_set(uint32_t pin_number)
+{
+    m_gpio_out |= (1UL << (pin_number % GPIO_PIN_COUNT));
+}
+
+
+void nrf_gpio_pin_clear(uint32_t pin_number)
+{
+    m_gpio_out &= ~(1UL << (pin_number % GPIO_PIN_COUNT));
+}
+
+
+void nrf_gpio_pin_toggle(uint32_t pin_number)
+{
+    m_gpio_out ^= (1UL << (pin_number % GPIO_PIN_COUNT));
+}
+
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    // Buttons are pulled up and never pressed.
+    return ((m_gpio_out >> (pin_number % GPIO_PIN_COUNT)) & 1) | 1;
+}
+
+
+void app_util_critical_region_enter(uint8_t * p_nested)
+{
+    // Simulation events never preempt each other.
+    *p_nested = 0;
+}
+
+
+void app_util_critical_region_exit(uint8_t nested)
+{
+    UNUSED_PARAMETER(nested);
+}
+
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    sim_abort(SIM_RESULT_APP_ERROR, "error 0x%08X at %s:%u", error_code, (const char *)p_file_name, line_num);
+}
+
+
+/**@brief Function for printing over the UART, as printf() retargeted to app_uart does on the chip.
+ *        Bytes that do not fit in the UART TX FIFO are lost.
+ */
+int sim_printf(const char * p_fmt, ...)
+{
+    char    buf[256];
+    va_list args;
+    int     len;
+    int     i;
+
+    va_start(args, p_fmt);
+    len = vsnprintf(buf, sizeof(buf), p_fmt, args);
+    va_end(args);
+
+    for (i = 0; (i < len) && (i < (int)sizeof(buf) - 1); i++)
+    {
+        UNUSED_VARIABLE(app_uart_put((uint8_t)buf[i]));
+    }
+    return len;
+}
+
+/** @}
+ *  @endcond
+ */
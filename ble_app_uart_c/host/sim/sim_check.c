@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+/* Checks of application modules driven directly on the simulated SoftDevice, for behaviour the
+ * black-box runs of bridge_sim cannot observe. Each case runs in its own process, so module state
+ * does not carry over, and the exit status is the number of failed cases.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "sim.h"
+#include "app_timer.h"
+#include "flash_sched.h"
+#include "pstorage.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+#define CHECK_PRESCALER     0                    /**< app_timer prescaler of the checks. */
+#define CHECK_MAX_DEFER_MS  1000                 /**< Deferral timeout of the flash scheduler checks. */
+#define CHECK_DEFER_ON_MS   10                   /**< Time deferral is switched on, as scanning starts. */
+#define CHECK_DURATION_MS   4000                 /**< Length of a flash scheduler check. */
+#define CHECK_JOBS_MAX      4                    /**< Jobs of a flash scheduler check. */
+#define CHECK_BLOCK_SIZE    16                   /**< Size of a flash block. */
+#define CHECK_MARGIN_MS     100                  /**< Time a job may take past its deadline, for the flash operation itself. */
+
+/**@brief pstorage user a job belongs to. */
+typedef enum
+{
+    USER_SPILL,                   /**< Urgent writes, as the store-and-forward buffer spills. */
+    USER_KV,                      /**< Deferrable writes, as the key-value store saves settings. */
+    USER_COUNT
+} user_t;
+
+/**@brief Flash job queued during a check. */
+typedef struct
+{
+    uint32_t           at_ms;     /**< Time the job is queued. */
+    user_t             user;      /**< User queueing it. */
+    flash_sched_prio_t prio;      /**< Priority of the job. */
+    bool               clear;     /**< Erase the block, which takes a page erase, rather than write it. */
+    uint32_t           done_min_ms; /**< Earliest time the job may complete. */
+    uint32_t           done_max_ms; /**< Latest time the job may complete, without the margin. */
+} job_t;
+
+/**@brief Flash scheduler check. Deferral is on from @ref CHECK_DEFER_ON_MS. */
+typedef struct
+{
+    const char * p_name;
+    const char * p_description;
+    uint32_t     defer_off_ms;    /**< Time deferral is switched off, as scanning stops. 0 to leave it on. */
+    uint8_t      job_count;
+    job_t        jobs[CHECK_JOBS_MAX];
+} flash_case_t;
+
+static const flash_case_t m_flash_cases[] =
+{
+    {
+        "flash_defer_alone", "A deferrable job waits for the deferral timeout.", 0, 1,
+        {
+            {100,  USER_KV,    FLASH_SCHED_PRIO_DEFERRABLE, false, 1100, 1100},
+        },
+    },
+    {
+        "flash_defer_behind_urgent", "A deferrable job queued behind an urgent one still times out.", 0, 2,
+        {
+            {100,  USER_SPILL, FLASH_SCHED_PRIO_URGENT,     false, 100,  100},
+            {100,  USER_KV,    FLASH_SCHED_PRIO_DEFERRABLE, false, 1100, 1100},
+        },
+    },
+    {
+        "flash_defer_behind_erase", "The same with the urgent job erasing a page in flash.", 0, 2,
+        {
+            {100,  USER_SPILL, FLASH_SCHED_PRIO_URGENT,     true,  100,  100},
+            {105,  USER_KV,    FLASH_SCHED_PRIO_DEFERRABLE, false, 1105, 1105},
+        },
+    },
+    {
+        "flash_defer_window_restart", "A deferrable job after the timeout starts a new one.", 0, 3,
+        {
+            {100,  USER_KV,    FLASH_SCHED_PRIO_DEFERRABLE, false, 1100, 1100},
+            {1500, USER_SPILL, FLASH_SCHED_PRIO_URGENT,     true,  1500, 1500},
+            {1501, USER_KV,    FLASH_SCHED_PRIO_DEFERRABLE, false, 2501, 2501},
+        },
+    },
+    {
+        "flash_defer_released", "Deferrable jobs go once deferral is switched off.", 600, 2,
+        {
+            {100,  USER_SPILL, FLASH_SCHED_PRIO_URGENT,     true,  100,  100},
+            {105,  USER_KV,    FLASH_SCHED_PRIO_DEFERRABLE, false, 600,  600},
+        },
+    },
+};
+
+static const flash_case_t * mp_case;                      /**< Check being run. */
+static pstorage_handle_t    m_base[USER_COUNT];           /**< First block of each user. */
+static pstorage_handle_t    m_blocks[CHECK_JOBS_MAX];     /**< Block of each job. */
+static uint8_t              m_data[CHECK_JOBS_MAX][CHECK_BLOCK_SIZE];
+static uint64_t             m_done_us[CHECK_JOBS_MAX];    /**< Completion times, 0 while pending. */
+
+
+static void flash_cb(pstorage_handle_t * p_handle,
+                     uint8_t             op_code,
+                     uint32_t            result,
+                     uint8_t           * p_data,
+                     uint32_t            data_len)
+{
+    uint8_t i;
+
+    UNUSED_PARAMETER(op_code);
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(data_len);
+
+    for (i = 0; i < mp_case->job_count; i++)
+    {
+        if ((p_handle->module_id == m_blocks[i].module_id) &&
+            (p_handle->block_id == m_blocks[i].block_id)   &&
+            (m_done_us[i] == 0))
+        {
+            m_done_us[i] = (result == NRF_SUCCESS) ? sim_now() : UINT64_MAX;
+        }
+    }
+}
+
+
+static void sys_evt_dispatch(uint32_t sys_evt)
+{
+    pstorage_sys_event_handler(sys_evt);
+    flash_sched_on_sys_evt(sys_evt);
+}
+
+
+static void defer_set(void * p_context, uint32_t arg)
+{
+    UNUSED_PARAMETER(p_context);
+    flash_sched_defer_set(arg != 0);
+}
+
+
+static void job_queue(void * p_context, uint32_t arg)
+{
+    const job_t       * p_job   = &mp_case->jobs[arg];
+    pstorage_handle_t * p_block = &m_blocks[arg];
+    uint32_t            err_code;
+
+    UNUSED_PARAMETER(p_context);
+
+    err_code = pstorage_block_identifier_get(&m_base[p_job->user], arg, p_block);
+    if ((err_code == NRF_SUCCESS) && p_job->clear)
+    {
+        err_code = flash_sched_clear(p_block, CHECK_BLOCK_SIZE, p_job->prio);
+    }
+    else if (err_code == NRF_SUCCESS)
+    {
+        err_code = flash_sched_store(p_block, m_data[arg], CHECK_BLOCK_SIZE, 0, p_job->prio);
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        sim_abort(SIM_RESULT_APP_ERROR, "job %u not queued: %u", (unsigned)arg, (unsigned)err_code);
+    }
+}
+
+
+/**@brief Function for running a flash scheduler check, in place of the application. */
+static int flash_case_main(void)
+{
+    pstorage_module_param_t param;
+    uint32_t                err_code;
+    uint8_t                 i;
+
+    APP_TIMER_INIT(CHECK_PRESCALER, 2, 4, false);
+    err_code = softdevice_sys_evt_handler_set(sys_evt_dispatch);
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = pstorage_init();
+    }
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = flash_sched_init(NULL, APP_TIMER_TICKS(CHECK_MAX_DEFER_MS, CHECK_PRESCALER));
+    }
+    for (i = 0; (i < USER_COUNT) && (err_code == NRF_SUCCESS); i++)
+    {
+        param.block_size  = CHECK_BLOCK_SIZE;
+        param.block_count = CHECK_JOBS_MAX;
+        param.cb          = flash_cb;
+        err_code          = flash_sched_register(&param, &m_base[i]);
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        sim_abort(SIM_RESULT_APP_ERROR, "setup failed: %u", (unsigned)err_code);
+    }
+
+    (void)sim_schedule(SIM_MS(CHECK_DEFER_ON_MS), defer_set, NULL, 1);
+    if (mp_case->defer_off_ms != 0)
+    {
+        (void)sim_schedule(SIM_MS(mp_case->defer_off_ms), defer_set, NULL, 0);
+    }
+    for (i = 0; i < mp_case->job_count; i++)
+    {
+        (void)sim_schedule(SIM_MS(mp_case->jobs[i].at_ms), job_queue, NULL, i);
+    }
+
+    for (;;)
+    {
+        (void)sd_app_evt_wait();
+    }
+}
+
+
+/**@brief Function for running one flash scheduler check in the current process.
+ *
+ * @return true if it passed.
+ */
+static bool flash_case_run(const flash_case_t * p_case)
+{
+    const char * p_reason;
+    sim_result_t result;
+    bool         passed = true;
+    uint8_t      i;
+
+    mp_case                        = p_case;
+    sim_config_get()->duration_us  = SIM_MS(CHECK_DURATION_MS);
+
+    result = sim_run(flash_case_main, &p_reason);
+    if (result != SIM_RESULT_OK)
+    {
+        printf("%s: FAIL, %s\n", p_case->p_name, p_reason);
+        return false;
+    }
+
+    for (i = 0; i < p_case->job_count; i++)
+    {
+        const job_t * p_job = &p_case->jobs[i];
+
+        if (m_done_us[i] == 0)
+        {
+            printf("%s: FAIL, job %u queued at %u ms never completed\n",
+                   p_case->p_name, i, (unsigned)p_job->at_ms);
+            passed = false;
+        }
+        else if ((m_done_us[i] < SIM_MS(p_job->done_min_ms)) ||
+                 (m_done_us[i] > SIM_MS(p_job->done_max_ms + CHECK_MARGIN_MS)))
+        {
+            printf("%s: FAIL, job %u completed at %.3f ms, expected %u to %u ms\n",
+                   p_case->p_name, i, (double)m_done_us[i] / 1000.0,
+                   (unsigned)p_job->done_min_ms, (unsigned)(p_job->done_max_ms + CHECK_MARGIN_MS));
+            passed = false;
+        }
+    }
+    if (passed)
+    {
+        printf("%s: ok\n", p_case->p_name);
+    }
+    return passed;
+}
+
+
+static void usage(const char * p_name)
+{
+    uint32_t i;
+
+    printf("Usage: %s [--verbose] [check...]\n\nChecks, all by default:\n", p_name);
+    for (i = 0; i < (sizeof(m_flash_cases) / sizeof(m_flash_cases[0])); i++)
+    {
+        printf("  %-32s %s\n", m_flash_cases[i].p_name, m_flash_cases[i].p_description);
+    }
+}
+
+
+int main(int argc, char ** argv)
+{
+    static const struct option options[] =
+    {
+        {"verbose", no_argument, NULL, 'v'},
+        {"help",    no_argument, NULL, 'h'},
+        {NULL,      0,           NULL, 0},
+    };
+    uint32_t failed = 0;
+    uint32_t i;
+    int      opt;
+    int      j;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'v':
+                sim_config_get()->verbose = true;
+                break;
+
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    for (i = 0; i < (sizeof(m_flash_cases) / sizeof(m_flash_cases[0])); i++)
+    {
+        const flash_case_t * p_case = &m_flash_cases[i];
+        bool                 wanted = (optind == argc);
+        pid_t                pid;
+        int                  status;
+
+        for (j = optind; j < argc; j++)
+        {
+            wanted = wanted || (strcmp(argv[j], p_case->p_name) == 0);
+        }
+        if (!wanted)
+        {
+            continue;
+        }
+
+        fflush(stdout);
+        pid = fork();
+        if (pid == 0)
+        {
+            bool passed = flash_case_run(p_case);
+
+            fflush(stdout);
+            _exit(passed ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        if ((pid < 0) || (waitpid(pid, &status, 0) != pid) ||
+            !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))
+        {
+            if ((pid > 0) && WIFSIGNALED(status))
+            {
+                printf("%s: FAIL, killed by signal %d\n", p_case->p_name, WTERMSIG(status));
+            }
+            failed++;
+        }
+    }
+
+    printf("%u failed\n", (unsigned)failed);
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "nrf_soc.h"
+
+#define EVT_POOL_INITIAL    256          /**< Initial number of simulation event slots. */
+#define ID_INDEX_BITS       20           /**< Bits of an event ID that index the pool. */
+#define ID_INDEX_MASK       ((1UL << ID_INDEX_BITS) - 1)
+
+/**@brief Simulation event. */
+typedef struct
+{
+    uint64_t      time;                  /**< Time the event is due. */
+    uint64_t      seq;                   /**< Order of scheduling, to break ties. */
+    sim_handler_t handler;               /**< Handler, NULL if cancelled or free. */
+    void        * p_context;             /**< Handler context. */
+    uint32_t      arg;                   /**< Handler argument. */
+    uint32_t      gen;                   /**< Generation of the slot, to detect stale IDs. */
+    uint32_t      next_free;             /**< Next free slot. */
+} sim_evt_t;
+
+static sim_config_t   m_config =
+{
+    .duration_us      = SIM_MS(10000),
+    .seed             = 1,
+    .baud             = 0,
+    .conn_interval_us = 0,
+    .pkts_per_event   = 4,
+    .tx_buffers       = 6,
+    .loss             = 0.0,
+    .pairing_events   = 6,
+    .peer_count       = 1,
+    .adv_noise        = 0,
+    .adv_interval_us  = SIM_MS(50),
+    .peer_mode        = SIM_PEER_ECHO,
+    .source_bps       = 1000,
+    .source_len       = 20,
+    .uart_start_us    = SIM_MS(1000),
+    .line_count       = 100,
+    .line_len         = 20,
+    .line_gap_us      = SIM_MS(50),
+};
+static sim_hooks_t    m_hooks;
+
+static sim_evt_t    * mp_pool;           /**< Event slots. */
+static uint32_t       m_pool_size;
+static uint32_t       m_free_head = UINT32_MAX;
+static uint32_t     * mp_heap;           /**< Binary heap of slot indexes, earliest first. */
+static uint32_t       m_heap_count;
+static uint64_t       m_seq;
+static uint64_t       m_now;
+static uint64_t       m_rand_state;
+
+static sim_prof_entry_t m_prof[SIM_PROF_SRC_COUNT][SIM_PROF_IDS];
+
+static jmp_buf        m_exit_jmp;
+static sim_result_t   m_result;
+static char           m_reason[160];
+
+
+sim_config_t * sim_config_get(void)
+{
+    return &m_config;
+}
+
+
+sim_hooks_t * sim_hooks_get(void)
+{
+    return &m_hooks;
+}
+
+
+uint64_t sim_now(void)
+{
+    return m_now;
+}
+
+
+/**@brief Function for checking whether slot a is due before slot b.
+ */
+static bool evt_before(uint32_t a, uint32_t b)
+{
+    if (mp_pool[a].time != mp_pool[b].time)
+    {
+        return mp_pool[a].time < mp_pool[b].time;
+    }
+    return mp_pool[a].seq < mp_pool[b].seq;
+}
+
+
+static void heap_swap(uint32_t i, uint32_t j)
+{
+    uint32_t tmp = mp_heap[i];
+
+    mp_heap[i] = mp_heap[j];
+    mp_heap[j] = tmp;
+}
+
+
+static void heap_push(uint32_t slot)
+{
+    uint32_t i = m_heap_count++;
+
+    mp_heap[i] = slot;
+    while ((i > 0) && evt_before(mp_heap[i], mp_heap[(i - 1) / 2]))
+    {
+        heap_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+
+static uint32_t heap_pop(void)
+{
+    uint32_t top = mp_heap[0];
+    uint32_t i   = 0;
+
+    mp_heap[0] = mp_heap[--m_heap_count];
+    for (;;)
+    {
+        uint32_t l     = 2 * i + 1;
+        uint32_t r     = l + 1;
+        uint32_t least = i;
+
+        if ((l < m_heap_count) && evt_before(mp_heap[l], mp_heap[least]))
+        {
+            least = l;
+        }
+        if ((r < m_heap_count) && evt_before(mp_heap[r], mp_heap[least]))
+        {
+            least = r;
+        }
+        if (least == i)
+        {
+            break;
+        }
+        heap_swap(i, least);
+        i = least;
+    }
+    return top;
+}
+
+
+static void pool_grow(void)
+{
+    uint32_t new_size = (m_pool_size == 0) ? EVT_POOL_INITIAL : (2 * m_pool_size);
+    uint32_t i;
+
+    if (new_size > ID_INDEX_MASK)
+    {
+        sim_abort(SIM_RESULT_APP_ERROR, "simulation event pool exhausted");
+    }
+    mp_pool = realloc(mp_pool, new_size * sizeof(sim_evt_t));
+    mp_heap = realloc(mp_heap, new_size * sizeof(uint32_t));
+    if ((mp_pool == NULL) || (mp_heap == NULL))
+    {
+        abort();
+    }
+    for (i = new_size; i > m_pool_size; i--)
+    {
+        memset(&mp_pool[i - 1], 0, sizeof(sim_evt_t));
+        mp_pool[i - 1].next_free = m_free_head;
+        m_free_head              = i - 1;
+    }
+    m_pool_size = new_size;
+}
+
+
+uint32_t sim_schedule(uint64_t time_us, sim_handler_t handler, void * p_context, uint32_t arg)
+{
+    uint32_t slot;
+
+    if (m_free_head == UINT32_MAX)
+    {
+        pool_grow();
+    }
+    slot        = m_free_head;
+    m_free_head = mp_pool[slot].next_free;
+
+    // Nothing can happen in the past.
+    mp_pool[slot].time      = (time_us < m_now) ? m_now : time_us;
+    mp_pool[slot].seq       = m_seq++;
+    mp_pool[slot].handler   = handler;
+    mp_pool[slot].p_context = p_context;
+    mp_pool[slot].arg       = arg;
+    mp_pool[slot].gen++;
+    heap_push(slot);
+
+    return slot | ((mp_pool[slot].gen & (0xFFFFFFFFUL >> ID_INDEX_BITS)) << ID_INDEX_BITS);
+}
+
+
+void sim_cancel(uint32_t id)
+{
+    uint32_t slot = id & ID_INDEX_MASK;
+
+    if ((slot < m_pool_size) &&
+        (((mp_pool[slot].gen & (0xFFFFFFFFUL >> ID_INDEX_BITS)) << ID_INDEX_BITS) == (id & ~ID_INDEX_MASK)))
+    {
+        // The slot stays in the heap and is freed when it comes up.
+        mp_pool[slot].handler = NULL;
+    }
+}
+
+
+uint32_t sim_rand(void)
+{
+    // xorshift64*
+    m_rand_state ^= m_rand_state >> 12;
+    m_rand_state ^= m_rand_state << 25;
+    m_rand_state ^= m_rand_state >> 27;
+    return (uint32_t)((m_rand_state * 2685821657736338717ULL) >> 32);
+}
+
+
+bool sim_chance(double probability)
+{
+    if (probability <= 0.0)
+    {
+        return false;
+    }
+    return ((double)sim_rand() / 4294967296.0) < probability;
+}
+
+
+void sim_log(const char * p_fmt, ...)
+{
+    va_list args;
+
+    if (!m_config.verbose)
+    {
+        return;
+    }
+    fprintf(stderr, "%10.3f ", (double)m_now / 1000.0);
+    va_start(args, p_fmt);
+    vfprintf(stderr, p_fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+
+void sim_abort(sim_result_t result, const char * p_fmt, ...)
+{
+    va_list args;
+
+    m_result = result;
+    va_start(args, p_fmt);
+    vsnprintf(m_reason, sizeof(m_reason), p_fmt, args);
+    va_end(args);
+    longjmp(m_exit_jmp, 1);
+}
+
+
+/**@brief Function for starting to measure the time of an application handler.
+ *
+ * @return Host time in nanoseconds, 0 if profiling is off.
+ */
+uint64_t sim_prof_start(void)
+{
+    struct timespec ts;
+
+    if (!m_config.profile)
+    {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+void sim_prof_end(sim_prof_src_t src, uint32_t id, uint64_t start)
+{
+    sim_prof_entry_t * p_entry;
+    uint64_t           ns;
+
+    if ((start == 0) || (src >= SIM_PROF_SRC_COUNT) || (id >= SIM_PROF_IDS))
+    {
+        return;
+    }
+    ns      = sim_prof_start() - start;
+    p_entry = &m_prof[src][id];
+    p_entry->count++;
+    p_entry->total_ns += ns;
+    if (ns > p_entry->max_ns)
+    {
+        p_entry->max_ns = ns;
+    }
+}
+
+
+const sim_prof_entry_t * sim_prof_get(sim_prof_src_t src, uint32_t id)
+{
+    return ((src < SIM_PROF_SRC_COUNT) && (id < SIM_PROF_IDS)) ? &m_prof[src][id] : NULL;
+}
+
+
+sim_result_t sim_run(int (* app_main)(void), const char ** pp_reason)
+{
+    m_rand_state = m_config.seed ^ 0x9E3779B97F4A7C15ULL;
+    if (m_rand_state == 0)
+    {
+        m_rand_state = 1;
+    }
+    m_result    = SIM_RESULT_OK;
+    m_reason[0] = '\0';
+
+    if (setjmp(m_exit_jmp) == 0)
+    {
+        sim_peer_init();
+        sim_radio_init();
+        (void)app_main();
+        sim_abort(SIM_RESULT_APP_ERROR, "main() returned");
+    }
+
+    *pp_reason = m_reason;
+    return m_result;
+}
+
+
+/**@brief Function for running the next simulation event. Stands in for sleeping until an
+ *        interrupt has been handled.
+ */
+uint32_t sd_app_evt_wait(void)
+{
+    for (;;)
+    {
+        uint32_t  slot;
+        sim_evt_t evt;
+
+        if (m_heap_count == 0)
+        {
+            sim_abort(SIM_RESULT_IDLE, "no more events");
+        }
+        if (mp_pool[mp_heap[0]].time > m_config.duration_us)
+        {
+            m_now = m_config.duration_us;
+            sim_abort(SIM_RESULT_OK, "end of run");
+        }
+
+        slot = heap_pop();
+        evt  = mp_pool[slot];
+
+        mp_pool[slot].handler   = NULL;
+        mp_pool[slot].next_free = m_free_head;
+        m_free_head             = slot;
+
+        if (evt.handler != NULL)
+        {
+            m_now = evt.time;
+            evt.handler(evt.p_context, evt.arg);
+            // Peripheral tasks the application triggered take effect once the handler is done.
+            sim_uart_tasks_process();
+            return NRF_SUCCESS;
+        }
+    }
+}
+
+/** @}
+ *  @endcond
+ */
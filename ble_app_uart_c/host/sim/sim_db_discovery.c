@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "ble_db_discovery.h"
+#include "nrf_error.h"
+
+#define SRV_DISC_START_HANDLE   0x0001           /**< Handle to start service discovery from. */
+
+/**@brief Service registered for discovery. */
+typedef struct
+{
+    ble_uuid_t                     srv_uuid;
+    ble_db_discovery_evt_handler_t evt_handler;
+} registered_handler_t;
+
+static registered_handler_t m_handlers[BLE_DB_DISCOVERY_MAX_SRV];
+static uint8_t              m_num_of_handlers;
+static bool                 m_initialized;
+
+
+static void evt_send(ble_db_discovery_t * p_db, ble_db_discovery_evt_t * p_evt)
+{
+    p_evt->conn_handle = p_db->conn_handle;
+    m_handlers[p_db->curr_srv_ind].evt_handler(p_evt);
+}
+
+
+static void error_send(ble_db_discovery_t * p_db, uint32_t err_code)
+{
+    ble_db_discovery_evt_t evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.evt_type        = BLE_DB_DISCOVERY_ERROR;
+    evt.params.err_code = err_code;
+    p_db->discovery_in_progress = false;
+    evt_send(p_db, &evt);
+}
+
+
+static void srv_discover(ble_db_discovery_t * p_db)
+{
+    ble_db_discovery_srv_t * p_srv = &p_db->services[p_db->curr_srv_ind];
+    uint32_t                 err_code;
+
+    memset(p_srv, 0, sizeof(*p_srv));
+    p_srv->srv_uuid    = m_handlers[p_db->curr_srv_ind].srv_uuid;
+    p_db->curr_char_ind = 0;
+
+    err_code = sd_ble_gattc_primary_services_discover(p_db->conn_handle, SRV_DISC_START_HANDLE, &p_srv->srv_uuid);
+    if (err_code != NRF_SUCCESS)
+    {
+        error_send(p_db, err_code);
+    }
+}
+
+
+/**@brief Function for moving on to the next registered service, or ending the discovery.
+ */
+static void srv_next(ble_db_discovery_t * p_db)
+{
+    p_db->discoveries_count++;
+    if ((p_db->curr_srv_ind + 1) < m_num_of_handlers)
+    {
+        p_db->curr_srv_ind++;
+        p_db->srv_count++;
+        srv_discover(p_db);
+    }
+    else
+    {
+        p_db->discovery_in_progress = false;
+    }
+}
+
+
+static void srv_complete(ble_db_discovery_t * p_db)
+{
+    ble_db_discovery_evt_t evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.evt_type             = BLE_DB_DISCOVERY_COMPLETE;
+    evt.params.discovered_db = p_db->services[p_db->curr_srv_ind];
+    evt_send(p_db, &evt);
+    srv_next(p_db);
+}
+
+
+static void chars_discover(ble_db_discovery_t * p_db)
+{
+    ble_db_discovery_srv_t * p_srv = &p_db->services[p_db->curr_srv_ind];
+    ble_gattc_handle_range_t range = p_srv->handle_range;
+    uint32_t                 err_code;
+
+    if (p_srv->char_count != 0)
+    {
+        range.start_handle = p_srv->charateristics[p_srv->char_count - 1].characteristic.handle_value + 1;
+    }
+    err_code = sd_ble_gattc_characteristics_discover(p_db->conn_handle, &range);
+    if (err_code != NRF_SUCCESS)
+    {
+        error_send(p_db, err_code);
+    }
+}
+
+
+/**@brief Function for finding the handle range of the descriptors of the current characteristic.
+ *
+ * @return false if the characteristic has no room for descriptors.
+ */
+static bool desc_range_get(ble_db_discovery_t * p_db, ble_gattc_handle_range_t * p_range)
+{
+    ble_db_discovery_srv_t  * p_srv  = &p_db->services[p_db->curr_srv_ind];
+    ble_db_discovery_char_t * p_char = &p_srv->charateristics[p_db->curr_char_ind];
+
+    p_range->start_handle = p_char->characteristic.handle_value + 1;
+    if ((p_db->curr_char_ind + 1) < p_srv->char_count)
+    {
+        p_range->end_handle = p_srv->charateristics[p_db->curr_char_ind + 1].characteristic.handle_decl - 1;
+    }
+    else
+    {
+        p_range->end_handle = p_srv->handle_range.end_handle;
+    }
+    return p_range->start_handle <= p_range->end_handle;
+}
+
+
+/**@brief Function for discovering the descriptors of the next characteristic that can have any.
+ */
+static void descs_discover(ble_db_discovery_t * p_db)
+{
+    ble_db_discovery_srv_t * p_srv = &p_db->services[p_db->curr_srv_ind];
+    ble_gattc_handle_range_t range;
+
+    for (; p_db->curr_char_ind < p_srv->char_count; p_db->curr_char_ind++)
+    {
+        if (desc_range_get(p_db, &range))
+        {
+            uint32_t err_code = sd_ble_gattc_descriptors_discover(p_db->conn_handle, &range);
+
+            if (err_code != NRF_SUCCESS)
+            {
+                error_send(p_db, err_code);
+            }
+            return;
+        }
+    }
+    srv_complete(p_db);
+}
+
+
+static void on_srv_disc_rsp(ble_db_discovery_t * p_db, const ble_gattc_evt_t * p_evt)
+{
+    ble_db_discovery_srv_t * p_srv = &p_db->services[p_db->curr_srv_ind];
+
+    if ((p_evt->gatt_status == BLE_GATT_STATUS_SUCCESS) && (p_evt->params.prim_srvc_disc_rsp.count != 0))
+    {
+        p_srv->handle_range = p_evt->params.prim_srvc_disc_rsp.services[0].handle_range;
+        chars_discover(p_db);
+    }
+    else
+    {
+        ble_db_discovery_evt_t evt;
+
+        memset(&evt, 0, sizeof(evt));
+        evt.evt_type = BLE_DB_DISCOVERY_SRV_NOT_FOUND;
+        evt.params.discovered_db.srv_uuid = p_srv->srv_uuid;
+        evt_send(p_db, &evt);
+        srv_next(p_db);
+    }
+}
+
+
+static void on_char_disc_rsp(ble_db_discovery_t * p_db, const ble_gattc_evt_t * p_evt)
+{
+    ble_db_discovery_srv_t * p_srv = &p_db->services[p_db->curr_srv_ind];
+    uint16_t                 i;
+
+    if (p_evt->gatt_status == BLE_GATT_STATUS_SUCCESS)
+    {
+        const ble_gattc_char_t * p_chars = p_evt->params.char_disc_rsp.chars;
+        uint16_t                 last    = 0;
+
+        for (i = 0; i < p_evt->params.char_disc_rsp.count; i++)
+        {
+            last = p_chars[i].handle_value;
+            if (p_srv->char_count < BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV)
+            {
+                p_srv->charateristics[p_srv->char_count].characteristic = p_chars[i];
+                p_srv->charateristics[p_srv->char_count].cccd_handle    = BLE_GATT_HANDLE_INVALID;
+                p_srv->char_count++;
+            }
+        }
+        if ((p_evt->params.char_disc_rsp.count != 0)                 &&
+            (p_srv->char_count < BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV)  &&
+            (last < p_srv->handle_range.end_handle))
+        {
+            chars_discover(p_db);
+            return;
+        }
+    }
+
+    // No more characteristics in the service.
+    p_db->curr_char_ind = 0;
+    descs_discover(p_db);
+}
+
+
+static void on_desc_disc_rsp(ble_db_discovery_t * p_db, const ble_gattc_evt_t * p_evt)
+{
+    ble_db_discovery_srv_t * p_srv = &p_db->services[p_db->curr_srv_ind];
+    uint16_t                 i;
+
+    if (p_evt->gatt_status == BLE_GATT_STATUS_SUCCESS)
+    {
+        const ble_gattc_desc_t * p_descs = p_evt->params.desc_disc_rsp.descs;
+
+        for (i = 0; i < p_evt->params.desc_disc_rsp.count; i++)
+        {
+            if ((p_descs[i].uuid.type == BLE_UUID_TYPE_BLE) &&
+                (p_descs[i].uuid.uuid == BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG))
+            {
+                p_srv->charateristics[p_db->curr_char_ind].cccd_handle = p_descs[i].handle;
+            }
+        }
+    }
+
+    p_db->curr_char_ind++;
+    descs_discover(p_db);
+}
+
+
+uint32_t ble_db_discovery_init(void)
+{
+    m_num_of_handlers = 0;
+    m_initialized     = true;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_db_discovery_close(void)
+{
+    m_num_of_handlers = 0;
+    m_initialized     = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_db_discovery_evt_register(const ble_uuid_t * const             p_uuid,
+                                       const ble_db_discovery_evt_handler_t evt_handler)
+{
+    if ((p_uuid == NULL) || (evt_handler == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_num_of_handlers == BLE_DB_DISCOVERY_MAX_SRV)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_handlers[m_num_of_handlers].srv_uuid    = *p_uuid;
+    m_handlers[m_num_of_handlers].evt_handler = evt_handler;
+    m_num_of_handlers++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_db_discovery_start(ble_db_discovery_t * p_db_discovery,
+                                uint16_t             conn_handle)
+{
+    if (p_db_discovery == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!m_initialized || (m_num_of_handlers == 0))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_db_discovery->discovery_in_progress)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    p_db_discovery->conn_handle           = conn_handle;
+    p_db_discovery->srv_count             = 0;
+    p_db_discovery->curr_srv_ind          = 0;
+    p_db_discovery->curr_char_ind         = 0;
+    p_db_discovery->discoveries_count     = 0;
+    p_db_discovery->discovery_in_progress = true;
+    srv_discover(p_db_discovery);
+    return NRF_SUCCESS;
+}
+
+
+void ble_db_discovery_on_ble_evt(ble_db_discovery_t * const p_db_discovery,
+                                 const ble_evt_t * const    p_ble_evt)
+{
+    const ble_gattc_evt_t * p_evt = &p_ble_evt->evt.gattc_evt;
+
+    if ((p_db_discovery == NULL) || (p_ble_evt == NULL))
+    {
+        return;
+    }
+
+    if (p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        if (p_ble_evt->evt.gap_evt.conn_handle == p_db_discovery->conn_handle)
+        {
+            p_db_discovery->discovery_in_progress = false;
+            p_db_discovery->conn_handle           = BLE_CONN_HANDLE_INVALID;
+        }
+        return;
+    }
+
+    if (!p_db_discovery->discovery_in_progress || (p_evt->conn_handle != p_db_discovery->conn_handle))
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+            on_srv_disc_rsp(p_db_discovery, p_evt);
+            break;
+
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+            on_char_disc_rsp(p_db_discovery, p_evt);
+            break;
+
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+            on_desc_disc_rsp(p_db_discovery, p_evt);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "device_manager.h"
+#include "pstorage.h"
+#include "nrf_error.h"
+#include "nordic_common.h"
+
+#define DEVICE_CONTEXT_SIZE     144              /**< Flash kept per bonded device: identity, keys and GATT context. */
+
+/**@brief Link known to the device manager. */
+typedef struct
+{
+    uint16_t             conn_handle;
+    ble_gap_addr_t       peer_addr;
+    dm_device_instance_t device_id;              /**< Bond of the peer, DM_INVALID_ID if not bonded. */
+} dm_conn_t;
+
+/**@brief Bonded device. */
+typedef struct
+{
+    bool           in_use;
+    ble_gap_addr_t addr;
+    uint8_t        context[DEVICE_CONTEXT_SIZE]; /**< Image of the context as stored in flash. */
+} dm_bond_t;
+
+static bool                   m_initialized;
+static dm_application_param_t m_app;
+static bool                   m_app_registered;
+static dm_conn_t              m_conns[DEVICE_MANAGER_MAX_CONNECTIONS];
+static dm_bond_t              m_bonds[DEVICE_MANAGER_MAX_BONDS];
+static pstorage_handle_t      m_storage_handle;
+
+
+static void conns_reset(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < DEVICE_MANAGER_MAX_CONNECTIONS; i++)
+    {
+        m_conns[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+        m_conns[i].device_id   = DM_INVALID_ID;
+    }
+}
+
+
+static dm_connection_instance_t conn_find(uint16_t conn_handle)
+{
+    dm_connection_instance_t i;
+
+    for (i = 0; i < DEVICE_MANAGER_MAX_CONNECTIONS; i++)
+    {
+        if (m_conns[i].conn_handle == conn_handle)
+        {
+            return i;
+        }
+    }
+    return DM_INVALID_ID;
+}
+
+
+static void evt_send(dm_connection_instance_t conn_id, uint8_t event_id, ble_gap_evt_t * p_gap_evt, ret_code_t result)
+{
+    dm_handle_t handle;
+    dm_event_t  event;
+
+    if (!m_app_registered)
+    {
+        return;
+    }
+    handle.appl_id       = 0;
+    handle.connection_id = conn_id;
+    handle.device_id     = (conn_id == DM_INVALID_ID) ? DM_INVALID_ID : m_conns[conn_id].device_id;
+    handle.service_id    = DM_PROTOCOL_CNTXT_GATT_CLI_ID;
+
+    event.event_id                = event_id;
+    event.event_paramlen          = (p_gap_evt == NULL) ? 0 : sizeof(ble_gap_evt_t);
+    event.event_param.p_gap_param = p_gap_evt;
+
+    (void)m_app.evt_handler(&handle, &event, result);
+}
+
+
+static void storage_cb(pstorage_handle_t * p_handle,
+                       uint8_t             op_code,
+                       uint32_t            result,
+                       uint8_t           * p_data,
+                       uint32_t            data_len)
+{
+    dm_connection_instance_t conn_id = DM_INVALID_ID;
+    dm_connection_instance_t i;
+
+    UNUSED_PARAMETER(p_handle);
+    UNUSED_PARAMETER(data_len);
+
+    if (op_code != PSTORAGE_UPDATE_OP_CODE)
+    {
+        return;
+    }
+    for (i = 0; i < DEVICE_MANAGER_MAX_CONNECTIONS; i++)
+    {
+        if ((m_conns[i].device_id != DM_INVALID_ID) && (p_data == m_bonds[m_conns[i].device_id].context))
+        {
+            conn_id = i;
+        }
+    }
+    evt_send(conn_id, DM_EVT_DEVICE_CONTEXT_STORED, NULL, result);
+}
+
+
+/**@brief Function for bonding with the peer of a link and storing the bond.
+ */
+static void bond_store(dm_connection_instance_t conn_id)
+{
+    dm_conn_t       * p_conn = &m_conns[conn_id];
+    pstorage_handle_t block;
+    uint8_t           i;
+
+    for (i = 0; i < DEVICE_MANAGER_MAX_BONDS; i++)
+    {
+        if (m_bonds[i].in_use && (memcmp(&m_bonds[i].addr, &p_conn->peer_addr, sizeof(ble_gap_addr_t)) == 0))
+        {
+            break;
+        }
+    }
+    if (i == DEVICE_MANAGER_MAX_BONDS)
+    {
+        for (i = 0; (i < DEVICE_MANAGER_MAX_BONDS) && m_bonds[i].in_use; i++)
+        {
+        }
+    }
+    if (i == DEVICE_MANAGER_MAX_BONDS)
+    {
+        evt_send(conn_id, DM_EVT_DEVICE_CONTEXT_STORED, NULL, NRF_ERROR_NO_MEM);
+        return;
+    }
+
+    m_bonds[i].in_use = true;
+    m_bonds[i].addr   = p_conn->peer_addr;
+    memset(m_bonds[i].context, 0, sizeof(m_bonds[i].context));
+    memcpy(m_bonds[i].context, &p_conn->peer_addr, sizeof(ble_gap_addr_t));
+    p_conn->device_id = i;
+
+    if ((pstorage_block_identifier_get(&m_storage_handle, i, &block) != NRF_SUCCESS) ||
+        (pstorage_update(&block, m_bonds[i].context, sizeof(m_bonds[i].context), 0) != NRF_SUCCESS))
+    {
+        evt_send(conn_id, DM_EVT_DEVICE_CONTEXT_STORED, NULL, NRF_ERROR_NO_MEM);
+    }
+}
+
+
+ret_code_t dm_init(dm_init_param_t const * p_init_param)
+{
+    pstorage_module_param_t param;
+    uint32_t                err_code;
+
+    if (p_init_param == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    memset(m_bonds, 0, sizeof(m_bonds));
+    conns_reset();
+
+    param.cb          = storage_cb;
+    param.block_size  = DEVICE_CONTEXT_SIZE;
+    param.block_count = DEVICE_MANAGER_MAX_BONDS;
+    err_code = pstorage_register(&param, &m_storage_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    if (p_init_param->clear_persistent_data)
+    {
+        err_code = pstorage_clear(&m_storage_handle, DEVICE_CONTEXT_SIZE * DEVICE_MANAGER_MAX_BONDS);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    m_initialized = true;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t dm_register(dm_application_instance_t    * p_appl_instance,
+                       dm_application_param_t const * p_appl_param)
+{
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_appl_instance == NULL) || (p_appl_param == NULL) || (p_appl_param->evt_handler == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (m_app_registered)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_app            = *p_appl_param;
+    m_app_registered = true;
+    *p_appl_instance = 0;
+    return NRF_SUCCESS;
+}
+
+
+void dm_ble_evt_handler(ble_evt_t * p_ble_evt)
+{
+    ble_gap_evt_t          * p_gap_evt = &p_ble_evt->evt.gap_evt;
+    dm_connection_instance_t conn_id;
+
+    if (!m_initialized)
+    {
+        return;
+    }
+
+    if (p_ble_evt->header.evt_id == BLE_GAP_EVT_CONNECTED)
+    {
+        uint8_t i;
+
+        conn_id = conn_find(BLE_CONN_HANDLE_INVALID);
+        if (conn_id == DM_INVALID_ID)
+        {
+            return;
+        }
+        m_conns[conn_id].conn_handle = p_gap_evt->conn_handle;
+        m_conns[conn_id].peer_addr   = p_gap_evt->params.connected.peer_addr;
+        m_conns[conn_id].device_id   = DM_INVALID_ID;
+        for (i = 0; i < DEVICE_MANAGER_MAX_BONDS; i++)
+        {
+            if (m_bonds[i].in_use &&
+                (memcmp(&m_bonds[i].addr, &p_gap_evt->params.connected.peer_addr, sizeof(ble_gap_addr_t)) == 0))
+            {
+                m_conns[conn_id].device_id = i;
+            }
+        }
+        evt_send(conn_id, DM_EVT_CONNECTION, p_gap_evt, NRF_SUCCESS);
+        return;
+    }
+
+    conn_id = conn_find(p_gap_evt->conn_handle);
+    if (conn_id == DM_INVALID_ID)
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_DISCONNECTED:
+            evt_send(conn_id, DM_EVT_DISCONNECTION, p_gap_evt, NRF_SUCCESS);
+            m_conns[conn_id].conn_handle = BLE_CONN_HANDLE_INVALID;
+            m_conns[conn_id].device_id   = DM_INVALID_ID;
+            break;
+
+        case BLE_GAP_EVT_SEC_REQUEST:
+            evt_send(conn_id, DM_EVT_SECURITY_SETUP, p_gap_evt, NRF_SUCCESS);
+            break;
+
+        case BLE_GAP_EVT_AUTH_STATUS:
+            evt_send(conn_id, DM_EVT_SECURITY_SETUP_COMPLETE, p_gap_evt, p_gap_evt->params.auth_status.auth_status);
+            if ((p_gap_evt->params.auth_status.auth_status == BLE_GAP_SEC_STATUS_SUCCESS) &&
+                p_gap_evt->params.auth_status.bonded)
+            {
+                bond_store(conn_id);
+            }
+            break;
+
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:
+            evt_send(conn_id, DM_EVT_LINK_SECURED, p_gap_evt, NRF_SUCCESS);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+ret_code_t dm_security_setup_req(dm_handle_t * p_handle)
+{
+    if (!m_initialized || !m_app_registered)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_handle == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if ((p_handle->connection_id >= DEVICE_MANAGER_MAX_CONNECTIONS) ||
+        (m_conns[p_handle->connection_id].conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return sd_ble_gap_authenticate(m_conns[p_handle->connection_id].conn_handle, &m_app.sec_param);
+}
+
+
+ret_code_t dm_whitelist_create(dm_application_instance_t const * p_handle,
+                               ble_gap_whitelist_t             * p_whitelist)
+{
+    uint8_t count = 0;
+    uint8_t i;
+
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_handle == NULL) || (p_whitelist == NULL) || (p_whitelist->pp_addrs == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    for (i = 0; (i < DEVICE_MANAGER_MAX_BONDS) && (count < p_whitelist->addr_count); i++)
+    {
+        if (m_bonds[i].in_use)
+        {
+            p_whitelist->pp_addrs[count++] = &m_bonds[i].addr;
+        }
+    }
+    p_whitelist->addr_count = count;
+    p_whitelist->irk_count  = 0;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t dm_peer_addr_get(dm_handle_t const * p_handle, ble_gap_addr_t * p_addr)
+{
+    if ((p_handle == NULL) || (p_addr == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if ((p_handle->connection_id >= DEVICE_MANAGER_MAX_CONNECTIONS) ||
+        (m_conns[p_handle->connection_id].conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    *p_addr = m_conns[p_handle->connection_id].peer_addr;
+    return NRF_SUCCESS;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "ble.h"
+#include "nordic_common.h"
+
+#define ATT_TIMEOUT_US               SIM_MS(30000)   /**< ATT transaction timeout. */
+
+#define ATT_OP_ERROR_RSP             0x01
+#define ATT_OP_FIND_INFO_REQ         0x04
+#define ATT_OP_FIND_INFO_RSP         0x05
+#define ATT_OP_FIND_BY_TYPE_REQ      0x06
+#define ATT_OP_FIND_BY_TYPE_RSP      0x07
+#define ATT_OP_READ_BY_TYPE_REQ      0x08
+#define ATT_OP_READ_BY_TYPE_RSP      0x09
+#define ATT_OP_READ_REQ              0x0A
+#define ATT_OP_READ_RSP              0x0B
+#define ATT_OP_WRITE_REQ             0x12
+#define ATT_OP_WRITE_RSP             0x13
+#define ATT_OP_NOTIFICATION          0x1B
+#define ATT_OP_INDICATION            0x1D
+#define ATT_OP_CONFIRMATION          0x1E
+#define ATT_OP_WRITE_CMD             0x52
+
+/**@brief GATT client state of one link. */
+typedef struct
+{
+    bool       connected;
+    uint8_t    pending_op;                   /**< Opcode of the outstanding request, 0 if none. */
+    uint16_t   pending_handle;               /**< Handle the outstanding request is for. */
+    ble_uuid_t pending_uuid;                 /**< Service UUID of an outstanding service discovery. */
+    uint32_t   timeout_id;                   /**< ATT transaction timer. */
+    bool       timed_out;                    /**< An ATT transaction has timed out, no more requests are accepted. */
+} gattc_link_t;
+
+static gattc_link_t m_links[SIM_MAX_CONNS];
+
+
+static void put_u16(uint8_t * p_dst, uint16_t value)
+{
+    p_dst[0] = (uint8_t)(value & 0xFF);
+    p_dst[1] = (uint8_t)(value >> 8);
+}
+
+
+static uint16_t get_u16(const uint8_t * p_src)
+{
+    return (uint16_t)(p_src[0] | (p_src[1] << 8));
+}
+
+
+static void evt_init(sim_ble_evt_buf_t * p_buf, uint16_t evt_id, uint16_t conn_handle)
+{
+    memset(p_buf, 0, sizeof(*p_buf));
+    p_buf->evt.header.evt_id              = evt_id;
+    p_buf->evt.header.evt_len             = sizeof(ble_evt_t) - sizeof(ble_evt_hdr_t);
+    p_buf->evt.evt.gattc_evt.conn_handle  = conn_handle;
+    p_buf->evt.evt.gattc_evt.gatt_status  = BLE_GATT_STATUS_SUCCESS;
+    p_buf->evt.evt.gattc_evt.error_handle = BLE_GATT_HANDLE_INVALID;
+}
+
+
+static void att_timeout_handler(void * p_context, uint32_t conn_handle)
+{
+    sim_ble_evt_buf_t buf;
+
+    UNUSED_PARAMETER(p_context);
+
+    m_links[conn_handle].timed_out  = true;
+    m_links[conn_handle].pending_op = 0;
+    sim_log("gattc: link %u ATT timeout", conn_handle);
+
+    evt_init(&buf, BLE_GATTC_EVT_TIMEOUT, (uint16_t)conn_handle);
+    buf.evt.evt.gattc_evt.params.timeout.src = BLE_GATT_TIMEOUT_SRC_PROTOCOL;
+    sim_sd_ble_evt_raise(&buf);
+}
+
+
+/**@brief Function for sending an ATT request, one at a time per link as ATT requires.
+ */
+static uint32_t request_send(uint16_t conn_handle, const sim_pdu_t * p_pdu, uint16_t handle)
+{
+    gattc_link_t * p_link;
+    uint32_t       err_code;
+
+    if ((conn_handle >= SIM_MAX_CONNS) || !m_links[conn_handle].connected)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    p_link = &m_links[conn_handle];
+    if (sim_config_get()->replay)
+    {
+        // Responses come from the trace.
+        return sim_radio_central_send(conn_handle, p_pdu, false);
+    }
+    if (p_link->timed_out)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_link->pending_op != 0)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    err_code = sim_radio_central_send(conn_handle, p_pdu, false);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    p_link->pending_op     = p_pdu->data[0];
+    p_link->pending_handle = handle;
+    p_link->timeout_id     = sim_schedule(sim_now() + ATT_TIMEOUT_US, att_timeout_handler, NULL, conn_handle);
+    return NRF_SUCCESS;
+}
+
+
+void sim_gattc_on_connect(uint16_t conn_handle)
+{
+    memset(&m_links[conn_handle], 0, sizeof(m_links[conn_handle]));
+    m_links[conn_handle].connected = true;
+}
+
+
+void sim_gattc_on_disconnect(uint16_t conn_handle)
+{
+    sim_cancel(m_links[conn_handle].timeout_id);
+    m_links[conn_handle].connected = false;
+}
+
+
+/**@brief Function for decoding a UUID of an attribute PDU.
+ */
+static void uuid_decode(const uint8_t * p_data, uint8_t len, ble_uuid_t * p_uuid)
+{
+    if (len == 2)
+    {
+        p_uuid->type = BLE_UUID_TYPE_BLE;
+        p_uuid->uuid = get_u16(p_data);
+    }
+    else
+    {
+        (void)sim_sd_uuid_decode(p_data, p_uuid);
+    }
+}
+
+
+/**@brief Function for turning a response to the outstanding request into an event.
+ */
+static void response_decode(uint16_t conn_handle, uint8_t req_op, const sim_pdu_t * p_pdu, sim_ble_evt_buf_t * p_buf)
+{
+    const uint8_t   * p_data = p_pdu->data;
+    gattc_link_t    * p_link = &m_links[conn_handle];
+    ble_gattc_evt_t * p_evt  = &p_buf->evt.evt.gattc_evt;
+    uint16_t          i;
+
+    switch (req_op)
+    {
+        case ATT_OP_FIND_BY_TYPE_REQ:
+        {
+            ble_gattc_service_t * p_srv = p_evt->params.prim_srvc_disc_rsp.services;
+
+            evt_init(p_buf, BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP, conn_handle);
+            for (i = 1; (i + 4) <= p_pdu->len; i += 4)
+            {
+                p_srv->uuid                      = p_link->pending_uuid;
+                p_srv->handle_range.start_handle = get_u16(&p_data[i]);
+                p_srv->handle_range.end_handle   = get_u16(&p_data[i + 2]);
+                p_srv++;
+                p_evt->params.prim_srvc_disc_rsp.count++;
+            }
+            break;
+        }
+
+        case ATT_OP_READ_BY_TYPE_REQ:
+        {
+            ble_gattc_char_t * p_char = p_evt->params.char_disc_rsp.chars;
+            uint8_t            len    = p_data[1];
+
+            evt_init(p_buf, BLE_GATTC_EVT_CHAR_DISC_RSP, conn_handle);
+            for (i = 2; (i + len) <= p_pdu->len; i += len)
+            {
+                uint8_t props = p_data[i + 2];
+
+                p_char->handle_decl                 = get_u16(&p_data[i]);
+                p_char->char_props.broadcast        = (props >> 0) & 1;
+                p_char->char_props.read             = (props >> 1) & 1;
+                p_char->char_props.write_wo_resp    = (props >> 2) & 1;
+                p_char->char_props.write            = (props >> 3) & 1;
+                p_char->char_props.notify           = (props >> 4) & 1;
+                p_char->char_props.indicate         = (props >> 5) & 1;
+                p_char->char_props.auth_signed_wr   = (props >> 6) & 1;
+                p_char->char_ext_props              = (props >> 7) & 1;
+                p_char->handle_value                = get_u16(&p_data[i + 3]);
+                uuid_decode(&p_data[i + 5], (uint8_t)(len - 5), &p_char->uuid);
+                p_char++;
+                p_evt->params.char_disc_rsp.count++;
+            }
+            break;
+        }
+
+        case ATT_OP_FIND_INFO_REQ:
+        {
+            ble_gattc_desc_t * p_desc = p_evt->params.desc_disc_rsp.descs;
+            uint8_t            len    = (p_data[1] == 0x01) ? 4 : 18;
+
+            evt_init(p_buf, BLE_GATTC_EVT_DESC_DISC_RSP, conn_handle);
+            for (i = 2; (i + len) <= p_pdu->len; i += len)
+            {
+                p_desc->handle = get_u16(&p_data[i]);
+                uuid_decode(&p_data[i + 2], (uint8_t)(len - 2), &p_desc->uuid);
+                p_desc++;
+                p_evt->params.desc_disc_rsp.count++;
+            }
+            break;
+        }
+
+        case ATT_OP_READ_REQ:
+            evt_init(p_buf, BLE_GATTC_EVT_READ_RSP, conn_handle);
+            p_evt->params.read_rsp.handle = p_link->pending_handle;
+            p_evt->params.read_rsp.len    = (uint16_t)(p_pdu->len - 1);
+            memcpy(p_evt->params.read_rsp.data, &p_data[1], p_pdu->len - 1);
+            break;
+
+        case ATT_OP_WRITE_REQ:
+        default:
+            evt_init(p_buf, BLE_GATTC_EVT_WRITE_RSP, conn_handle);
+            p_evt->params.write_rsp.handle   = p_link->pending_handle;
+            p_evt->params.write_rsp.write_op = BLE_GATT_OP_WRITE_REQ;
+            break;
+    }
+}
+
+
+/**@brief Function for mapping a request to the event its response or error is reported in.
+ */
+static uint16_t request_evt_id(uint8_t req_op)
+{
+    switch (req_op)
+    {
+        case ATT_OP_FIND_BY_TYPE_REQ:
+            return BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP;
+        case ATT_OP_READ_BY_TYPE_REQ:
+            return BLE_GATTC_EVT_CHAR_DISC_RSP;
+        case ATT_OP_FIND_INFO_REQ:
+            return BLE_GATTC_EVT_DESC_DISC_RSP;
+        case ATT_OP_READ_REQ:
+            return BLE_GATTC_EVT_READ_RSP;
+        default:
+            return BLE_GATTC_EVT_WRITE_RSP;
+    }
+}
+
+
+void sim_gattc_on_rx(uint16_t conn_handle, const sim_pdu_t * p_pdu)
+{
+    gattc_link_t    * p_link = &m_links[conn_handle];
+    sim_ble_evt_buf_t buf;
+    uint8_t           op     = p_pdu->data[0];
+    uint8_t           req_op = p_link->pending_op;
+
+    if (!p_link->connected)
+    {
+        return;
+    }
+
+    if ((op == ATT_OP_NOTIFICATION) || (op == ATT_OP_INDICATION))
+    {
+        evt_init(&buf, BLE_GATTC_EVT_HVX, conn_handle);
+        buf.evt.evt.gattc_evt.params.hvx.handle = get_u16(&p_pdu->data[1]);
+        buf.evt.evt.gattc_evt.params.hvx.type   = (op == ATT_OP_NOTIFICATION) ? BLE_GATT_HVX_NOTIFICATION
+                                                                              : BLE_GATT_HVX_INDICATION;
+        buf.evt.evt.gattc_evt.params.hvx.len    = (uint16_t)(p_pdu->len - 3);
+        memcpy(buf.evt.evt.gattc_evt.params.hvx.data, &p_pdu->data[3], p_pdu->len - 3);
+        sim_sd_ble_evt_raise(&buf);
+        return;
+    }
+
+    if (req_op == 0)
+    {
+        // Not a response to anything, the SoftDevice drops it.
+        return;
+    }
+    sim_cancel(p_link->timeout_id);
+    p_link->pending_op = 0;
+
+    if (op == ATT_OP_ERROR_RSP)
+    {
+        evt_init(&buf, request_evt_id(req_op), conn_handle);
+        buf.evt.evt.gattc_evt.gatt_status  = (uint16_t)(BLE_GATT_STATUS_ATTERR_INVALID + p_pdu->data[4]);
+        buf.evt.evt.gattc_evt.error_handle = get_u16(&p_pdu->data[2]);
+        if (req_op == ATT_OP_WRITE_REQ)
+        {
+            buf.evt.evt.gattc_evt.params.write_rsp.handle   = p_link->pending_handle;
+            buf.evt.evt.gattc_evt.params.write_rsp.write_op = BLE_GATT_OP_WRITE_REQ;
+        }
+    }
+    else
+    {
+        response_decode(conn_handle, req_op, p_pdu, &buf);
+    }
+    sim_sd_ble_evt_raise(&buf);
+}
+
+
+uint32_t sd_ble_gattc_primary_services_discover(uint16_t conn_handle, uint16_t start_handle, ble_uuid_t const * const p_srvc_uuid)
+{
+    sim_pdu_t pdu;
+    uint32_t  err_code;
+
+    if (p_srvc_uuid == NULL)
+    {
+        // Discovery of all services is not used by the application.
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    pdu.data[0] = ATT_OP_FIND_BY_TYPE_REQ;
+    put_u16(&pdu.data[1], start_handle);
+    put_u16(&pdu.data[3], BLE_GATT_HANDLE_END);
+    put_u16(&pdu.data[5], BLE_UUID_SERVICE_PRIMARY);
+    if (p_srvc_uuid->type == BLE_UUID_TYPE_BLE)
+    {
+        put_u16(&pdu.data[7], p_srvc_uuid->uuid);
+        pdu.len = 9;
+    }
+    else if (sim_sd_uuid_encode(p_srvc_uuid, &pdu.data[7]))
+    {
+        pdu.len = 23;
+    }
+    else
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    err_code = request_send(conn_handle, &pdu, start_handle);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_links[conn_handle].pending_uuid = *p_srvc_uuid;
+    }
+    return err_code;
+}
+
+
+static uint32_t range_request(uint16_t conn_handle, uint8_t op, ble_gattc_handle_range_t const * p_range)
+{
+    sim_pdu_t pdu;
+
+    if (p_range == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    pdu.data[0] = op;
+    put_u16(&pdu.data[1], p_range->start_handle);
+    put_u16(&pdu.data[3], p_range->end_handle);
+    pdu.len = 5;
+    if (op == ATT_OP_READ_BY_TYPE_REQ)
+    {
+        put_u16(&pdu.data[5], BLE_UUID_CHARACTERISTIC);
+        pdu.len = 7;
+    }
+    return request_send(conn_handle, &pdu, p_range->start_handle);
+}
+
+
+uint32_t sd_ble_gattc_characteristics_discover(uint16_t conn_handle, ble_gattc_handle_range_t const * const p_handle_range)
+{
+    return range_request(conn_handle, ATT_OP_READ_BY_TYPE_REQ, p_handle_range);
+}
+
+
+uint32_t sd_ble_gattc_descriptors_discover(uint16_t conn_handle, ble_gattc_handle_range_t const * const p_handle_range)
+{
+    return range_request(conn_handle, ATT_OP_FIND_INFO_REQ, p_handle_range);
+}
+
+
+uint32_t sd_ble_gattc_read(uint16_t conn_handle, uint16_t handle, uint16_t offset)
+{
+    sim_pdu_t pdu;
+
+    if (offset != 0)
+    {
+        // Long reads are not used by the application.
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    pdu.data[0] = ATT_OP_READ_REQ;
+    put_u16(&pdu.data[1], handle);
+    pdu.len = 3;
+    return request_send(conn_handle, &pdu, handle);
+}
+
+
+uint32_t sd_ble_gattc_write(uint16_t conn_handle, ble_gattc_write_params_t const * const p_write_params)
+{
+    sim_pdu_t pdu;
+
+    if (p_write_params == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if ((p_write_params->len > (SIM_ATT_MTU - 3)) || (p_write_params->offset != 0))
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    if ((p_write_params->len != 0) && (p_write_params->p_value == NULL))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    put_u16(&pdu.data[1], p_write_params->handle);
+    if (p_write_params->len != 0)
+    {
+        memcpy(&pdu.data[3], p_write_params->p_value, p_write_params->len);
+    }
+    pdu.len = (uint16_t)(3 + p_write_params->len);
+
+    switch (p_write_params->write_op)
+    {
+        case BLE_GATT_OP_WRITE_REQ:
+            pdu.data[0] = ATT_OP_WRITE_REQ;
+            return request_send(conn_handle, &pdu, p_write_params->handle);
+
+        case BLE_GATT_OP_WRITE_CMD:
+            if ((conn_handle >= SIM_MAX_CONNS) || !m_links[conn_handle].connected)
+            {
+                return BLE_ERROR_INVALID_CONN_HANDLE;
+            }
+            pdu.data[0] = ATT_OP_WRITE_CMD;
+            return sim_radio_central_send(conn_handle, &pdu, true);
+
+        default:
+            return NRF_ERROR_INVALID_PARAM;
+    }
+}
+
+
+uint32_t sd_ble_gattc_hv_confirm(uint16_t conn_handle, uint16_t handle)
+{
+    sim_pdu_t pdu;
+
+    UNUSED_PARAMETER(handle);
+
+    if ((conn_handle >= SIM_MAX_CONNS) || !m_links[conn_handle].connected)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    pdu.data[0] = ATT_OP_CONFIRMATION;
+    pdu.len     = 1;
+    return sim_radio_central_send(conn_handle, &pdu, false);
+}
+
+/** @}
+ *  @endcond
+ */
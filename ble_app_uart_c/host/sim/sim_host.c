@@ -0,0 +1,1188 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "ble_hci.h"
+#include "app_util.h"
+#include "link_quality.h"
+#include "nordic_common.h"
+#include "rtt_probe.h"
+#include "scan_gw.h"
+#include "uart_cmd.h"
+
+#define LINE_LEN_MAX        240                  /**< Longest line the host writes. */
+#define SCRIPT_LINE_MAX     512                  /**< Longest line of a scenario script. */
+#define HOST_POLL_US        1000                 /**< Host poll interval while writing back to back. */
+#define SETTLE_US           SIM_MS(1000)         /**< Lines younger than this at the end of a run are in flight, not lost. */
+#define SOURCE_SEQ_RING     4096                 /**< Notified lines of each peer remembered for latency. */
+
+/**@brief State of the host's decoder of scanner gateway batches, named after the field expected next. */
+typedef enum
+{
+    GW_RX_DATA,                                  /**< Data, or ESC. */
+    GW_RX_OP,                                    /**< Op of a frame. */
+    GW_RX_COUNT,                                 /**< Record count of a batch. */
+    GW_RX_DROPPED,                               /**< Dropped count of a batch. */
+    GW_RX_LEN,                                   /**< Length of a batch. */
+    GW_RX_RECORDS,                               /**< Records of a batch. */
+    GW_RX_PROBE_ID,                              /**< Id of a probe or link quality report, unused. */
+    GW_RX_PROBE_STATUS,                          /**< Status of a report, unused. */
+    GW_RX_PROBE_LEN,                             /**< Length of a report. */
+    GW_RX_PROBE_REPORT,                          /**< Body of a report. */
+    GW_RX_RESPONSE                               /**< Rest of a command response, skipped. */
+} gw_rx_state_t;
+
+/**@brief Host's decoder of scanner gateway batches, round trip probe and link quality reports. */
+typedef struct
+{
+    gw_rx_state_t state;
+    uint8_t       count;                         /**< Records the batch header announces. */
+    uint16_t      len;                           /**< Bytes of records the batch header announces. */
+    uint16_t      pos;                           /**< Bytes of records received. */
+    uint16_t      rec_start;                     /**< Position where the current record starts. */
+    uint16_t      rec_end;                       /**< Position where the current record ends. */
+    uint8_t       records;                       /**< Records found in the batch so far. */
+    uint8_t       op;                            /**< Op of the report being received. */
+    uint8_t       report[MAX(RTT_PROBE_REPORT_LEN, LINK_QUALITY_REPORT_LEN)]; /**< Report being received. */
+} gw_rx_t;
+
+/**@brief Scenario script step. */
+typedef struct script_step_s
+{
+    uint64_t               time_us;
+    char                   cmd[16];
+    char                   args[SCRIPT_LINE_MAX];
+    struct script_step_s * p_next;
+} script_step_t;
+
+/**@brief Line being reassembled from a byte stream. */
+typedef struct
+{
+    char     data[LINE_LEN_MAX + 1];
+    uint16_t len;
+} line_buf_t;
+
+/**@brief Growable set of latency samples, in microseconds. */
+typedef struct
+{
+    uint32_t * p_samples;
+    uint32_t   count;
+    uint32_t   size;
+} samples_t;
+
+/**@brief Command line option. */
+typedef struct
+{
+    const char * p_name;
+    const char * p_arg;                          /**< Argument name, NULL if the option takes none. */
+    const char * p_help;
+    int       (* set)(sim_config_t * p_cfg, const char * p_value);
+} option_t;
+
+/**@brief Field of the results, for printing. */
+typedef struct
+{
+    const char * p_name;
+    size_t       offset;
+    char         kind;                           /**< 'u' for uint32_t, 'U' for uint64_t, 'd' for double, 'r' for the result. */
+} metric_t;
+
+static const char * const m_result_names[] = {"ok", "app_error", "deadlock", "reset", "idle"};
+
+static uint64_t    * mp_line_sent;               /**< Time each host line was written. */
+static uint64_t    * mp_line_delivered;          /**< Time each host line reached a peer, 0 if it has not. */
+static uint32_t      m_lines_sent;
+static uint32_t      m_lines_delivered;
+static uint32_t      m_lines_echoed;
+static uint64_t      m_up_bytes;                 /**< Bytes of host lines received by peers. */
+static uint64_t      m_up_first;
+static uint64_t      m_up_last;
+static uint64_t      m_down_bytes;               /**< Bytes received by the host after the first notification. */
+static uint64_t      m_down_first;
+static uint64_t      m_down_last;
+static uint32_t      m_down_lines;
+static uint32_t      m_host_queue_high_water;
+static uint64_t      m_source_sent[SIM_MAX_PEERS][SOURCE_SEQ_RING];
+static line_buf_t    m_host_line;
+static line_buf_t    m_peer_lines[SIM_MAX_PEERS];
+static samples_t     m_up_latency;
+static samples_t     m_rtt;
+static samples_t     m_down_latency;
+static script_step_t * mp_script;
+static FILE        * mp_uart_out;
+static gw_rx_t       m_gw_rx;
+static uint32_t      m_gw_batches;
+static uint32_t      m_gw_records;
+static uint32_t      m_gw_dropped;
+static uint32_t      m_gw_errors;
+static uint32_t      m_probe_reports;
+static uint8_t       m_probe_report[RTT_PROBE_REPORT_LEN]; /**< Last probe report received. */
+static uint32_t      m_lq_reports;
+static uint8_t       m_lq_report[LINK_QUALITY_REPORT_LEN]; /**< Last link quality report received. */
+
+
+static int set_duration(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->duration_us = (uint64_t)(atof(p_value) * 1000.0);
+    return 0;
+}
+
+
+static int set_seed(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->seed = strtoull(p_value, NULL, 0);
+    return 0;
+}
+
+
+static int set_baud(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->baud = (uint32_t)atoi(p_value);
+    return 0;
+}
+
+
+static int set_ci(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->conn_interval_us = (uint32_t)(atof(p_value) * 1000.0);
+    return 0;
+}
+
+
+static int set_ppe(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->pkts_per_event = (uint8_t)MAX(atoi(p_value), 1);
+    return 0;
+}
+
+
+static int set_tx_buffers(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->tx_buffers = (uint8_t)atoi(p_value);
+    return 0;
+}
+
+
+static int set_loss(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->loss = atof(p_value);
+    return ((p_cfg->loss >= 0.0) && (p_cfg->loss < 1.0)) ? 0 : -1;
+}
+
+
+static int set_pairing_events(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->pairing_events = (uint16_t)atoi(p_value);
+    return 0;
+}
+
+
+static int set_peers(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->peer_count = (uint8_t)atoi(p_value);
+    return 0;
+}
+
+
+static int set_noise(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->adv_noise = (uint8_t)atoi(p_value);
+    return 0;
+}
+
+
+static int set_adv_interval(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->adv_interval_us = (uint32_t)(atof(p_value) * 1000.0);
+    return (p_cfg->adv_interval_us != 0) ? 0 : -1;
+}
+
+
+static int set_peer_mode(sim_config_t * p_cfg, const char * p_value)
+{
+    if (strcmp(p_value, "echo") == 0)
+    {
+        p_cfg->peer_mode = SIM_PEER_ECHO;
+    }
+    else if (strcmp(p_value, "sink") == 0)
+    {
+        p_cfg->peer_mode = SIM_PEER_SINK;
+    }
+    else if (strcmp(p_value, "source") == 0)
+    {
+        p_cfg->peer_mode = SIM_PEER_SOURCE;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+
+static int set_source_bps(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->source_bps = (uint32_t)atoi(p_value);
+    return 0;
+}
+
+
+static int set_source_len(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->source_len = (uint16_t)atoi(p_value);
+    return 0;
+}
+
+
+static int set_uart_start(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->uart_start_us = (uint64_t)(atof(p_value) * 1000.0);
+    return 0;
+}
+
+
+static int set_lines(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->line_count = (uint32_t)atoi(p_value);
+    return 0;
+}
+
+
+static int set_line_len(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->line_len = (uint16_t)MIN(MAX(atoi(p_value), 8), LINE_LEN_MAX);
+    return 0;
+}
+
+
+static int set_line_gap(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->line_gap_us = (uint32_t)(atof(p_value) * 1000.0);
+    return 0;
+}
+
+
+static int set_script(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->p_script = p_value;
+    return 0;
+}
+
+
+static int set_record(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->p_record = p_value;
+    return 0;
+}
+
+
+static int set_uart_out(sim_config_t * p_cfg, const char * p_value)
+{
+    p_cfg->p_uart_out = p_value;
+    return 0;
+}
+
+
+static int set_console(sim_config_t * p_cfg, const char * p_value)
+{
+    UNUSED_PARAMETER(p_value);
+    p_cfg->console = true;
+    return 0;
+}
+
+
+static int set_verbose(sim_config_t * p_cfg, const char * p_value)
+{
+    UNUSED_PARAMETER(p_value);
+    p_cfg->verbose = true;
+    return 0;
+}
+
+
+static const option_t m_options[] =
+{
+    {"duration",       "MS",    "length of the run (10000)",                                  set_duration},
+    {"seed",           "N",     "random seed (1)",                                            set_seed},
+    {"baud",           "BPS",   "UART rate, overriding the application's",                    set_baud},
+    {"ci",             "MS",    "connection interval, overriding the application's minimum",  set_ci},
+    {"ppe",            "N",     "packet pairs per connection event (4)",                      set_ppe},
+    {"tx-buffers",     "N",     "SoftDevice TX buffers (6)",                                  set_tx_buffers},
+    {"loss",           "P",     "packet loss probability (0)",                                set_loss},
+    {"pairing-events", "N",     "connection events pairing takes (6)",                        set_pairing_events},
+    {"peers",          "N",     "NUS peripherals (1)",                                        set_peers},
+    {"noise",          "N",     "other advertisers (0)",                                      set_noise},
+    {"adv-interval",   "MS",    "advertising interval (50)",                                  set_adv_interval},
+    {"peer-mode",      "MODE",  "echo, sink or source (echo)",                                set_peer_mode},
+    {"source-bps",     "N",     "notified bytes per second in source mode (1000)",            set_source_bps},
+    {"source-len",     "N",     "notified line length in source mode (20)",                   set_source_len},
+    {"uart-start",     "MS",    "time the host starts writing lines (1000)",                  set_uart_start},
+    {"lines",          "N",     "lines the host writes (100)",                                set_lines},
+    {"line-len",       "N",     "line length, including the newline (20)",                    set_line_len},
+    {"line-gap",       "MS",    "time between lines, 0 for back to back (50)",                set_line_gap},
+    {"script",         "FILE",  "scenario script",                                            set_script},
+    {"record",         "FILE",  "record the events the application handles to an event trace", set_record},
+    {"uart-out",       "FILE",  "write the application's UART output to a file",              set_uart_out},
+    {"console",        NULL,    "copy the application's UART output to stdout",               set_console},
+    {"verbose",        NULL,    "trace the simulation on stderr",                             set_verbose},
+};
+
+#define METRIC(NAME, FIELD, KIND)   {NAME, offsetof(sim_host_results_t, FIELD), KIND}
+
+static const metric_t m_metrics[] =
+{
+    METRIC("result",                    result,                  'r'),
+    METRIC("time_ms",                   time_ms,                 'd'),
+    METRIC("lines_sent",                lines_sent,              'u'),
+    METRIC("lines_delivered",           lines_delivered,         'u'),
+    METRIC("lines_echoed",              lines_echoed,            'u'),
+    METRIC("lines_lost",                lines_lost,              'u'),
+    METRIC("up_bytes",                  up_bytes,                'U'),
+    METRIC("up_bps",                    up_bps,                  'd'),
+    METRIC("up_latency_p50_ms",         up_latency_ms[0],        'd'),
+    METRIC("up_latency_p99_ms",         up_latency_ms[1],        'd'),
+    METRIC("up_latency_max_ms",         up_latency_ms[2],        'd'),
+    METRIC("rtt_p50_ms",                rtt_ms[0],               'd'),
+    METRIC("rtt_p99_ms",                rtt_ms[1],               'd'),
+    METRIC("rtt_max_ms",                rtt_ms[2],               'd'),
+    METRIC("down_bytes",                down_bytes,              'U'),
+    METRIC("down_bps",                  down_bps,                'd'),
+    METRIC("down_lines",                down_lines,              'u'),
+    METRIC("down_latency_p50_ms",       down_latency_ms[0],      'd'),
+    METRIC("down_latency_p99_ms",       down_latency_ms[1],      'd'),
+    METRIC("down_latency_max_ms",       down_latency_ms[2],      'd'),
+    METRIC("peer_tx_dropped",           peer_tx_dropped,         'u'),
+    METRIC("host_queue_high_water",     host_queue_high_water,   'u'),
+    METRIC("uart_rx_overflows",         uart.rx_overflows,       'u'),
+    METRIC("uart_rx_errors",            uart.rx_errors,          'u'),
+    METRIC("uart_put_retries",          uart.put_retries,        'u'),
+    METRIC("uart_rts_stops",            uart.rts_stops,          'u'),
+    METRIC("uart_rts_stopped_us",       uart.rts_stopped_us,     'U'),
+    METRIC("uart_rx_fifo_high_water",   uart.rx_fifo_high_water, 'h'),
+    METRIC("uart_tx_fifo_high_water",   uart.tx_fifo_high_water, 'h'),
+    METRIC("radio_adv_reports",         radio.adv_reports,       'u'),
+    METRIC("radio_connections",         radio.connections,       'u'),
+    METRIC("radio_disconnections",      radio.disconnections,    'u'),
+    METRIC("radio_sup_timeouts",        radio.sup_timeouts,      'u'),
+    METRIC("radio_conn_events",         radio.conn_events,       'u'),
+    METRIC("radio_conn_events_blocked", radio.conn_events_blocked, 'u'),
+    METRIC("radio_packets_sent",        radio.packets_sent,      'u'),
+    METRIC("radio_packets_lost",        radio.packets_lost,      'u'),
+    METRIC("radio_central_pdus",        radio.central_pdus,      'u'),
+    METRIC("radio_peer_pdus",           radio.peer_pdus,         'u'),
+    METRIC("radio_tx_queue_high_water", radio.tx_queue_high_water, 'u'),
+    METRIC("gw_batches",                gw_batches,              'u'),
+    METRIC("gw_records",                gw_records,              'u'),
+    METRIC("gw_dropped",                gw_dropped,              'u'),
+    METRIC("gw_errors",                 gw_errors,               'u'),
+    METRIC("probe_reports",             probe_reports,           'u'),
+    METRIC("probe_sent",                probe_sent,              'u'),
+    METRIC("probe_received",            probe_received,          'u'),
+    METRIC("probe_lost",                probe_lost,              'u'),
+    METRIC("probe_busy",                probe_busy,              'u'),
+    METRIC("probe_rtt_mean_us",         probe_rtt_mean_us,       'u'),
+    METRIC("probe_rtt_max_us",          probe_rtt_max_us,        'u'),
+    METRIC("lq_reports",                lq_reports,              'u'),
+    METRIC("lq_disc_sup_timeout",       lq_disc_sup_timeout,     'u'),
+    METRIC("lq_tx_power",               lq_tx_power,             'i'),
+    METRIC("lq_links",                  lq_links,                'u'),
+    METRIC("lq_rssi_avg",               lq_rssi_avg,             'i'),
+    METRIC("lq_rssi_samples",           lq_rssi_samples,         'u'),
+    METRIC("lq_tx_failed",              lq_tx_failed,            'u'),
+    METRIC("lq_tx_retries",             lq_tx_retries,           'u'),
+    METRIC("radio_tx_power",            radio.tx_power,          'i'),
+    METRIC("radio_tx_power_changes",    radio.tx_power_changes,  'u'),
+};
+
+
+static void sample_add(samples_t * p_set, uint64_t value)
+{
+    if (p_set->count == p_set->size)
+    {
+        uint32_t   size      = MAX(p_set->size * 2, 1024);
+        uint32_t * p_samples = realloc(p_set->p_samples, size * sizeof(uint32_t));
+
+        if (p_samples == NULL)
+        {
+            return;
+        }
+        p_set->p_samples = p_samples;
+        p_set->size      = size;
+    }
+    p_set->p_samples[p_set->count++] = (uint32_t)MIN(value, UINT32_MAX);
+}
+
+
+static int sample_compare(const void * p_a, const void * p_b)
+{
+    uint32_t a = *(const uint32_t *)p_a;
+    uint32_t b = *(const uint32_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+
+/**@brief Function for reducing a set of samples to its 50th and 99th percentile and maximum, in milliseconds.
+ */
+static void samples_summarize(samples_t * p_set, double * p_ms)
+{
+    memset(p_ms, 0, 3 * sizeof(double));
+    if (p_set->count == 0)
+    {
+        return;
+    }
+    qsort(p_set->p_samples, p_set->count, sizeof(uint32_t), sample_compare);
+    p_ms[0] = p_set->p_samples[(p_set->count - 1) * 50 / 100] / 1000.0;
+    p_ms[1] = p_set->p_samples[(p_set->count - 1) * 99 / 100] / 1000.0;
+    p_ms[2] = p_set->p_samples[p_set->count - 1] / 1000.0;
+}
+
+
+/**@brief Function for adding a byte to a line being reassembled.
+ *
+ * @return true when the byte completes a line.
+ */
+static bool line_buf_put(line_buf_t * p_line, uint8_t byte)
+{
+    if (p_line->len < LINE_LEN_MAX)
+    {
+        p_line->data[p_line->len++] = (char)byte;
+    }
+    if (byte != '\n')
+    {
+        return false;
+    }
+    p_line->data[p_line->len] = '\0';
+    return true;
+}
+
+
+/**@brief Function for formatting host line n. Lines are numbered so they can be traced end to end.
+ */
+static uint16_t line_format(uint32_t n, uint8_t * p_line)
+{
+    uint16_t len  = sim_config_get()->line_len;
+    int      head = snprintf((char *)p_line, LINE_LEN_MAX, "L%05u:", (unsigned)(n % 100000));
+
+    memset(&p_line[head], 'a' + (n % 26), len - head);
+    p_line[len - 1] = '\n';
+    return len;
+}
+
+
+/**@brief Function for matching a complete line against the lines the host wrote.
+ *
+ * @return Line number, or -1 if it is not a host line.
+ */
+static int32_t line_parse(const line_buf_t * p_line)
+{
+    unsigned n;
+
+    if ((p_line->len < 7) || (p_line->data[0] != 'L') || (sscanf(p_line->data, "L%5u:", &n) != 1))
+    {
+        return -1;
+    }
+    // Line numbers wrap at 100000, take the latest line with the number.
+    while ((n + 100000) < m_lines_sent)
+    {
+        n += 100000;
+    }
+    return (n < m_lines_sent) ? (int32_t)n : -1;
+}
+
+
+static void host_line_write(void * p_context, uint32_t arg)
+{
+    sim_config_t * p_cfg = sim_config_get();
+    uint8_t        line[LINE_LEN_MAX];
+    uint16_t       len;
+
+    UNUSED_PARAMETER(p_context);
+    UNUSED_PARAMETER(arg);
+
+    if (m_lines_sent == p_cfg->line_count)
+    {
+        return;
+    }
+    if ((p_cfg->line_gap_us == 0) && (sim_uart_host_pending() > p_cfg->line_len))
+    {
+        // Back to back: keep the host queue just ahead of the line.
+        (void)sim_schedule(sim_now() + HOST_POLL_US, host_line_write, NULL, 0);
+        return;
+    }
+
+    len = line_format(m_lines_sent, line);
+    if (m_up_first == 0)
+    {
+        m_up_first = sim_now();
+    }
+    mp_line_sent[m_lines_sent++] = sim_now();
+    sim_uart_host_write(line, len);
+    m_host_queue_high_water = MAX(m_host_queue_high_water, sim_uart_host_pending());
+
+    (void)sim_schedule(sim_now() + ((p_cfg->line_gap_us != 0) ? p_cfg->line_gap_us : HOST_POLL_US),
+                       host_line_write, NULL, 0);
+}
+
+
+static void host_line_rx(uint8_t byte)
+{
+    int32_t  n;
+    unsigned peer;
+    unsigned seq;
+
+    if (m_down_first != 0)
+    {
+        m_down_bytes++;
+        m_down_last = sim_now();
+    }
+    if (!line_buf_put(&m_host_line, byte))
+    {
+        return;
+    }
+
+    n = line_parse(&m_host_line);
+    if (n >= 0)
+    {
+        m_lines_echoed++;
+        sample_add(&m_rtt, sim_now() - mp_line_sent[n]);
+    }
+    else if ((sscanf(m_host_line.data, "P%u:%5u:", &peer, &seq) == 2) && (peer < SIM_MAX_PEERS))
+    {
+        uint64_t sent = m_source_sent[peer][seq % SOURCE_SEQ_RING];
+
+        m_down_lines++;
+        if (sent != 0)
+        {
+            sample_add(&m_down_latency, sim_now() - sent);
+        }
+    }
+    m_host_line.len = 0;
+}
+
+
+/**@brief Function for taking scanner gateway batches, probe and link quality reports out of the
+ *        UART output and checking them.
+ *
+ * @details Command responses are skipped, ESC ESC is passed on as one ESC, and everything else as
+ *          it is.
+ */
+static void on_host_rx(uint8_t byte)
+{
+    gw_rx_t * p_rx = &m_gw_rx;
+
+    if (mp_uart_out != NULL)
+    {
+        (void)fputc(byte, mp_uart_out);
+    }
+
+    switch (p_rx->state)
+    {
+        case GW_RX_DATA:
+            if (byte == UART_CMD_ESC)
+            {
+                p_rx->state = GW_RX_OP;
+                return;
+            }
+            host_line_rx(byte);
+            return;
+
+        case GW_RX_OP:
+            if (byte == SCAN_GW_FRAME_OP)
+            {
+                p_rx->state = GW_RX_COUNT;
+                return;
+            }
+            if ((byte == RTT_PROBE_FRAME_OP) || (byte == LINK_QUALITY_FRAME_OP))
+            {
+                p_rx->op    = byte;
+                p_rx->state = GW_RX_PROBE_ID;
+                return;
+            }
+            if ((byte & UART_CMD_OP_RESPONSE) && (byte < SCAN_GW_FRAME_OP))
+            {
+                p_rx->len   = 0;
+                p_rx->pos   = 0;
+                p_rx->state = GW_RX_RESPONSE;
+                return;
+            }
+            p_rx->state = GW_RX_DATA;
+            host_line_rx(UART_CMD_ESC);
+            if (byte != UART_CMD_ESC)
+            {
+                host_line_rx(byte);
+            }
+            return;
+
+        case GW_RX_COUNT:
+            p_rx->count = byte;
+            p_rx->state = GW_RX_DROPPED;
+            return;
+
+        case GW_RX_DROPPED:
+            m_gw_dropped += byte;
+            p_rx->state   = GW_RX_LEN;
+            return;
+
+        case GW_RX_LEN:
+            p_rx->len     = byte;
+            p_rx->pos     = 0;
+            p_rx->rec_end = 0;
+            p_rx->records = 0;
+            p_rx->state   = GW_RX_RECORDS;
+            if (byte == 0)
+            {
+                // A batch is only sent with records in it.
+                m_gw_errors++;
+                p_rx->state = GW_RX_DATA;
+            }
+            return;
+
+        case GW_RX_RECORDS:
+            if (p_rx->pos == p_rx->rec_end)
+            {
+                // Record header, until its dlen is known.
+                p_rx->rec_start = p_rx->pos;
+                p_rx->rec_end   = p_rx->pos + SCAN_GW_REC_HDR_LEN;
+                p_rx->records++;
+            }
+            if (p_rx->pos == (p_rx->rec_start + SCAN_GW_REC_HDR_LEN - 1))
+            {
+                p_rx->rec_end += byte;
+            }
+            if (++p_rx->pos < p_rx->len)
+            {
+                return;
+            }
+            if ((p_rx->rec_end != p_rx->len) || (p_rx->records != p_rx->count))
+            {
+                m_gw_errors++;
+            }
+            else
+            {
+                m_gw_batches++;
+                m_gw_records += p_rx->count;
+            }
+            p_rx->state = GW_RX_DATA;
+            return;
+
+        case GW_RX_PROBE_ID:
+            p_rx->state = GW_RX_PROBE_STATUS;
+            return;
+
+        case GW_RX_PROBE_STATUS:
+            p_rx->state = GW_RX_PROBE_LEN;
+            return;
+
+        case GW_RX_PROBE_LEN:
+            p_rx->len   = byte;
+            p_rx->pos   = 0;
+            p_rx->state = GW_RX_PROBE_REPORT;
+            if ((p_rx->op == RTT_PROBE_FRAME_OP) ? (byte != RTT_PROBE_REPORT_LEN) :
+                                                   ((byte > LINK_QUALITY_REPORT_LEN) ||
+                                                    (byte < LINK_QUALITY_DISC_COUNT * 2 + 2)))
+            {
+                m_gw_errors++;
+                p_rx->state = GW_RX_DATA;
+            }
+            return;
+
+        case GW_RX_PROBE_REPORT:
+            p_rx->report[p_rx->pos] = byte;
+            if (++p_rx->pos < p_rx->len)
+            {
+                return;
+            }
+            if (p_rx->op == RTT_PROBE_FRAME_OP)
+            {
+                memcpy(m_probe_report, p_rx->report, sizeof(m_probe_report));
+                m_probe_reports++;
+            }
+            else
+            {
+                memset(m_lq_report, 0, sizeof(m_lq_report));
+                memcpy(m_lq_report, p_rx->report, p_rx->len);
+                m_lq_reports++;
+            }
+            p_rx->state = GW_RX_DATA;
+            return;
+
+        case GW_RX_RESPONSE:
+            // Id, status and len, then len bytes of value.
+            if (p_rx->pos == 2)
+            {
+                p_rx->len = byte;
+            }
+            if (++p_rx->pos >= (3 + p_rx->len))
+            {
+                p_rx->state = GW_RX_DATA;
+            }
+            return;
+
+        default:
+            p_rx->state = GW_RX_DATA;
+            return;
+    }
+}
+
+
+static void on_peer_rx(uint8_t peer, const uint8_t * p_data, uint16_t len)
+{
+    line_buf_t * p_line = &m_peer_lines[peer];
+    uint16_t     i;
+
+    m_up_last = sim_now();
+    for (i = 0; i < len; i++)
+    {
+        int32_t n;
+
+        if (!line_buf_put(p_line, p_data[i]))
+        {
+            continue;
+        }
+        n = line_parse(p_line);
+        if ((n >= 0) && (mp_line_delivered[n] == 0))
+        {
+            mp_line_delivered[n] = sim_now();
+            m_lines_delivered++;
+            m_up_bytes += p_line->len;
+            sample_add(&m_up_latency, sim_now() - mp_line_sent[n]);
+        }
+        p_line->len = 0;
+    }
+}
+
+
+static void on_peer_tx(uint8_t peer, const uint8_t * p_data, uint16_t len)
+{
+    unsigned n;
+    unsigned seq;
+    char     head[16];
+
+    if (m_down_first == 0)
+    {
+        m_down_first = sim_now();
+    }
+    // Generated lines are notified whole, their header is at the start of the first chunk.
+    memcpy(head, p_data, MIN(len, sizeof(head) - 1));
+    head[MIN(len, sizeof(head) - 1)] = '\0';
+    if (sscanf(head, "P%u:%5u:", &n, &seq) == 2)
+    {
+        m_source_sent[peer][seq % SOURCE_SEQ_RING] = sim_now();
+    }
+}
+
+
+/**@brief Function for turning the escapes \n, \r, \xNN and \\ of a script argument into bytes.
+ */
+static uint16_t unescape(const char * p_src, uint8_t * p_dst, uint16_t size)
+{
+    uint16_t len = 0;
+    unsigned byte;
+
+    while ((*p_src != '\0') && (len < size))
+    {
+        if ((p_src[0] == '\\') && (p_src[1] == 'x') && (sscanf(&p_src[2], "%2x", &byte) == 1))
+        {
+            p_dst[len++] = (uint8_t)byte;
+            p_src       += isxdigit((unsigned char)p_src[3]) ? 4 : 3;
+            continue;
+        }
+        if ((p_src[0] == '\\') && (p_src[1] != '\0'))
+        {
+            p_src++;
+            p_dst[len++] = (*p_src == 'n') ? '\n' : ((*p_src == 'r') ? '\r' : (uint8_t)*p_src);
+        }
+        else
+        {
+            p_dst[len++] = (uint8_t)*p_src;
+        }
+        p_src++;
+    }
+    return len;
+}
+
+
+static void script_step_run(void * p_context, uint32_t arg)
+{
+    script_step_t * p_step = (script_step_t *)p_context;
+    uint8_t         data[SCRIPT_LINE_MAX];
+    unsigned        peer   = 0;
+    unsigned        value  = 0;
+    char            text[SCRIPT_LINE_MAX];
+
+    UNUSED_PARAMETER(arg);
+
+    sim_log("script: %s %s", p_step->cmd, p_step->args);
+    if (strcmp(p_step->cmd, "uart") == 0)
+    {
+        sim_uart_host_write(data, unescape(p_step->args, data, sizeof(data)));
+    }
+    else if ((strcmp(p_step->cmd, "notify") == 0) && (sscanf(p_step->args, "%u %511[^\n]", &peer, text) == 2))
+    {
+        if (peer < sim_peer_count())
+        {
+            (void)sim_peer_notify((uint8_t)peer, data, unescape(text, data, sizeof(data)));
+        }
+    }
+    else if ((strcmp(p_step->cmd, "drop") == 0) && (sscanf(p_step->args, "%u", &value) == 1))
+    {
+        sim_radio_drop(SIM_MS(value));
+    }
+    else if ((strcmp(p_step->cmd, "disconnect") == 0) && (sscanf(p_step->args, "%u", &peer) == 1))
+    {
+        if ((peer < sim_peer_count()) && (sim_peer_conn_handle((uint8_t)peer) != BLE_CONN_HANDLE_INVALID))
+        {
+            sim_radio_peer_disconnect(sim_peer_conn_handle((uint8_t)peer), BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+        }
+    }
+    else if ((strcmp(p_step->cmd, "adv") == 0) && (sscanf(p_step->args, "%u %511s", &peer, text) == 2))
+    {
+        if (peer < sim_peer_count())
+        {
+            sim_peer_adv_set((uint8_t)peer, strcmp(text, "on") == 0);
+        }
+    }
+    else if ((strcmp(p_step->cmd, "uarterr") == 0) && (sscanf(p_step->args, "%u", &value) == 1))
+    {
+        sim_uart_rx_error(value);
+    }
+    else if ((strcmp(p_step->cmd, "stall") == 0) && (sscanf(p_step->args, "%u %u", &peer, &value) == 2))
+    {
+        if (peer < sim_peer_count())
+        {
+            sim_peer_stall((uint8_t)peer, SIM_MS(value));
+        }
+    }
+    else if (strcmp(p_step->cmd, "connparam") == 0)
+    {
+        double                min_ms;
+        double                max_ms;
+        ble_gap_conn_params_t params;
+
+        if ((sscanf(p_step->args, "%u %lf %lf", &peer, &min_ms, &max_ms) == 3) &&
+            (peer < sim_peer_count()) && (sim_peer_conn_handle((uint8_t)peer) != BLE_CONN_HANDLE_INVALID))
+        {
+            params.min_conn_interval = (uint16_t)(min_ms / 1.25);
+            params.max_conn_interval = (uint16_t)(max_ms / 1.25);
+            params.slave_latency     = 0;
+            params.conn_sup_timeout  = 400;
+            sim_radio_peer_conn_param_request(sim_peer_conn_handle((uint8_t)peer), &params);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "script: bad step '%s %s'\n", p_step->cmd, p_step->args);
+    }
+}
+
+
+/**@brief Function for loading a scenario script.
+ *
+ * @details One step per line: a time in milliseconds, a command and its arguments.
+ *          Empty lines and lines starting with '#' are skipped.
+ */
+static int script_load(const char * p_path)
+{
+    FILE           * p_file  = fopen(p_path, "r");
+    char             line[SCRIPT_LINE_MAX];
+    script_step_t ** pp_tail = &mp_script;
+
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        script_step_t * p_step;
+        double          ms;
+        int             used = 0;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if ((line[0] == '\0') || (line[0] == '#'))
+        {
+            continue;
+        }
+        p_step = calloc(1, sizeof(*p_step));
+        if ((p_step == NULL) || (sscanf(line, "%lf %15s %n", &ms, p_step->cmd, &used) < 2))
+        {
+            fprintf(stderr, "%s: bad line '%s'\n", p_path, line);
+            free(p_step);
+            fclose(p_file);
+            return -1;
+        }
+        snprintf(p_step->args, sizeof(p_step->args), "%s", &line[used]);
+        p_step->time_us = (uint64_t)(ms * 1000.0);
+        *pp_tail        = p_step;
+        pp_tail         = &p_step->p_next;
+    }
+    fclose(p_file);
+    return 0;
+}
+
+
+/**@brief Function for starting the host side of the run. Runs as the first simulation event.
+ */
+static void host_start(void * p_context, uint32_t arg)
+{
+    sim_config_t  * p_cfg = sim_config_get();
+    script_step_t * p_step;
+
+    UNUSED_PARAMETER(p_context);
+    UNUSED_PARAMETER(arg);
+
+    for (p_step = mp_script; p_step != NULL; p_step = p_step->p_next)
+    {
+        (void)sim_schedule(p_step->time_us, script_step_run, p_step, 0);
+    }
+    if (p_cfg->line_count != 0)
+    {
+        (void)sim_schedule(p_cfg->uart_start_us, host_line_write, NULL, 0);
+    }
+}
+
+
+int sim_host_option_set(const char * p_name, const char * p_value)
+{
+    uint32_t i;
+
+    for (i = 0; i < sizeof(m_options) / sizeof(m_options[0]); i++)
+    {
+        if (strcmp(m_options[i].p_name, p_name) == 0)
+        {
+            if ((m_options[i].p_arg != NULL) && (p_value == NULL))
+            {
+                return -1;
+            }
+            return m_options[i].set(sim_config_get(), p_value);
+        }
+    }
+    return -1;
+}
+
+
+bool sim_host_option_get(uint32_t index, const char ** pp_name, bool * p_has_arg)
+{
+    if (index >= sizeof(m_options) / sizeof(m_options[0]))
+    {
+        return false;
+    }
+    *pp_name   = m_options[index].p_name;
+    *p_has_arg = (m_options[index].p_arg != NULL);
+    return true;
+}
+
+
+void sim_host_options_print(FILE * p_file)
+{
+    uint32_t i;
+
+    for (i = 0; i < sizeof(m_options) / sizeof(m_options[0]); i++)
+    {
+        char name[32];
+
+        snprintf(name, sizeof(name), "%s %s", m_options[i].p_name,
+                 (m_options[i].p_arg != NULL) ? m_options[i].p_arg : "");
+        fprintf(p_file, "  --%-20s %s\n", name, m_options[i].p_help);
+    }
+}
+
+
+int sim_host_init(void)
+{
+    sim_config_t * p_cfg = sim_config_get();
+
+    if (p_cfg->peer_count + p_cfg->adv_noise > SIM_MAX_PEERS)
+    {
+        fprintf(stderr, "at most %u advertisers\n", SIM_MAX_PEERS);
+        return -1;
+    }
+    if (p_cfg->line_len < 8)
+    {
+        p_cfg->line_len = 8;
+    }
+    if ((p_cfg->p_script != NULL) && (script_load(p_cfg->p_script) != 0))
+    {
+        return -1;
+    }
+    mp_line_sent      = calloc(MAX(p_cfg->line_count, 1), sizeof(uint64_t));
+    mp_line_delivered = calloc(MAX(p_cfg->line_count, 1), sizeof(uint64_t));
+    if ((mp_line_sent == NULL) || (mp_line_delivered == NULL))
+    {
+        return -1;
+    }
+
+    if (p_cfg->p_uart_out != NULL)
+    {
+        mp_uart_out = fopen(p_cfg->p_uart_out, "wb");
+        if (mp_uart_out == NULL)
+        {
+            perror(p_cfg->p_uart_out);
+            return -1;
+        }
+    }
+    if (p_cfg->p_record != NULL)
+    {
+        sim_trace_record_start();
+    }
+
+    sim_hooks_get()->host_rx = on_host_rx;
+    sim_hooks_get()->peer_rx = on_peer_rx;
+    sim_hooks_get()->peer_tx = on_peer_tx;
+    (void)sim_schedule(0, host_start, NULL, 0);
+    return 0;
+}
+
+
+void sim_host_results_get(sim_result_t result, sim_host_results_t * p_results)
+{
+    uint64_t now = sim_now();
+    uint32_t i;
+
+    memset(p_results, 0, sizeof(*p_results));
+    p_results->result          = result;
+    p_results->time_ms         = now / 1000.0;
+    p_results->lines_sent      = m_lines_sent;
+    p_results->lines_delivered = m_lines_delivered;
+    p_results->lines_echoed    = m_lines_echoed;
+    for (i = 0; i < m_lines_sent; i++)
+    {
+        if ((mp_line_delivered[i] == 0) && ((mp_line_sent[i] + SETTLE_US) <= now))
+        {
+            p_results->lines_lost++;
+        }
+    }
+
+    p_results->up_bytes   = m_up_bytes;
+    p_results->up_bps     = (m_up_last > m_up_first) ? (m_up_bytes * 1e6 / (m_up_last - m_up_first)) : 0.0;
+    p_results->down_bytes = m_down_bytes;
+    p_results->down_bps   = (m_down_last > m_down_first) ? (m_down_bytes * 1e6 / (m_down_last - m_down_first)) : 0.0;
+    p_results->down_lines = m_down_lines;
+    samples_summarize(&m_up_latency, p_results->up_latency_ms);
+    samples_summarize(&m_rtt, p_results->rtt_ms);
+    samples_summarize(&m_down_latency, p_results->down_latency_ms);
+
+    for (i = 0; i < sim_config_get()->peer_count; i++)
+    {
+        p_results->peer_tx_dropped += sim_peer_stats_get((uint8_t)i)->tx_dropped;
+    }
+    p_results->host_queue_high_water = m_host_queue_high_water;
+    p_results->uart                  = *sim_uart_stats_get();
+    p_results->radio                 = *sim_radio_stats_get();
+    p_results->gw_batches            = m_gw_batches;
+    p_results->gw_records            = m_gw_records;
+    p_results->gw_dropped            = m_gw_dropped;
+    p_results->gw_errors             = m_gw_errors;
+    p_results->probe_reports         = m_probe_reports;
+    p_results->probe_sent            = uint32_decode(&m_probe_report[0]);
+    p_results->probe_received        = uint32_decode(&m_probe_report[4]);
+    p_results->probe_lost            = uint32_decode(&m_probe_report[8]);
+    p_results->probe_busy            = uint32_decode(&m_probe_report[20]);
+    p_results->probe_rtt_mean_us     = uint32_decode(&m_probe_report[28]);
+    p_results->probe_rtt_max_us      = uint32_decode(&m_probe_report[32]);
+    p_results->lq_reports            = m_lq_reports;
+    p_results->lq_disc_sup_timeout   = uint16_decode(&m_lq_report[LINK_QUALITY_DISC_SUP_TIMEOUT * 2]);
+    p_results->lq_tx_power           = (int8_t)m_lq_report[LINK_QUALITY_DISC_COUNT * 2];
+    p_results->lq_links              = m_lq_report[LINK_QUALITY_DISC_COUNT * 2 + 1];
+    // First link in the report.
+    p_results->lq_rssi_avg           = (int8_t)m_lq_report[LINK_QUALITY_DISC_COUNT * 2 + 4];
+    p_results->lq_rssi_samples       = uint32_decode(&m_lq_report[LINK_QUALITY_DISC_COUNT * 2 + 7]);
+    p_results->lq_tx_failed          = uint32_decode(&m_lq_report[LINK_QUALITY_DISC_COUNT * 2 + 11]);
+    p_results->lq_tx_retries         = uint32_decode(&m_lq_report[LINK_QUALITY_DISC_COUNT * 2 + 15]);
+}
+
+
+static void metric_print(FILE * p_file, const sim_host_results_t * p_results, const metric_t * p_metric, bool quote)
+{
+    const uint8_t * p_field = (const uint8_t *)p_results + p_metric->offset;
+
+    switch (p_metric->kind)
+    {
+        case 'r':
+            fprintf(p_file, quote ? "\"%s\"" : "%s", m_result_names[*(const sim_result_t *)p_field]);
+            break;
+
+        case 'u':
+            fprintf(p_file, "%u", *(const uint32_t *)p_field);
+            break;
+
+        case 'h':
+            fprintf(p_file, "%u", *(const uint16_t *)p_field);
+            break;
+
+        case 'i':
+            fprintf(p_file, "%d", *(const int32_t *)p_field);
+            break;
+
+        case 'U':
+            fprintf(p_file, "%llu", (unsigned long long)*(const uint64_t *)p_field);
+            break;
+
+        default:
+            fprintf(p_file, "%.3f", *(const double *)p_field);
+            break;
+    }
+}
+
+
+void sim_host_results_print(FILE                     * p_file,
+                            sim_host_format_t          format,
+                            const sim_host_results_t * p_results)
+{
+    uint32_t i;
+
+    for (i = 0; i < sizeof(m_metrics) / sizeof(m_metrics[0]); i++)
+    {
+        switch (format)
+        {
+            case SIM_HOST_FORMAT_KV:
+                fprintf(p_file, "%s=", m_metrics[i].p_name);
+                metric_print(p_file, p_results, &m_metrics[i], false);
+                fputc('\n', p_file);
+                break;
+
+            case SIM_HOST_FORMAT_JSON:
+                fprintf(p_file, "%s\"%s\": ", (i == 0) ? "" : ", ", m_metrics[i].p_name);
+                metric_print(p_file, p_results, &m_metrics[i], true);
+                break;
+
+            case SIM_HOST_FORMAT_CSV:
+                fprintf(p_file, "%s", (i == 0) ? "" : ",");
+                metric_print(p_file, p_results, &m_metrics[i], false);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+
+void sim_host_results_header_print(FILE * p_file)
+{
+    uint32_t i;
+
+    for (i = 0; i < sizeof(m_metrics) / sizeof(m_metrics[0]); i++)
+    {
+        fprintf(p_file, "%s%s", (i == 0) ? "" : ",", m_metrics[i].p_name);
+    }
+}
+
+/** @}
+ *  @endcond
+ */
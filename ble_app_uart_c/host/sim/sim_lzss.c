@@ -0,0 +1,443 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+/* Round trip checks of the LZSS compression, built once for each window and length setting the
+ * Makefile lists. Streams of text, random data and runs are encoded into packets of several sizes
+ * as the application sends them, and decoded in order by a second window, which must give back
+ * exactly the data each packet took. The decoder must leave its state untouched on a bad packet.
+ * The exit status is the number of failed checks.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lzss.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+#define STREAM_LEN          12000                /**< Bytes of each stream, several windows of the largest setting. */
+#define PACKET_MAX          20                   /**< Largest packet, BLE_NUS_MAX_DATA_LEN. */
+#define CHUNK_MAX           64                   /**< Largest piece of the stream given to the encoder at once, UART_LINE_MAX_LEN. */
+#define FUZZ_PACKETS        20000                /**< Random packets given to the decoder. */
+
+/**@brief Stream the checks compress. */
+typedef struct
+{
+    const char * p_name;
+    void      (* generate)(uint8_t * p_data, uint32_t len);
+    uint32_t     min_window;      /**< Smallest window the stream must come out smaller than it went in with, 0 for none. */
+} stream_t;
+
+static uint64_t m_rand_state = 0x9E3779B97F4A7C15ULL;
+static uint8_t  m_stream[STREAM_LEN];
+static uint8_t  m_decoded[STREAM_LEN];
+static uint32_t m_failed;
+
+
+static uint32_t rand_get(void)
+{
+    m_rand_state ^= m_rand_state << 13;
+    m_rand_state ^= m_rand_state >> 7;
+    m_rand_state ^= m_rand_state << 17;
+    return (uint32_t)(m_rand_state >> 32);
+}
+
+
+/**@brief Sensor style lines, which repeat with a few digits changing. */
+static void gen_text(uint8_t * p_data, uint32_t len)
+{
+    uint32_t pos = 0;
+    uint32_t seq = 0;
+
+    while (pos < len)
+    {
+        char line[64];
+        int  n = snprintf(line, sizeof(line), "seq=%05u temp=%u.%u hum=%u%% state=%s\n",
+                          (unsigned)seq++, 20 + (rand_get() % 5), rand_get() % 10, 40 + (rand_get() % 20),
+                          ((rand_get() % 8) == 0) ? "ALARM" : "ok");
+
+        memcpy(&p_data[pos], line, MIN((uint32_t)n, len - pos));
+        pos += (uint32_t)n;
+    }
+}
+
+
+static void gen_random(uint8_t * p_data, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        p_data[i] = (uint8_t)rand_get();
+    }
+}
+
+
+/**@brief Long runs of one byte, where matches overlap the bytes they produce. */
+static void gen_runs(uint8_t * p_data, uint32_t len)
+{
+    uint32_t pos = 0;
+
+    while (pos < len)
+    {
+        uint32_t run  = 1 + (rand_get() % 300);
+        uint8_t  byte = (uint8_t)rand_get();
+
+        memset(&p_data[pos], byte, MIN(run, len - pos));
+        pos += run;
+    }
+}
+
+
+/**@brief Text and random data in turn, so matches reach back across random stretches. */
+static void gen_mixed(uint8_t * p_data, uint32_t len)
+{
+    uint32_t pos = 0;
+
+    while (pos < len)
+    {
+        uint32_t block = 50 + (rand_get() % 400);
+
+        block = MIN(block, len - pos);
+
+        if ((rand_get() % 2) == 0)
+        {
+            gen_text(&p_data[pos], block);
+        }
+        else
+        {
+            gen_random(&p_data[pos], block);
+        }
+        pos += block;
+    }
+}
+
+
+static const stream_t m_streams[] =
+{
+    {"text",   gen_text,   64},   // Matches reach back to the previous line.
+    {"random", gen_random, 0},
+    {"runs",   gen_runs,   16},
+    {"mixed",  gen_mixed,  0},
+};
+
+/* Packet sizes, 0 for a random size for each packet. */
+static const uint16_t m_packet_sizes[] = {2, 3, 7, PACKET_MAX, 0};
+
+
+static void fail(const char * p_check, const char * p_fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void fail(const char * p_check, const char * p_fmt, ...)
+{
+    va_list args;
+
+    printf("lzss W=%u L=%u %s: FAIL, ", LZSS_WINDOW_BITS, LZSS_LENGTH_BITS, p_check);
+    va_start(args, p_fmt);
+    vprintf(p_fmt, args);
+    va_end(args);
+    printf("\n");
+    m_failed++;
+}
+
+
+static void pass(const char * p_check)
+{
+    printf("lzss W=%u L=%u %s: ok\n", LZSS_WINDOW_BITS, LZSS_LENGTH_BITS, p_check);
+}
+
+
+static bool state_equal(const lzss_t * p_a, const lzss_t * p_b)
+{
+    return (memcmp(p_a->window, p_b->window, sizeof(p_a->window)) == 0) &&
+           (p_a->head == p_b->head) && (p_a->fill == p_b->fill) &&
+           (memcmp(&p_a->stats, &p_b->stats, sizeof(p_a->stats)) == 0);
+}
+
+
+/**@brief Function for sending a stream through an encoder and a decoder, a packet at a time.
+ *
+ * @details The stream is handed to the encoder in chunks, as UART lines, and each chunk is sent
+ *          in as many packets as it takes. Each packet must decode to exactly the bytes it took,
+ *          which also checks that its padding is not read as a token.
+ *
+ * @return  Bytes of packets sent, 0 on failure.
+ */
+static uint32_t round_trip(const char * p_check, lzss_t * p_enc, lzss_t * p_dec, const uint8_t * p_data,
+                           uint32_t len, uint16_t packet_size)
+{
+    uint32_t pos       = 0;
+    uint32_t out_total = 0;
+
+    while (pos < len)
+    {
+        uint32_t want  = 1 + (rand_get() % CHUNK_MAX);
+        uint16_t chunk = (uint16_t)MIN(want, len - pos);
+        uint16_t done  = 0;
+
+        while (done < chunk)
+        {
+            uint8_t  packet[PACKET_MAX];
+            uint8_t  again[PACKET_MAX];
+            uint8_t  decoded[LZSS_DECODED_MAX(PACKET_MAX)];
+            uint16_t size = (packet_size != 0) ? packet_size : (uint16_t)(2 + (rand_get() % (PACKET_MAX - 1)));
+            uint16_t consumed;
+            uint16_t consumed_again;
+            uint16_t out_len;
+            uint16_t decoded_len;
+            uint32_t err_code;
+
+            out_len = lzss_encode(p_enc, &p_data[pos + done], chunk - done, packet, size, &consumed);
+            if ((consumed == 0) || (out_len == 0) || (out_len > size))
+            {
+                fail(p_check, "at %u, packet of %u bytes took %u bytes into %u bytes",
+                     (unsigned)(pos + done), size, consumed, out_len);
+                return 0;
+            }
+
+            // Until it is committed, the packet leaves the encoder as it was.
+            if ((lzss_encode(p_enc, &p_data[pos + done], chunk - done, again, size, &consumed_again) != out_len) ||
+                (consumed_again != consumed) || (memcmp(packet, again, out_len) != 0))
+            {
+                fail(p_check, "at %u, encoding the same data again gave another packet", (unsigned)(pos + done));
+                return 0;
+            }
+            lzss_encode_commit(p_enc, &p_data[pos + done], consumed, out_len);
+
+            err_code = lzss_decode(p_dec, packet, out_len, decoded, LZSS_DECODED_MAX(out_len), &decoded_len);
+            if (err_code != NRF_SUCCESS)
+            {
+                fail(p_check, "at %u, packet of %u bytes did not decode: %u",
+                     (unsigned)(pos + done), out_len, (unsigned)err_code);
+                return 0;
+            }
+            if ((decoded_len != consumed) || (memcmp(decoded, &p_data[pos + done], consumed) != 0))
+            {
+                fail(p_check, "at %u, packet of %u bytes took %u bytes and decoded to %u other bytes",
+                     (unsigned)(pos + done), out_len, consumed, decoded_len);
+                return 0;
+            }
+            memcpy(&m_decoded[pos + done], decoded, decoded_len);
+
+            done      += consumed;
+            out_total += out_len;
+        }
+        pos += chunk;
+    }
+
+    if (memcmp(m_decoded, p_data, len) != 0)
+    {
+        fail(p_check, "the decoded stream differs");
+        return 0;
+    }
+    return out_total;
+}
+
+
+static void streams_check(void)
+{
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < sizeof(m_streams) / sizeof(m_streams[0]); i++)
+    {
+        const stream_t * p_stream = &m_streams[i];
+
+        m_streams[i].generate(m_stream, STREAM_LEN);
+        for (j = 0; j < sizeof(m_packet_sizes) / sizeof(m_packet_sizes[0]); j++)
+        {
+            lzss_t       enc;
+            lzss_t       dec;
+            lzss_stats_t enc_stats;
+            lzss_stats_t dec_stats;
+            char         check[48];
+            uint32_t     out_total;
+
+            snprintf(check, sizeof(check), "%s_packet_%u", p_stream->p_name, m_packet_sizes[j]);
+            lzss_reset(&enc);
+            lzss_reset(&dec);
+            out_total = round_trip(check, &enc, &dec, m_stream, STREAM_LEN, m_packet_sizes[j]);
+            if (out_total == 0)
+            {
+                continue;
+            }
+            lzss_stats_get(&enc, &enc_stats);
+            lzss_stats_get(&dec, &dec_stats);
+            if ((enc_stats.bytes_in != STREAM_LEN) || (dec_stats.bytes_out != STREAM_LEN) ||
+                (enc_stats.bytes_out != out_total) || (dec_stats.bytes_in != out_total) ||
+                (enc_stats.packets != dec_stats.packets))
+            {
+                fail(check, "statistics do not add up");
+            }
+            else if ((p_stream->min_window != 0) && (LZSS_WINDOW_SIZE >= p_stream->min_window) &&
+                     (m_packet_sizes[j] == PACKET_MAX) && (out_total >= STREAM_LEN))
+            {
+                fail(check, "%u bytes compressed to %u", STREAM_LEN, (unsigned)out_total);
+            }
+            else
+            {
+                pass(check);
+            }
+        }
+    }
+}
+
+
+/**@brief Function for decoding a packet that must be refused, and checking the state is kept. */
+static bool refused_check(const char * p_check, lzss_t * p_dec, const uint8_t * p_packet, uint16_t len,
+                          uint16_t out_size)
+{
+    lzss_t   before = *p_dec;
+    uint8_t  decoded[LZSS_DECODED_MAX(PACKET_MAX)];
+    uint16_t decoded_len;
+
+    if (lzss_decode(p_dec, p_packet, len, decoded, out_size, &decoded_len) != NRF_ERROR_INVALID_DATA)
+    {
+        fail(p_check, "the packet was not refused");
+        return false;
+    }
+    if (!state_equal(&before, p_dec))
+    {
+        fail(p_check, "the refused packet changed the decoder");
+        return false;
+    }
+    return true;
+}
+
+
+/**@brief Function for checking that bad packets are refused, and that the link carries on
+ *        after them as if they had not come.
+ */
+static void errors_check(void)
+{
+    static const char * p_check = "bad_packets";
+    uint8_t  packet[PACKET_MAX];
+    uint8_t  decoded[LZSS_DECODED_MAX(PACKET_MAX)];
+    uint16_t decoded_len;
+    uint16_t consumed;
+    uint16_t out_len;
+    lzss_t   enc;
+    lzss_t   dec;
+    lzss_t   before;
+    uint32_t refused = 0;
+    uint32_t i;
+
+    gen_text(m_stream, STREAM_LEN);
+    lzss_reset(&enc);
+    lzss_reset(&dec);
+
+    // A match on an empty window.
+    memset(packet, 0, sizeof(packet));
+    if (!refused_check(p_check, &dec, packet, (LZSS_MATCH_BITS + 7) / 8, sizeof(decoded)))
+    {
+        return;
+    }
+
+    // Part of a window, then a literal followed by a match reaching one byte too far back, so the
+    // literal is decoded before the match is found bad.
+    if (round_trip(p_check, &enc, &dec, m_stream, 5, PACKET_MAX) == 0)
+    {
+        return;
+    }
+    memset(packet, 0, sizeof(packet));
+    packet[0] = 0x80 | ('x' >> 1);
+    packet[1] = (uint8_t)(('x' & 1) << 7);
+    for (i = 0; i < LZSS_WINDOW_BITS; i++)
+    {
+        // Distance - 1 from bit 10, after the flag of the match. The literal adds one to the fill,
+        // so a distance of the fill + 2 is one too far.
+        if (((dec.fill + 1) >> (LZSS_WINDOW_BITS - 1 - i)) & 1)
+        {
+            packet[(10 + i) / 8] |= (uint8_t)(0x80 >> ((10 + i) % 8));
+        }
+    }
+    if (!refused_check(p_check, &dec, packet, (9 + LZSS_MATCH_BITS + 7) / 8, sizeof(decoded)))
+    {
+        return;
+    }
+
+    // A good packet with no room for what it decodes to.
+    out_len = lzss_encode(&enc, &m_stream[5], 40, packet, PACKET_MAX, &consumed);
+    if (!refused_check(p_check, &dec, packet, out_len, consumed - 1))
+    {
+        return;
+    }
+    lzss_encode_commit(&enc, &m_stream[5], consumed, out_len);
+    if ((lzss_decode(&dec, packet, out_len, decoded, sizeof(decoded), &decoded_len) != NRF_SUCCESS) ||
+        (decoded_len != consumed) || (memcmp(decoded, &m_stream[5], consumed) != 0))
+    {
+        fail(p_check, "a good packet after refused ones did not decode");
+        return;
+    }
+
+    // Random packets with room for a random part of what they may decode to, each given to the
+    // same decoder early in the stream, with the window part full.
+    for (i = 0; i < FUZZ_PACKETS; i++)
+    {
+        uint16_t len      = (uint16_t)(1 + (rand_get() % PACKET_MAX));
+        uint16_t out_size = (uint16_t)(rand_get() % (LZSS_DECODED_MAX(len) + 1));
+        uint16_t j;
+
+        for (j = 0; j < len; j++)
+        {
+            packet[j] = (uint8_t)rand_get();
+        }
+        before = dec;
+        if (lzss_decode(&dec, packet, len, decoded, out_size, &decoded_len) != NRF_SUCCESS)
+        {
+            if (!state_equal(&before, &dec))
+            {
+                fail(p_check, "random packet %u was refused but changed the decoder", (unsigned)i);
+                return;
+            }
+            refused++;
+        }
+        else if (decoded_len > out_size)
+        {
+            fail(p_check, "random packet %u decoded past the end of its buffer", (unsigned)i);
+            return;
+        }
+        dec = before;
+    }
+    if (refused == 0)
+    {
+        fail(p_check, "no random packet was refused");
+        return;
+    }
+
+    // The link carries on where it was.
+    if (round_trip(p_check, &enc, &dec, &m_stream[5 + consumed], 6000, 0) == 0)
+    {
+        return;
+    }
+    pass(p_check);
+}
+
+
+int main(int argc, char ** argv)
+{
+    UNUSED_PARAMETER(argc);
+    UNUSED_PARAMETER(argv);
+
+    streams_check();
+    errors_check();
+
+    printf("lzss W=%u L=%u: %u failed\n", LZSS_WINDOW_BITS, LZSS_LENGTH_BITS, (unsigned)m_failed);
+    return (m_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/** @}
+ *  @endcond
+ */
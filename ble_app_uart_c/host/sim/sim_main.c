@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+#define OPTIONS_MAX         40
+#define OPT_FORMAT          0x100
+#define OPT_HELP            0x101
+
+int fw_main(void);
+
+
+static void usage(const char * p_name)
+{
+    printf("Usage: %s [options]\n", p_name);
+    sim_host_options_print(stdout);
+    printf("  --%-20s %s\n", "format FMT", "report as kv, json or csv (kv)");
+}
+
+
+int main(int argc, char ** argv)
+{
+    struct option      options[OPTIONS_MAX];
+    sim_host_format_t  format = SIM_HOST_FORMAT_KV;
+    sim_host_results_t results;
+    sim_result_t       result;
+    const char       * p_reason;
+    uint32_t           count;
+    bool               has_arg;
+    int                index;
+    int                opt;
+
+    for (count = 0; sim_host_option_get(count, &options[count].name, &has_arg); count++)
+    {
+        options[count].has_arg = has_arg ? required_argument : no_argument;
+        options[count].flag    = NULL;
+        options[count].val     = 0;
+    }
+    options[count++] = (struct option){"format", required_argument, NULL, OPT_FORMAT};
+    options[count++] = (struct option){"help",   no_argument,       NULL, OPT_HELP};
+    options[count]   = (struct option){NULL,     0,                 NULL, 0};
+
+    while ((opt = getopt_long(argc, argv, "", options, &index)) != -1)
+    {
+        switch (opt)
+        {
+            case 0:
+                if (sim_host_option_set(options[index].name, optarg) != 0)
+                {
+                    fprintf(stderr, "bad value for --%s\n", options[index].name);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case OPT_FORMAT:
+                if (strcmp(optarg, "json") == 0)
+                {
+                    format = SIM_HOST_FORMAT_JSON;
+                }
+                else if (strcmp(optarg, "csv") == 0)
+                {
+                    format = SIM_HOST_FORMAT_CSV;
+                }
+                break;
+
+            case OPT_HELP:
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (sim_host_init() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    result = sim_run(fw_main, &p_reason);
+    sim_host_results_get(result, &results);
+    if ((sim_config_get()->p_record != NULL) && (sim_trace_save(sim_config_get()->p_record) != 0))
+    {
+        fprintf(stderr, "%s: could not write the trace\n", sim_config_get()->p_record);
+    }
+
+    fflush(stdout);
+    switch (format)
+    {
+        case SIM_HOST_FORMAT_JSON:
+            printf("{\"reason\": \"%s\", ", p_reason);
+            sim_host_results_print(stdout, format, &results);
+            printf("}\n");
+            break;
+
+        case SIM_HOST_FORMAT_CSV:
+            sim_host_results_header_print(stdout);
+            printf("\n");
+            sim_host_results_print(stdout, format, &results);
+            printf("\n");
+            break;
+
+        default:
+            printf("reason=%s\n", p_reason);
+            sim_host_results_print(stdout, format, &results);
+            break;
+    }
+
+    return ((result == SIM_RESULT_OK) || (result == SIM_RESULT_IDLE)) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/** @}
+ *  @endcond
+ */
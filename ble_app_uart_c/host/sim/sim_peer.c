@@ -0,0 +1,570 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "ble.h"
+#include "nordic_common.h"
+
+#define ATT_OP_ERROR_RSP             0x01
+#define ATT_OP_FIND_INFO_REQ         0x04
+#define ATT_OP_FIND_INFO_RSP         0x05
+#define ATT_OP_FIND_BY_TYPE_REQ      0x06
+#define ATT_OP_FIND_BY_TYPE_RSP      0x07
+#define ATT_OP_READ_BY_TYPE_REQ      0x08
+#define ATT_OP_READ_BY_TYPE_RSP      0x09
+#define ATT_OP_READ_REQ              0x0A
+#define ATT_OP_READ_RSP              0x0B
+#define ATT_OP_WRITE_REQ             0x12
+#define ATT_OP_WRITE_RSP             0x13
+#define ATT_OP_NOTIFICATION          0x1B
+#define ATT_OP_CONFIRMATION          0x1E
+#define ATT_OP_WRITE_CMD             0x52
+
+#define ATT_ERR_INVALID_HANDLE       0x01
+#define ATT_ERR_READ_NOT_PERMITTED   0x02
+#define ATT_ERR_WRITE_NOT_PERMITTED  0x03
+#define ATT_ERR_REQ_NOT_SUPPORTED    0x06
+#define ATT_ERR_ATTR_NOT_FOUND       0x0A
+
+#define NUS_DATA_MAX_LEN             (SIM_ATT_MTU - 3)   /**< Payload of one notification. */
+
+#define HANDLE_NUS_RX_VALUE          7                   /**< Value of the characteristic the central writes. */
+#define HANDLE_NUS_TX_VALUE          9                   /**< Value of the characteristic the peer notifies. */
+#define HANDLE_NUS_TX_CCCD           10                  /**< CCCD of the notified characteristic. */
+
+/**@brief Attribute of the peer's GATT server. */
+typedef struct
+{
+    uint16_t        handle;
+    uint16_t        type;              /**< 16-bit attribute type, 0 for a NUS value. */
+    uint16_t        group_end;         /**< Last handle of a service. */
+    const uint8_t * p_value;           /**< Value of a declaration or read-only attribute. */
+    uint8_t         value_len;
+} attr_t;
+
+/**@brief Simulated peripheral. */
+typedef struct
+{
+    bool             nus;               /**< Has the NUS service, rather than being an unrelated advertiser. */
+    bool             advertising;
+    ble_gap_addr_t   addr;
+    int8_t           rssi;
+    uint16_t         conn_handle;
+    uint16_t         cccd;
+    uint32_t         source_timer_id;
+    uint32_t         source_seq;
+    uint64_t         stall_until;       /**< ATT requests are left without a response until this time. */
+    sim_peer_stats_t stats;
+} peer_t;
+
+static const uint8_t m_nus_uuid[16] = {0x9E, 0xCA, 0xDC, 0x24, 0x0E, 0xE5, 0xA9, 0xE0,
+                                       0x93, 0xF3, 0xA3, 0xB5, 0x01, 0x00, 0x40, 0x6E};
+
+static const uint8_t m_gap_srv[]    = {0x00, 0x18};
+static const uint8_t m_gatt_srv[]   = {0x01, 0x18};
+static const uint8_t m_name_decl[]  = {0x02, 0x03, 0x00, 0x00, 0x2A};
+static const uint8_t m_name[]       = {'S', 'i', 'm', 'N', 'U', 'S'};
+static const uint8_t m_nus_rx_decl[] = {0x0C, HANDLE_NUS_RX_VALUE, 0x00,
+                                        0x9E, 0xCA, 0xDC, 0x24, 0x0E, 0xE5, 0xA9, 0xE0,
+                                        0x93, 0xF3, 0xA3, 0xB5, 0x02, 0x00, 0x40, 0x6E};
+static const uint8_t m_nus_tx_decl[] = {0x10, HANDLE_NUS_TX_VALUE, 0x00,
+                                        0x9E, 0xCA, 0xDC, 0x24, 0x0E, 0xE5, 0xA9, 0xE0,
+                                        0x93, 0xF3, 0xA3, 0xB5, 0x03, 0x00, 0x40, 0x6E};
+
+static const attr_t m_attrs[] =
+{
+    {1,                   BLE_UUID_SERVICE_PRIMARY,               3,  m_gap_srv,     sizeof(m_gap_srv)},
+    {2,                   BLE_UUID_CHARACTERISTIC,                0,  m_name_decl,   sizeof(m_name_decl)},
+    {3,                   0x2A00,                                 0,  m_name,        sizeof(m_name)},
+    {4,                   BLE_UUID_SERVICE_PRIMARY,               4,  m_gatt_srv,    sizeof(m_gatt_srv)},
+    {5,                   BLE_UUID_SERVICE_PRIMARY,               10, m_nus_uuid,    sizeof(m_nus_uuid)},
+    {6,                   BLE_UUID_CHARACTERISTIC,                0,  m_nus_rx_decl, sizeof(m_nus_rx_decl)},
+    {HANDLE_NUS_RX_VALUE, 0,                                      0,  NULL,          0},
+    {8,                   BLE_UUID_CHARACTERISTIC,                0,  m_nus_tx_decl, sizeof(m_nus_tx_decl)},
+    {HANDLE_NUS_TX_VALUE, 0,                                      0,  NULL,          0},
+    {HANDLE_NUS_TX_CCCD,  BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG, 0,  NULL,          0},
+};
+
+static peer_t  m_peers[SIM_MAX_PEERS];
+static uint8_t m_peer_count;
+
+
+static void put_u16(uint8_t * p_dst, uint16_t value)
+{
+    p_dst[0] = (uint8_t)(value & 0xFF);
+    p_dst[1] = (uint8_t)(value >> 8);
+}
+
+
+static uint16_t get_u16(const uint8_t * p_src)
+{
+    return (uint16_t)(p_src[0] | (p_src[1] << 8));
+}
+
+
+void sim_peer_init(void)
+{
+    sim_config_t * p_cfg = sim_config_get();
+    uint8_t        i;
+
+    memset(m_peers, 0, sizeof(m_peers));
+    m_peer_count = (uint8_t)MIN(p_cfg->peer_count + p_cfg->adv_noise, SIM_MAX_PEERS);
+
+    for (i = 0; i < m_peer_count; i++)
+    {
+        peer_t * p_peer = &m_peers[i];
+
+        p_peer->nus            = (i < p_cfg->peer_count);
+        p_peer->advertising    = true;
+        p_peer->conn_handle    = BLE_CONN_HANDLE_INVALID;
+        p_peer->rssi           = p_peer->nus ? (int8_t)(-55 - 6 * i) : (int8_t)(-75 - i);
+        p_peer->addr.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+        p_peer->addr.addr[0]   = (uint8_t)(i + 1);
+        p_peer->addr.addr[1]   = 0x00;
+        p_peer->addr.addr[2]   = 0x5E;
+        p_peer->addr.addr[3]   = 0xA1;
+        p_peer->addr.addr[4]   = p_peer->nus ? 0x0B : 0x0E;
+        p_peer->addr.addr[5]   = 0xC0;
+    }
+}
+
+
+uint8_t sim_peer_count(void)
+{
+    return m_peer_count;
+}
+
+
+bool sim_peer_is_nus(uint8_t peer)
+{
+    return m_peers[peer].nus;
+}
+
+
+bool sim_peer_advertising(uint8_t peer)
+{
+    return m_peers[peer].advertising;
+}
+
+
+void sim_peer_adv_set(uint8_t peer, bool on)
+{
+    // A connected peer does not advertise.
+    m_peers[peer].advertising = on && (m_peers[peer].conn_handle == BLE_CONN_HANDLE_INVALID);
+}
+
+
+void sim_peer_stall(uint8_t peer, uint64_t duration_us)
+{
+    m_peers[peer].stall_until = sim_now() + duration_us;
+}
+
+
+void sim_peer_addr_get(uint8_t peer, ble_gap_addr_t * p_addr)
+{
+    *p_addr = m_peers[peer].addr;
+}
+
+
+uint8_t sim_peer_adv_data_get(uint8_t peer, uint8_t * p_data)
+{
+    static const uint8_t flags[]  = {0x02, BLE_GAP_AD_TYPE_FLAGS, 0x06};
+    static const uint8_t hrs[]    = {0x03, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE, 0x0D, 0x18};
+    uint8_t              len      = 0;
+
+    memcpy(&p_data[len], flags, sizeof(flags));
+    len += sizeof(flags);
+    if (m_peers[peer].nus)
+    {
+        p_data[len++] = 1 + sizeof(m_nus_uuid);
+        p_data[len++] = BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE;
+        memcpy(&p_data[len], m_nus_uuid, sizeof(m_nus_uuid));
+        len += sizeof(m_nus_uuid);
+    }
+    else
+    {
+        memcpy(&p_data[len], hrs, sizeof(hrs));
+        len += sizeof(hrs);
+    }
+    return len;
+}
+
+
+int8_t sim_peer_rssi_get(uint8_t peer)
+{
+    return m_peers[peer].rssi;
+}
+
+
+uint16_t sim_peer_conn_handle(uint8_t peer)
+{
+    return m_peers[peer].conn_handle;
+}
+
+
+const sim_peer_stats_t * sim_peer_stats_get(uint8_t peer)
+{
+    return &m_peers[peer].stats;
+}
+
+
+bool sim_peer_notify(uint8_t peer, const uint8_t * p_data, uint16_t len)
+{
+    peer_t * p_peer = &m_peers[peer];
+    bool     all    = true;
+
+    while (len > 0)
+    {
+        uint16_t  chunk = MIN(len, NUS_DATA_MAX_LEN);
+        sim_pdu_t pdu;
+
+        if ((p_peer->conn_handle == BLE_CONN_HANDLE_INVALID) || ((p_peer->cccd & 0x0001) == 0) ||
+            (sim_radio_peer_queue_free(p_peer->conn_handle) == 0))
+        {
+            p_peer->stats.tx_dropped += chunk;
+            all = false;
+        }
+        else
+        {
+            pdu.data[0] = ATT_OP_NOTIFICATION;
+            put_u16(&pdu.data[1], HANDLE_NUS_TX_VALUE);
+            memcpy(&pdu.data[3], p_data, chunk);
+            pdu.len = (uint16_t)(3 + chunk);
+            (void)sim_radio_peer_send(p_peer->conn_handle, &pdu);
+
+            p_peer->stats.tx_notifications++;
+            p_peer->stats.tx_bytes += chunk;
+            if (sim_hooks_get()->peer_tx != NULL)
+            {
+                sim_hooks_get()->peer_tx(peer, p_data, chunk);
+            }
+        }
+        p_data += chunk;
+        len    -= chunk;
+    }
+    return all;
+}
+
+
+/**@brief Function for notifying the next generated line in @ref SIM_PEER_SOURCE mode.
+ */
+static void source_timeout_handler(void * p_context, uint32_t peer)
+{
+    sim_config_t * p_cfg  = sim_config_get();
+    peer_t       * p_peer = &m_peers[peer];
+    uint8_t        line[256];
+    uint16_t       len    = (uint16_t)MIN(MAX(p_cfg->source_len, 8), sizeof(line));
+    int            n;
+
+    UNUSED_PARAMETER(p_context);
+
+    n = snprintf((char *)line, sizeof(line), "P%u:%05u:", (unsigned)peer, (unsigned)(p_peer->source_seq++ % 100000));
+    memset(&line[n], 'a' + (peer % 26), len - n);
+    line[len - 1] = '\n';
+    (void)sim_peer_notify((uint8_t)peer, line, len);
+
+    p_peer->source_timer_id = sim_schedule(sim_now() + (uint64_t)len * 1000000 / MAX(p_cfg->source_bps, 1),
+                                           source_timeout_handler, NULL, peer);
+}
+
+
+void sim_peer_on_connect(uint8_t peer, uint16_t conn_handle)
+{
+    peer_t * p_peer = &m_peers[peer];
+
+    p_peer->conn_handle = conn_handle;
+    p_peer->advertising = false;
+    p_peer->cccd        = 0;
+}
+
+
+void sim_peer_on_disconnect(uint8_t peer)
+{
+    peer_t * p_peer = &m_peers[peer];
+
+    sim_cancel(p_peer->source_timer_id);
+    p_peer->conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_peer->advertising = true;
+}
+
+
+static void respond(peer_t * p_peer, const uint8_t * p_data, uint16_t len)
+{
+    sim_pdu_t pdu;
+
+    memcpy(pdu.data, p_data, len);
+    pdu.len = len;
+    (void)sim_radio_peer_send(p_peer->conn_handle, &pdu);
+}
+
+
+static void error_respond(peer_t * p_peer, uint8_t req_op, uint16_t handle, uint8_t error)
+{
+    uint8_t rsp[5];
+
+    rsp[0] = ATT_OP_ERROR_RSP;
+    rsp[1] = req_op;
+    put_u16(&rsp[2], handle);
+    rsp[4] = error;
+    respond(p_peer, rsp, sizeof(rsp));
+}
+
+
+static void data_received(uint8_t peer, const uint8_t * p_data, uint16_t len)
+{
+    peer_t * p_peer = &m_peers[peer];
+
+    p_peer->stats.rx_writes++;
+    p_peer->stats.rx_bytes += len;
+    if (sim_hooks_get()->peer_rx != NULL)
+    {
+        sim_hooks_get()->peer_rx(peer, p_data, len);
+    }
+    if (sim_config_get()->peer_mode == SIM_PEER_ECHO)
+    {
+        (void)sim_peer_notify(peer, p_data, len);
+    }
+}
+
+
+static void cccd_written(uint8_t peer, uint16_t value)
+{
+    peer_t * p_peer = &m_peers[peer];
+
+    p_peer->cccd = value;
+    sim_log("peer %u: notifications %s", peer, (value & 0x0001) ? "on" : "off");
+
+    sim_cancel(p_peer->source_timer_id);
+    if ((sim_config_get()->peer_mode == SIM_PEER_SOURCE) && ((value & 0x0001) != 0))
+    {
+        p_peer->source_timer_id = sim_schedule(sim_now(), source_timeout_handler, NULL, peer);
+    }
+}
+
+
+static void find_by_type(peer_t * p_peer, const sim_pdu_t * p_pdu)
+{
+    uint16_t start = get_u16(&p_pdu->data[1]);
+    uint16_t end   = get_u16(&p_pdu->data[3]);
+    uint16_t type  = get_u16(&p_pdu->data[5]);
+    uint8_t  vlen  = (uint8_t)(p_pdu->len - 7);
+    uint8_t  rsp[SIM_ATT_MTU];
+    uint16_t len   = 1;
+    uint8_t  i;
+
+    rsp[0] = ATT_OP_FIND_BY_TYPE_RSP;
+    for (i = 0; i < sizeof(m_attrs) / sizeof(m_attrs[0]); i++)
+    {
+        const attr_t * p_attr = &m_attrs[i];
+
+        if ((p_attr->handle < start) || (p_attr->handle > end) || (p_attr->type != type) ||
+            (p_attr->value_len != vlen) || (memcmp(p_attr->p_value, &p_pdu->data[7], vlen) != 0))
+        {
+            continue;
+        }
+        if ((len + 4) > SIM_ATT_MTU)
+        {
+            break;
+        }
+        put_u16(&rsp[len], p_attr->handle);
+        put_u16(&rsp[len + 2], p_attr->group_end);
+        len += 4;
+    }
+
+    if (len == 1)
+    {
+        error_respond(p_peer, ATT_OP_FIND_BY_TYPE_REQ, start, ATT_ERR_ATTR_NOT_FOUND);
+        return;
+    }
+    respond(p_peer, rsp, len);
+}
+
+
+static void read_by_type(peer_t * p_peer, const sim_pdu_t * p_pdu)
+{
+    uint16_t start = get_u16(&p_pdu->data[1]);
+    uint16_t end   = get_u16(&p_pdu->data[3]);
+    uint8_t  rsp[SIM_ATT_MTU];
+    uint16_t len   = 2;
+    uint8_t  i;
+
+    rsp[0] = ATT_OP_READ_BY_TYPE_RSP;
+    rsp[1] = 0;
+    for (i = 0; i < sizeof(m_attrs) / sizeof(m_attrs[0]); i++)
+    {
+        const attr_t * p_attr = &m_attrs[i];
+        uint8_t        entry  = (uint8_t)(2 + p_attr->value_len);
+
+        if ((p_attr->handle < start) || (p_attr->handle > end) ||
+            (p_attr->type != get_u16(&p_pdu->data[5])))
+        {
+            continue;
+        }
+        // All entries of a response have the same length.
+        if (((rsp[1] != 0) && (rsp[1] != entry)) || ((len + entry) > SIM_ATT_MTU))
+        {
+            break;
+        }
+        rsp[1] = entry;
+        put_u16(&rsp[len], p_attr->handle);
+        memcpy(&rsp[len + 2], p_attr->p_value, p_attr->value_len);
+        len += entry;
+    }
+
+    if (len == 2)
+    {
+        error_respond(p_peer, ATT_OP_READ_BY_TYPE_REQ, start, ATT_ERR_ATTR_NOT_FOUND);
+        return;
+    }
+    respond(p_peer, rsp, len);
+}
+
+
+static void find_info(peer_t * p_peer, const sim_pdu_t * p_pdu)
+{
+    uint16_t start = get_u16(&p_pdu->data[1]);
+    uint16_t end   = get_u16(&p_pdu->data[3]);
+    uint8_t  rsp[SIM_ATT_MTU];
+    uint16_t len   = 2;
+    uint8_t  i;
+
+    rsp[0] = ATT_OP_FIND_INFO_RSP;
+    rsp[1] = 0x01;
+    for (i = 0; i < sizeof(m_attrs) / sizeof(m_attrs[0]); i++)
+    {
+        const attr_t * p_attr = &m_attrs[i];
+
+        if ((p_attr->handle < start) || (p_attr->handle > end))
+        {
+            continue;
+        }
+        // NUS values have 128-bit types, which would need a response of their own.
+        if ((p_attr->type == 0) || ((len + 4) > SIM_ATT_MTU))
+        {
+            break;
+        }
+        put_u16(&rsp[len], p_attr->handle);
+        put_u16(&rsp[len + 2], p_attr->type);
+        len += 4;
+    }
+
+    if (len == 2)
+    {
+        error_respond(p_peer, ATT_OP_FIND_INFO_REQ, start, ATT_ERR_ATTR_NOT_FOUND);
+        return;
+    }
+    respond(p_peer, rsp, len);
+}
+
+
+static void read(peer_t * p_peer, const sim_pdu_t * p_pdu)
+{
+    uint16_t handle = get_u16(&p_pdu->data[1]);
+    uint8_t  rsp[SIM_ATT_MTU];
+    uint8_t  i;
+
+    rsp[0] = ATT_OP_READ_RSP;
+    if (handle == HANDLE_NUS_TX_CCCD)
+    {
+        put_u16(&rsp[1], p_peer->cccd);
+        respond(p_peer, rsp, 3);
+        return;
+    }
+    for (i = 0; i < sizeof(m_attrs) / sizeof(m_attrs[0]); i++)
+    {
+        if ((m_attrs[i].handle == handle) && (m_attrs[i].p_value != NULL))
+        {
+            memcpy(&rsp[1], m_attrs[i].p_value, m_attrs[i].value_len);
+            respond(p_peer, rsp, (uint16_t)(1 + m_attrs[i].value_len));
+            return;
+        }
+    }
+    error_respond(p_peer, ATT_OP_READ_REQ, handle,
+                  (handle <= HANDLE_NUS_TX_CCCD) ? ATT_ERR_READ_NOT_PERMITTED : ATT_ERR_INVALID_HANDLE);
+}
+
+
+void sim_peer_on_rx(uint8_t peer, const sim_pdu_t * p_pdu)
+{
+    peer_t * p_peer = &m_peers[peer];
+    uint8_t  op     = p_pdu->data[0];
+    uint16_t handle = (p_pdu->len >= 3) ? get_u16(&p_pdu->data[1]) : 0;
+
+    if ((sim_now() < p_peer->stall_until) && (op != ATT_OP_WRITE_CMD) && (op != ATT_OP_CONFIRMATION))
+    {
+        // A hung GATT server: the request is received but never answered.
+        p_peer->stats.att_ignored++;
+        return;
+    }
+
+    switch (op)
+    {
+        case ATT_OP_FIND_BY_TYPE_REQ:
+            find_by_type(p_peer, p_pdu);
+            break;
+
+        case ATT_OP_READ_BY_TYPE_REQ:
+            read_by_type(p_peer, p_pdu);
+            break;
+
+        case ATT_OP_FIND_INFO_REQ:
+            find_info(p_peer, p_pdu);
+            break;
+
+        case ATT_OP_READ_REQ:
+            read(p_peer, p_pdu);
+            break;
+
+        case ATT_OP_WRITE_REQ:
+        {
+            uint8_t rsp = ATT_OP_WRITE_RSP;
+
+            if (handle == HANDLE_NUS_TX_CCCD)
+            {
+                // The response goes out before the first notification.
+                respond(p_peer, &rsp, 1);
+                cccd_written(peer, (p_pdu->len >= 5) ? get_u16(&p_pdu->data[3]) : 0);
+            }
+            else if (handle == HANDLE_NUS_RX_VALUE)
+            {
+                respond(p_peer, &rsp, 1);
+                data_received(peer, &p_pdu->data[3], (uint16_t)(p_pdu->len - 3));
+            }
+            else
+            {
+                error_respond(p_peer, op, handle, ATT_ERR_WRITE_NOT_PERMITTED);
+            }
+            break;
+        }
+
+        case ATT_OP_WRITE_CMD:
+            if (handle == HANDLE_NUS_RX_VALUE)
+            {
+                data_received(peer, &p_pdu->data[3], (uint16_t)(p_pdu->len - 3));
+            }
+            break;
+
+        case ATT_OP_CONFIRMATION:
+            break;
+
+        default:
+            error_respond(p_peer, op, 0, ATT_ERR_REQ_NOT_SUPPORTED);
+            break;
+    }
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,454 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "pstorage.h"
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "nordic_common.h"
+#include "app_util.h"
+
+#define FLASH_SIZE              (256 * 1024)     /**< Flash of the simulated chip. */
+#define FLASH_WORD_WRITE_US     46               /**< Time to write one word. */
+#define FLASH_PAGE_ERASE_US     21000            /**< Time to erase one page. */
+#define MAX_PHASES              8                /**< Flash operations one command can take. */
+
+/**@brief Queued pstorage command. */
+typedef struct
+{
+    uint8_t           op_code;
+    pstorage_handle_t handle;                    /**< Destination. */
+    uint8_t         * p_src;                     /**< Source of a store or update. */
+    pstorage_size_t   size;
+    pstorage_size_t   offset;
+    uint8_t           phase;                     /**< Flash operation in progress. */
+    uint8_t           phase_count;               /**< Flash operations the command takes. */
+} cmd_t;
+
+/**@brief Registered module. */
+typedef struct
+{
+    pstorage_ntf_cb_t cb;
+    uint32_t          base;                      /**< Address of the first block. */
+    pstorage_size_t   block_size;
+    pstorage_size_t   block_count;
+} module_t;
+
+static uint8_t  m_flash[FLASH_SIZE];
+static bool     m_initialized;
+static module_t m_modules[PSTORAGE_MAX_APPLICATIONS];
+static uint8_t  m_module_count;
+static uint32_t m_next_page_addr;
+
+static cmd_t    m_cmds[PSTORAGE_CMD_QUEUE_SIZE];
+static uint8_t  m_cmd_head;
+static uint8_t  m_cmd_count;
+static bool     m_busy;                          /**< The command at the head of the queue is running. */
+
+
+static uint32_t page_size(void)
+{
+    return PSTORAGE_FLASH_PAGE_SIZE;
+}
+
+
+/**@brief Function for getting the duration of one flash operation of a command.
+ */
+static uint32_t phase_duration(const cmd_t * p_cmd)
+{
+    switch (p_cmd->op_code)
+    {
+        case PSTORAGE_STORE_OP_CODE:
+            return (p_cmd->size / sizeof(uint32_t)) * FLASH_WORD_WRITE_US;
+
+        case PSTORAGE_CLEAR_OP_CODE:
+            if (p_cmd->phase_count != 4)
+            {
+                return FLASH_PAGE_ERASE_US;
+            }
+            // fall through
+
+        default:
+            // Page swaps alternate erasing a page and writing it back.
+            return ((p_cmd->phase % 2) == 0) ? FLASH_PAGE_ERASE_US
+                                             : ((page_size() / sizeof(uint32_t)) * FLASH_WORD_WRITE_US);
+    }
+}
+
+
+/**@brief Function for applying the effect of one flash operation of a command to flash.
+ */
+static void phase_apply(void * p_context)
+{
+    cmd_t  * p_cmd = (cmd_t *)p_context;
+    uint32_t addr  = p_cmd->handle.block_id + p_cmd->offset;
+    uint32_t i;
+
+    switch (p_cmd->op_code)
+    {
+        case PSTORAGE_STORE_OP_CODE:
+            // Writing can only clear bits.
+            for (i = 0; i < p_cmd->size; i++)
+            {
+                m_flash[addr + i] &= p_cmd->p_src[i];
+            }
+            break;
+
+        case PSTORAGE_UPDATE_OP_CODE:
+            if (p_cmd->phase == (p_cmd->phase_count - 1))
+            {
+                memcpy(&m_flash[addr], p_cmd->p_src, p_cmd->size);
+            }
+            break;
+
+        case PSTORAGE_CLEAR_OP_CODE:
+            if (p_cmd->phase_count != 4)
+            {
+                memset(&m_flash[p_cmd->handle.block_id + p_cmd->phase * page_size()], 0xFF, page_size());
+            }
+            else if (p_cmd->phase == 3)
+            {
+                memset(&m_flash[p_cmd->handle.block_id], 0xFF, p_cmd->size);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+static void cmd_process(void)
+{
+    cmd_t  * p_cmd;
+    uint32_t err_code;
+
+    if (m_busy || (m_cmd_count == 0))
+    {
+        return;
+    }
+    p_cmd    = &m_cmds[m_cmd_head];
+    err_code = sim_sd_flash_op(phase_duration(p_cmd), phase_apply, p_cmd);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_busy = true;
+    }
+}
+
+
+static uint32_t cmd_enqueue(uint8_t             op_code,
+                            pstorage_handle_t * p_dest,
+                            uint8_t           * p_src,
+                            pstorage_size_t     size,
+                            pstorage_size_t     offset)
+{
+    cmd_t * p_cmd;
+
+    if (m_cmd_count == PSTORAGE_CMD_QUEUE_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_cmd = &m_cmds[(m_cmd_head + m_cmd_count) % PSTORAGE_CMD_QUEUE_SIZE];
+    memset(p_cmd, 0, sizeof(*p_cmd));
+    p_cmd->op_code = op_code;
+    p_cmd->handle  = *p_dest;
+    p_cmd->p_src   = p_src;
+    p_cmd->size    = size;
+    p_cmd->offset  = offset;
+
+    switch (op_code)
+    {
+        case PSTORAGE_STORE_OP_CODE:
+            p_cmd->phase_count = 1;
+            break;
+
+        case PSTORAGE_CLEAR_OP_CODE:
+            if (((p_dest->block_id % page_size()) == 0) && ((size % page_size()) == 0))
+            {
+                p_cmd->phase_count = (uint8_t)MIN(size / page_size(), MAX_PHASES);
+                break;
+            }
+            // fall through
+
+        default:
+            // Through the swap page: erase it, copy the page to it, erase the page, write it back.
+            p_cmd->phase_count = 4;
+            break;
+    }
+    m_cmd_count++;
+
+    cmd_process();
+    return NRF_SUCCESS;
+}
+
+
+static module_t * module_get(const pstorage_handle_t * p_handle)
+{
+    if ((p_handle == NULL) || (p_handle->module_id >= m_module_count))
+    {
+        return NULL;
+    }
+    return &m_modules[p_handle->module_id];
+}
+
+
+/**@brief Function for checking that an access stays within one block of a module.
+ */
+static uint32_t access_check(const pstorage_handle_t * p_handle, pstorage_size_t size, pstorage_size_t offset)
+{
+    module_t * p_module = module_get(p_handle);
+    uint32_t   end;
+
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_module == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    end = p_module->base + (uint32_t)p_module->block_size * p_module->block_count;
+    if ((p_handle->block_id < p_module->base) || (p_handle->block_id >= end))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if ((size == 0) || ((uint32_t)size + offset > p_module->block_size))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return NRF_SUCCESS;
+}
+
+
+void pstorage_sys_event_handler(uint32_t sys_evt)
+{
+    cmd_t             * p_cmd;
+    cmd_t               cmd;
+    module_t          * p_module;
+
+    if (!m_busy || ((sys_evt != NRF_EVT_FLASH_OPERATION_SUCCESS) && (sys_evt != NRF_EVT_FLASH_OPERATION_ERROR)))
+    {
+        return;
+    }
+    m_busy = false;
+    p_cmd  = &m_cmds[m_cmd_head];
+
+    if ((sys_evt == NRF_EVT_FLASH_OPERATION_SUCCESS) && (++p_cmd->phase < p_cmd->phase_count))
+    {
+        cmd_process();
+        return;
+    }
+
+    // The command stays queued while its user is notified, as in the SDK module.
+    cmd      = *p_cmd;
+    p_module = module_get(&cmd.handle);
+    if ((p_module != NULL) && (p_module->cb != NULL))
+    {
+        p_module->cb(&cmd.handle,
+                     cmd.op_code,
+                     (sys_evt == NRF_EVT_FLASH_OPERATION_SUCCESS) ? NRF_SUCCESS : NRF_ERROR_TIMEOUT,
+                     cmd.p_src,
+                     cmd.size);
+    }
+    m_cmd_head = (m_cmd_head + 1) % PSTORAGE_CMD_QUEUE_SIZE;
+    m_cmd_count--;
+    cmd_process();
+}
+
+
+uint32_t pstorage_init(void)
+{
+    memset(m_flash, 0xFF, sizeof(m_flash));
+    memset(m_modules, 0, sizeof(m_modules));
+    m_module_count     = 0;
+    m_cmd_head         = 0;
+    m_cmd_count        = 0;
+    m_busy             = false;
+    m_next_page_addr   = PSTORAGE_DATA_START_ADDR;
+    m_initialized      = true;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pstorage_register(pstorage_module_param_t * p_module_param,
+                           pstorage_handle_t       * p_block_id)
+{
+    module_t * p_module;
+    uint32_t   total;
+
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_module_param == NULL) || (p_block_id == NULL) || (p_module_param->cb == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if ((p_module_param->block_size < PSTORAGE_MIN_BLOCK_SIZE) ||
+        (p_module_param->block_size > PSTORAGE_MAX_BLOCK_SIZE) ||
+        (p_module_param->block_count == 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_module_count == PSTORAGE_MAX_APPLICATIONS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    total = (uint32_t)p_module_param->block_size * p_module_param->block_count;
+    if ((m_next_page_addr + CEIL_DIV(total, page_size()) * page_size()) > PSTORAGE_DATA_END_ADDR)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_module              = &m_modules[m_module_count];
+    p_module->cb          = p_module_param->cb;
+    p_module->base        = m_next_page_addr;
+    p_module->block_size  = p_module_param->block_size;
+    p_module->block_count = p_module_param->block_count;
+
+    p_block_id->module_id = m_module_count++;
+    p_block_id->block_id  = p_module->base;
+    m_next_page_addr     += CEIL_DIV(total, page_size()) * page_size();
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pstorage_block_identifier_get(pstorage_handle_t * p_base_id,
+                                       pstorage_size_t     block_num,
+                                       pstorage_handle_t * p_block_id)
+{
+    module_t * p_module = module_get(p_base_id);
+
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_module == NULL) || (p_block_id == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (block_num >= p_module->block_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    p_block_id->module_id = p_base_id->module_id;
+    p_block_id->block_id  = p_base_id->block_id + (uint32_t)block_num * p_module->block_size;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pstorage_store(pstorage_handle_t * p_dest,
+                        uint8_t           * p_src,
+                        pstorage_size_t     size,
+                        pstorage_size_t     offset)
+{
+    uint32_t err_code = access_check(p_dest, size, offset);
+
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    if (p_src == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (((size % sizeof(uint32_t)) != 0) || ((offset % sizeof(uint32_t)) != 0))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return cmd_enqueue(PSTORAGE_STORE_OP_CODE, p_dest, p_src, size, offset);
+}
+
+
+uint32_t pstorage_update(pstorage_handle_t * p_dest,
+                         uint8_t           * p_src,
+                         pstorage_size_t     size,
+                         pstorage_size_t     offset)
+{
+    uint32_t err_code = access_check(p_dest, size, offset);
+
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    if (p_src == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (((size % sizeof(uint32_t)) != 0) || ((offset % sizeof(uint32_t)) != 0))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return cmd_enqueue(PSTORAGE_UPDATE_OP_CODE, p_dest, p_src, size, offset);
+}
+
+
+uint32_t pstorage_load(uint8_t           * p_dest,
+                       pstorage_handle_t * p_src,
+                       pstorage_size_t     size,
+                       pstorage_size_t     offset)
+{
+    uint32_t err_code = access_check(p_src, size, offset);
+
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    if (p_dest == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    memcpy(p_dest, &m_flash[p_src->block_id + offset], size);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pstorage_clear(pstorage_handle_t * p_base_id, pstorage_size_t size)
+{
+    module_t * p_module = module_get(p_base_id);
+
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_module == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if ((size == 0) || ((size % p_module->block_size) != 0) ||
+        ((p_base_id->block_id + size) > (p_module->base + (uint32_t)p_module->block_size * p_module->block_count)))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return cmd_enqueue(PSTORAGE_CLEAR_OP_CODE, p_base_id, NULL, size, 0);
+}
+
+
+uint32_t pstorage_access_status_get(uint32_t * p_count)
+{
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_count == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    *p_count = m_cmd_count;
+    return NRF_SUCCESS;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,1100 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "ble.h"
+#include "ble_hci.h"
+#include "nordic_common.h"
+
+#define LINK_QUEUE_SIZE         32             /**< ATT PDUs queued per direction and link. */
+#define T_IFS_US                150            /**< Inter frame space. */
+#define T_EMPTY_PACKET_US       80             /**< Air time of an empty packet. */
+#define LL_OVERHEAD_BYTES       14             /**< Preamble, access address, header, L2CAP header and CRC. */
+#define ADV_DELAY_MAX_US        10000          /**< Random delay added to each advertising event. */
+#define CONNECT_DELAY_US        2500           /**< CONNECT_REQ to the first connection event. */
+#define PARAM_UPDATE_EVENTS     6              /**< Connection events from a parameter update to its instant. */
+#define FLASH_SEARCH_US         SIM_MS(100)    /**< Longest search for radio idle time for a flash operation. */
+#define OWN_ADDR                {BLE_GAP_ADDR_TYPE_RANDOM_STATIC, {0x11, 0x22, 0x33, 0x44, 0x55, 0xC6}}
+
+/**@brief ATT PDU waiting to be sent on a link. */
+typedef struct
+{
+    sim_pdu_t pdu;                             /**< PDU. */
+    bool      write_cmd;                       /**< Holds a SoftDevice TX buffer until acknowledged. */
+    uint32_t  ready_event;                     /**< First connection event the PDU can go out in. */
+} queued_pdu_t;
+
+/**@brief ATT PDU queue of one direction of a link. */
+typedef struct
+{
+    queued_pdu_t items[LINK_QUEUE_SIZE];
+    uint8_t      head;
+    uint8_t      count;
+} pdu_queue_t;
+
+/**@brief Link, from the point of view of the central. */
+typedef struct
+{
+    bool                  active;
+    uint8_t               peer;                /**< Peer at the other end. */
+    ble_gap_conn_params_t params;              /**< Current connection parameters. */
+    uint32_t              interval_us;         /**< Connection interval. */
+    uint64_t              anchor;              /**< Start of the current or next connection event. */
+    uint32_t              event_counter;       /**< Counter of the current or next connection event. */
+    bool                  in_event;            /**< A connection event is in progress. */
+    uint8_t               exchanges;           /**< Packet pairs exchanged in the current event. */
+    uint64_t              last_rx;             /**< Last time a packet from the peer was received. */
+    uint32_t              timer_id;            /**< Next connection event or exchange. */
+    pdu_queue_t           to_peer;             /**< PDUs queued by the application. */
+    pdu_queue_t           to_central;          /**< PDUs queued by the peer. */
+    uint8_t               tx_free;             /**< Free SoftDevice TX buffers. */
+    uint8_t               tx_unacked;          /**< Write Commands received by the peer, not yet acknowledged. */
+    uint8_t               tx_completed;        /**< Write Commands acknowledged in this event. */
+    bool                  update_pending;      /**< A connection parameter update waits for its instant. */
+    uint32_t              update_instant;      /**< Event counter of the update instant. */
+    ble_gap_conn_params_t update_params;       /**< Parameters that apply from the instant. */
+    uint16_t              pairing_left;        /**< Events until pairing completes, 0 if not pairing. */
+    bool                  pairing_bond;        /**< Pairing was asked to bond. */
+    bool                  terminate;           /**< Disconnect at the next connection event. */
+    uint8_t               terminate_reason;    /**< Reason reported for the disconnection. */
+    bool                  rssi_reporting;      /**< RSSI changes are reported. */
+    uint8_t               rssi_threshold;      /**< Smallest change reported, in dB. */
+    uint8_t               rssi_skip;           /**< Samples that must differ before a change is reported. */
+    uint8_t               rssi_changed;        /**< Samples that differed since the last report. */
+    int8_t                rssi;                /**< Last reported RSSI. */
+} link_t;
+
+/**@brief Scanner and initiator. */
+typedef struct
+{
+    bool                  scanning;
+    bool                  initiating;
+    bool                  selective;
+    uint32_t              interval_us;
+    uint32_t              window_us;
+    uint64_t              start;
+    uint32_t              timeout_id;
+    ble_gap_addr_t        whitelist[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+    uint8_t               whitelist_count;
+    ble_gap_addr_t        target;              /**< Peer to connect to. */
+    ble_gap_conn_params_t conn_params;         /**< Parameters of the link to establish. */
+} scanner_t;
+
+static link_t            m_links[SIM_MAX_CONNS];
+static scanner_t         m_scanner;
+static sim_radio_stats_t m_stats;
+static uint64_t          m_flash_from;         /**< Start of the radio time held by flash. */
+static uint64_t          m_flash_until;        /**< End of the radio time held by flash. */
+static uint64_t          m_drop_until;         /**< Every packet is lost until this time. */
+
+static void conn_event_start(void * p_context, uint32_t arg);
+
+
+static void evt_init(sim_ble_evt_buf_t * p_buf, uint16_t evt_id, uint16_t conn_handle)
+{
+    memset(p_buf, 0, sizeof(*p_buf));
+    p_buf->evt.header.evt_id  = evt_id;
+    p_buf->evt.header.evt_len = sizeof(ble_evt_t) - sizeof(ble_evt_hdr_t);
+    // The connection handle is the first member of every event group.
+    p_buf->evt.evt.gap_evt.conn_handle = conn_handle;
+}
+
+
+static bool queue_push(pdu_queue_t * p_queue, const queued_pdu_t * p_item)
+{
+    if (p_queue->count == LINK_QUEUE_SIZE)
+    {
+        return false;
+    }
+    p_queue->items[(p_queue->head + p_queue->count) % LINK_QUEUE_SIZE] = *p_item;
+    p_queue->count++;
+    return true;
+}
+
+
+static queued_pdu_t * queue_peek(pdu_queue_t * p_queue)
+{
+    return (p_queue->count == 0) ? NULL : &p_queue->items[p_queue->head];
+}
+
+
+static void queue_pop(pdu_queue_t * p_queue)
+{
+    p_queue->head = (p_queue->head + 1) % LINK_QUEUE_SIZE;
+    p_queue->count--;
+}
+
+
+static uint32_t air_time(uint16_t att_len)
+{
+    return (att_len == 0) ? T_EMPTY_PACKET_US : ((LL_OVERHEAD_BYTES + att_len) * 8);
+}
+
+
+static bool addr_equal(const ble_gap_addr_t * p_a, const ble_gap_addr_t * p_b)
+{
+    return (p_a->addr_type == p_b->addr_type) && (memcmp(p_a->addr, p_b->addr, BLE_GAP_ADDR_LEN) == 0);
+}
+
+
+static link_t * link_get(uint16_t conn_handle)
+{
+    if ((conn_handle >= SIM_MAX_CONNS) || !m_links[conn_handle].active)
+    {
+        return NULL;
+    }
+    return &m_links[conn_handle];
+}
+
+
+/**@brief Function for checking whether flash holds the radio at a given time.
+ */
+static bool flash_holds_radio(uint64_t t)
+{
+    return (t >= m_flash_from) && (t < m_flash_until);
+}
+
+
+/**@brief Function for checking whether the scanner can receive at a given time.
+ */
+static bool scanner_listening(uint64_t t)
+{
+    uint8_t i;
+
+    if (!(m_scanner.scanning || m_scanner.initiating) || (t < m_drop_until) || flash_holds_radio(t))
+    {
+        return false;
+    }
+    if (((t - m_scanner.start) % m_scanner.interval_us) >= m_scanner.window_us)
+    {
+        return false;
+    }
+    // Connection events have priority over scanning.
+    for (i = 0; i < SIM_MAX_CONNS; i++)
+    {
+        if (m_links[i].active && m_links[i].in_event)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static void scan_timeout_handler(void * p_context, uint32_t arg)
+{
+    sim_ble_evt_buf_t buf;
+
+    UNUSED_PARAMETER(p_context);
+    UNUSED_PARAMETER(arg);
+
+    evt_init(&buf, BLE_GAP_EVT_TIMEOUT, BLE_CONN_HANDLE_INVALID);
+    buf.evt.evt.gap_evt.params.timeout.src = m_scanner.initiating ? BLE_GAP_TIMEOUT_SRC_CONN
+                                                                   : BLE_GAP_TIMEOUT_SRC_SCAN;
+    m_scanner.scanning   = false;
+    m_scanner.initiating = false;
+    sim_log("radio: %s timeout", (buf.evt.evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_CONN) ? "connect" : "scan");
+    sim_sd_ble_evt_raise(&buf);
+}
+
+
+/**@brief Function for taking over the scan parameters, as the SoftDevice copies them.
+ */
+static uint32_t scanner_setup(ble_gap_scan_params_t const * p_scan_params)
+{
+    uint8_t i;
+
+    if (p_scan_params == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if ((p_scan_params->interval < BLE_GAP_SCAN_INTERVAL_MIN) ||
+        (p_scan_params->interval > BLE_GAP_SCAN_INTERVAL_MAX) ||
+        (p_scan_params->window < BLE_GAP_SCAN_WINDOW_MIN)     ||
+        (p_scan_params->window > p_scan_params->interval))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_scanner.selective       = p_scan_params->selective;
+    m_scanner.interval_us     = p_scan_params->interval * 625UL;
+    m_scanner.window_us       = p_scan_params->window * 625UL;
+    m_scanner.start           = sim_now();
+    m_scanner.whitelist_count = 0;
+    if (p_scan_params->selective)
+    {
+        if (p_scan_params->p_whitelist == NULL)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+        for (i = 0; (i < p_scan_params->p_whitelist->addr_count) && (i < BLE_GAP_WHITELIST_ADDR_MAX_COUNT); i++)
+        {
+            m_scanner.whitelist[i] = *p_scan_params->p_whitelist->pp_addrs[i];
+        }
+        m_scanner.whitelist_count = i;
+    }
+
+    sim_cancel(m_scanner.timeout_id);
+    if ((p_scan_params->timeout != 0) && !sim_config_get()->replay)
+    {
+        m_scanner.timeout_id = sim_schedule(sim_now() + SIM_MS(p_scan_params->timeout * 1000UL),
+                                            scan_timeout_handler, NULL, 0);
+    }
+    return NRF_SUCCESS;
+}
+
+
+static bool whitelisted(const ble_gap_addr_t * p_addr)
+{
+    uint8_t i;
+
+    if (!m_scanner.selective)
+    {
+        return true;
+    }
+    for (i = 0; i < m_scanner.whitelist_count; i++)
+    {
+        if (addr_equal(&m_scanner.whitelist[i], p_addr))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static void link_disconnect(link_t * p_link, uint8_t reason)
+{
+    uint16_t          conn_handle = (uint16_t)(p_link - m_links);
+    sim_ble_evt_buf_t buf;
+
+    sim_log("radio: link %u down, reason 0x%02X", conn_handle, reason);
+    sim_cancel(p_link->timer_id);
+    p_link->active = false;
+    m_stats.disconnections++;
+    if (reason == BLE_HCI_CONNECTION_TIMEOUT)
+    {
+        m_stats.sup_timeouts++;
+    }
+
+    evt_init(&buf, BLE_GAP_EVT_DISCONNECTED, conn_handle);
+    buf.evt.evt.gap_evt.params.disconnected.reason = reason;
+    sim_sd_ble_evt_raise(&buf);
+
+    sim_gattc_on_disconnect(conn_handle);
+    sim_peer_on_disconnect(p_link->peer);
+}
+
+
+static void link_establish(uint8_t peer, uint64_t t)
+{
+    sim_config_t    * p_cfg = sim_config_get();
+    const ble_gap_addr_t own = OWN_ADDR;
+    sim_ble_evt_buf_t buf;
+    link_t          * p_link = NULL;
+    uint16_t          conn_handle;
+
+    for (conn_handle = 0; conn_handle < SIM_MAX_CONNS; conn_handle++)
+    {
+        if (!m_links[conn_handle].active)
+        {
+            p_link = &m_links[conn_handle];
+            break;
+        }
+    }
+    if (p_link == NULL)
+    {
+        return;
+    }
+
+    memset(p_link, 0, sizeof(*p_link));
+    p_link->active        = true;
+    p_link->peer          = peer;
+    p_link->params        = m_scanner.conn_params;
+    p_link->interval_us   = (p_cfg->conn_interval_us != 0) ? p_cfg->conn_interval_us
+                                                           : (m_scanner.conn_params.min_conn_interval * 1250UL);
+    p_link->params.min_conn_interval = (uint16_t)(p_link->interval_us / 1250);
+    p_link->params.max_conn_interval = p_link->params.min_conn_interval;
+    p_link->anchor        = t + CONNECT_DELAY_US;
+    p_link->last_rx       = p_link->anchor;
+    p_link->tx_free       = p_cfg->tx_buffers;
+    p_link->rssi          = sim_peer_rssi_get(peer);
+    p_link->timer_id      = sim_schedule(p_link->anchor, conn_event_start, p_link, 0);
+
+    m_scanner.initiating = false;
+    sim_cancel(m_scanner.timeout_id);
+    m_stats.connections++;
+    sim_log("radio: link %u up to peer %u, interval %u us", conn_handle, peer, p_link->interval_us);
+
+    evt_init(&buf, BLE_GAP_EVT_CONNECTED, conn_handle);
+    sim_peer_addr_get(peer, &buf.evt.evt.gap_evt.params.connected.peer_addr);
+    buf.evt.evt.gap_evt.params.connected.own_addr    = own;
+    buf.evt.evt.gap_evt.params.connected.role        = BLE_GAP_ROLE_CENTRAL;
+    buf.evt.evt.gap_evt.params.connected.conn_params = p_link->params;
+    sim_sd_ble_evt_raise(&buf);
+
+    sim_gattc_on_connect(conn_handle);
+    sim_peer_on_connect(peer, conn_handle);
+}
+
+
+/**@brief Function for handling an advertising event of a simulated advertiser.
+ */
+static void adv_event(void * p_context, uint32_t peer)
+{
+    sim_config_t * p_cfg = sim_config_get();
+    uint64_t       t     = sim_now();
+
+    UNUSED_PARAMETER(p_context);
+
+    if (sim_peer_advertising((uint8_t)peer))
+    {
+        ble_gap_addr_t addr;
+
+        m_stats.adv_events++;
+        sim_peer_addr_get((uint8_t)peer, &addr);
+
+        if (scanner_listening(t) && !sim_chance(p_cfg->loss) && whitelisted(&addr))
+        {
+            if (m_scanner.initiating)
+            {
+                if (m_scanner.selective || addr_equal(&addr, &m_scanner.target))
+                {
+                    link_establish((uint8_t)peer, t);
+                }
+            }
+            else
+            {
+                sim_ble_evt_buf_t buf;
+
+                evt_init(&buf, BLE_GAP_EVT_ADV_REPORT, BLE_CONN_HANDLE_INVALID);
+                buf.evt.evt.gap_evt.params.adv_report.peer_addr = addr;
+                buf.evt.evt.gap_evt.params.adv_report.rssi      = (int8_t)(sim_peer_rssi_get((uint8_t)peer) + (int)(sim_rand() % 5) - 2);
+                buf.evt.evt.gap_evt.params.adv_report.type      = BLE_GAP_ADV_TYPE_ADV_IND;
+                buf.evt.evt.gap_evt.params.adv_report.dlen      =
+                    sim_peer_adv_data_get((uint8_t)peer, buf.evt.evt.gap_evt.params.adv_report.data);
+                m_stats.adv_reports++;
+                sim_sd_ble_evt_raise(&buf);
+            }
+        }
+    }
+
+    (void)sim_schedule(t + p_cfg->adv_interval_us + (sim_rand() % ADV_DELAY_MAX_US), adv_event, NULL, peer);
+}
+
+
+/**@brief Function for closing the current connection event and scheduling the next one.
+ */
+static void conn_event_close(link_t * p_link)
+{
+    uint16_t conn_handle = (uint16_t)(p_link - m_links);
+
+    p_link->in_event = false;
+    if (p_link->tx_completed != 0)
+    {
+        sim_ble_evt_buf_t buf;
+
+        evt_init(&buf, BLE_EVT_TX_COMPLETE, conn_handle);
+        buf.evt.evt.common_evt.params.tx_complete.count = p_link->tx_completed;
+        p_link->tx_completed = 0;
+        sim_sd_ble_evt_raise(&buf);
+    }
+
+    p_link->event_counter++;
+    p_link->anchor  += p_link->interval_us;
+    p_link->timer_id = sim_schedule(p_link->anchor, conn_event_start, p_link, 0);
+}
+
+
+/**@brief Function for exchanging one packet pair in a connection event.
+ */
+static void conn_exchange(void * p_context, uint32_t arg)
+{
+    sim_config_t * p_cfg  = sim_config_get();
+    link_t       * p_link = (link_t *)p_context;
+    uint16_t       conn_handle = (uint16_t)(p_link - m_links);
+    uint64_t       t      = sim_now();
+    queued_pdu_t * p_m;
+    queued_pdu_t * p_s;
+    uint16_t       m_len;
+    uint16_t       s_len;
+    uint32_t       pair_us;
+    bool           m_cmd  = false;
+
+    UNUSED_PARAMETER(arg);
+
+    p_m = queue_peek(&p_link->to_peer);
+    p_s = queue_peek(&p_link->to_central);
+    if ((p_s != NULL) && (p_s->ready_event > p_link->event_counter))
+    {
+        p_s = NULL;
+    }
+    m_len   = (p_m == NULL) ? 0 : p_m->pdu.len;
+    s_len   = (p_s == NULL) ? 0 : p_s->pdu.len;
+    pair_us = air_time(m_len) + T_IFS_US + air_time(s_len) + T_IFS_US;
+
+    if (((p_link->exchanges > 0) && (p_m == NULL) && (p_s == NULL)) ||
+        (p_link->exchanges >= p_cfg->pkts_per_event)                ||
+        ((t + pair_us) > (p_link->anchor + p_link->interval_us - T_IFS_US)) ||
+        flash_holds_radio(t))
+    {
+        conn_event_close(p_link);
+        return;
+    }
+
+    // Central to peripheral. A lost packet gets no response, and ends the event.
+    m_stats.packets_sent++;
+    if ((t < m_drop_until) || sim_chance(p_cfg->loss))
+    {
+        m_stats.packets_lost++;
+        conn_event_close(p_link);
+        return;
+    }
+    if (p_m != NULL)
+    {
+        sim_pdu_t pdu = p_m->pdu;
+
+        m_cmd = p_m->write_cmd;
+        queue_pop(&p_link->to_peer);
+        m_stats.central_pdus++;
+        if (m_cmd)
+        {
+            p_link->tx_unacked++;
+        }
+        sim_peer_on_rx(p_link->peer, &pdu);
+    }
+
+    // Peripheral to central. When lost, the central retransmits and the peer discards the copy,
+    // so only the acknowledgement is late.
+    m_stats.packets_sent++;
+    if ((t < m_drop_until) || sim_chance(p_cfg->loss))
+    {
+        m_stats.packets_lost++;
+        conn_event_close(p_link);
+        return;
+    }
+    p_link->last_rx       = t;
+    p_link->tx_completed += p_link->tx_unacked;
+    p_link->tx_free      += p_link->tx_unacked;
+    p_link->tx_unacked    = 0;
+    p_link->exchanges++;
+
+    if (p_s != NULL)
+    {
+        sim_pdu_t pdu = p_s->pdu;
+
+        queue_pop(&p_link->to_central);
+        m_stats.peer_pdus++;
+        sim_gattc_on_rx(conn_handle, &pdu);
+    }
+
+    if (p_link->active)
+    {
+        p_link->timer_id = sim_schedule(t + pair_us, conn_exchange, p_link, 0);
+    }
+}
+
+
+static void conn_event_start(void * p_context, uint32_t arg)
+{
+    link_t * p_link      = (link_t *)p_context;
+    uint16_t conn_handle = (uint16_t)(p_link - m_links);
+    uint64_t t           = sim_now();
+
+    UNUSED_PARAMETER(arg);
+
+    if (p_link->terminate)
+    {
+        link_disconnect(p_link, p_link->terminate_reason);
+        return;
+    }
+    if ((t - p_link->last_rx) >= (p_link->params.conn_sup_timeout * 10000ULL))
+    {
+        link_disconnect(p_link, BLE_HCI_CONNECTION_TIMEOUT);
+        return;
+    }
+
+    if (p_link->update_pending && (p_link->event_counter == p_link->update_instant))
+    {
+        sim_ble_evt_buf_t buf;
+
+        p_link->update_pending = false;
+        p_link->params         = p_link->update_params;
+        p_link->interval_us    = p_link->params.min_conn_interval * 1250UL;
+        sim_log("radio: link %u interval %u us", conn_handle, p_link->interval_us);
+
+        evt_init(&buf, BLE_GAP_EVT_CONN_PARAM_UPDATE, conn_handle);
+        buf.evt.evt.gap_evt.params.conn_param_update.conn_params = p_link->params;
+        sim_sd_ble_evt_raise(&buf);
+    }
+
+    if (flash_holds_radio(t))
+    {
+        m_stats.conn_events_blocked++;
+        p_link->in_event = true;
+        conn_event_close(p_link);
+        return;
+    }
+
+    if ((p_link->pairing_left != 0) && (--p_link->pairing_left == 0))
+    {
+        sim_ble_evt_buf_t buf;
+
+        evt_init(&buf, BLE_GAP_EVT_CONN_SEC_UPDATE, conn_handle);
+        buf.evt.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm = 1;
+        buf.evt.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv = 2;
+        buf.evt.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = 16;
+        sim_sd_ble_evt_raise(&buf);
+
+        evt_init(&buf, BLE_GAP_EVT_AUTH_STATUS, conn_handle);
+        buf.evt.evt.gap_evt.params.auth_status.auth_status = BLE_GAP_SEC_STATUS_SUCCESS;
+        buf.evt.evt.gap_evt.params.auth_status.bonded      = p_link->pairing_bond;
+        sim_sd_ble_evt_raise(&buf);
+    }
+
+    if (p_link->rssi_reporting)
+    {
+        int8_t rssi = (int8_t)(sim_peer_rssi_get(p_link->peer) + (int)(sim_rand() % 5) - 2);
+
+        if (abs(rssi - p_link->rssi) < p_link->rssi_threshold)
+        {
+            p_link->rssi_changed = 0;
+        }
+        else if (++p_link->rssi_changed > p_link->rssi_skip)
+        {
+            sim_ble_evt_buf_t buf;
+
+            evt_init(&buf, BLE_GAP_EVT_RSSI_CHANGED, conn_handle);
+            buf.evt.evt.gap_evt.params.rssi_changed.rssi = rssi;
+            sim_sd_ble_evt_raise(&buf);
+            p_link->rssi         = rssi;
+            p_link->rssi_changed = 0;
+        }
+    }
+
+    m_stats.conn_events++;
+    p_link->in_event  = true;
+    p_link->exchanges = 0;
+    conn_exchange(p_link, 0);
+}
+
+
+void sim_radio_init(void)
+{
+    uint8_t i;
+
+    memset(m_links, 0, sizeof(m_links));
+    memset(&m_scanner, 0, sizeof(m_scanner));
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    for (i = 0; i < sim_peer_count(); i++)
+    {
+        (void)sim_schedule(sim_rand() % sim_config_get()->adv_interval_us, adv_event, NULL, i);
+    }
+}
+
+
+uint32_t sim_radio_central_send(uint16_t conn_handle, const sim_pdu_t * p_pdu, bool write_cmd)
+{
+    link_t     * p_link = link_get(conn_handle);
+    queued_pdu_t item;
+
+    if (p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (sim_config_get()->replay)
+    {
+        // Buffers are released by the TX_COMPLETE events of the trace.
+        if (sim_hooks_get()->central_tx != NULL)
+        {
+            sim_hooks_get()->central_tx(conn_handle, p_pdu->data, p_pdu->len);
+        }
+        return NRF_SUCCESS;
+    }
+    if (write_cmd && (p_link->tx_free == 0))
+    {
+        return BLE_ERROR_NO_TX_BUFFERS;
+    }
+
+    item.pdu         = *p_pdu;
+    item.write_cmd   = write_cmd;
+    item.ready_event = 0;
+    if (!queue_push(&p_link->to_peer, &item))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    if (write_cmd)
+    {
+        p_link->tx_free--;
+    }
+    if (sim_hooks_get()->central_tx != NULL)
+    {
+        sim_hooks_get()->central_tx(conn_handle, p_pdu->data, p_pdu->len);
+    }
+    if (p_link->to_peer.count > m_stats.tx_queue_high_water)
+    {
+        m_stats.tx_queue_high_water = p_link->to_peer.count;
+    }
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for following the link state in the events of a replayed trace, so the calls
+ *        the application makes in response are accepted. No events are generated.
+ */
+void sim_radio_replay_evt(const ble_evt_t * p_ble_evt)
+{
+    const ble_gap_evt_t * p_gap_evt   = &p_ble_evt->evt.gap_evt;
+    uint16_t              conn_handle = p_gap_evt->conn_handle;
+    link_t              * p_link      = link_get(conn_handle);
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            if (conn_handle < SIM_MAX_CONNS)
+            {
+                p_link = &m_links[conn_handle];
+                memset(p_link, 0, sizeof(*p_link));
+                p_link->active  = true;
+                p_link->params  = p_gap_evt->params.connected.conn_params;
+                p_link->tx_free = sim_config_get()->tx_buffers;
+                sim_gattc_on_connect(conn_handle);
+                m_stats.connections++;
+            }
+            m_scanner.scanning   = false;
+            m_scanner.initiating = false;
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_link != NULL)
+            {
+                p_link->active = false;
+                sim_gattc_on_disconnect(conn_handle);
+                m_stats.disconnections++;
+            }
+            break;
+
+        case BLE_GAP_EVT_TIMEOUT:
+            if (p_gap_evt->params.timeout.src == BLE_GAP_TIMEOUT_SRC_SCAN)
+            {
+                m_scanner.scanning = false;
+            }
+            else if (p_gap_evt->params.timeout.src == BLE_GAP_TIMEOUT_SRC_CONN)
+            {
+                m_scanner.initiating = false;
+            }
+            break;
+
+        case BLE_GAP_EVT_ADV_REPORT:
+            m_stats.adv_reports++;
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            if (p_link != NULL)
+            {
+                p_link->params         = p_gap_evt->params.conn_param_update.conn_params;
+                p_link->update_pending = false;
+            }
+            break;
+
+        case BLE_GAP_EVT_AUTH_STATUS:
+            if (p_link != NULL)
+            {
+                p_link->pairing_left = 0;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+uint32_t sim_radio_peer_send(uint16_t conn_handle, const sim_pdu_t * p_pdu)
+{
+    link_t     * p_link = link_get(conn_handle);
+    queued_pdu_t item;
+
+    if (p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+
+    // Whatever the peer queues during an event goes out in the next one.
+    item.pdu         = *p_pdu;
+    item.write_cmd   = false;
+    item.ready_event = p_link->in_event ? (p_link->event_counter + 1) : p_link->event_counter;
+    return queue_push(&p_link->to_central, &item) ? NRF_SUCCESS : NRF_ERROR_NO_MEM;
+}
+
+
+uint8_t sim_radio_peer_queue_free(uint16_t conn_handle)
+{
+    link_t * p_link = link_get(conn_handle);
+
+    return (p_link == NULL) ? 0 : (uint8_t)(LINK_QUEUE_SIZE - p_link->to_central.count);
+}
+
+
+void sim_radio_peer_disconnect(uint16_t conn_handle, uint8_t reason)
+{
+    link_t * p_link = link_get(conn_handle);
+
+    if (p_link != NULL)
+    {
+        p_link->terminate        = true;
+        p_link->terminate_reason = reason;
+    }
+}
+
+
+void sim_radio_peer_conn_param_request(uint16_t conn_handle, const ble_gap_conn_params_t * p_params)
+{
+    sim_ble_evt_buf_t buf;
+
+    if (link_get(conn_handle) == NULL)
+    {
+        return;
+    }
+    evt_init(&buf, BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, conn_handle);
+    buf.evt.evt.gap_evt.params.conn_param_update_request.conn_params = *p_params;
+    sim_sd_ble_evt_raise(&buf);
+}
+
+
+void sim_radio_drop(uint64_t duration_us)
+{
+    m_drop_until = sim_now() + duration_us;
+}
+
+
+/**@brief Function for finding the end of the first radio activity that overlaps a time span.
+ *
+ * @return End of the activity, or 0 if the span is free.
+ */
+static uint64_t radio_conflict(uint64_t from, uint64_t to)
+{
+    sim_config_t * p_cfg = sim_config_get();
+    uint64_t       end   = 0;
+    uint8_t        i;
+
+    for (i = 0; i < SIM_MAX_CONNS; i++)
+    {
+        link_t * p_link = &m_links[i];
+        uint64_t ev;
+        uint64_t len;
+
+        if (!p_link->active)
+        {
+            continue;
+        }
+        len = p_cfg->pkts_per_event * (2 * (air_time(SIM_ATT_MTU) + T_IFS_US));
+        len = MIN(len, p_link->interval_us);
+        ev  = p_link->anchor;
+        while ((ev + len) <= from)
+        {
+            ev += p_link->interval_us;
+        }
+        if (ev < to)
+        {
+            end = MAX(end, ev + len);
+        }
+    }
+
+    if (m_scanner.scanning || m_scanner.initiating)
+    {
+        uint64_t phase = (from - m_scanner.start) % m_scanner.interval_us;
+        uint64_t win   = from - phase;
+
+        if (phase >= m_scanner.window_us)
+        {
+            win += m_scanner.interval_us;
+        }
+        if (win < to)
+        {
+            end = MAX(end, win + m_scanner.window_us);
+        }
+    }
+    return end;
+}
+
+
+uint64_t sim_radio_flash_reserve(uint32_t duration_us)
+{
+    uint64_t earliest = MAX(sim_now(), m_flash_until);
+    uint64_t start    = earliest;
+
+    // Look for a gap in the radio schedule. If there is none soon enough the flash operation takes
+    // the radio anyway, and the connection events and scan windows it overlaps are lost.
+    while (start < (earliest + FLASH_SEARCH_US))
+    {
+        uint64_t end = radio_conflict(start, start + duration_us);
+
+        if (end == 0)
+        {
+            break;
+        }
+        start = end;
+    }
+    if (start >= (earliest + FLASH_SEARCH_US))
+    {
+        start = earliest;
+    }
+
+    m_flash_from  = start;
+    m_flash_until = start + duration_us;
+    return start;
+}
+
+
+const sim_radio_stats_t * sim_radio_stats_get(void)
+{
+    return &m_stats;
+}
+
+
+uint32_t sd_ble_gap_address_get(ble_gap_addr_t * p_addr)
+{
+    const ble_gap_addr_t own = OWN_ADDR;
+
+    if (p_addr == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    *p_addr = own;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_scan_start(ble_gap_scan_params_t const * p_scan_params)
+{
+    uint32_t err_code;
+
+    if (m_scanner.scanning || m_scanner.initiating)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    err_code = scanner_setup(p_scan_params);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    m_scanner.scanning = true;
+    sim_log("radio: scan start, window %u/%u us", m_scanner.window_us, m_scanner.interval_us);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_scan_stop(void)
+{
+    if (!m_scanner.scanning)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    m_scanner.scanning = false;
+    sim_cancel(m_scanner.timeout_id);
+    sim_log("radio: scan stop");
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_connect(ble_gap_addr_t const * p_peer_addr,
+                            ble_gap_scan_params_t const * p_scan_params,
+                            ble_gap_conn_params_t const * p_conn_params)
+{
+    uint32_t err_code;
+
+    if ((p_conn_params == NULL) || ((p_peer_addr == NULL) && ((p_scan_params == NULL) || !p_scan_params->selective)))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (m_scanner.scanning || m_scanner.initiating)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_conn_params->min_conn_interval < BLE_GAP_CP_MIN_CONN_INTVL_MIN) ||
+        (p_conn_params->max_conn_interval > BLE_GAP_CP_MAX_CONN_INTVL_MAX) ||
+        (p_conn_params->min_conn_interval > p_conn_params->max_conn_interval))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    err_code = scanner_setup(p_scan_params);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    if (p_peer_addr != NULL)
+    {
+        m_scanner.target = *p_peer_addr;
+    }
+    m_scanner.conn_params = *p_conn_params;
+    m_scanner.initiating  = true;
+    sim_log("radio: connecting");
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_connect_cancel(void)
+{
+    if (!m_scanner.initiating)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    m_scanner.initiating = false;
+    sim_cancel(m_scanner.timeout_id);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code)
+{
+    link_t * p_link = link_get(conn_handle);
+
+    if (p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (p_link->terminate)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    UNUSED_PARAMETER(hci_status_code);
+    p_link->terminate        = true;
+    p_link->terminate_reason = BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_tx_power_set(int8_t tx_power)
+{
+    switch (tx_power)
+    {
+        case -40: case -30: case -20: case -16: case -12: case -8: case -4: case 0: case 4:
+            break;
+
+        default:
+            return NRF_ERROR_INVALID_PARAM;
+    }
+    if (tx_power != m_stats.tx_power)
+    {
+        m_stats.tx_power_changes++;
+    }
+    m_stats.tx_power = tx_power;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const * p_conn_params)
+{
+    link_t * p_link = link_get(conn_handle);
+
+    if (p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (p_conn_params == NULL)
+    {
+        // Rejects the request of the peer.
+        return NRF_SUCCESS;
+    }
+    if (p_link->update_pending)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if ((p_conn_params->min_conn_interval < BLE_GAP_CP_MIN_CONN_INTVL_MIN) ||
+        (p_conn_params->max_conn_interval > BLE_GAP_CP_MAX_CONN_INTVL_MAX) ||
+        (p_conn_params->min_conn_interval > p_conn_params->max_conn_interval))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    p_link->update_pending = true;
+    p_link->update_instant = p_link->event_counter + PARAM_UPDATE_EVENTS;
+    p_link->update_params  = *p_conn_params;
+    p_link->update_params.max_conn_interval = p_conn_params->min_conn_interval;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_authenticate(uint16_t conn_handle, ble_gap_sec_params_t const * p_sec_params)
+{
+    link_t * p_link = link_get(conn_handle);
+
+    if (p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (p_sec_params == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (p_link->pairing_left != 0)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    p_link->pairing_left = MAX(sim_config_get()->pairing_events, 1);
+    p_link->pairing_bond = p_sec_params->bond;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_rssi_start(uint16_t conn_handle, uint8_t threshold_dbm, uint8_t skip_count)
+{
+    link_t * p_link = link_get(conn_handle);
+
+    if (p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    p_link->rssi_reporting = true;
+    p_link->rssi_threshold = threshold_dbm;
+    p_link->rssi_skip      = skip_count;
+    p_link->rssi_changed   = 0;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_rssi_stop(uint16_t conn_handle)
+{
+    link_t * p_link = link_get(conn_handle);
+
+    if (p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    p_link->rssi_reporting = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_rssi_get(uint16_t conn_handle, int8_t * p_rssi)
+{
+    link_t * p_link = link_get(conn_handle);
+
+    if (p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (!p_link->rssi_reporting)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    *p_rssi = p_link->rssi;
+    return NRF_SUCCESS;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "evt_trace.h"
+#include "app_uart.h"
+#include "nrf_soc.h"
+#include "nordic_common.h"
+
+#define FNV_OFFSET          0xCBF29CE484222325ULL  /**< FNV-1a 64 bit offset basis. */
+#define FNV_PRIME           0x100000001B3ULL       /**< FNV-1a 64 bit prime. */
+#define OPT_UART_OUT        0x100
+#define OPT_DURATION        0x101
+#define OPT_FORMAT          0x102
+#define OPT_HELP            0x103
+
+/**@brief Name of an event ID, for the profile. */
+typedef struct
+{
+    sim_prof_src_t src;
+    uint32_t       id;
+    const char   * p_name;
+} evt_name_t;
+
+int fw_main(void);
+
+static const evt_name_t m_evt_names[] =
+{
+    {SIM_PROF_BLE,   BLE_GAP_EVT_CONNECTED,             "BLE_GAP_EVT_CONNECTED"},
+    {SIM_PROF_BLE,   BLE_GAP_EVT_DISCONNECTED,          "BLE_GAP_EVT_DISCONNECTED"},
+    {SIM_PROF_BLE,   BLE_GAP_EVT_CONN_PARAM_UPDATE,     "BLE_GAP_EVT_CONN_PARAM_UPDATE"},
+    {SIM_PROF_BLE,   BLE_GAP_EVT_SEC_PARAMS_REQUEST,    "BLE_GAP_EVT_SEC_PARAMS_REQUEST"},
+    {SIM_PROF_BLE,   BLE_GAP_EVT_AUTH_STATUS,           "BLE_GAP_EVT_AUTH_STATUS"},
+    {SIM_PROF_BLE,   BLE_GAP_EVT_CONN_SEC_UPDATE,       "BLE_GAP_EVT_CONN_SEC_UPDATE"},
+    {SIM_PROF_BLE,   BLE_GAP_EVT_TIMEOUT,               "BLE_GAP_EVT_TIMEOUT"},
+    {SIM_PROF_BLE,   BLE_GAP_EVT_ADV_REPORT,            "BLE_GAP_EVT_ADV_REPORT"},
+    {SIM_PROF_BLE,   BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, "BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST"},
+    {SIM_PROF_BLE,   BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP,  "BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP"},
+    {SIM_PROF_BLE,   BLE_GATTC_EVT_CHAR_DISC_RSP,       "BLE_GATTC_EVT_CHAR_DISC_RSP"},
+    {SIM_PROF_BLE,   BLE_GATTC_EVT_DESC_DISC_RSP,       "BLE_GATTC_EVT_DESC_DISC_RSP"},
+    {SIM_PROF_BLE,   BLE_GATTC_EVT_WRITE_RSP,           "BLE_GATTC_EVT_WRITE_RSP"},
+    {SIM_PROF_BLE,   BLE_GATTC_EVT_HVX,                 "BLE_GATTC_EVT_HVX"},
+    {SIM_PROF_BLE,   BLE_GATTC_EVT_TIMEOUT,             "BLE_GATTC_EVT_TIMEOUT"},
+    {SIM_PROF_BLE,   BLE_EVT_TX_COMPLETE,               "BLE_EVT_TX_COMPLETE"},
+    {SIM_PROF_SYS,   NRF_EVT_FLASH_OPERATION_SUCCESS,   "NRF_EVT_FLASH_OPERATION_SUCCESS"},
+    {SIM_PROF_SYS,   NRF_EVT_FLASH_OPERATION_ERROR,     "NRF_EVT_FLASH_OPERATION_ERROR"},
+    {SIM_PROF_UART,  APP_UART_DATA_READY,               "APP_UART_DATA_READY"},
+    {SIM_PROF_UART,  APP_UART_FIFO_ERROR,               "APP_UART_FIFO_ERROR"},
+    {SIM_PROF_UART,  APP_UART_COMMUNICATION_ERROR,      "APP_UART_COMMUNICATION_ERROR"},
+    {SIM_PROF_UART,  APP_UART_TX_EMPTY,                 "APP_UART_TX_EMPTY"},
+};
+
+static const char * const m_src_names[] = {"ble", "sys", "uart", "timer"};
+
+static FILE   * mp_uart_out;
+static uint64_t m_uart_hash = FNV_OFFSET;
+static uint32_t m_uart_bytes;
+static uint64_t m_att_hash  = FNV_OFFSET;
+static uint32_t m_att_pdus;
+static uint32_t m_att_bytes;
+
+
+static uint64_t fnv1a(uint64_t hash, const uint8_t * p_data, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        hash = (hash ^ p_data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+
+static void on_host_rx(uint8_t byte)
+{
+    m_uart_hash = fnv1a(m_uart_hash, &byte, 1);
+    m_uart_bytes++;
+    if (mp_uart_out != NULL)
+    {
+        (void)fputc(byte, mp_uart_out);
+    }
+}
+
+
+static void on_central_tx(uint16_t conn_handle, const uint8_t * p_data, uint16_t len)
+{
+    UNUSED_PARAMETER(conn_handle);
+
+    m_att_hash   = fnv1a(m_att_hash, p_data, len);
+    m_att_bytes += len;
+    m_att_pdus++;
+}
+
+
+static const char * evt_name_get(sim_prof_src_t src, uint32_t id)
+{
+    uint32_t i;
+
+    for (i = 0; i < sizeof(m_evt_names) / sizeof(m_evt_names[0]); i++)
+    {
+        if ((m_evt_names[i].src == src) && (m_evt_names[i].id == id))
+        {
+            return m_evt_names[i].p_name;
+        }
+    }
+    return NULL;
+}
+
+
+static void profile_print(bool json)
+{
+    bool     first = true;
+    uint32_t src;
+    uint32_t id;
+
+    printf(json ? "\"handlers\": [" : "%-6s %-40s %8s %10s %10s\n", "source", "event", "count", "mean_ns", "max_ns");
+    for (src = 0; src < SIM_PROF_SRC_COUNT; src++)
+    {
+        for (id = 0; id < SIM_PROF_IDS; id++)
+        {
+            const sim_prof_entry_t * p_entry = sim_prof_get((sim_prof_src_t)src, id);
+            const char             * p_name  = evt_name_get((sim_prof_src_t)src, id);
+            char                     name[48];
+            double                   mean_ns;
+
+            if (p_entry->count == 0)
+            {
+                continue;
+            }
+            if (p_name == NULL)
+            {
+                snprintf(name, sizeof(name), "%u", (unsigned)id);
+                p_name = name;
+            }
+            mean_ns = (double)p_entry->total_ns / p_entry->count;
+            if (json)
+            {
+                printf("%s{\"source\": \"%s\", \"event\": \"%s\", \"count\": %u, \"mean_ns\": %.0f, "
+                       "\"max_ns\": %llu}", first ? "" : ", ", m_src_names[src], p_name,
+                       (unsigned)p_entry->count, mean_ns, (unsigned long long)p_entry->max_ns);
+            }
+            else
+            {
+                printf("%-6s %-40s %8u %10.0f %10llu\n", m_src_names[src], p_name,
+                       (unsigned)p_entry->count, mean_ns, (unsigned long long)p_entry->max_ns);
+            }
+            first = false;
+        }
+    }
+    if (json)
+    {
+        printf("]");
+    }
+}
+
+
+static void usage(const char * p_name)
+{
+    printf("Usage: %s [options] TRACE\n", p_name);
+    printf("Replays an event trace into the application and reports the time its handlers take.\n");
+    printf("  --%-20s %s\n", "uart-out FILE",  "write the UART output of the application to FILE");
+    printf("  --%-20s %s\n", "duration MS",    "stop replaying after MS (end of the trace)");
+    printf("  --%-20s %s\n", "format FMT",     "report as kv or json (kv)");
+}
+
+
+int main(int argc, char ** argv)
+{
+    static const struct option options[] =
+    {
+        {"uart-out", required_argument, NULL, OPT_UART_OUT},
+        {"duration", required_argument, NULL, OPT_DURATION},
+        {"format",   required_argument, NULL, OPT_FORMAT},
+        {"help",     no_argument,       NULL, OPT_HELP},
+        {NULL,       0,                 NULL, 0}
+    };
+    sim_config_t * p_cfg       = sim_config_get();
+    bool           json        = false;
+    uint64_t       duration_us = 0;
+    const char   * p_reason;
+    sim_result_t   result;
+    int            opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case OPT_UART_OUT:
+                mp_uart_out = fopen(optarg, "wb");
+                if (mp_uart_out == NULL)
+                {
+                    perror(optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case OPT_DURATION:
+                duration_us = (uint64_t)(atof(optarg) * 1000.0);
+                break;
+
+            case OPT_FORMAT:
+                json = (strcmp(optarg, "json") == 0);
+                break;
+
+            case OPT_HELP:
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((optind != (argc - 1)) || (sim_trace_load(argv[optind]) != 0))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Nothing but the trace drives the application.
+    p_cfg->peer_count  = 0;
+    p_cfg->adv_noise   = 0;
+    p_cfg->line_count  = 0;
+    p_cfg->replay      = true;
+    p_cfg->profile     = true;
+    p_cfg->duration_us = sim_trace_replay_start() + SIM_MS(1000);
+    if (duration_us != 0)
+    {
+        p_cfg->duration_us = duration_us;
+    }
+
+    sim_hooks_get()->host_rx    = on_host_rx;
+    sim_hooks_get()->central_tx = on_central_tx;
+
+    result = sim_run(fw_main, &p_reason);
+    if (mp_uart_out != NULL)
+    {
+        fclose(mp_uart_out);
+    }
+
+    fflush(stdout);
+    if (json)
+    {
+        printf("{\"reason\": \"%s\", \"time_ms\": %.3f, \"trace_dropped\": %u, \"uart_bytes\": %u, "
+               "\"uart_hash\": \"%016llx\", \"att_pdus\": %u, \"att_bytes\": %u, \"att_hash\": \"%016llx\", ",
+               p_reason, sim_now() / 1000.0, (unsigned)sim_trace_header_get()->dropped,
+               (unsigned)m_uart_bytes, (unsigned long long)m_uart_hash, (unsigned)m_att_pdus,
+               (unsigned)m_att_bytes, (unsigned long long)m_att_hash);
+        profile_print(true);
+        printf("}\n");
+    }
+    else
+    {
+        printf("reason=%s\n", p_reason);
+        printf("time_ms=%.3f\n", sim_now() / 1000.0);
+        printf("trace_dropped=%u\n", (unsigned)sim_trace_header_get()->dropped);
+        printf("uart_bytes=%u\n", (unsigned)m_uart_bytes);
+        printf("uart_hash=%016llx\n", (unsigned long long)m_uart_hash);
+        printf("att_pdus=%u\n", (unsigned)m_att_pdus);
+        printf("att_bytes=%u\n", (unsigned)m_att_bytes);
+        printf("att_hash=%016llx\n", (unsigned long long)m_att_hash);
+        profile_print(false);
+    }
+
+    return ((result == SIM_RESULT_OK) || (result == SIM_RESULT_IDLE)) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "ble.h"
+#include "nordic_common.h"
+#include "nrf_soc.h"
+#include "softdevice_handler.h"
+
+#define BLE_EVT_QUEUE_SIZE    256        /**< BLE events the SoftDevice can hold for the application. */
+#define SYS_EVT_QUEUE_SIZE    16         /**< SoC events the SoftDevice can hold for the application. */
+#define VS_UUID_COUNT         4          /**< Vendor specific UUID bases that can be added. */
+
+static sim_ble_evt_buf_t  m_ble_evts[BLE_EVT_QUEUE_SIZE];
+static uint32_t           m_ble_evt_head;
+static uint32_t           m_ble_evt_count;
+static uint32_t           m_sys_evts[SYS_EVT_QUEUE_SIZE];
+static uint32_t           m_sys_evt_head;
+static uint32_t           m_sys_evt_count;
+static bool               m_dispatch_pending;
+
+static ble_evt_handler_t  m_ble_evt_handler;
+static sys_evt_handler_t  m_sys_evt_handler;
+static bool               m_enabled;
+
+static ble_uuid128_t      m_vs_uuids[VS_UUID_COUNT];
+static uint8_t            m_vs_uuid_count;
+
+static bool               m_flash_busy;
+static void            (* m_flash_apply)(void * p_context);
+static void             * mp_flash_context;
+
+
+/**@brief Function for handing queued events to the application, as the SoftDevice event interrupt
+ *        does. Events raised by the handlers are handed over in the same pass.
+ */
+static void evt_dispatch(void * p_context, uint32_t arg)
+{
+    UNUSED_PARAMETER(p_context);
+    UNUSED_PARAMETER(arg);
+
+    m_dispatch_pending = false;
+
+    for (;;)
+    {
+        if (m_sys_evt_count != 0)
+        {
+            uint32_t sys_evt = m_sys_evts[m_sys_evt_head];
+
+            m_sys_evt_head = (m_sys_evt_head + 1) % SYS_EVT_QUEUE_SIZE;
+            m_sys_evt_count--;
+            sim_trace_on_sys_evt(sys_evt);
+            if (m_sys_evt_handler != NULL)
+            {
+                uint64_t start = sim_prof_start();
+
+                m_sys_evt_handler(sys_evt);
+                sim_prof_end(SIM_PROF_SYS, sys_evt, start);
+            }
+            continue;
+        }
+        if (m_ble_evt_count != 0)
+        {
+            sim_ble_evt_buf_t buf = m_ble_evts[m_ble_evt_head];
+
+            m_ble_evt_head = (m_ble_evt_head + 1) % BLE_EVT_QUEUE_SIZE;
+            m_ble_evt_count--;
+            sim_trace_on_ble_evt(&buf.evt);
+            if (m_ble_evt_handler != NULL)
+            {
+                uint64_t start = sim_prof_start();
+
+                m_ble_evt_handler(&buf.evt);
+                sim_prof_end(SIM_PROF_BLE, buf.evt.header.evt_id, start);
+            }
+            continue;
+        }
+        break;
+    }
+}
+
+
+static void dispatch_pend(void)
+{
+    if (!m_dispatch_pending)
+    {
+        m_dispatch_pending = true;
+        (void)sim_schedule(sim_now(), evt_dispatch, NULL, 0);
+    }
+}
+
+
+void sim_sd_ble_evt_raise(const sim_ble_evt_buf_t * p_buf)
+{
+    if (m_ble_evt_count == BLE_EVT_QUEUE_SIZE)
+    {
+        sim_abort(SIM_RESULT_APP_ERROR, "SoftDevice BLE event queue overflow");
+    }
+    m_ble_evts[(m_ble_evt_head + m_ble_evt_count) % BLE_EVT_QUEUE_SIZE] = *p_buf;
+    m_ble_evt_count++;
+    dispatch_pend();
+}
+
+
+void sim_sd_sys_evt_raise(uint32_t sys_evt)
+{
+    if (m_sys_evt_count == SYS_EVT_QUEUE_SIZE)
+    {
+        sim_abort(SIM_RESULT_APP_ERROR, "SoftDevice SoC event queue overflow");
+    }
+    m_sys_evts[(m_sys_evt_head + m_sys_evt_count) % SYS_EVT_QUEUE_SIZE] = sys_evt;
+    m_sys_evt_count++;
+    dispatch_pend();
+}
+
+
+bool sim_sd_uuid_decode(const uint8_t * p_uuid128, ble_uuid_t * p_uuid)
+{
+    uint8_t i;
+
+    for (i = 0; i < m_vs_uuid_count; i++)
+    {
+        if ((memcmp(p_uuid128, m_vs_uuids[i].uuid128, 12) == 0) &&
+            (memcmp(&p_uuid128[14], &m_vs_uuids[i].uuid128[14], 2) == 0))
+        {
+            p_uuid->type = BLE_UUID_TYPE_VENDOR_BEGIN + i;
+            p_uuid->uuid = (uint16_t)(p_uuid128[12] | (p_uuid128[13] << 8));
+            return true;
+        }
+    }
+    p_uuid->type = BLE_UUID_TYPE_UNKNOWN;
+    p_uuid->uuid = 0;
+    return false;
+}
+
+
+bool sim_sd_uuid_encode(const ble_uuid_t * p_uuid, uint8_t * p_uuid128)
+{
+    uint8_t index = p_uuid->type - BLE_UUID_TYPE_VENDOR_BEGIN;
+
+    if ((p_uuid->type < BLE_UUID_TYPE_VENDOR_BEGIN) || (index >= m_vs_uuid_count))
+    {
+        return false;
+    }
+    memcpy(p_uuid128, m_vs_uuids[index].uuid128, 16);
+    p_uuid128[12] = (uint8_t)(p_uuid->uuid & 0xFF);
+    p_uuid128[13] = (uint8_t)(p_uuid->uuid >> 8);
+    return true;
+}
+
+
+/**@brief Function for completing a flash operation.
+ */
+static void flash_op_done(void * p_context, uint32_t arg)
+{
+    UNUSED_PARAMETER(p_context);
+    UNUSED_PARAMETER(arg);
+
+    m_flash_busy = false;
+    m_flash_apply(mp_flash_context);
+    sim_sd_sys_evt_raise(NRF_EVT_FLASH_OPERATION_SUCCESS);
+}
+
+
+uint32_t sim_sd_flash_op(uint32_t duration_us, void (* apply)(void * p_context), void * p_context)
+{
+    uint64_t start;
+
+    if (m_flash_busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (sim_config_get()->replay)
+    {
+        // The completion event comes from the trace.
+        apply(p_context);
+        return NRF_SUCCESS;
+    }
+    m_flash_busy     = true;
+    m_flash_apply    = apply;
+    mp_flash_context = p_context;
+
+    // Flash operations run in radio idle time and hold the radio while they run.
+    start = sim_radio_flash_reserve(duration_us);
+    sim_log("flash: %u us operation from %.3f ms", duration_us, (double)start / 1000.0);
+    (void)sim_schedule(start + duration_us, flash_op_done, NULL, 0);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t softdevice_handler_init(nrf_clock_lfclksrc_t           clock_source,
+                                 void *                         p_ble_evt_buffer,
+                                 uint16_t                       ble_evt_buffer_size,
+                                 softdevice_evt_schedule_func_t evt_schedule_func)
+{
+    UNUSED_PARAMETER(clock_source);
+    UNUSED_PARAMETER(p_ble_evt_buffer);
+    UNUSED_PARAMETER(ble_evt_buffer_size);
+
+    if (evt_schedule_func != NULL)
+    {
+        // The application does not use the scheduler, so neither does the simulation.
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t softdevice_handler_sd_disable(void)
+{
+    m_enabled = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler)
+{
+    if (ble_evt_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    m_ble_evt_handler = ble_evt_handler;
+    return NRF_SUCCESS;
+}
+
+
+ble_evt_handler_t sim_sd_ble_evt_handler_get(void)
+{
+    return m_ble_evt_handler;
+}
+
+
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler)
+{
+    if (sys_evt_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    m_sys_evt_handler = sys_evt_handler;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_enable(ble_enable_params_t * p_ble_enable_params)
+{
+    if (p_ble_enable_params == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (m_enabled)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    m_enabled = true;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * const p_vs_uuid, uint8_t * const p_uuid_type)
+{
+    uint8_t i;
+
+    if ((p_vs_uuid == NULL) || (p_uuid_type == NULL))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    for (i = 0; i < m_vs_uuid_count; i++)
+    {
+        if (memcmp(p_vs_uuid->uuid128, m_vs_uuids[i].uuid128, 16) == 0)
+        {
+            *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN + i;
+            return NRF_SUCCESS;
+        }
+    }
+    if (m_vs_uuid_count == VS_UUID_COUNT)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_vs_uuids[m_vs_uuid_count] = *p_vs_uuid;
+    *p_uuid_type                = BLE_UUID_TYPE_VENDOR_BEGIN + m_vs_uuid_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_tx_buffer_count_get(uint8_t * p_count)
+{
+    if (p_count == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    *p_count = sim_config_get()->tx_buffers;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_rand_application_vector_get(uint8_t * p_buff, uint8_t length)
+{
+    uint8_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        p_buff[i] = (uint8_t)sim_rand();
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_SystemReset(void)
+{
+    sim_abort(SIM_RESULT_RESET, "system reset requested");
+}
+
+/** @}
+ *  @endcond
+ */
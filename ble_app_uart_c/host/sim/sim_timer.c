@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "app_timer.h"
+#include "nrf_error.h"
+#include "nordic_common.h"
+
+#define MAX_TIMERS          32                   /**< Timers the simulation can hold, whatever the application asks for. */
+#define RTC_COUNTER_MASK    0x00FFFFFF           /**< RTC1 has a 24-bit counter. */
+
+/**@brief Application timer. */
+typedef struct
+{
+    app_timer_timeout_handler_t handler;
+    app_timer_mode_t            mode;
+    bool                        running;
+    uint64_t                    expiry_tick;     /**< Tick of the next expiry. */
+    uint32_t                    period;          /**< Ticks between expiries of a repeated timer. */
+    void                      * p_context;
+    uint32_t                    evt_id;          /**< Simulation event of the next expiry. */
+} timer_node_t;
+
+static timer_node_t m_timers[MAX_TIMERS];
+static uint8_t      m_max_timers;
+static uint8_t      m_timer_count;
+static uint32_t     m_prescaler;
+static bool         m_initialized;
+
+
+uint64_t sim_timer_ticks_to_us(uint32_t ticks)
+{
+    return ((uint64_t)ticks * (m_prescaler + 1) * 1000000 + APP_TIMER_CLOCK_FREQ - 1) / APP_TIMER_CLOCK_FREQ;
+}
+
+
+/**@brief Function for getting the current tick, counting from the start of the run without wrapping.
+ */
+static uint64_t tick_now(void)
+{
+    return sim_now() * APP_TIMER_CLOCK_FREQ / ((uint64_t)(m_prescaler + 1) * 1000000);
+}
+
+
+static uint64_t tick_to_time(uint64_t tick)
+{
+    return (tick * (m_prescaler + 1) * 1000000 + APP_TIMER_CLOCK_FREQ - 1) / APP_TIMER_CLOCK_FREQ;
+}
+
+
+static void timer_expire(void * p_context, uint32_t timer_id)
+{
+    timer_node_t * p_timer = &m_timers[timer_id];
+    uint64_t       start   = sim_prof_start();
+
+    UNUSED_PARAMETER(p_context);
+
+    if (p_timer->mode == APP_TIMER_MODE_REPEATED)
+    {
+        p_timer->expiry_tick += p_timer->period;
+        p_timer->evt_id       = sim_schedule(tick_to_time(p_timer->expiry_tick), timer_expire, NULL, timer_id);
+    }
+    else
+    {
+        p_timer->running = false;
+    }
+    p_timer->handler(p_timer->p_context);
+    sim_prof_end(SIM_PROF_TIMER, timer_id, start);
+}
+
+
+uint32_t app_timer_init(uint32_t                      prescaler,
+                        uint8_t                       max_timers,
+                        uint8_t                       op_queues_size,
+                        void *                        p_buffer,
+                        app_timer_evt_schedule_func_t evt_schedule_func)
+{
+    UNUSED_PARAMETER(op_queues_size);
+
+    if ((p_buffer == NULL) || (max_timers > MAX_TIMERS))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (evt_schedule_func != NULL)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    memset(m_timers, 0, sizeof(m_timers));
+    m_prescaler   = prescaler;
+    m_max_timers  = max_timers;
+    m_timer_count = 0;
+    m_initialized = true;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_create(app_timer_id_t *            p_timer_id,
+                          app_timer_mode_t            mode,
+                          app_timer_timeout_handler_t timeout_handler)
+{
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_timer_id == NULL) || (timeout_handler == NULL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_timer_count == m_max_timers)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    m_timers[m_timer_count].handler = timeout_handler;
+    m_timers[m_timer_count].mode    = mode;
+    *p_timer_id                     = m_timer_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    timer_node_t * p_timer;
+
+    if (timer_id >= m_timer_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if ((timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS) || (timeout_ticks > RTC_COUNTER_MASK))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_timer = &m_timers[timer_id];
+    if (p_timer->running)
+    {
+        // Starting a running timer is ignored, as by the SDK module.
+        return NRF_SUCCESS;
+    }
+    p_timer->running     = true;
+    p_timer->period      = timeout_ticks;
+    p_timer->p_context   = p_context;
+    p_timer->expiry_tick = tick_now() + timeout_ticks;
+    p_timer->evt_id      = sim_schedule(tick_to_time(p_timer->expiry_tick), timer_expire, NULL, timer_id);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_stop(app_timer_id_t timer_id)
+{
+    if (timer_id >= m_timer_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    sim_cancel(m_timers[timer_id].evt_id);
+    m_timers[timer_id].running = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_stop_all(void)
+{
+    app_timer_id_t i;
+
+    for (i = 0; i < m_timer_count; i++)
+    {
+        (void)app_timer_stop(i);
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_get(uint32_t * p_ticks)
+{
+    *p_ticks = (uint32_t)(tick_now() & RTC_COUNTER_MASK);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_diff_compute(uint32_t   ticks_to,
+                                    uint32_t   ticks_from,
+                                    uint32_t * p_ticks_diff)
+{
+    *p_ticks_diff = (ticks_to - ticks_from) & RTC_COUNTER_MASK;
+    return NRF_SUCCESS;
+}
+
+/** @}
+ *  @endcond
+ */
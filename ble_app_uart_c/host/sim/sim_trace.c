@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "evt_trace.h"
+#include "app_util.h"
+#include "nordic_common.h"
+
+#define TRACE_TICK_HZ       32768                /**< Timestamp rate of recorded traces, as app_timer with prescaler 0. */
+#define REC_DELTA_MAX       0xFFFF               /**< Longest gap a record header holds. */
+
+/**@brief Trace in memory: header and records, as in the RAM buffer of the evt_trace module. */
+typedef struct
+{
+    evt_trace_header_t header;
+    uint8_t          * p_records;
+    uint32_t           size;                     /**< Room for records. */
+} trace_t;
+
+static trace_t  m_record;                        /**< Trace being recorded. */
+static bool     m_recording;
+static uint64_t m_rec_ticks;                     /**< Time of the last recorded record. */
+static uint64_t m_byte_ticks;                    /**< Time of the last recorded UART byte. */
+static uint32_t m_uart_rec;                      /**< Offset of the last record if it holds UART bytes. */
+static bool     m_uart_open;
+
+static trace_t  m_replay;                        /**< Trace being replayed. */
+static uint32_t m_replay_pos;                    /**< Offset of the next record to replay. */
+static uint64_t m_replay_ticks;                  /**< Time of the last replayed record. */
+
+
+static uint64_t ticks_now(void)
+{
+    return sim_now() * TRACE_TICK_HZ / 1000000;
+}
+
+
+static uint8_t * record_alloc(evt_trace_rec_type_t type, uint16_t len)
+{
+    uint64_t  now   = ticks_now();
+    uint64_t  delta = now - m_rec_ticks;
+    uint32_t  need  = EVT_TRACE_REC_HDR_SIZE + len + EVT_TRACE_REC_HDR_SIZE + sizeof(uint32_t);
+    uint8_t * p_rec;
+
+    if ((m_record.header.length + need) > m_record.size)
+    {
+        uint32_t  size      = MAX(m_record.size * 2, 65536);
+        uint8_t * p_records = realloc(m_record.p_records, size);
+
+        if (p_records == NULL)
+        {
+            m_record.header.dropped++;
+            return NULL;
+        }
+        m_record.p_records = p_records;
+        m_record.size      = size;
+    }
+
+    p_rec = &m_record.p_records[m_record.header.length];
+    while (delta > REC_DELTA_MAX)
+    {
+        uint32_t gap = (uint32_t)MIN(delta, UINT32_MAX);
+
+        p_rec[0] = EVT_TRACE_REC_TIME;
+        UNUSED_VARIABLE(uint16_encode(0, &p_rec[1]));
+        UNUSED_VARIABLE(uint16_encode(sizeof(uint32_t), &p_rec[3]));
+        UNUSED_VARIABLE(uint32_encode(gap, &p_rec[EVT_TRACE_REC_HDR_SIZE]));
+        p_rec                   += EVT_TRACE_REC_HDR_SIZE + sizeof(uint32_t);
+        m_record.header.length  += EVT_TRACE_REC_HDR_SIZE + sizeof(uint32_t);
+        delta                   -= gap;
+    }
+    p_rec[0] = (uint8_t)type;
+    UNUSED_VARIABLE(uint16_encode((uint16_t)delta, &p_rec[1]));
+    UNUSED_VARIABLE(uint16_encode(len, &p_rec[3]));
+
+    m_record.header.length += EVT_TRACE_REC_HDR_SIZE + len;
+    m_rec_ticks             = now;
+    m_uart_open             = false;
+    return p_rec + EVT_TRACE_REC_HDR_SIZE;
+}
+
+
+void sim_trace_record_start(void)
+{
+    memset(&m_record, 0, sizeof(m_record));
+    m_record.header.magic   = EVT_TRACE_MAGIC;
+    m_record.header.version = EVT_TRACE_VERSION;
+    m_record.header.tick_hz = TRACE_TICK_HZ;
+    m_rec_ticks             = ticks_now();
+    m_recording             = true;
+}
+
+
+void sim_trace_on_ble_evt(const ble_evt_t * p_ble_evt)
+{
+    uint16_t  len;
+    uint8_t * p_rec;
+
+    if (!m_recording)
+    {
+        return;
+    }
+    len   = (uint16_t)MIN(sizeof(ble_evt_hdr_t) + p_ble_evt->header.evt_len, sizeof(sim_ble_evt_buf_t));
+    p_rec = record_alloc(EVT_TRACE_REC_BLE, len);
+    if (p_rec != NULL)
+    {
+        memcpy(p_rec, p_ble_evt, len);
+    }
+}
+
+
+void sim_trace_on_sys_evt(uint32_t sys_evt)
+{
+    uint8_t * p_rec;
+
+    if (!m_recording)
+    {
+        return;
+    }
+    p_rec = record_alloc(EVT_TRACE_REC_SYS, sizeof(uint32_t));
+    if (p_rec != NULL)
+    {
+        UNUSED_VARIABLE(uint32_encode(sys_evt, p_rec));
+    }
+}
+
+
+void sim_trace_on_uart_rx(uint8_t byte)
+{
+    uint8_t * p_rec;
+
+    if (!m_recording)
+    {
+        return;
+    }
+    if (m_uart_open && ((ticks_now() - m_byte_ticks) <= EVT_TRACE_UART_MERGE_TICKS) &&
+        ((m_record.header.length + 1) <= m_record.size))
+    {
+        p_rec = &m_record.p_records[m_uart_rec];
+        m_record.p_records[m_record.header.length++] = byte;
+        UNUSED_VARIABLE(uint16_encode(uint16_decode(&p_rec[3]) + 1, &p_rec[3]));
+        m_byte_ticks = ticks_now();
+        return;
+    }
+
+    p_rec = record_alloc(EVT_TRACE_REC_UART_RX, 1);
+    if (p_rec != NULL)
+    {
+        *p_rec       = byte;
+        m_uart_rec   = (uint32_t)(p_rec - EVT_TRACE_REC_HDR_SIZE - m_record.p_records);
+        m_uart_open  = true;
+        m_byte_ticks = ticks_now();
+    }
+}
+
+
+int sim_trace_save(const char * p_path)
+{
+    FILE * p_file = fopen(p_path, "wb");
+    bool   ok;
+
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        return -1;
+    }
+    ok = (fwrite(&m_record.header, sizeof(m_record.header), 1, p_file) == 1) &&
+         (fwrite(m_record.p_records, 1, m_record.header.length, p_file) == m_record.header.length);
+    ok = (fclose(p_file) == 0) && ok;
+    return ok ? 0 : -1;
+}
+
+
+int sim_trace_load(const char * p_path)
+{
+    FILE * p_file = fopen(p_path, "rb");
+    bool   ok;
+
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        return -1;
+    }
+    memset(&m_replay, 0, sizeof(m_replay));
+    ok = (fread(&m_replay.header, sizeof(m_replay.header), 1, p_file) == 1) &&
+         (m_replay.header.magic == EVT_TRACE_MAGIC) && (m_replay.header.version == EVT_TRACE_VERSION) &&
+         (m_replay.header.tick_hz != 0);
+    if (ok)
+    {
+        m_replay.size      = m_replay.header.length;
+        m_replay.p_records = malloc(MAX(m_replay.size, 1));
+        ok = (m_replay.p_records != NULL) &&
+             (fread(m_replay.p_records, 1, m_replay.size, p_file) == m_replay.size);
+    }
+    fclose(p_file);
+    if (!ok)
+    {
+        fprintf(stderr, "%s: not an event trace\n", p_path);
+        return -1;
+    }
+    return 0;
+}
+
+
+const evt_trace_header_t * sim_trace_header_get(void)
+{
+    return &m_replay.header;
+}
+
+
+/**@brief Function for finding the time of the next record to replay.
+ *
+ * @return false if there are no more records.
+ */
+static bool replay_next_time(uint64_t * p_time_us)
+{
+    uint64_t ticks = m_replay_ticks;
+    uint32_t pos   = m_replay_pos;
+
+    while ((pos + EVT_TRACE_REC_HDR_SIZE) <= m_replay.size)
+    {
+        const uint8_t * p_rec = &m_replay.p_records[pos];
+        uint16_t        len   = uint16_decode(&p_rec[3]);
+
+        ticks += uint16_decode(&p_rec[1]);
+        if (p_rec[0] != EVT_TRACE_REC_TIME)
+        {
+            *p_time_us = ticks * 1000000 / m_replay.header.tick_hz;
+            return true;
+        }
+        if (len == sizeof(uint32_t))
+        {
+            ticks += uint32_decode(&p_rec[EVT_TRACE_REC_HDR_SIZE]);
+        }
+        pos += EVT_TRACE_REC_HDR_SIZE + len;
+    }
+    return false;
+}
+
+
+/**@brief Function for replaying the records that are due.
+ */
+static void replay_step(void * p_context, uint32_t arg)
+{
+    uint64_t next;
+
+    UNUSED_PARAMETER(p_context);
+    UNUSED_PARAMETER(arg);
+
+    while ((m_replay_pos + EVT_TRACE_REC_HDR_SIZE) <= m_replay.size)
+    {
+        const uint8_t * p_rec   = &m_replay.p_records[m_replay_pos];
+        const uint8_t * p_data  = &p_rec[EVT_TRACE_REC_HDR_SIZE];
+        uint16_t        len     = uint16_decode(&p_rec[3]);
+        uint64_t        ticks   = m_replay_ticks + uint16_decode(&p_rec[1]);
+
+        if ((p_rec[0] != EVT_TRACE_REC_TIME) && ((ticks * 1000000 / m_replay.header.tick_hz) > sim_now()))
+        {
+            break;
+        }
+        if ((m_replay_pos + EVT_TRACE_REC_HDR_SIZE + len) > m_replay.size)
+        {
+            m_replay_pos = m_replay.size;
+            break;
+        }
+        m_replay_ticks  = ticks;
+        m_replay_pos   += EVT_TRACE_REC_HDR_SIZE + len;
+
+        switch (p_rec[0])
+        {
+            case EVT_TRACE_REC_TIME:
+                if (len == sizeof(uint32_t))
+                {
+                    m_replay_ticks += uint32_decode(p_data);
+                }
+                break;
+
+            case EVT_TRACE_REC_BLE:
+            {
+                sim_ble_evt_buf_t buf;
+
+                memset(&buf, 0, sizeof(buf));
+                memcpy(&buf, p_data, MIN(len, sizeof(buf)));
+                sim_radio_replay_evt(&buf.evt);
+                sim_sd_ble_evt_raise(&buf);
+                break;
+            }
+
+            case EVT_TRACE_REC_SYS:
+                if (len == sizeof(uint32_t))
+                {
+                    sim_sd_sys_evt_raise(uint32_decode(p_data));
+                }
+                break;
+
+            case EVT_TRACE_REC_UART_RX:
+                sim_uart_host_write(p_data, len);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (replay_next_time(&next))
+    {
+        (void)sim_schedule(MAX(next, sim_now()), replay_step, NULL, 0);
+    }
+}
+
+
+uint64_t sim_trace_replay_start(void)
+{
+    uint64_t end = 0;
+    uint64_t next;
+
+    m_replay_pos   = 0;
+    m_replay_ticks = 0;
+
+    // Find the time of the last record.
+    while (replay_next_time(&next))
+    {
+        const uint8_t * p_rec = &m_replay.p_records[m_replay_pos];
+
+        end             = next;
+        m_replay_ticks += uint16_decode(&p_rec[1]);
+        if ((p_rec[0] == EVT_TRACE_REC_TIME) && (uint16_decode(&p_rec[3]) == sizeof(uint32_t)))
+        {
+            m_replay_ticks += uint32_decode(&p_rec[EVT_TRACE_REC_HDR_SIZE]);
+        }
+        m_replay_pos += EVT_TRACE_REC_HDR_SIZE + uint16_decode(&p_rec[3]);
+    }
+
+    m_replay_pos   = 0;
+    m_replay_ticks = 0;
+    if (replay_next_time(&next))
+    {
+        (void)sim_schedule(next, replay_step, NULL, 0);
+    }
+    return end;
+}
+
+/** @}
+ *  @endcond
+ */
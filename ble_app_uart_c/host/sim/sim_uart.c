@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "app_uart.h"
+#include "app_util.h"
+#include "nrf.h"
+#include "nrf_error.h"
+#include "nordic_common.h"
+
+#define BITS_PER_BYTE          10                /**< Start bit, 8 data bits and stop bit. */
+#define HOST_QUEUE_SIZE        (64 * 1024)       /**< Bytes the host can have waiting to be sent. */
+#define PUT_SPIN_LIMIT         1000000           /**< Failed app_uart_put() calls in a row, at one point in time, that mean the caller will spin forever. */
+#define ERRORSRC_OVERRUN       0x01              /**< OVERRUN bit of the UART ERRORSRC register. */
+
+/**@brief Byte FIFO with the semantics of app_fifo. */
+typedef struct
+{
+    uint8_t * p_buf;
+    uint32_t  size;
+    uint32_t  read;
+    uint32_t  write;
+} fifo_t;
+
+static app_uart_event_handler_t m_evt_handler;
+static bool                     m_open;
+static uint32_t                 m_baud;             /**< Bits per second. */
+static fifo_t                   m_rx_fifo;
+static fifo_t                   m_tx_fifo;
+static bool                     m_tx_active;        /**< A byte is being sent to the host. */
+
+static uint8_t                  m_host_queue[HOST_QUEUE_SIZE];
+static uint32_t                 m_host_head;
+static uint32_t                 m_host_count;
+static bool                     m_host_active;      /**< A byte is being sent from the host. */
+static bool                     m_rx_stopped;       /**< The receiver is stopped, so RTS tells the host to wait. */
+static uint64_t                 m_rx_stop_time;     /**< Time the receiver was stopped. */
+static uint32_t                 m_rx_errors;        /**< Bytes from the host still to be lost to a line error. */
+
+static uint32_t                 m_put_spins;        /**< Failed app_uart_put() calls in a row. */
+static uint64_t                 m_put_spin_time;    /**< Time of the first of them. */
+
+static sim_uart_stats_t         m_stats;
+
+
+static uint32_t fifo_length(const fifo_t * p_fifo)
+{
+    return p_fifo->write - p_fifo->read;
+}
+
+
+static bool fifo_put(fifo_t * p_fifo, uint8_t byte)
+{
+    if (fifo_length(p_fifo) == p_fifo->size)
+    {
+        return false;
+    }
+    p_fifo->p_buf[p_fifo->write++ % p_fifo->size] = byte;
+    return true;
+}
+
+
+static bool fifo_get(fifo_t * p_fifo, uint8_t * p_byte)
+{
+    if (fifo_length(p_fifo) == 0)
+    {
+        return false;
+    }
+    *p_byte = p_fifo->p_buf[p_fifo->read++ % p_fifo->size];
+    return true;
+}
+
+
+/**@brief Function for converting a BAUDRATE register value to bits per second.
+ */
+static uint32_t baud_decode(uint32_t baud_reg)
+{
+    static const struct
+    {
+        uint32_t reg;
+        uint32_t bps;
+    } rates[] =
+    {
+        {UART_BAUDRATE_BAUDRATE_Baud1200,   1200},
+        {UART_BAUDRATE_BAUDRATE_Baud2400,   2400},
+        {UART_BAUDRATE_BAUDRATE_Baud4800,   4800},
+        {UART_BAUDRATE_BAUDRATE_Baud9600,   9600},
+        {UART_BAUDRATE_BAUDRATE_Baud14400,  14400},
+        {UART_BAUDRATE_BAUDRATE_Baud19200,  19200},
+        {UART_BAUDRATE_BAUDRATE_Baud28800,  28800},
+        {UART_BAUDRATE_BAUDRATE_Baud38400,  38400},
+        {UART_BAUDRATE_BAUDRATE_Baud57600,  57600},
+        {UART_BAUDRATE_BAUDRATE_Baud76800,  76800},
+        {UART_BAUDRATE_BAUDRATE_Baud115200, 115200},
+        {UART_BAUDRATE_BAUDRATE_Baud230400, 230400},
+        {UART_BAUDRATE_BAUDRATE_Baud250000, 250000},
+        {UART_BAUDRATE_BAUDRATE_Baud460800, 460800},
+        {UART_BAUDRATE_BAUDRATE_Baud921600, 921600},
+        {UART_BAUDRATE_BAUDRATE_Baud1M,     1000000},
+    };
+    uint8_t i;
+
+    for (i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        if (rates[i].reg == baud_reg)
+        {
+            return rates[i].bps;
+        }
+    }
+    return 0;
+}
+
+
+/**@brief Function for getting the time one byte takes on the line.
+ */
+static void rx_byte_done(void * p_context, uint32_t arg);
+
+
+static uint64_t byte_time(void)
+{
+    return ((uint64_t)BITS_PER_BYTE * 1000000 + m_baud - 1) / m_baud;
+}
+
+
+static void evt_send(app_uart_evt_type_t evt_type, uint32_t data)
+{
+    app_uart_evt_t evt;
+    uint64_t       start = sim_prof_start();
+
+    evt.evt_type        = evt_type;
+    evt.data.error_code = data;
+    m_evt_handler(&evt);
+    sim_prof_end(SIM_PROF_UART, evt_type, start);
+}
+
+
+/**@brief Function for starting the next byte from the host, if its CTS input allows it.
+ */
+static void host_send_next(void)
+{
+    if (!m_host_active && (m_host_count != 0) && (m_baud != 0) && !m_rx_stopped)
+    {
+        m_host_active = true;
+        (void)sim_schedule(sim_now() + byte_time(), rx_byte_done, NULL, 0);
+    }
+}
+
+
+/**@brief Function for handling the end of a byte sent by the host, as the RXDRDY interrupt does.
+ *
+ * @details A byte the host started before RTS was deasserted is still received.
+ */
+static void rx_byte_done(void * p_context, uint32_t arg)
+{
+    uint8_t byte;
+
+    UNUSED_PARAMETER(p_context);
+    UNUSED_PARAMETER(arg);
+
+    byte          = m_host_queue[m_host_head];
+    m_host_head   = (m_host_head + 1) % HOST_QUEUE_SIZE;
+    m_host_count--;
+    m_host_active = false;
+    m_stats.host_tx_bytes++;
+    if (sim_hooks_get()->host_tx != NULL)
+    {
+        sim_hooks_get()->host_tx(byte);
+    }
+
+    host_send_next();
+
+    if (!m_open)
+    {
+        return;
+    }
+    if (m_rx_errors != 0)
+    {
+        // The byte is lost, and the UART reports an overrun in ERRORSRC.
+        m_rx_errors--;
+        m_stats.rx_errors++;
+        evt_send(APP_UART_COMMUNICATION_ERROR, ERRORSRC_OVERRUN);
+        return;
+    }
+    if (!fifo_put(&m_rx_fifo, byte))
+    {
+        m_stats.rx_overflows++;
+        evt_send(APP_UART_FIFO_ERROR, NRF_ERROR_NO_MEM);
+    }
+    else
+    {
+        if (fifo_length(&m_rx_fifo) > m_stats.rx_fifo_high_water)
+        {
+            m_stats.rx_fifo_high_water = (uint16_t)fifo_length(&m_rx_fifo);
+        }
+        // Only the first byte put in the FIFO is notified.
+        if (fifo_length(&m_rx_fifo) == 1)
+        {
+            evt_send(APP_UART_DATA_READY, 0);
+        }
+    }
+}
+
+
+/**@brief Function for handling the end of a byte sent to the host, as the TXDRDY interrupt does.
+ */
+static void tx_byte_done(void * p_context, uint32_t byte)
+{
+    uint8_t next;
+
+    UNUSED_PARAMETER(p_context);
+
+    m_stats.host_rx_bytes++;
+    if (sim_config_get()->console)
+    {
+        putchar((int)byte);
+    }
+    if (sim_hooks_get()->host_rx != NULL)
+    {
+        sim_hooks_get()->host_rx((uint8_t)byte);
+    }
+
+    if (fifo_get(&m_tx_fifo, &next))
+    {
+        (void)sim_schedule(sim_now() + byte_time(), tx_byte_done, NULL, next);
+    }
+    else
+    {
+        m_tx_active = false;
+        evt_send(APP_UART_TX_EMPTY, 0);
+    }
+}
+
+
+void sim_uart_rx_error(uint32_t count)
+{
+    m_rx_errors += count;
+}
+
+
+void sim_uart_host_write(const uint8_t * p_data, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; (i < len) && (m_host_count < HOST_QUEUE_SIZE); i++)
+    {
+        m_host_queue[(m_host_head + m_host_count) % HOST_QUEUE_SIZE] = p_data[i];
+        m_host_count++;
+    }
+    host_send_next();
+}
+
+
+void sim_uart_tasks_process(void)
+{
+    if (NRF_UART0->TASKS_STOPRX != 0)
+    {
+        NRF_UART0->TASKS_STOPRX = 0;
+        if (!m_rx_stopped)
+        {
+            m_rx_stopped   = true;
+            m_rx_stop_time = sim_now();
+            m_stats.rts_stops++;
+        }
+    }
+    if (NRF_UART0->TASKS_STARTRX != 0)
+    {
+        NRF_UART0->TASKS_STARTRX = 0;
+        if (m_rx_stopped)
+        {
+            m_rx_stopped           = false;
+            m_stats.rts_stopped_us += sim_now() - m_rx_stop_time;
+            host_send_next();
+        }
+    }
+}
+
+
+uint32_t sim_uart_host_pending(void)
+{
+    return m_host_count;
+}
+
+
+const sim_uart_stats_t * sim_uart_stats_get(void)
+{
+    return &m_stats;
+}
+
+
+uint32_t app_uart_init(const app_uart_comm_params_t * p_comm_params,
+                       app_uart_buffers_t *           p_buffers,
+                       app_uart_event_handler_t       event_handler,
+                       app_irq_priority_t             irq_priority)
+{
+    UNUSED_PARAMETER(irq_priority);
+
+    if ((p_buffers == NULL) || (event_handler == NULL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (!IS_POWER_OF_TWO(p_buffers->rx_buf_size) || !IS_POWER_OF_TWO(p_buffers->tx_buf_size))
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    m_baud = (sim_config_get()->baud != 0) ? sim_config_get()->baud : baud_decode(p_comm_params->baud_rate);
+    if (m_baud == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    NRF_UART0->BAUDRATE = p_comm_params->baud_rate;
+
+    m_rx_fifo.p_buf = p_buffers->rx_buf;
+    m_rx_fifo.size  = p_buffers->rx_buf_size;
+    m_rx_fifo.read  = m_rx_fifo.write = 0;
+    m_tx_fifo.p_buf = p_buffers->tx_buf;
+    m_tx_fifo.size  = p_buffers->tx_buf_size;
+    m_tx_fifo.read  = m_tx_fifo.write = 0;
+    m_evt_handler   = event_handler;
+    m_open          = true;
+    m_rx_stopped    = false;
+
+    // Bytes the host queued before the UART was up go out now.
+    sim_uart_host_write(NULL, 0);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_uart_get(uint8_t * p_byte)
+{
+    if (!fifo_get(&m_rx_fifo, p_byte))
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    sim_trace_on_uart_rx(*p_byte);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_uart_put(uint8_t byte)
+{
+    if (!m_open)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (!m_tx_active)
+    {
+        m_tx_active = true;
+        m_put_spins = 0;
+        (void)sim_schedule(sim_now() + byte_time(), tx_byte_done, NULL, byte);
+        return NRF_SUCCESS;
+    }
+    if (fifo_put(&m_tx_fifo, byte))
+    {
+        m_put_spins = 0;
+        if (fifo_length(&m_tx_fifo) > m_stats.tx_fifo_high_water)
+        {
+            m_stats.tx_fifo_high_water = (uint16_t)fifo_length(&m_tx_fifo);
+        }
+        return NRF_SUCCESS;
+    }
+
+    // Only another interrupt can make room, so a caller that keeps retrying without time moving
+    // on is spinning in interrupt context and will never get out.
+    m_stats.put_retries++;
+    if ((m_put_spins == 0) || (m_put_spin_time != sim_now()))
+    {
+        m_put_spins     = 0;
+        m_put_spin_time = sim_now();
+    }
+    if (++m_put_spins >= PUT_SPIN_LIMIT)
+    {
+        sim_abort(SIM_RESULT_DEADLOCK, "app_uart_put() spinning on a full TX FIFO");
+    }
+    return NRF_ERROR_NO_MEM;
+}
+
+
+uint32_t app_uart_flush(void)
+{
+    m_rx_fifo.read = m_rx_fifo.write;
+    m_tx_fifo.read = m_tx_fifo.write;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_uart_close(void)
+{
+    m_open = false;
+    return NRF_SUCCESS;
+}
+
+/** @}
+ *  @endcond
+ */
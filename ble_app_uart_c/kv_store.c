@@ -0,0 +1,757 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kv_store.h"
+#include "flash_sched.h"
+#include "pstorage.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+#include "app_util.h"
+#include "app_trace.h"
+
+#define LOG                    app_trace_log         /**< Debug logger macro that will be used in this file to do logging of important information over UART. */
+
+#define PAGE_MAGIC             0x4B56                /**< Marks a page header, the generation is in the upper half word. */
+#define PAGE_HDR_SIZE          4                     /**< Size of the page header. */
+#define REC_HDR_SIZE           4                     /**< Size of the record header. */
+#define PAGE_SIZE_MIN          1024                  /**< Smallest flash page of the nRF51 series. */
+#define FLASH_ERASED_WORD      0xFFFFFFFF            /**< Content of an erased flash word. */
+#define LEN_DELETED            0xFF                  /**< Record length marking a deleted key. */
+#define PAGE_NONE              0xFF                  /**< Index entry of a key without a value. */
+#define VALUE_WORDS            CEIL_DIV(KV_STORE_MAX_VALUE_LEN, sizeof(uint32_t))
+
+/**@brief Size in flash of a record with a value of the given length. */
+#define REC_SIZE(LEN)          (REC_HDR_SIZE + (((LEN) + 3) & ~3))
+
+STATIC_ASSERT(KV_STORE_PAGES >= 2);
+STATIC_ASSERT(KV_STORE_MAX_KEYS < PAGE_NONE);
+STATIC_ASSERT(KV_STORE_MAX_VALUE_LEN < LEN_DELETED);
+// Compaction copies every current value, plus the old value of the key being written, into one
+// page.
+STATIC_ASSERT((KV_STORE_MAX_KEYS + 1) * REC_SIZE(KV_STORE_MAX_VALUE_LEN) <= (PAGE_SIZE_MIN - PAGE_HDR_SIZE));
+
+/**@brief Record, laid out as in flash. */
+typedef struct
+{
+    uint32_t header;                                 /**< Key, length and CRC. */
+    uint32_t value[VALUE_WORDS];                     /**< Value, padded to a whole word. */
+} kv_record_t;
+
+/**@brief Location of the newest record of a key. */
+typedef struct
+{
+    uint8_t  page;                                   /**< Page of the record, PAGE_NONE if none. */
+    uint8_t  len;                                    /**< Length of the value. */
+    uint16_t offset;                                 /**< Offset of the record in the page. */
+} kv_index_t;
+
+/**@brief Flash operation in progress. */
+typedef enum
+{
+    OP_NONE,                                         /**< Nothing in progress. */
+    OP_FORMAT,                                       /**< Erasing a page before first use. */
+    OP_HEADER,                                       /**< Writing a page header. */
+    OP_COPY,                                         /**< Copying a record out of the page being compacted. */
+    OP_ERASE,                                        /**< Erasing the compacted page. */
+    OP_WRITE                                         /**< Writing a queued record. */
+} kv_op_t;
+
+static pstorage_handle_t      m_base_handle;                        /**< pstorage handle of the log. */
+static uint16_t               m_page_size;                          /**< Size of a flash page. */
+static kv_index_t             m_index[KV_STORE_MAX_KEYS];           /**< Newest record of each key. */
+static kv_record_t            m_queue[KV_STORE_QUEUE_SIZE];         /**< Records waiting to be written. */
+static uint8_t                m_queue_head;                         /**< Oldest queued record. */
+static uint8_t                m_queue_count;                        /**< Number of queued records. */
+static kv_record_t            m_copy;                               /**< Record being copied by compaction. */
+static uint8_t                m_copy_key;                           /**< Key of the record being copied. */
+static uint32_t               m_page_header;                        /**< Page header being written. */
+static uint8_t                m_active;                             /**< Page being written. */
+static uint16_t               m_generation;                         /**< Generation of the page being written. */
+static uint16_t               m_wr_offset;                          /**< Offset of the next record in the page being written. */
+static bool                   m_header_needed;                      /**< Whether the page being written lacks its header. */
+static bool                   m_compacting;                         /**< Whether a page is being compacted. */
+static uint8_t                m_compact_page;                       /**< Page being compacted. */
+static uint8_t                m_format_next;                        /**< Next page to erase before first use. */
+static uint8_t                m_format_end;                         /**< Page after the last one to erase before first use. */
+static kv_op_t                m_op;                                 /**< Flash operation in progress. */
+static kv_store_evt_handler_t m_evt_handler;                        /**< Application event handler. */
+static kv_store_stats_t       m_stats;                              /**< Statistics. */
+
+static void kv_process(void);
+
+
+/**@brief Function for computing the CRC-16-CCITT of a buffer.
+ */
+static uint16_t crc16_compute(const uint8_t * p_data, uint32_t size, uint16_t crc)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        crc  = (uint16_t)((crc >> 8) | (crc << 8));
+        crc ^= p_data[i];
+        crc ^= (uint16_t)((crc & 0xFF) >> 4);
+        crc ^= (uint16_t)((crc << 8) << 4);
+        crc ^= (uint16_t)(((crc & 0xFF) << 4) << 1);
+    }
+    return crc;
+}
+
+
+/**@brief Function for building a record header.
+ */
+static uint32_t record_header(uint8_t key, uint8_t len, const uint8_t * p_value)
+{
+    uint8_t  key_len[2];
+    uint16_t crc;
+
+    key_len[0] = key;
+    key_len[1] = len;
+
+    crc = crc16_compute(key_len, sizeof(key_len), 0xFFFF);
+    if (len != LEN_DELETED)
+    {
+        crc = crc16_compute(p_value, len, crc);
+    }
+    return (uint32_t)key | ((uint32_t)len << 8) | ((uint32_t)crc << 16);
+}
+
+
+/**@brief Function for getting the size in flash of a record from its header.
+ */
+static uint16_t record_size(uint32_t header)
+{
+    uint8_t len = (uint8_t)(header >> 8);
+
+    return REC_SIZE((len == LEN_DELETED) ? 0 : len);
+}
+
+
+/**@brief Function for getting the index of the page after the given one.
+ */
+static uint8_t page_next(uint8_t page)
+{
+    return (uint8_t)((page + 1) % KV_STORE_PAGES);
+}
+
+
+/**@brief Function for reading from a page.
+ */
+static uint32_t page_load(uint8_t page, uint16_t offset, void * p_dest, uint16_t size)
+{
+    pstorage_handle_t block;
+    uint32_t          err_code;
+
+    err_code = pstorage_block_identifier_get(&m_base_handle, page, &block);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    return pstorage_load((uint8_t *)p_dest, &block, size, offset);
+}
+
+
+/**@brief Function for checking whether a page is fully erased.
+ */
+static bool page_is_erased(uint8_t page)
+{
+    uint32_t words[8];
+    uint16_t offset;
+    uint8_t  i;
+
+    for (offset = 0; offset < m_page_size; offset += sizeof(words))
+    {
+        if (page_load(page, offset, words, sizeof(words)) != NRF_SUCCESS)
+        {
+            return false;
+        }
+        for (i = 0; i < (sizeof(words) / sizeof(words[0])); i++)
+        {
+            if (words[i] != FLASH_ERASED_WORD)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/**@brief Function for applying the records of a page to the index.
+ *
+ * @return Offset after the last good record.
+ */
+static uint16_t page_replay(uint8_t page)
+{
+    uint16_t offset = PAGE_HDR_SIZE;
+    uint16_t size;
+    uint8_t  key;
+    uint8_t  len;
+
+    while ((offset + REC_HDR_SIZE) <= m_page_size)
+    {
+        if (page_load(page, offset, &m_copy.header, REC_HDR_SIZE) != NRF_SUCCESS)
+        {
+            break;
+        }
+        if (m_copy.header == FLASH_ERASED_WORD)
+        {
+            return offset;
+        }
+
+        key  = (uint8_t)m_copy.header;
+        len  = (uint8_t)(m_copy.header >> 8);
+        size = record_size(m_copy.header);
+
+        if ((key >= KV_STORE_MAX_KEYS)                                   ||
+            ((len > KV_STORE_MAX_VALUE_LEN) && (len != LEN_DELETED))     ||
+            ((offset + size) > m_page_size)                              ||
+            ((size > REC_HDR_SIZE) &&
+             (page_load(page, offset + REC_HDR_SIZE, m_copy.value, size - REC_HDR_SIZE) != NRF_SUCCESS)) ||
+            (record_header(key, len, (uint8_t *)m_copy.value) != m_copy.header))
+        {
+            // Interrupted write. Nothing after it in this page can be trusted.
+            m_stats.bad_records++;
+            break;
+        }
+
+        if (len == LEN_DELETED)
+        {
+            m_index[key].page = PAGE_NONE;
+        }
+        else
+        {
+            m_index[key].page   = page;
+            m_index[key].len    = len;
+            m_index[key].offset = offset;
+        }
+        offset += size;
+    }
+
+    return m_page_size;
+}
+
+
+/**@brief Function for finding the newest page and rebuilding the index.
+ */
+static void log_recover(void)
+{
+    uint32_t header;
+    uint16_t generation;
+    uint16_t end;
+    bool     found = false;
+    uint8_t  page;
+    uint8_t  i;
+
+    for (page = 0; page < KV_STORE_PAGES; page++)
+    {
+        if ((page_load(page, 0, &header, sizeof(header)) != NRF_SUCCESS) ||
+            ((header & 0xFFFF) != PAGE_MAGIC))
+        {
+            continue;
+        }
+        generation = (uint16_t)(header >> 16);
+        if (!found || ((int16_t)(generation - m_generation) > 0))
+        {
+            m_active     = page;
+            m_generation = generation;
+            found        = true;
+        }
+    }
+
+    if (!found)
+    {
+        // Blank or foreign flash. Erase all pages and start over.
+        m_active        = 0;
+        m_generation    = 0;
+        m_wr_offset     = PAGE_HDR_SIZE;
+        m_header_needed = true;
+        m_format_next   = 0;
+        m_format_end    = KV_STORE_PAGES;
+        return;
+    }
+
+    // Pages follow the newest one from oldest to newest.
+    for (i = 1; i <= KV_STORE_PAGES; i++)
+    {
+        page = (uint8_t)((m_active + i) % KV_STORE_PAGES);
+        if ((page_load(page, 0, &header, sizeof(header)) != NRF_SUCCESS) ||
+            ((header & 0xFFFF) != PAGE_MAGIC))
+        {
+            continue;
+        }
+        end = page_replay(page);
+        if (page == m_active)
+        {
+            m_wr_offset = end;
+        }
+    }
+
+    // The page after the newest one is left erased. If it is not, compaction was interrupted.
+    if (!page_is_erased(page_next(m_active)))
+    {
+        m_compacting   = true;
+        m_compact_page = page_next(m_active);
+    }
+}
+
+
+/**@brief Function for moving on to the next page and compacting the oldest one.
+ */
+static void page_switch(void)
+{
+    m_active        = page_next(m_active);
+    m_generation++;
+    m_wr_offset     = PAGE_HDR_SIZE;
+    m_header_needed = true;
+    m_compacting    = true;
+    m_compact_page  = page_next(m_active);
+}
+
+
+/**@brief Function for finding a key whose newest record is in the page being compacted.
+ */
+static bool compact_key_find(uint8_t * p_key)
+{
+    uint8_t key;
+
+    for (key = 0; key < KV_STORE_MAX_KEYS; key++)
+    {
+        if (m_index[key].page == m_compact_page)
+        {
+            *p_key = key;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**@brief Function for passing an event to the application.
+ */
+static void evt_send(kv_store_evt_type_t evt_type, uint8_t key, uint32_t result)
+{
+    kv_store_evt_t evt;
+
+    if (m_evt_handler == NULL)
+    {
+        return;
+    }
+
+    evt.evt_type = evt_type;
+    evt.key      = key;
+    evt.result   = result;
+    m_evt_handler(&evt);
+}
+
+
+/**@brief Function for handling flash scheduler completions for the log.
+ */
+static void flash_cb_handler(pstorage_handle_t * p_handle,
+                             uint8_t             op_code,
+                             uint32_t            result,
+                             uint8_t           * p_data,
+                             uint32_t            data_len)
+{
+    kv_record_t * p_record;
+    kv_op_t       op = m_op;
+    uint8_t       key;
+    uint8_t       len;
+
+    m_op = OP_NONE;
+
+    // A failed operation was not carried out by the SoftDevice and is retried as it was.
+    if (result != NRF_SUCCESS)
+    {
+        m_stats.flash_errors++;
+    }
+
+    switch (op)
+    {
+        case OP_FORMAT:
+            if (result == NRF_SUCCESS)
+            {
+                m_format_next++;
+                m_stats.page_erases++;
+            }
+            break;
+
+        case OP_HEADER:
+            if (result == NRF_SUCCESS)
+            {
+                m_header_needed = false;
+            }
+            break;
+
+        case OP_COPY:
+            if (result == NRF_SUCCESS)
+            {
+                m_index[m_copy_key].page   = m_active;
+                m_index[m_copy_key].offset = m_wr_offset;
+                m_wr_offset               += record_size(m_copy.header);
+                m_stats.copied++;
+            }
+            break;
+
+        case OP_ERASE:
+            if (result == NRF_SUCCESS)
+            {
+                m_compacting = false;
+                m_stats.page_erases++;
+                evt_send(KV_STORE_EVT_COMPACTED, 0, result);
+            }
+            break;
+
+        case OP_WRITE:
+            if (result != NRF_SUCCESS)
+            {
+                break;
+            }
+
+            p_record = &m_queue[m_queue_head];
+            key      = (uint8_t)p_record->header;
+            len      = (uint8_t)(p_record->header >> 8);
+
+            if (len == LEN_DELETED)
+            {
+                m_index[key].page = PAGE_NONE;
+            }
+            else
+            {
+                m_index[key].page   = m_active;
+                m_index[key].len    = len;
+                m_index[key].offset = m_wr_offset;
+            }
+            m_wr_offset += record_size(p_record->header);
+            m_stats.writes++;
+
+            m_queue_head = (uint8_t)((m_queue_head + 1) % KV_STORE_QUEUE_SIZE);
+            m_queue_count--;
+
+            evt_send(KV_STORE_EVT_WRITE_DONE, key, result);
+            break;
+
+        default:
+            break;
+    }
+
+    kv_process();
+}
+
+
+/**@brief Function for starting the next flash operation, if any.
+ */
+static void kv_process(void)
+{
+    pstorage_handle_t block;
+    kv_record_t     * p_record;
+    uint16_t          size;
+    uint8_t           key;
+    uint32_t          err_code;
+
+    while (m_op == OP_NONE)
+    {
+        if (m_format_next < m_format_end)
+        {
+            err_code = pstorage_block_identifier_get(&m_base_handle, m_format_next, &block);
+            if (err_code == NRF_SUCCESS)
+            {
+                err_code = flash_sched_clear(&block, m_page_size, FLASH_SCHED_PRIO_DEFERRABLE);
+            }
+            m_op = OP_FORMAT;
+        }
+        else if (m_header_needed)
+        {
+            m_page_header = PAGE_MAGIC | ((uint32_t)m_generation << 16);
+
+            err_code = pstorage_block_identifier_get(&m_base_handle, m_active, &block);
+            if (err_code == NRF_SUCCESS)
+            {
+                err_code = flash_sched_store(&block,
+                                             (uint8_t *)&m_page_header,
+                                             PAGE_HDR_SIZE,
+                                             0,
+                                             FLASH_SCHED_PRIO_DEFERRABLE);
+            }
+            m_op = OP_HEADER;
+        }
+        else if (m_compacting)
+        {
+            err_code = pstorage_block_identifier_get(&m_base_handle, m_compact_page, &block);
+            if ((err_code == NRF_SUCCESS) && compact_key_find(&key))
+            {
+                size = REC_SIZE(m_index[key].len);
+
+                if ((m_wr_offset + size) > m_page_size)
+                {
+                    // Only possible when a compaction interrupted by a reset left a bad record
+                    // behind. The value is lost, as the page cannot be erased until it is moved.
+                    m_index[key].page = PAGE_NONE;
+                    m_stats.flash_errors++;
+                    continue;
+                }
+
+                err_code = page_load(m_compact_page, m_index[key].offset, &m_copy, size);
+                if (err_code == NRF_SUCCESS)
+                {
+                    err_code = pstorage_block_identifier_get(&m_base_handle, m_active, &block);
+                }
+                if (err_code == NRF_SUCCESS)
+                {
+                    err_code = flash_sched_store(&block,
+                                                 (uint8_t *)&m_copy,
+                                                 size,
+                                                 m_wr_offset,
+                                                 FLASH_SCHED_PRIO_DEFERRABLE);
+                }
+                m_copy_key = key;
+                m_op       = OP_COPY;
+            }
+            else if (err_code == NRF_SUCCESS)
+            {
+                err_code = flash_sched_clear(&block, m_page_size, FLASH_SCHED_PRIO_DEFERRABLE);
+                m_op     = OP_ERASE;
+            }
+        }
+        else if (m_queue_count != 0)
+        {
+            p_record = &m_queue[m_queue_head];
+            size     = record_size(p_record->header);
+
+            if ((m_wr_offset + size) > m_page_size)
+            {
+                page_switch();
+                continue;
+            }
+
+            err_code = pstorage_block_identifier_get(&m_base_handle, m_active, &block);
+            if (err_code == NRF_SUCCESS)
+            {
+                err_code = flash_sched_store(&block,
+                                             (uint8_t *)p_record,
+                                             size,
+                                             m_wr_offset,
+                                             FLASH_SCHED_PRIO_DEFERRABLE);
+            }
+            m_op = OP_WRITE;
+        }
+        else
+        {
+            return;
+        }
+
+        if (err_code != NRF_SUCCESS)
+        {
+            // Most likely the flash scheduler queue is full. Tried again on the next write.
+            m_stats.flash_errors++;
+            m_op = OP_NONE;
+            return;
+        }
+    }
+}
+
+
+/**@brief Function for queueing a record.
+ */
+static uint32_t record_enqueue(uint8_t key, const void * p_value, uint8_t len)
+{
+    kv_record_t * p_record = NULL;
+    uint8_t       first    = 0;
+    uint8_t       i;
+
+    // The oldest record may be on its way to flash and must stay as it is.
+    if (m_op == OP_WRITE)
+    {
+        first = 1;
+    }
+
+    for (i = first; i < m_queue_count; i++)
+    {
+        kv_record_t * p_queued = &m_queue[(m_queue_head + i) % KV_STORE_QUEUE_SIZE];
+
+        if ((uint8_t)p_queued->header == key)
+        {
+            p_record = p_queued;
+            m_stats.coalesced++;
+            break;
+        }
+    }
+
+    if (p_record == NULL)
+    {
+        if (m_queue_count == KV_STORE_QUEUE_SIZE)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        p_record = &m_queue[(m_queue_head + m_queue_count) % KV_STORE_QUEUE_SIZE];
+        m_queue_count++;
+    }
+
+    memset(p_record->value, 0, sizeof(p_record->value));
+    if (len != LEN_DELETED)
+    {
+        memcpy(p_record->value, p_value, len);
+    }
+    p_record->header = record_header(key, len, (uint8_t *)p_record->value);
+
+    kv_process();
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t kv_store_init(kv_store_evt_handler_t evt_handler)
+{
+    pstorage_module_param_t param;
+    uint32_t                err_code;
+    uint8_t                 key;
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    for (key = 0; key < KV_STORE_MAX_KEYS; key++)
+    {
+        m_index[key].page = PAGE_NONE;
+    }
+
+    m_queue_head    = 0;
+    m_queue_count   = 0;
+    m_header_needed = false;
+    m_compacting    = false;
+    m_format_next   = 0;
+    m_format_end    = 0;
+    m_op            = OP_NONE;
+    m_evt_handler   = evt_handler;
+    m_page_size     = PSTORAGE_FLASH_PAGE_SIZE;
+
+    param.block_size  = PSTORAGE_FLASH_PAGE_SIZE;
+    param.block_count = KV_STORE_PAGES;
+    param.cb          = flash_cb_handler;
+
+    err_code = flash_sched_register(&param, &m_base_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    log_recover();
+
+    LOG("[kv]: page %d, offset %d.\r\n", m_active, m_wr_offset);
+
+    kv_process();
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t kv_store_set(uint8_t key, const void * p_value, uint8_t len)
+{
+    if ((key >= KV_STORE_MAX_KEYS) || (len > KV_STORE_MAX_VALUE_LEN))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if ((p_value == NULL) && (len != 0))
+    {
+        return NRF_ERROR_NULL;
+    }
+    return record_enqueue(key, p_value, len);
+}
+
+
+uint32_t kv_store_get(uint8_t key, void * p_value, uint8_t * p_len)
+{
+    kv_record_t   record;
+    kv_record_t * p_record;
+    uint8_t       len;
+    uint8_t       i;
+    uint32_t      err_code;
+
+    if (key >= KV_STORE_MAX_KEYS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // A queued record is newer than anything in flash.
+    for (i = m_queue_count; i > 0; i--)
+    {
+        p_record = &m_queue[(m_queue_head + i - 1) % KV_STORE_QUEUE_SIZE];
+        if ((uint8_t)p_record->header != key)
+        {
+            continue;
+        }
+
+        len = (uint8_t)(p_record->header >> 8);
+        if (len == LEN_DELETED)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+        if (len > *p_len)
+        {
+            return NRF_ERROR_DATA_SIZE;
+        }
+        memcpy(p_value, p_record->value, len);
+        *p_len = len;
+        return NRF_SUCCESS;
+    }
+
+    if (m_index[key].page == PAGE_NONE)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    len = m_index[key].len;
+    if (len > *p_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    err_code = page_load(m_index[key].page,
+                         m_index[key].offset,
+                         &record,
+                         REC_SIZE(len));
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    memcpy(p_value, record.value, len);
+    *p_len = len;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t kv_store_delete(uint8_t key)
+{
+    if (key >= KV_STORE_MAX_KEYS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return record_enqueue(key, NULL, LEN_DELETED);
+}
+
+
+bool kv_store_is_busy(void)
+{
+    return ((m_queue_count != 0) || m_compacting || m_header_needed || (m_op != OP_NONE));
+}
+
+
+const kv_store_stats_t * kv_store_stats_get(void)
+{
+    return &m_stats;
+}
+
+/** @}
+ *  @endcond
+ */
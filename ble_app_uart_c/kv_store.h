@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup kv_store Key-Value Store
+ * @{
+ * @brief    Log structured key-value store for small, frequently updated bridge state.
+ *
+ * @details  Values are appended to a log spread over @ref KV_STORE_PAGES flash pages, so an
+ *           update costs a few words of flash instead of a page erase. Each page starts with a
+ *           header holding a generation number. Each record is a header word with the key,
+ *           length and a CRC, followed by the value padded to a whole word.
+ *
+ *           The page after the one being written is always erased. When the current page is full,
+ *           writing moves on to that page, the records that are still current in the oldest page
+ *           are copied over, and the oldest page is erased. At startup the pages are read in
+ *           generation order to rebuild the RAM index of the newest record of each key. An
+ *           interrupted compaction is finished after startup.
+ *
+ *           Writes are queued in RAM and go to flash as deferrable jobs through @ref flash_sched.
+ *           Reads return a queued value until it is in flash.
+ *
+ * @note     pstorage_init() and flash_sched_init() must have been called first.
+ */
+
+#ifndef KV_STORE_H__
+#define KV_STORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kv_store_cnfg.h"
+
+/**@brief Key-value store event type. */
+typedef enum
+{
+    KV_STORE_EVT_WRITE_DONE,      /**< A write or delete is in flash, or has failed. */
+    KV_STORE_EVT_COMPACTED        /**< A page has been compacted and erased. */
+} kv_store_evt_type_t;
+
+/**@brief Key-value store event. */
+typedef struct
+{
+    kv_store_evt_type_t evt_type;   /**< Type of the event. */
+    uint8_t             key;        /**< Key written, for @ref KV_STORE_EVT_WRITE_DONE. */
+    uint32_t            result;     /**< Result of the flash operation. */
+} kv_store_evt_t;
+
+/**@brief Key-value store event handler type. */
+typedef void (* kv_store_evt_handler_t) (const kv_store_evt_t * p_evt);
+
+/**@brief Key-value store statistics. */
+typedef struct
+{
+    uint32_t writes;           /**< Records written. */
+    uint32_t coalesced;        /**< Writes that replaced a queued value of the same key. */
+    uint32_t copied;           /**< Records copied by compaction. */
+    uint32_t page_erases;      /**< Pages erased. */
+    uint32_t flash_errors;     /**< Failed flash operations. */
+    uint32_t bad_records;      /**< Records with a bad CRC found at startup. */
+} kv_store_stats_t;
+
+/**@brief     Function for initializing the key-value store.
+ *
+ * @details   Registers the log with the flash scheduler and rebuilds the index from flash.
+ *
+ * @param[in] evt_handler Event handler, or NULL.
+ *
+ * @retval    NRF_SUCCESS On success. Otherwise an error code propagated from pstorage.
+ */
+uint32_t kv_store_init(kv_store_evt_handler_t evt_handler);
+
+/**@brief     Function for writing a value.
+ *
+ * @param[in] key     Key, less than @ref KV_STORE_MAX_KEYS.
+ * @param[in] p_value Value. Copied, so it need not stay valid.
+ * @param[in] len     Length of the value, at most @ref KV_STORE_MAX_VALUE_LEN.
+ *
+ * @retval    NRF_SUCCESS             If the write was queued.
+ * @retval    NRF_ERROR_INVALID_PARAM If the key or length is out of range.
+ * @retval    NRF_ERROR_NO_MEM        If the write queue is full.
+ */
+uint32_t kv_store_set(uint8_t key, const void * p_value, uint8_t len);
+
+/**@brief     Function for reading a value.
+ *
+ * @param[in]     key     Key.
+ * @param[out]    p_value Buffer for the value.
+ * @param[in,out] p_len   Size of the buffer in, length of the value out.
+ *
+ * @retval    NRF_SUCCESS             If the value was read.
+ * @retval    NRF_ERROR_NOT_FOUND     If the key has no value.
+ * @retval    NRF_ERROR_DATA_SIZE     If the buffer is too small.
+ * @retval    NRF_ERROR_INVALID_PARAM If the key is out of range.
+ */
+uint32_t kv_store_get(uint8_t key, void * p_value, uint8_t * p_len);
+
+/**@brief     Function for deleting a value.
+ *
+ * @retval    NRF_SUCCESS      If the delete was queued.
+ * @retval    NRF_ERROR_NO_MEM If the write queue is full.
+ */
+uint32_t kv_store_delete(uint8_t key);
+
+/**@brief     Function for checking whether writes are waiting to go to flash.
+ */
+bool kv_store_is_busy(void);
+
+/**@brief     Function for getting the key-value store statistics.
+ */
+const kv_store_stats_t * kv_store_stats_get(void);
+
+#endif // KV_STORE_H__
+
+/** @} */
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "link_quality.h"
+#include "uart_cmd.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "ble_hci.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+#define FRAME_HEADER_LEN   5                                 /**< ESC, op, id, status and len of a report. */
+#define RSSI_SCALE         16                                /**< Fixed point scale of the RSSI average. */
+
+STATIC_ASSERT(LINK_QUALITY_REPORT_LEN <= 0xFF);
+STATIC_ASSERT(LINK_QUALITY_RSSI_AVG_SHIFT <= 7);
+
+/**@brief Tracked link. */
+typedef struct
+{
+    link_quality_link_stats_t stats;                         /**< Statistics, without the average. */
+    int16_t                   rssi_acc;                      /**< Average RSSI, scaled by RSSI_SCALE. */
+} link_t;
+
+/**@brief TX power levels of the radio, in dBm, lowest first. */
+static const int8_t m_tx_power_levels[] = {-40, -30, -20, -16, -12, -8, -4, 0, 4};
+
+#define TX_POWER_LEVEL_COUNT (sizeof(m_tx_power_levels) / sizeof(m_tx_power_levels[0])) /**< Number of TX power levels. */
+
+static link_quality_init_t m_init;                           /**< Copy of the initialization parameters. */
+static link_quality_cfg_t  m_cfg;                            /**< Settings in use. */
+static link_t              m_links[LINK_QUALITY_MAX_LINKS];  /**< Tracked links. */
+static uint32_t            m_disc_hist[LINK_QUALITY_DISC_COUNT]; /**< Disconnections by reason class. */
+static app_timer_id_t      m_timer_id;                       /**< Report and TX power timer. */
+static bool                m_timer_running;                  /**< Whether m_timer_id is started. */
+static int8_t              m_tx_power;                       /**< TX power in use, in dBm. */
+
+
+static link_t * link_find(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < LINK_QUALITY_MAX_LINKS; i++)
+    {
+        if (m_links[i].stats.conn_handle == conn_handle)
+        {
+            return &m_links[i];
+        }
+    }
+    return NULL;
+}
+
+
+static void link_stats_read(const link_t * p_link, link_quality_link_stats_t * p_stats)
+{
+    *p_stats          = p_link->stats;
+    p_stats->rssi_avg = (int8_t)(p_link->rssi_acc / RSSI_SCALE);
+}
+
+
+static link_quality_disc_t disc_class(uint8_t reason)
+{
+    switch (reason)
+    {
+        case BLE_HCI_CONNECTION_TIMEOUT:
+            return LINK_QUALITY_DISC_SUP_TIMEOUT;
+
+        case BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION:
+        case BLE_HCI_REMOTE_DEV_TERMINATION_DUE_TO_LOW_RESOURCES:
+        case BLE_HCI_REMOTE_DEV_TERMINATION_DUE_TO_POWER_OFF:
+            return LINK_QUALITY_DISC_REMOTE;
+
+        case BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION:
+            return LINK_QUALITY_DISC_LOCAL;
+
+        case BLE_HCI_STATUS_CODE_LMP_RESPONSE_TIMEOUT:
+            return LINK_QUALITY_DISC_LL_TIMEOUT;
+
+        case BLE_HCI_CONN_TERMINATED_DUE_TO_MIC_FAILURE:
+            return LINK_QUALITY_DISC_MIC_FAILURE;
+
+        case BLE_HCI_CONN_FAILED_TO_BE_ESTABLISHED:
+            return LINK_QUALITY_DISC_FAILED_TO_ESTABLISH;
+
+        default:
+            return LINK_QUALITY_DISC_OTHER;
+    }
+}
+
+
+static void tx_power_apply(int8_t tx_power)
+{
+    if (tx_power == m_tx_power)
+    {
+        return;
+    }
+    // The power is valid, and the SoftDevice takes it in any state.
+    UNUSED_VARIABLE(sd_ble_gap_tx_power_set(tx_power));
+    m_tx_power = tx_power;
+}
+
+
+/**@brief Function for picking the lowest TX power that reaches the peer of the weakest link.
+ */
+static void tx_power_adapt(void)
+{
+    int16_t rssi_min = INT16_MAX;
+    int16_t required;
+    uint8_t level;
+    uint8_t i;
+
+    for (i = 0; i < LINK_QUALITY_MAX_LINKS; i++)
+    {
+        if ((m_links[i].stats.conn_handle != BLE_CONN_HANDLE_INVALID) && (m_links[i].stats.rssi_samples != 0))
+        {
+            rssi_min = MIN(rssi_min, m_links[i].rssi_acc / RSSI_SCALE);
+        }
+    }
+    if (rssi_min == INT16_MAX)
+    {
+        // Nothing measured, keep what works.
+        return;
+    }
+
+    // TX power needed = target RSSI + path loss, path loss = peer TX power - RSSI.
+    required = LINK_QUALITY_TARGET_RSSI_DBM + (LINK_QUALITY_PEER_TX_POWER_DBM - rssi_min);
+
+    for (level = 0; level < TX_POWER_LEVEL_COUNT - 1; level++)
+    {
+        if (m_tx_power_levels[level] >= required)
+        {
+            break;
+        }
+    }
+    if (m_tx_power_levels[level] < m_tx_power)
+    {
+        // Lower only with a margin, so that the power does not flap around a level boundary.
+        while ((level < TX_POWER_LEVEL_COUNT - 1) &&
+               (m_tx_power_levels[level] < required + LINK_QUALITY_TX_POWER_HYST_DB) &&
+               (m_tx_power_levels[level] < m_tx_power))
+        {
+            level++;
+        }
+    }
+    tx_power_apply(m_tx_power_levels[level]);
+}
+
+
+static void report_write(void)
+{
+    uint8_t                   frame[FRAME_HEADER_LEN + LINK_QUALITY_REPORT_LEN];
+    uint8_t                 * p_field = &frame[FRAME_HEADER_LEN];
+    uint8_t                 * p_count;
+    link_quality_link_stats_t stats;
+    uint8_t                   i;
+
+    frame[0] = UART_CMD_ESC;
+    frame[1] = LINK_QUALITY_FRAME_OP;
+    frame[2] = 0;
+    frame[3] = NRF_SUCCESS;
+
+    for (i = 0; i < LINK_QUALITY_DISC_COUNT; i++)
+    {
+        p_field += uint16_encode((uint16_t)MIN(m_disc_hist[i], 0xFFFF), p_field);
+    }
+    *p_field++ = (uint8_t)m_tx_power;
+    p_count    = p_field++;
+    *p_count   = 0;
+
+    for (i = 0; i < LINK_QUALITY_MAX_LINKS; i++)
+    {
+        if (m_links[i].stats.conn_handle == BLE_CONN_HANDLE_INVALID)
+        {
+            continue;
+        }
+        link_stats_read(&m_links[i], &stats);
+        p_field   += uint16_encode(stats.conn_handle, p_field);
+        *p_field++ = (uint8_t)stats.rssi_avg;
+        *p_field++ = (uint8_t)stats.rssi_min;
+        *p_field++ = (uint8_t)stats.rssi_max;
+        p_field   += uint32_encode(stats.rssi_samples, p_field);
+        p_field   += uint32_encode(stats.tx_failed, p_field);
+        p_field   += uint32_encode(stats.tx_retries, p_field);
+        (*p_count)++;
+    }
+
+    frame[4] = (uint8_t)(p_field - &frame[FRAME_HEADER_LEN]);
+    m_init.write(frame, (uint16_t)(p_field - frame));
+}
+
+
+static void report_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (m_cfg.tx_power == LINK_QUALITY_TX_POWER_ADAPTIVE)
+    {
+        tx_power_adapt();
+    }
+    if (m_cfg.report)
+    {
+        report_write();
+    }
+}
+
+
+uint32_t link_quality_init(const link_quality_init_t * p_init)
+{
+    uint32_t err_code;
+    uint8_t  i;
+
+    if (p_init->write == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_init          = *p_init;
+    m_timer_running = false;
+    memset(&m_cfg, 0, sizeof(m_cfg));
+    memset(m_disc_hist, 0, sizeof(m_disc_hist));
+    for (i = 0; i < LINK_QUALITY_MAX_LINKS; i++)
+    {
+        m_links[i].stats.conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
+
+    m_tx_power = LINK_QUALITY_TX_POWER_DEFAULT;
+    err_code   = sd_ble_gap_tx_power_set(m_tx_power);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return app_timer_create(&m_timer_id, APP_TIMER_MODE_REPEATED, report_timeout_handler);
+}
+
+
+uint32_t link_quality_cfg_set(const link_quality_cfg_t * p_cfg)
+{
+    bool     run;
+    uint32_t err_code;
+
+    if ((p_cfg->report > 1) || (p_cfg->tx_power > LINK_QUALITY_TX_POWER_ADAPTIVE))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_cfg = *p_cfg;
+    if (m_cfg.tx_power == LINK_QUALITY_TX_POWER_FIXED)
+    {
+        tx_power_apply(LINK_QUALITY_TX_POWER_DEFAULT);
+    }
+
+    run = m_cfg.report || (m_cfg.tx_power == LINK_QUALITY_TX_POWER_ADAPTIVE);
+    if (run == m_timer_running)
+    {
+        return NRF_SUCCESS;
+    }
+    if (!run)
+    {
+        m_timer_running = false;
+        return app_timer_stop(m_timer_id);
+    }
+
+    err_code = app_timer_start(m_timer_id, APP_TIMER_TICKS(LINK_QUALITY_REPORT_MS, m_init.prescaler), NULL);
+    m_timer_running = (err_code == NRF_SUCCESS);
+    return err_code;
+}
+
+
+void link_quality_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    link_t * p_link;
+    int8_t   rssi;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            p_link = link_find(BLE_CONN_HANDLE_INVALID);
+            if (p_link == NULL)
+            {
+                // More links than tracked, this one goes without telemetry.
+                break;
+            }
+            memset(p_link, 0, sizeof(*p_link));
+            p_link->stats.conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            // Without RSSI reports the link is still counted, only its RSSI stays unknown.
+            UNUSED_VARIABLE(sd_ble_gap_rssi_start(p_link->stats.conn_handle,
+                                                  LINK_QUALITY_RSSI_THRESHOLD_DB,
+                                                  LINK_QUALITY_RSSI_SKIP_COUNT));
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            m_disc_hist[disc_class(p_ble_evt->evt.gap_evt.params.disconnected.reason)]++;
+            p_link = link_find(p_ble_evt->evt.gap_evt.conn_handle);
+            if (p_link != NULL)
+            {
+                p_link->stats.conn_handle = BLE_CONN_HANDLE_INVALID;
+            }
+            break;
+
+        case BLE_GAP_EVT_RSSI_CHANGED:
+            p_link = link_find(p_ble_evt->evt.gap_evt.conn_handle);
+            if (p_link == NULL)
+            {
+                break;
+            }
+            rssi = p_ble_evt->evt.gap_evt.params.rssi_changed.rssi;
+            if (p_link->stats.rssi_samples == 0)
+            {
+                p_link->rssi_acc       = rssi * RSSI_SCALE;
+                p_link->stats.rssi_min = rssi;
+                p_link->stats.rssi_max = rssi;
+            }
+            else
+            {
+                p_link->rssi_acc      += (rssi * RSSI_SCALE - p_link->rssi_acc) / (1 << LINK_QUALITY_RSSI_AVG_SHIFT);
+                p_link->stats.rssi_min = MIN(p_link->stats.rssi_min, rssi);
+                p_link->stats.rssi_max = MAX(p_link->stats.rssi_max, rssi);
+            }
+            p_link->stats.rssi_samples++;
+            break;
+
+        case BLE_GATTC_EVT_WRITE_RSP:
+            if (p_ble_evt->evt.gattc_evt.gatt_status != BLE_GATT_STATUS_SUCCESS)
+            {
+                link_quality_tx_failed(p_ble_evt->evt.gattc_evt.conn_handle);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void link_quality_tx_failed(uint16_t conn_handle)
+{
+    link_t * p_link;
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+    p_link = link_find(conn_handle);
+    if (p_link != NULL)
+    {
+        p_link->stats.tx_failed++;
+    }
+}
+
+
+void link_quality_tx_retried(uint16_t conn_handle)
+{
+    link_t * p_link;
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+    p_link = link_find(conn_handle);
+    if (p_link != NULL)
+    {
+        p_link->stats.tx_retries++;
+    }
+}
+
+
+uint32_t link_quality_link_stats_get(uint16_t conn_handle, link_quality_link_stats_t * p_stats)
+{
+    link_t * p_link = (conn_handle == BLE_CONN_HANDLE_INVALID) ? NULL : link_find(conn_handle);
+
+    if (p_link == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    link_stats_read(p_link, p_stats);
+    return NRF_SUCCESS;
+}
+
+
+void link_quality_disc_hist_get(uint32_t * p_counts)
+{
+    memcpy(p_counts, m_disc_hist, sizeof(m_disc_hist));
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup link_quality Link Quality Telemetry
+ * @{
+ * @brief    Tracks the RSSI, failed and retried writes of each link and why links ended, and
+ *           adapts the TX power to the weakest link.
+ *
+ * @details  RSSI reporting is started on every new link, and the reported values are averaged.
+ *           Write responses with an error status, writes the NUS client gave up on and writes
+ *           held back for a full TX queue are counted per link. The reason of every disconnection
+ *           goes into a histogram.
+ *
+ *           While reports are on, a report is written to the UART every
+ *           @ref LINK_QUALITY_REPORT_MS, framed like a @ref uart_cmd response:
+ *
+ *           @code
+ *           ESC 0xC2 0x00 0x00 len report[len]
+ *           @endcode
+ *
+ *           The report holds the @ref LINK_QUALITY_DISC_COUNT disconnection counts as 16 bit
+ *           values, the TX power in dBm, the number of links and then per link the connection
+ *           handle (16 bit), the RSSI average, minimum and maximum in dBm (8 bit, signed) and the
+ *           RSSI sample, failed write and retried write counts (32 bit), all little endian.
+ *
+ *           The SoftDevice has one TX power for all links. The adaptive policy estimates the path
+ *           loss of each link from its RSSI and @ref LINK_QUALITY_PEER_TX_POWER_DBM, and picks the
+ *           lowest TX power that reaches @ref LINK_QUALITY_TARGET_RSSI_DBM at the peer of the
+ *           weakest link. It raises the power at once, and lowers it only once the path loss has
+ *           improved by @ref LINK_QUALITY_TX_POWER_HYST_DB beyond the lower level.
+ */
+
+#ifndef LINK_QUALITY_H__
+#define LINK_QUALITY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "link_quality_cnfg.h"
+
+#define LINK_QUALITY_FRAME_OP       0xC2 /**< Op of a report frame, a response op no request uses. */
+#define LINK_QUALITY_LINK_REPORT_LEN 17  /**< Bytes of one link in a report. */
+#define LINK_QUALITY_REPORT_LEN     (LINK_QUALITY_DISC_COUNT * 2 + 2 + \
+                                     LINK_QUALITY_MAX_LINKS * LINK_QUALITY_LINK_REPORT_LEN) /**< Longest report. */
+
+/**@brief Disconnection reason classes of the histogram. */
+typedef enum
+{
+    LINK_QUALITY_DISC_SUP_TIMEOUT,       /**< Supervision timeout, the peer went out of range. */
+    LINK_QUALITY_DISC_REMOTE,            /**< Closed by the peer. */
+    LINK_QUALITY_DISC_LOCAL,             /**< Closed by this device. */
+    LINK_QUALITY_DISC_LL_TIMEOUT,        /**< Link layer procedure timeout. */
+    LINK_QUALITY_DISC_MIC_FAILURE,       /**< Packet failed the integrity check. */
+    LINK_QUALITY_DISC_FAILED_TO_ESTABLISH, /**< No packet received after the connection request. */
+    LINK_QUALITY_DISC_OTHER,             /**< Any other reason. */
+    LINK_QUALITY_DISC_COUNT              /**< Number of classes. */
+} link_quality_disc_t;
+
+/**@brief TX power policies. */
+typedef enum
+{
+    LINK_QUALITY_TX_POWER_FIXED,         /**< @ref LINK_QUALITY_TX_POWER_DEFAULT. */
+    LINK_QUALITY_TX_POWER_ADAPTIVE       /**< Lowest power reaching the peer of the weakest link. */
+} link_quality_tx_power_t;
+
+/**@brief Telemetry settings. */
+typedef struct
+{
+    uint8_t report;                      /**< Whether reports are written to the UART. */
+    uint8_t tx_power;                    /**< TX power policy, see @ref link_quality_tx_power_t. */
+} link_quality_cfg_t;
+
+/**@brief Statistics of a link. */
+typedef struct
+{
+    uint16_t conn_handle;                /**< Connection handle, BLE_CONN_HANDLE_INVALID if the entry is free. */
+    int8_t   rssi_avg;                   /**< Average RSSI in dBm. */
+    int8_t   rssi_min;                   /**< Lowest RSSI in dBm. */
+    int8_t   rssi_max;                   /**< Highest RSSI in dBm. */
+    uint32_t rssi_samples;               /**< RSSI changes reported. */
+    uint32_t tx_failed;                  /**< Writes rejected by the peer or given up on. */
+    uint32_t tx_retries;                 /**< Writes held back for a full TX queue and tried again. */
+} link_quality_link_stats_t;
+
+/**@brief Function for writing a report to the UART, without escaping. */
+typedef void (* link_quality_write_t) (const uint8_t * p_data, uint16_t len);
+
+/**@brief Telemetry initialization structure. */
+typedef struct
+{
+    link_quality_write_t write;          /**< Function for writing reports. */
+    uint32_t             prescaler;      /**< RTC1 prescaler of the app_timer module. */
+} link_quality_init_t;
+
+/**@brief     Function for initializing the telemetry.
+ *
+ * @param[in] p_init Initialization parameters.
+ *
+ * @retval    NRF_SUCCESS    On success.
+ * @retval    NRF_ERROR_NULL If the write function is missing.
+ * @return    Otherwise an error code propagated from @ref app_timer_create or
+ *            @ref sd_ble_gap_tx_power_set.
+ */
+uint32_t link_quality_init(const link_quality_init_t * p_init);
+
+/**@brief     Function for changing the telemetry settings.
+ *
+ * @details   Switching the adaptive policy off restores @ref LINK_QUALITY_TX_POWER_DEFAULT.
+ *
+ * @param[in] p_cfg Telemetry settings.
+ *
+ * @retval    NRF_SUCCESS             On success.
+ * @retval    NRF_ERROR_INVALID_PARAM If a setting is out of range.
+ * @return    Otherwise an error code propagated from @ref app_timer_start.
+ */
+uint32_t link_quality_cfg_set(const link_quality_cfg_t * p_cfg);
+
+/**@brief     Function for handling the connection, RSSI and write response events.
+ *
+ * @param[in] p_ble_evt BLE stack event.
+ */
+void link_quality_on_ble_evt(ble_evt_t * p_ble_evt);
+
+/**@brief     Function for counting a write of a link that failed outside a write response.
+ *
+ * @param[in] conn_handle Link of the write.
+ */
+void link_quality_tx_failed(uint16_t conn_handle);
+
+/**@brief     Function for counting a write of a link that was held back and will be tried again.
+ *
+ * @param[in] conn_handle Link of the write.
+ */
+void link_quality_tx_retried(uint16_t conn_handle);
+
+/**@brief     Function for getting the statistics of a link.
+ *
+ * @param[in]  conn_handle Link.
+ * @param[out] p_stats     Statistics since the link was established.
+ *
+ * @retval    NRF_SUCCESS        On success.
+ * @retval    NRF_ERROR_NOT_FOUND If the link is not tracked.
+ */
+uint32_t link_quality_link_stats_get(uint16_t conn_handle, link_quality_link_stats_t * p_stats);
+
+/**@brief     Function for getting the disconnection histogram.
+ *
+ * @param[out] p_counts @ref LINK_QUALITY_DISC_COUNT counts, indexed by @ref link_quality_disc_t.
+ */
+void link_quality_disc_hist_get(uint32_t * p_counts);
+
+#endif // LINK_QUALITY_H__
+
+/** @} */
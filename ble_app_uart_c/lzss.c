@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "lzss.h"
+#include "app_util.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+#define WINDOW_MASK        (LZSS_WINDOW_SIZE - 1)  /**< Mask of a window position. */
+
+// A match must cost fewer bits than the literals it replaces, and no token may be shorter than
+// the padding of a packet.
+STATIC_ASSERT(LZSS_MATCH_BITS < (LZSS_MIN_MATCH * LZSS_LITERAL_BITS));
+STATIC_ASSERT(LZSS_MATCH_BITS >= LZSS_LITERAL_BITS);
+
+// The encoder keeps a table of LZSS_HASH_SIZE positions on the stack.
+STATIC_ASSERT(LZSS_HASH_BITS <= 8);
+
+/**@brief Bit writer of a packet. */
+typedef struct
+{
+    uint8_t  * p_buf;
+    uint32_t   pos;                                /**< Bits written. */
+} bit_writer_t;
+
+
+static void bits_put(bit_writer_t * p_writer, uint32_t value, uint8_t count)
+{
+    while (count-- > 0)
+    {
+        uint8_t * p_byte = &p_writer->p_buf[p_writer->pos >> 3];
+        uint8_t   mask   = (uint8_t)(0x80 >> (p_writer->pos & 7));
+
+        if ((p_writer->pos & 7) == 0)
+        {
+            *p_byte = 0;
+        }
+        if ((value >> count) & 1)
+        {
+            *p_byte |= mask;
+        }
+        p_writer->pos++;
+    }
+}
+
+
+static uint32_t bits_get(const uint8_t * p_buf, uint32_t * p_pos, uint8_t count)
+{
+    uint32_t value = 0;
+
+    while (count-- > 0)
+    {
+        value = (value << 1) | ((p_buf[*p_pos >> 3] >> (7 - (*p_pos & 7))) & 1);
+        (*p_pos)++;
+    }
+    return value;
+}
+
+
+/**@brief Function for getting the byte distance bytes before position pos of the input, which
+ *        may be in the window.
+ */
+static uint8_t history_byte(const lzss_t * p_lzss, const uint8_t * p_in, uint16_t pos, uint16_t distance)
+{
+    if (distance <= pos)
+    {
+        return p_in[pos - distance];
+    }
+    return p_lzss->window[(p_lzss->head - (distance - pos)) & WINDOW_MASK];
+}
+
+
+/**@brief Function for getting the length of the match distance bytes back from position pos of
+ *        the input.
+ */
+static uint16_t match_len(const lzss_t * p_lzss, const uint8_t * p_in, uint16_t pos, uint16_t distance,
+                          uint16_t max_len)
+{
+    uint16_t len = 0;
+
+    // Bytes of the match at or after pos come from p_in, which the window is behind of.
+    while ((len < max_len) && (p_in[pos + len] == history_byte(p_lzss, p_in, pos + len, distance)))
+    {
+        len++;
+    }
+    return len;
+}
+
+
+/**@brief Function for hashing the two bytes a match starts with.
+ */
+static uint16_t hash_get(uint8_t first, uint8_t second)
+{
+    uint32_t product = (uint32_t)((((uint32_t)first << 8) | second) * 2654435761UL);
+
+    return (uint16_t)(product >> (32 - LZSS_HASH_BITS));
+}
+
+
+/**@brief Function for adding a committed position to the hash chain.
+ */
+static void hash_insert(lzss_t * p_lzss, uint16_t pos, uint16_t hash)
+{
+    p_lzss->hash_prev[pos & WINDOW_MASK] = p_lzss->hash_head[hash];
+    p_lzss->hash_head[hash]              = pos;
+}
+
+
+void lzss_reset(lzss_t * p_lzss)
+{
+    uint32_t i;
+
+    p_lzss->head = 0;
+    p_lzss->fill = 0;
+    p_lzss->pos  = 0;
+    for (i = 0; i < LZSS_HASH_SIZE; i++)
+    {
+        // Just out of reach of every position until the counter wraps.
+        p_lzss->hash_head[i] = (uint16_t)(0 - LZSS_WINDOW_SIZE - 1);
+    }
+    memset(&p_lzss->stats, 0, sizeof(p_lzss->stats));
+}
+
+
+void lzss_stats_get(const lzss_t * p_lzss, lzss_stats_t * p_stats)
+{
+    *p_stats = p_lzss->stats;
+}
+
+
+uint16_t lzss_encode(const lzss_t  * p_lzss,
+                     const uint8_t * p_in,
+                     uint16_t        in_len,
+                     uint8_t       * p_out,
+                     uint16_t        out_size,
+                     uint16_t      * p_consumed)
+{
+    bit_writer_t writer = {p_out, 0};
+    uint32_t     bits   = (uint32_t)out_size * 8;
+    uint16_t     pos    = 0;
+    uint16_t     recent[LZSS_HASH_SIZE];   // Newest position of each hash in p_in, as in the chain.
+    uint32_t     i;
+
+    for (i = 0; i < LZSS_HASH_SIZE; i++)
+    {
+        recent[i] = (uint16_t)(p_lzss->pos - LZSS_WINDOW_SIZE - 1);
+    }
+    if ((p_lzss->fill != 0) && (in_len != 0))
+    {
+        // The last byte committed is not in the chain until the byte after it is known.
+        recent[hash_get(p_lzss->window[(p_lzss->head - 1) & WINDOW_MASK], p_in[0])] =
+            (uint16_t)(p_lzss->pos - 1);
+    }
+
+    while (pos < in_len)
+    {
+        uint16_t max_len  = (uint16_t)MIN(in_len - pos, LZSS_MAX_MATCH);
+        uint32_t reach    = MIN((uint32_t)p_lzss->fill + pos, LZSS_WINDOW_SIZE);
+        uint16_t now      = (uint16_t)(p_lzss->pos + pos);
+        uint16_t best_len = 0;
+        uint16_t best_distance = 0;
+
+        if (max_len >= LZSS_MIN_MATCH)
+        {
+            uint16_t hash      = hash_get(p_in[pos], p_in[pos + 1]);
+            uint16_t candidate = p_lzss->hash_head[hash];
+            uint16_t distance  = (uint16_t)(now - recent[hash]);
+            uint16_t last      = 0;
+            uint16_t tries;
+
+            if (distance <= reach)
+            {
+                best_len      = match_len(p_lzss, p_in, pos, distance, max_len);
+                best_distance = distance;
+            }
+
+            // The chain holds older positions than p_in, newest first, so the first of equally
+            // long matches is the nearest. A candidate no further back than the one before it
+            // has been overwritten since it was chained, and ends the chain.
+            for (tries = 0; (tries < LZSS_CHAIN_MAX) && (best_len < max_len); tries++)
+            {
+                uint16_t len;
+
+                distance = (uint16_t)(now - candidate);
+                if ((distance <= last) || (distance > reach))
+                {
+                    break;
+                }
+                len = match_len(p_lzss, p_in, pos, distance, max_len);
+                if (len > best_len)
+                {
+                    best_len      = len;
+                    best_distance = distance;
+                }
+                candidate = p_lzss->hash_prev[candidate & WINDOW_MASK];
+                last      = distance;
+            }
+        }
+
+        // A match the packet has no room for left may still leave room for a literal.
+        if ((best_len >= LZSS_MIN_MATCH) && ((writer.pos + LZSS_MATCH_BITS) <= bits))
+        {
+            bits_put(&writer, 0, 1);
+            bits_put(&writer, best_distance - 1, LZSS_WINDOW_BITS);
+            bits_put(&writer, best_len - LZSS_MIN_MATCH, LZSS_LENGTH_BITS);
+        }
+        else
+        {
+            if ((writer.pos + LZSS_LITERAL_BITS) > bits)
+            {
+                break;
+            }
+            bits_put(&writer, 1, 1);
+            bits_put(&writer, p_in[pos], 8);
+            best_len = 1;
+        }
+
+        // Every position the token covers may start a later match.
+        for (i = pos; (i < (uint32_t)(pos + best_len)) && ((i + 1) < in_len); i++)
+        {
+            recent[hash_get(p_in[i], p_in[i + 1])] = (uint16_t)(p_lzss->pos + i);
+        }
+        pos += best_len;
+    }
+
+    *p_consumed = pos;
+    return (uint16_t)((writer.pos + 7) / 8);
+}
+
+
+void lzss_encode_commit(lzss_t * p_lzss, const uint8_t * p_in, uint16_t consumed, uint16_t out_len)
+{
+    uint16_t i;
+
+    for (i = 0; i < consumed; i++)
+    {
+        // The position before this byte can be hashed now.
+        if ((p_lzss->fill != 0) || (i != 0))
+        {
+            hash_insert(p_lzss, (uint16_t)(p_lzss->pos - 1),
+                        hash_get(p_lzss->window[(p_lzss->head - 1) & WINDOW_MASK], p_in[i]));
+        }
+        p_lzss->window[p_lzss->head] = p_in[i];
+        p_lzss->head                 = (p_lzss->head + 1) & WINDOW_MASK;
+        p_lzss->pos++;
+    }
+    p_lzss->fill             = (uint16_t)MIN((uint32_t)p_lzss->fill + consumed, LZSS_WINDOW_SIZE);
+    p_lzss->stats.bytes_in  += consumed;
+    p_lzss->stats.bytes_out += out_len;
+    p_lzss->stats.packets++;
+}
+
+
+/**@brief Function for checking that every match of a packet stays within the data received and
+ *        that the packet fits in p_out, before the window is changed.
+ */
+static uint32_t packet_check(const lzss_t * p_lzss, const uint8_t * p_in, uint16_t in_len, uint16_t out_size)
+{
+    uint32_t bits = (uint32_t)in_len * 8;
+    uint32_t pos  = 0;
+    uint32_t fill = p_lzss->fill;
+    uint32_t len  = 0;
+
+    while ((pos + LZSS_LITERAL_BITS) <= bits)
+    {
+        uint32_t count;
+
+        if (bits_get(p_in, &pos, 1) != 0)
+        {
+            pos  += 8;
+            count = 1;
+        }
+        else
+        {
+            if ((pos + LZSS_MATCH_BITS - 1) > bits)
+            {
+                break;
+            }
+            if ((bits_get(p_in, &pos, LZSS_WINDOW_BITS) + 1) > fill)
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+            count = bits_get(p_in, &pos, LZSS_LENGTH_BITS) + LZSS_MIN_MATCH;
+        }
+
+        len += count;
+        if (len > out_size)
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+        fill = MIN(fill + count, LZSS_WINDOW_SIZE);
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t lzss_decode(lzss_t        * p_lzss,
+                     const uint8_t * p_in,
+                     uint16_t        in_len,
+                     uint8_t       * p_out,
+                     uint16_t        out_size,
+                     uint16_t      * p_out_len)
+{
+    uint32_t bits = (uint32_t)in_len * 8;
+    uint32_t pos  = 0;
+    uint16_t len  = 0;
+    uint32_t err_code;
+
+    // A bad packet leaves the window as it was, so the link may carry on with the next one.
+    err_code = packet_check(p_lzss, p_in, in_len, out_size);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Fewer bits than a literal left are padding.
+    while ((pos + LZSS_LITERAL_BITS) <= bits)
+    {
+        uint16_t distance;
+        uint16_t count;
+
+        if (bits_get(p_in, &pos, 1) != 0)
+        {
+            distance = 0;
+            count    = 1;
+        }
+        else
+        {
+            if ((pos + LZSS_MATCH_BITS - 1) > bits)
+            {
+                break;
+            }
+            distance = (uint16_t)(bits_get(p_in, &pos, LZSS_WINDOW_BITS) + 1);
+            count    = (uint16_t)(bits_get(p_in, &pos, LZSS_LENGTH_BITS) + LZSS_MIN_MATCH);
+        }
+
+        while (count-- > 0)
+        {
+            uint8_t byte = (distance == 0) ? (uint8_t)bits_get(p_in, &pos, 8) :
+                                             p_lzss->window[(p_lzss->head - distance) & WINDOW_MASK];
+
+            p_out[len++]                 = byte;
+            p_lzss->window[p_lzss->head] = byte;
+            p_lzss->head                 = (p_lzss->head + 1) & WINDOW_MASK;
+            if (p_lzss->fill < LZSS_WINDOW_SIZE)
+            {
+                p_lzss->fill++;
+            }
+        }
+    }
+
+    p_lzss->stats.bytes_in  += in_len;
+    p_lzss->stats.bytes_out += len;
+    p_lzss->stats.packets++;
+    *p_out_len = len;
+    return NRF_SUCCESS;
+}
+
+/** @}
+ *  @endcond
+ */
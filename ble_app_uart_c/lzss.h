@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup lzss LZSS Compression
+ * @{
+ * @brief    Streaming LZSS compression of the data exchanged with the peer, one packet at a time.
+ *
+ * @details  Each packet is a sequence of tokens, most significant bit first:
+ *
+ *           @code
+ *           1 byte[8]                                          literal
+ *           0 distance-1[LZSS_WINDOW_BITS] length-2[LZSS_LENGTH_BITS]  match
+ *           @endcode
+ *
+ *           A match copies length bytes starting distance bytes back in the data sent so far on
+ *           the link, and may overlap the bytes it produces. Every packet ends on a token, padded
+ *           with zero bits to a whole byte, so the receiver can pass on everything a packet holds
+ *           as soon as it arrives. The window carries over from packet to packet, which is where
+ *           repetitive text gains most, so both ends must start from an empty window on a new
+ *           link and see every packet in order.
+ *
+ *           A window is kept per direction and link in an @ref lzss_t. The encoder does not move
+ *           its window until the packet is accepted, see @ref lzss_encode_commit.
+ *
+ *           The encoder finds matches through a hash chain of the window positions, keyed on the
+ *           two bytes a match starts with, and tries at most @ref LZSS_CHAIN_MAX of them for each
+ *           byte, newest first. Matches within the data being encoded are looked up from the
+ *           latest position with the same hash.
+ */
+
+#ifndef LZSS_H__
+#define LZSS_H__
+
+#include <stdint.h>
+#include "lzss_cnfg.h"
+
+#define LZSS_WINDOW_SIZE    (1UL << LZSS_WINDOW_BITS)                   /**< Bytes in a window. */
+#define LZSS_MIN_MATCH      2                                            /**< Shortest match. */
+#define LZSS_MAX_MATCH      (LZSS_MIN_MATCH + (1UL << LZSS_LENGTH_BITS) - 1) /**< Longest match. */
+#define LZSS_MATCH_BITS     (1 + LZSS_WINDOW_BITS + LZSS_LENGTH_BITS)   /**< Bits of a match token. */
+#define LZSS_LITERAL_BITS   9                                            /**< Bits of a literal token. */
+#define LZSS_HASH_SIZE      (1UL << LZSS_HASH_BITS)                     /**< Entries of the hash table. */
+
+/**@brief Most bytes a packet of LEN bytes decompresses to: as many longest matches as it holds,
+ *        and literals in the bits left over.
+ */
+#define LZSS_DECODED_MAX(LEN) (((((LEN) * 8) / LZSS_MATCH_BITS) * LZSS_MAX_MATCH) + \
+                               ((((LEN) * 8) % LZSS_MATCH_BITS) / LZSS_LITERAL_BITS))
+
+/**@brief Compression statistics of one direction. */
+typedef struct
+{
+    uint32_t bytes_in;                   /**< Bytes given to the encoder or decoder. */
+    uint32_t bytes_out;                  /**< Bytes it produced. The ratio is bytes_in / bytes_out for the encoder. */
+    uint32_t packets;                    /**< Packets encoded or decoded. */
+} lzss_stats_t;
+
+/**@brief State of one direction of a link. */
+typedef struct
+{
+    uint8_t      window[LZSS_WINDOW_SIZE]; /**< Last bytes of the uncompressed data. */
+    uint16_t     head;                   /**< Position of the next byte in the window. */
+    uint16_t     fill;                   /**< Valid bytes in the window. */
+    uint16_t     pos;                    /**< Bytes committed since the reset, modulo 2^16. Hash chain entries are such positions. */
+    uint16_t     hash_head[LZSS_HASH_SIZE];   /**< Newest position of each hash, encoder only. */
+    uint16_t     hash_prev[LZSS_WINDOW_SIZE]; /**< Position before each window position with the same hash, encoder only. */
+    lzss_stats_t stats;                  /**< Statistics since the last reset. */
+} lzss_t;
+
+/**@brief     Function for emptying a window, at the start of a link.
+ *
+ * @param[out] p_lzss State to reset.
+ */
+void lzss_reset(lzss_t * p_lzss);
+
+/**@brief     Function for getting the statistics of one direction.
+ *
+ * @param[in]  p_lzss  State of the direction.
+ * @param[out] p_stats Statistics since the last @ref lzss_reset.
+ */
+void lzss_stats_get(const lzss_t * p_lzss, lzss_stats_t * p_stats);
+
+/**@brief     Function for compressing data into one packet.
+ *
+ * @details   As much of the data is compressed as the packet takes. The window is not changed.
+ *
+ * @param[in]  p_lzss     Encoder state.
+ * @param[in]  p_in       Data to compress.
+ * @param[in]  in_len     Length of the data.
+ * @param[out] p_out      Packet.
+ * @param[in]  out_size   Size of the packet, at least 2 bytes.
+ * @param[out] p_consumed Bytes of the data in the packet.
+ *
+ * @return    Length of the packet.
+ */
+uint16_t lzss_encode(const lzss_t  * p_lzss,
+                     const uint8_t * p_in,
+                     uint16_t        in_len,
+                     uint8_t       * p_out,
+                     uint16_t        out_size,
+                     uint16_t      * p_consumed);
+
+/**@brief     Function for moving the encoder window past a packet that has been sent, and
+ *            adding its positions to the hash chain.
+ *
+ * @param[in,out] p_lzss   Encoder state.
+ * @param[in]     p_in     Data given to @ref lzss_encode.
+ * @param[in]     consumed Bytes of the data in the packet.
+ * @param[in]     out_len  Length of the packet.
+ */
+void lzss_encode_commit(lzss_t * p_lzss, const uint8_t * p_in, uint16_t consumed, uint16_t out_len);
+
+/**@brief     Function for decompressing a packet.
+ *
+ * @param[in,out] p_lzss    Decoder state.
+ * @param[in]     p_in      Packet.
+ * @param[in]     in_len    Length of the packet.
+ * @param[out]    p_out     Decompressed data.
+ * @param[in]     out_size  Size of p_out, @ref LZSS_DECODED_MAX of in_len for any packet.
+ * @param[out]    p_out_len Length of the decompressed data.
+ *
+ * @retval    NRF_SUCCESS            On success.
+ * @retval    NRF_ERROR_INVALID_DATA If a match reaches back beyond the data received, or the
+ *                                   data does not fit in p_out. Nothing is decoded and the state
+ *                                   is not changed.
+ */
+uint32_t lzss_decode(lzss_t        * p_lzss,
+                     const uint8_t * p_in,
+                     uint16_t        in_len,
+                     uint8_t       * p_out,
+                     uint16_t        out_size,
+                     uint16_t      * p_out_len);
+
+#endif // LZSS_H__
+
+/** @} */
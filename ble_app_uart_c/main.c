@@ -27,14 +27,28 @@
 #include "ble_advdata_parser.h"
 #include "ble.h"
 #include "ble_uart_c.h"
+#include "ble_uart_c_rel.h"
 #include "ble_db_discovery.h"
+#include "ble_hci.h"
+#include "ble_evt_router.h"
+#include "buf_pool.h"
 #include "bsp.h"
 #include "device_manager.h"
+#include "err_recovery.h"
+#include "evt_trace.h"
+#include "flash_sched.h"
+#include "kv_store.h"
+#include "link_quality.h"
+#include "lzss.h"
 #include "nordic_common.h"
 #include "nrf_sdm.h"
 #include "nrf_gpio.h"
 #include "pstorage.h"
+#include "rtt_probe.h"
+#include "scan_gw.h"
 #include "softdevice_handler.h"
+#include "store_fwd.h"
+#include "uart_cmd.h"
 
 #if defined(BOARD_PCA10031)
 #define SCAN_LED_PIN_NO                  LED_RGB_BLUE                                   /**< Is on when device is scanning. */
@@ -57,6 +71,11 @@
 #define SCAN_INTERVAL              0x00A0                             /**< Determines scan interval in units of 0.625 millisecond. */
 #define SCAN_WINDOW                0x0050                             /**< Determines scan window in units of 0.625 millisecond. */
 
+#define RECONNECT_PEER_COUNT       4                                  /**< Number of recent peers reconnected to after a link loss, 0 to always scan. At most BLE_GAP_WHITELIST_ADDR_MAX_COUNT. */
+#define RECONNECT_SCAN_INTERVAL    0x0030                             /**< Scan interval while reconnecting, in units of 0.625 millisecond. */
+#define RECONNECT_SCAN_WINDOW      0x0030                             /**< Scan window while reconnecting, in units of 0.625 millisecond. Equal to the interval to listen all the time. */
+#define RECONNECT_TIMEOUT          2                                  /**< Time, in seconds, spent reconnecting before scanning for any peer. */
+
 #define MIN_CONNECTION_INTERVAL    MSEC_TO_UNITS(7.5, UNIT_1_25_MS)   /**< Determines maximum connection interval in millisecond. */
 #define MAX_CONNECTION_INTERVAL    MSEC_TO_UNITS(30, UNIT_1_25_MS)    /**< Determines maximum connection interval in millisecond. */
 #define SLAVE_LATENCY              0                                  /**< Determines slave latency in counts of connection events. */
@@ -67,11 +86,18 @@
 #define UUID16_SIZE                2                                  /**< Size of 16 bit UUID */
 #define BUTTON_DETECTION_DELAY               APP_TIMER_TICKS(50, APP_TIMER_PRESCALER)   /**< Delay from a GPIOTE event until a button is reported as pushed (in number of timer ticks). */
 #define APP_TIMER_PRESCALER                  0                                          /**< Value of the RTC1 PRESCALER register. */
-#define APP_TIMER_MAX_TIMERS                 4                                          /**< Maximum number of simultaneously created timers. */
-#define APP_TIMER_OP_QUEUE_SIZE              5                                          /**< Size of timer operation queues. */
+#define APP_TIMER_MAX_TIMERS                 (5 + BLE_UART_C_REL_ENABLED + SCAN_GW_ENABLED + 2 * BLE_UART_C_QOS_ENABLED + 2 * BLE_UART_C_WDT_ENABLED + RTT_PROBE_ENABLED + LINK_QUALITY_ENABLED + 1) /**< Maximum number of simultaneously created timers. */
+#define APP_TIMER_OP_QUEUE_SIZE              (2 * APP_TIMER_MAX_TIMERS)                 /**< Size of timer operation queues. Room for a stop and a start of every timer before the queue is processed. */
 #define UART_SEND_INTERVAL          APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER) /**< Battery level measurement interval (ticks). */
-#define UART_TX_BUF_SIZE                256                                         /**< UART TX buffer size. */
+#define UART_TX_BUF_SIZE                256                                         /**< UART TX buffer size. Data from the peer beyond it waits in @ref buf_pool blocks. */
 #define UART_RX_BUF_SIZE                256                                         /**< UART RX buffer size. */
+#define UART_BAUDRATE_DEFAULT           UART_BAUDRATE_BAUDRATE_Baud38400            /**< UART baud rate at startup, see @ref uart_baudrate_set. */
+
+#if BLE_UART_C_REL_ENABLED
+#define UART_LINE_MAX_LEN               BLE_UART_C_REL_MAX_PAYLOAD                  /**< Maximum number of UART bytes sent to the peer in one packet. */
+#else
+#define UART_LINE_MAX_LEN               BLE_NUS_MAX_DATA_LEN                        /**< Maximum number of UART bytes sent to the peer in one packet. */
+#endif
 
 #define DEAD_BEEF                            0xDEADBEEF                                 /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 
@@ -96,23 +122,160 @@ typedef enum
     BLE_NO_SCAN,                                                  /**< No advertising running. */
     BLE_WHITELIST_SCAN,                                           /**< Advertising with whitelist. */
     BLE_FAST_SCAN,                                                /**< Fast advertising running. */
+    BLE_RECONNECT_SCAN,                                           /**< Connecting to a recent peer. */
 } ble_advertising_mode_t;
 
+/**@brief Scan and connection parameters, applied at the next scan or connection. */
+typedef struct
+{
+    uint16_t              scan_interval;                          /**< Scan interval in units of 0.625 millisecond. */
+    uint16_t              scan_window;                            /**< Scan window in units of 0.625 millisecond. */
+    ble_gap_conn_params_t conn_params;                            /**< Connection parameters requested. */
+} link_cfg_t;
+
+/**@brief UART bridge parameters. */
+typedef struct
+{
+    uint32_t baudrate;                                            /**< BAUDRATE register value, applied once the UART has sent its output. */
+    uint8_t  line_len;                                            /**< Bytes after which a line without a newline is sent. */
+    uint8_t  store_fwd_policy;                                    /**< Store-and-forward policy, see @ref store_fwd_policy_t. */
+} uart_cfg_t;
+
+/**@brief Scanner gateway parameters. */
+typedef struct
+{
+    uint8_t          mode;                                        /**< Whether advertising reports are streamed to the UART instead of connecting, see @ref scan_gw. */
+    scan_gw_filter_t filter;                                      /**< Filter and deduplication settings. */
+} gw_cfg_t;
+
+/**@brief Bridge parameters that can be changed at runtime through the UART command channel. */
+typedef struct
+{
+    link_cfg_t link;                                              /**< Scan and connection parameters. */
+    uint8_t    target_uuid[16];                                   /**< 128 bit service UUID a peripheral must advertise. */
+    uart_cfg_t uart;                                              /**< UART bridge parameters. */
+    gw_cfg_t   gw;                                                /**< Scanner gateway parameters. */
+    ble_uart_c_qos_cfg_t qos;                                     /**< Rate limits of the NUS link. */
+    rtt_probe_cfg_t probe;                                        /**< Round trip probe settings, see @ref rtt_probe. */
+    link_quality_cfg_t lq;                                        /**< Link quality telemetry settings, see @ref link_quality. */
+    uint8_t    compress;                                          /**< Whether data exchanged with the peer is compressed, see @ref lzss. */
+    uint8_t    line_coalesce;                                     /**< Whether lines read from the RX FIFO together share packets, see @ref uart_rx_process. Off by default. */
+} bridge_cfg_t;
+
+/**@brief Parameter IDs of the UART command channel. */
+typedef enum
+{
+    APP_CFG_ID_SCAN_INTERVAL     = 0x01,                          /**< link_cfg_t::scan_interval. */
+    APP_CFG_ID_SCAN_WINDOW       = 0x02,                          /**< link_cfg_t::scan_window. */
+    APP_CFG_ID_MIN_CONN_INTERVAL = 0x10,                          /**< ble_gap_conn_params_t::min_conn_interval. */
+    APP_CFG_ID_MAX_CONN_INTERVAL = 0x11,                          /**< ble_gap_conn_params_t::max_conn_interval. */
+    APP_CFG_ID_SLAVE_LATENCY     = 0x12,                          /**< ble_gap_conn_params_t::slave_latency. */
+    APP_CFG_ID_SUP_TIMEOUT       = 0x13,                          /**< ble_gap_conn_params_t::conn_sup_timeout. */
+    APP_CFG_ID_TARGET_UUID       = 0x20,                          /**< bridge_cfg_t::target_uuid. */
+    APP_CFG_ID_BAUDRATE          = 0x30,                          /**< uart_cfg_t::baudrate. */
+    APP_CFG_ID_LINE_LEN          = 0x31,                          /**< uart_cfg_t::line_len. */
+    APP_CFG_ID_STORE_FWD_POLICY  = 0x32,                          /**< uart_cfg_t::store_fwd_policy. */
+    APP_CFG_ID_COMPRESS          = 0x33,                          /**< bridge_cfg_t::compress. */
+    APP_CFG_ID_LINE_COALESCE     = 0x34,                          /**< bridge_cfg_t::line_coalesce. */
+    APP_CFG_ID_LZSS_TX_STATS     = 0x35,                          /**< lzss_stats_t of the data sent to the peer on the current link. Read only. */
+    APP_CFG_ID_LZSS_RX_STATS     = 0x36,                          /**< lzss_stats_t of the data notified by the peer on the current link. Read only. */
+    APP_CFG_ID_GW_MODE           = 0x40,                          /**< gw_cfg_t::mode. */
+    APP_CFG_ID_GW_AD_TYPE        = 0x41,                          /**< scan_gw_filter_t::ad_type. */
+    APP_CFG_ID_GW_RSSI_MIN       = 0x42,                          /**< scan_gw_filter_t::rssi_min. */
+    APP_CFG_ID_GW_DEDUP_MS       = 0x43,                          /**< scan_gw_filter_t::dedup_ms. */
+    APP_CFG_ID_QOS_TX_RATE       = 0x50,                          /**< ble_uart_c_qos_cfg_t::tx_rate. */
+    APP_CFG_ID_QOS_TX_BURST      = 0x51,                          /**< ble_uart_c_qos_cfg_t::tx_burst. */
+    APP_CFG_ID_QOS_RX_RATE       = 0x52,                          /**< ble_uart_c_qos_cfg_t::rx_rate. */
+    APP_CFG_ID_QOS_RX_BURST      = 0x53,                          /**< ble_uart_c_qos_cfg_t::rx_burst. */
+    APP_CFG_ID_QOS_RX_CLASS      = 0x54,                          /**< ble_uart_c_qos_cfg_t::rx_qos. */
+    APP_CFG_ID_QOS_RX_DROP       = 0x55,                          /**< ble_uart_c_qos_cfg_t::rx_drop. */
+    APP_CFG_ID_PROBE_MODE        = 0x60,                          /**< rtt_probe_cfg_t::mode. */
+    APP_CFG_ID_PROBE_LEN         = 0x61,                          /**< rtt_probe_cfg_t::len. */
+    APP_CFG_ID_PROBE_INTERVAL    = 0x62,                          /**< rtt_probe_cfg_t::interval_ms. */
+    APP_CFG_ID_LQ_REPORT         = 0x70,                          /**< link_quality_cfg_t::report. */
+    APP_CFG_ID_LQ_TX_POWER       = 0x71                           /**< link_quality_cfg_t::tx_power. */
+} app_cfg_id_t;
+
+#if KV_STORE_ENABLED
+/**@brief Keys of the bridge state kept in the key-value store. */
+typedef enum
+{
+    APP_KV_KEY_LINK_STATS,                                        /**< Link statistics, see @ref link_stats_t. */
+    APP_KV_KEY_CFG_LINK,                                          /**< Saved scan and connection parameters, see @ref link_cfg_t. */
+    APP_KV_KEY_CFG_TARGET_UUID,                                   /**< Saved target UUID. */
+    APP_KV_KEY_CFG_UART,                                          /**< Saved UART bridge parameters, see @ref uart_cfg_t. */
+    APP_KV_KEY_CFG_GW,                                            /**< Saved scanner gateway parameters, see @ref gw_cfg_t. */
+    APP_KV_KEY_CFG_QOS,                                           /**< Saved NUS rate limits, see @ref ble_uart_c_qos_cfg_t. */
+    APP_KV_KEY_CFG_PROBE,                                         /**< Saved round trip probe settings, see @ref rtt_probe_cfg_t. */
+    APP_KV_KEY_CFG_LQ,                                            /**< Saved link quality telemetry settings, see @ref link_quality_cfg_t. */
+    APP_KV_KEY_CFG_COMPRESS,                                      /**< Saved compression setting. */
+    APP_KV_KEY_CFG_LINE_COALESCE                                  /**< Saved line coalescing setting. Devices saved before it existed get the default. */
+} app_kv_key_t;
+
+/**@brief Link statistics kept across resets. */
+typedef struct
+{
+    uint32_t connections;                                         /**< Connections established. */
+    uint32_t disconnections;                                      /**< Connections lost or closed. */
+    uint32_t reconnections;                                       /**< Connections to a recent peer made without scanning. */
+} link_stats_t;
+#endif
+
+#if !BLE_UART_C_FAST_DISC_ENABLED
 static ble_db_discovery_t           m_ble_db_discovery;                  /**< Structure used to identify the DB Discovery module. */
+#endif
 static ble_uart_c_t                  m_ble_uart_c;                         /**< Structure used to identify the heart rate client module. */
+#if BLE_UART_C_REL_ENABLED
+static ble_uart_c_rel_t              m_ble_uart_c_rel;                     /**< Reliability layer on top of the NUS client. */
+#endif
+#if STORE_FWD_ENABLED
+static store_fwd_t                   m_store_fwd;                          /**< UART data held while the link is down. */
+#endif
+#if KV_STORE_ENABLED
+static link_stats_t                  m_link_stats;                         /**< Link statistics, saved in the key-value store. */
+#endif
+
+static uint8_t                       m_uart_line[UART_LINE_MAX_LEN];      /**< UART line being assembled, or held until it can be forwarded, unless it is in a NUS client write buffer. */
+static uint8_t                     * mp_uart_line = m_uart_line;         /**< Buffer of the UART line: a write buffer reserved from the NUS client, or @ref m_uart_line. */
+static uint8_t                       m_uart_line_len;                      /**< Number of bytes in the UART line. */
+static bool                          m_uart_rx_held;                       /**< Whether the receiver is stopped because the BLE TX queue is full. */
+static bool                          m_uart_line_ended;                    /**< Whether the UART line holds a newline, and goes out as soon as the BLE TX queue takes it. */
+static uint8_t                       m_uart_rx_skip;                       /**< Bytes left to drop of a line damaged by a UART error. */
+static uint8_t                     * m_uart_out[BUF_POOL_QUOTA_NUS_RX];   /**< Blocks of UART output waiting for room in the UART TX FIFO, oldest first. */
+static uint8_t                       m_uart_out_head;                      /**< Index of the oldest block in @ref m_uart_out. */
+static uint8_t                       m_uart_out_count;                     /**< Number of blocks in @ref m_uart_out. */
+static uint8_t                       m_uart_out_rd;                        /**< Bytes of the oldest block written to the UART. */
+static uint8_t                       m_uart_out_wr;                        /**< Bytes in the newest block. */
+static uint32_t                      m_uart_out_dropped;                   /**< Bytes of UART output dropped with no block to hold them. */
+static uint32_t                      m_uart_baudrate = UART_BAUDRATE_DEFAULT; /**< Current UART BAUDRATE register value. */
+static bridge_cfg_t                  m_cfg;                                /**< Bridge parameters in use. */
+#if LZSS_ENABLED
+static bool                          m_lzss_active;                        /**< Whether the current link is compressed, latched from @ref bridge_cfg_t::compress when it comes up. */
+static lzss_t                        m_lzss_tx;                            /**< Compression of the data sent to the peer. */
+static lzss_t                        m_lzss_rx;                            /**< Decompression of the data notified by the peer. */
+static uint8_t                       m_lzss_tx_rest[UART_LINE_MAX_LEN];    /**< Data accepted but left over from a full packet. */
+static uint8_t                       m_lzss_tx_rest_len;                   /**< Number of bytes in @ref m_lzss_tx_rest. */
+static uint8_t                       m_lzss_rx_buf[LZSS_DECODED_MAX(BLE_NUS_MAX_DATA_LEN)]; /**< Decompressed notification. */
+static lzss_stats_t                  m_lzss_tx_stats;                      /**< Copy of the statistics of @ref m_lzss_tx, taken when the host reads them. */
+static lzss_stats_t                  m_lzss_rx_stats;                      /**< Copy of the statistics of @ref m_lzss_rx, taken when the host reads them. */
+#endif
 
 static ble_gap_scan_params_t        m_scan_param;                        /**< Scan parameters requested for scanning and connection. */
 static dm_application_instance_t    m_dm_app_id;                         /**< Application identifier. */
 static dm_handle_t                  m_dm_device_handle;                  /**< Device Identifier identifier. */
 static uint8_t                      m_peer_count = 0;                    /**< Number of peer's connected. */
 static uint8_t                      m_scan_mode;                         /**< Scan mode used by application. */
+#if RECONNECT_PEER_COUNT > 0
+static ble_gap_addr_t               m_recent_peers[RECONNECT_PEER_COUNT]; /**< Peers connected to most recently, most recent first. */
+static uint8_t                      m_recent_peer_count;                 /**< Number of entries in @ref m_recent_peers. */
+#endif
 
-static bool                         m_memory_access_in_progress = false; /**< Flag to keep track of ongoing operations on persistent memory. */
+static bool                         m_scan_reduced = false;              /**< Whether scanning runs with a reduced window while flash work is pending. */
 
 uint8_t   nus_service_uuid[16] = {0x9E, 0xCA, 0xDC, 0x24, 0x0E, 0xE5, 0xA9, 0xE0,
                                      0x93, 0xF3, 0xA3, 0xB5, 0x01, 0x00, 0x40, 0x6E};
 /**
- * @brief Connection parameters requested for connection.
+ * @brief Connection parameters requested for connection, unless changed at runtime.
  */
 static const ble_gap_conn_params_t m_connection_param =
 {
@@ -122,7 +285,59 @@ static const ble_gap_conn_params_t m_connection_param =
     (uint16_t)SUPERVISION_TIMEOUT        // Supervision time-out
 };
 
+#if UART_CMD_ENABLED
+/**
+ * @brief Bridge parameters the host can read and set through the UART command channel.
+ */
+static const uart_cmd_param_t m_cfg_params[] =
+{
+    {APP_CFG_ID_SCAN_INTERVAL,     2,  true,  &m_cfg.link.scan_interval,                 0x0004, 0x4000},
+    {APP_CFG_ID_SCAN_WINDOW,       2,  true,  &m_cfg.link.scan_window,                   0x0004, 0x4000},
+    {APP_CFG_ID_MIN_CONN_INTERVAL, 2,  true,  &m_cfg.link.conn_params.min_conn_interval, 0x0006, 0x0C80},
+    {APP_CFG_ID_MAX_CONN_INTERVAL, 2,  true,  &m_cfg.link.conn_params.max_conn_interval, 0x0006, 0x0C80},
+    {APP_CFG_ID_SLAVE_LATENCY,     2,  true,  &m_cfg.link.conn_params.slave_latency,     0,      499},
+    {APP_CFG_ID_SUP_TIMEOUT,       2,  true,  &m_cfg.link.conn_params.conn_sup_timeout,  0x000A, 0x0C80},
+    {APP_CFG_ID_TARGET_UUID,       16, false, m_cfg.target_uuid,                         0,      0},
+    {APP_CFG_ID_BAUDRATE,          4,  true,  &m_cfg.uart.baudrate,                      0,      0xFFFFFFFF},
+    {APP_CFG_ID_LINE_LEN,          1,  true,  &m_cfg.uart.line_len,                      1,      UART_LINE_MAX_LEN},
+    {APP_CFG_ID_STORE_FWD_POLICY,  1,  true,  &m_cfg.uart.store_fwd_policy,              STORE_FWD_POLICY_DROP_OLDEST_RAM, STORE_FWD_POLICY_DROP_NEWEST},
+    {APP_CFG_ID_LINE_COALESCE,     1,  true,  &m_cfg.line_coalesce,                      0,      1},
+#if LZSS_ENABLED
+    {APP_CFG_ID_COMPRESS,          1,  true,  &m_cfg.compress,                           0,      1},
+    {APP_CFG_ID_LZSS_TX_STATS,     sizeof(lzss_stats_t), false, &m_lzss_tx_stats,        0,      0},
+    {APP_CFG_ID_LZSS_RX_STATS,     sizeof(lzss_stats_t), false, &m_lzss_rx_stats,        0,      0},
+#endif
+#if SCAN_GW_ENABLED
+    {APP_CFG_ID_GW_MODE,           1,  true,  &m_cfg.gw.mode,                            0,      1},
+    {APP_CFG_ID_GW_AD_TYPE,        1,  true,  &m_cfg.gw.filter.ad_type,                  0,      0xFF},
+    {APP_CFG_ID_GW_RSSI_MIN,       1,  true,  &m_cfg.gw.filter.rssi_min,                 0,      0xFF},
+    {APP_CFG_ID_GW_DEDUP_MS,       2,  true,  &m_cfg.gw.filter.dedup_ms,                 0,      0xFFFF},
+#endif
+#if BLE_UART_C_QOS_ENABLED
+    {APP_CFG_ID_QOS_TX_RATE,       4,  true,  &m_cfg.qos.tx_rate,                        0,      0xFFFFFFFF},
+    {APP_CFG_ID_QOS_TX_BURST,      2,  true,  &m_cfg.qos.tx_burst,                       2 * BLE_NUS_MAX_DATA_LEN, 0xFFFF},
+    {APP_CFG_ID_QOS_RX_RATE,       4,  true,  &m_cfg.qos.rx_rate,                        0,      0xFFFFFFFF},
+    {APP_CFG_ID_QOS_RX_BURST,      2,  true,  &m_cfg.qos.rx_burst,                       2 * BLE_NUS_MAX_DATA_LEN, 0xFFFF},
+    {APP_CFG_ID_QOS_RX_CLASS,      1,  true,  &m_cfg.qos.rx_qos,                         BLE_UART_C_QOS_CONTROL, BLE_UART_C_QOS_BULK},
+    {APP_CFG_ID_QOS_RX_DROP,       1,  true,  &m_cfg.qos.rx_drop,                        0,      1},
+#endif
+#if RTT_PROBE_ENABLED
+    {APP_CFG_ID_PROBE_MODE,        1,  true,  &m_cfg.probe.mode,                         0,      1},
+    {APP_CFG_ID_PROBE_LEN,         1,  true,  &m_cfg.probe.len,                          RTT_PROBE_HDR_LEN, BLE_NUS_MAX_DATA_LEN},
+    {APP_CFG_ID_PROBE_INTERVAL,    2,  true,  &m_cfg.probe.interval_ms,                  RTT_PROBE_INTERVAL_MIN_MS, 0xFFFF},
+#endif
+#if LINK_QUALITY_ENABLED
+    {APP_CFG_ID_LQ_REPORT,         1,  true,  &m_cfg.lq.report,                          0,      1},
+    {APP_CFG_ID_LQ_TX_POWER,       1,  true,  &m_cfg.lq.tx_power,                        LINK_QUALITY_TX_POWER_FIXED, LINK_QUALITY_TX_POWER_ADAPTIVE},
+#endif
+};
+#endif
+
 static void scan_start(void);
+static void reconnect_start(void);
+static void uart_rx_resume(void);
+static void uart_out_drain(void);
+uint32_t uart_baudrate_set(uint32_t baudrate);
 
 /**@brief Callback function for asserts in the SoftDevice.
  *
@@ -141,6 +356,92 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
 }
 
 
+#if KV_STORE_ENABLED
+/**@brief Function for saving the link statistics.
+ *
+ * @details The write is queued, and a later update replaces it if it has not reached flash yet.
+ */
+static void link_stats_save(void)
+{
+    uint32_t err_code = kv_store_set(APP_KV_KEY_LINK_STATS, &m_link_stats, sizeof(m_link_stats));
+
+    // A full queue only delays saving until the next update.
+    if (err_code != NRF_ERROR_NO_MEM)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+#endif
+
+
+/**@brief Function for starting the discovery of the NUS on a new link. Retried by @ref err_recovery.
+ */
+static uint32_t discovery_start(uint16_t conn_handle)
+{
+#if BLE_UART_C_FAST_DISC_ENABLED
+    return ble_uart_c_discover(&m_ble_uart_c, conn_handle);
+#else
+    return ble_db_discovery_start(&m_ble_db_discovery, conn_handle);
+#endif
+}
+
+
+/**@brief Function for starting security on the link of @ref m_dm_device_handle. Retried by
+ *        @ref err_recovery.
+ */
+static uint32_t security_setup(uint16_t conn_handle)
+{
+    UNUSED_PARAMETER(conn_handle);
+
+    return dm_security_setup_req(&m_dm_device_handle);
+}
+
+
+/**@brief Function for enabling notification of the RX characteristic. Retried by
+ *        @ref err_recovery.
+ *
+ * @details The NUS client serves the link it discovered last, so a retry for a link it has moved
+ *          away from fails, and that link is disconnected.
+ */
+static uint32_t rx_notif_enable(uint16_t conn_handle)
+{
+    if (m_ble_uart_c.conn_handle != conn_handle)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    return ble_uart_c_rx_notif_enable(&m_ble_uart_c);
+}
+
+
+#if RECONNECT_PEER_COUNT > 0
+/**@brief Function for moving a peer to the front of @ref m_recent_peers.
+ */
+static void recent_peer_add(const ble_gap_addr_t * p_addr)
+{
+    uint8_t i;
+
+    for (i = 0; i < m_recent_peer_count; i++)
+    {
+        if (memcmp(&m_recent_peers[i], p_addr, sizeof(ble_gap_addr_t)) == 0)
+        {
+            break;
+        }
+    }
+    if (i == m_recent_peer_count)
+    {
+        // A new peer replaces the least recent one when the list is full.
+        i = MIN(m_recent_peer_count, RECONNECT_PEER_COUNT - 1);
+        if (m_recent_peer_count < RECONNECT_PEER_COUNT)
+        {
+            m_recent_peer_count++;
+        }
+    }
+    memmove(&m_recent_peers[1], &m_recent_peers[0], i * sizeof(ble_gap_addr_t));
+    m_recent_peers[0] = *p_addr;
+}
+#endif
+
+
 /**@brief Callback handling device manager events.
  *
  * @details This function is called to notify the application of device manager events.
@@ -163,11 +464,27 @@ static ret_code_t device_manager_event_handler(const dm_handle_t    * p_handle,
             nrf_gpio_pin_set(CONNECTED_LED_PIN_NO);
 	    printf("Connected \r\n");
             m_dm_device_handle = (*p_handle);
+#if RECONNECT_PEER_COUNT > 0
+            recent_peer_add(&p_event->event_param.p_gap_param->params.connected.peer_addr);
+            if (m_scan_mode == BLE_RECONNECT_SCAN)
+            {
+                m_scan_mode = BLE_FAST_SCAN;
+                nrf_gpio_pin_clear(SCAN_LED_PIN_NO);
+#if KV_STORE_ENABLED
+                m_link_stats.reconnections++;
+#endif
+            }
+#endif
 
-            // Discover peer's services. 
-             err_code = ble_db_discovery_start(&m_ble_db_discovery,
-                                               p_event->event_param.p_gap_param->conn_handle);
-            APP_ERROR_CHECK(err_code);
+            // Discover peer's services. Discovery runs on one link at a time, so it is retried
+            // while another link is being discovered.
+            err_code = discovery_start(p_event->event_param.p_gap_param->conn_handle);
+            ERR_RECOVERY_CHECK(err_code, discovery_start, p_event->event_param.p_gap_param->conn_handle);
+
+#if KV_STORE_ENABLED
+            m_link_stats.connections++;
+            link_stats_save();
+#endif
 
             m_peer_count++;
             if (m_peer_count < MAX_PEER_COUNT)
@@ -179,14 +496,26 @@ static ret_code_t device_manager_event_handler(const dm_handle_t    * p_handle,
         
         case DM_EVT_DISCONNECTION:
         {
+            err_recovery_link_down(p_event->event_param.p_gap_param->conn_handle);
+#if !BLE_UART_C_FAST_DISC_ENABLED
             memset(&m_ble_db_discovery, 0 , sizeof (m_ble_db_discovery));
+#endif
+#if STORE_FWD_ENABLED
+            store_fwd_link_down(&m_store_fwd);
+#endif
+            // A line held for the lost link is now stored or dropped.
+            uart_rx_resume();
+#if KV_STORE_ENABLED
+            m_link_stats.disconnections++;
+            link_stats_save();
+#endif
 
             nrf_gpio_pin_clear(CONNECTED_LED_PIN_NO);
-            if (m_peer_count == MAX_PEER_COUNT)
+            m_peer_count--;
+            if (m_peer_count == MAX_PEER_COUNT - 1)
             {
-                scan_start();
+                reconnect_start();
             }
-            m_peer_count--;
             break;
         }
         
@@ -194,15 +523,15 @@ static ret_code_t device_manager_event_handler(const dm_handle_t    * p_handle,
         {
             // Slave securtiy request received from peer, if from a non bonded device, 
             // initiate security setup, else, wait for encryption to complete.
-            err_code = dm_security_setup_req(&m_dm_device_handle);
-            APP_ERROR_CHECK(err_code);
+            err_code = security_setup(p_event->event_param.p_gap_param->conn_handle);
+            ERR_RECOVERY_CHECK(err_code, security_setup, p_event->event_param.p_gap_param->conn_handle);
             break;
         }
         case DM_EVT_SECURITY_SETUP_COMPLETE:
         {    
             // Nordic UART service discovered. Enable notification of RX channel.
-            err_code = ble_uart_c_rx_notif_enable(&m_ble_uart_c);
-            APP_ERROR_CHECK(err_code);
+            err_code = rx_notif_enable(p_event->event_param.p_gap_param->conn_handle);
+            ERR_RECOVERY_CHECK(err_code, rx_notif_enable, p_event->event_param.p_gap_param->conn_handle);
             break;
         }
         
@@ -228,157 +557,535 @@ static ret_code_t device_manager_event_handler(const dm_handle_t    * p_handle,
     return NRF_SUCCESS;
 }
 
-/**@brief   Function for handling app_uart events.
+/**@brief Function for sending a packet to the peer as it is.
  *
- * @details This function will receive a single character from the app_uart module and append it to 
- *          a string. The string will be be sent over BLE when the last character received was a 
- *          'new line' i.e '\n' (hex 0x0D) or if the string has reached a length of 
- *          @ref NUS_MAX_DATA_LENGTH.
+ * @retval NRF_ERROR_INVALID_STATE If there is no link to the peer.
+ * @retval NRF_ERROR_NO_MEM        If the TX queue or window is full.
+ * @retval NRF_ERROR_BUSY          If the link is over its rate limit.
  */
-/**@snippet [Handling the data received over UART] */
-void uart_event_handle(app_uart_evt_t * p_event)
+static uint32_t nus_packet_send(const uint8_t * p_data, uint16_t len)
 {
-    static uint8_t data_array[BLE_NUS_MAX_DATA_LEN];
-    static uint8_t index = 0;
-    uint32_t err_code;
+#if BLE_UART_C_REL_ENABLED
+    return ble_uart_c_rel_send(&m_ble_uart_c_rel, p_data, len);
+#else
+    return ble_uart_c_write_string(&m_ble_uart_c, p_data, len);
+#endif
+}
 
-    switch (p_event->evt_type)
-    {
-        case APP_UART_DATA_READY:
-            UNUSED_VARIABLE(app_uart_get(&data_array[index]));
-            index++;
 
-            if ((data_array[index - 1] == '\n') || (index >= (BLE_NUS_MAX_DATA_LEN)))
-            {
-                err_code = ble_uart_c_write_string(&m_ble_uart_c, data_array, index);
-                if (err_code != NRF_ERROR_INVALID_STATE)
-                {
-                    APP_ERROR_CHECK(err_code);
-                }
-                
-                index = 0;
-            }
-            break;
+#if LZSS_ENABLED
+/**@brief Function for resetting the compression at the start of a link. The peer does the same.
+ */
+static void lzss_link_start(void)
+{
+    m_lzss_active      = (m_cfg.compress != 0);
+    m_lzss_tx_rest_len = 0;
+    lzss_reset(&m_lzss_tx);
+    lzss_reset(&m_lzss_rx);
+}
 
-        case APP_UART_COMMUNICATION_ERROR:
-            APP_ERROR_HANDLER(p_event->data.error_communication);
-            break;
 
-        case APP_UART_FIFO_ERROR:
-            APP_ERROR_HANDLER(p_event->data.error_code);
-            break;
+/**@brief Function for sending data in packets, compressed, up to the first packet refused.
+ *
+ * @param[in]  p_data     Data to send.
+ * @param[in]  len        Length of the data.
+ * @param[out] p_consumed Bytes of the data sent.
+ */
+static uint32_t lzss_packets_send(const uint8_t * p_data, uint16_t len, uint16_t * p_consumed)
+{
+    uint8_t  packet[UART_LINE_MAX_LEN];
+    uint16_t packet_len;
+    uint16_t consumed;
+    uint32_t err_code = NRF_SUCCESS;
 
-        default:
+    *p_consumed = 0;
+    while (*p_consumed < len)
+    {
+        packet_len = lzss_encode(&m_lzss_tx, &p_data[*p_consumed], len - *p_consumed,
+                                 packet, sizeof(packet), &consumed);
+        err_code   = nus_packet_send(packet, packet_len);
+        if (err_code != NRF_SUCCESS)
+        {
             break;
-            }
+        }
+        lzss_encode_commit(&m_lzss_tx, &p_data[*p_consumed], consumed, packet_len);
+        *p_consumed += consumed;
+    }
+    return err_code;
 }
-/**@snippet [Handling the data received over UART] */
 
 
-/**
- * @brief Parses advertisement data, providing length and location of the field in case
- *        matching data is found.
- *
- * @param[in]  Type of data to be looked for in advertisement data.
- * @param[in]  Advertisement report length and pointer to report.
- * @param[out] If data type requested is found in the data report, type data length and
- *             pointer to data will be populated here.
+/**@brief Function for sending what is left over of data already accepted.
  *
- * @retval NRF_SUCCESS if the data type is found in the report.
- * @retval NRF_ERROR_NOT_FOUND if the data type could not be found.
+ * @return NRF_SUCCESS once nothing is left over, otherwise the error that stopped it.
  */
-static uint32_t adv_report_parse(uint8_t type, data_t * p_advdata, data_t * p_typedata)
+static uint32_t lzss_tx_rest_send(void)
 {
-    uint32_t index = 0;
-    uint8_t * p_data;
-
-    p_data = p_advdata->p_data;
+    uint16_t consumed;
+    uint32_t err_code;
 
-    while (index < p_advdata->data_len)
+    if (m_lzss_tx_rest_len == 0)
     {
-        uint8_t field_length = p_data[index];
-        uint8_t field_type = p_data[index+1];
+        return NRF_SUCCESS;
+    }
+    err_code = lzss_packets_send(m_lzss_tx_rest, m_lzss_tx_rest_len, &consumed);
+    m_lzss_tx_rest_len -= (uint8_t)consumed;
+    memmove(m_lzss_tx_rest, &m_lzss_tx_rest[consumed], m_lzss_tx_rest_len);
+    return err_code;
+}
+#endif
 
-        if (field_type == type)
+
+/**@brief Function for sending a packet of UART data to the peer, compressed if the link is.
+ *
+ * @details A compressed packet that does not take all of the data is followed by another one.
+ *          Once the first has been accepted the data counts as sent, and the rest goes out
+ *          ahead of the next data.
+ *
+ * @retval NRF_ERROR_INVALID_STATE If there is no link to the peer.
+ * @retval NRF_ERROR_NO_MEM        If the TX queue or window is full.
+ * @retval NRF_ERROR_BUSY          If the link is over its rate limit.
+ */
+static uint32_t nus_send(const uint8_t * p_data, uint16_t len)
+{
+#if LZSS_ENABLED
+    uint16_t consumed;
+    uint32_t err_code;
+
+    if (m_lzss_active)
+    {
+        err_code = lzss_tx_rest_send();
+        if (err_code != NRF_SUCCESS)
         {
-            p_typedata->p_data = &p_data[index+2];
-            p_typedata->data_len = field_length-1;
-            return NRF_SUCCESS;
+            return err_code;
         }
-        index += field_length+1;
+        err_code = lzss_packets_send(p_data, len, &consumed);
+        if ((consumed == 0) || (consumed == len))
+        {
+            return err_code;
+        }
+        m_lzss_tx_rest_len = (uint8_t)(len - consumed);
+        memcpy(m_lzss_tx_rest, &p_data[consumed], m_lzss_tx_rest_len);
+        return NRF_SUCCESS;
     }
-    return NRF_ERROR_NOT_FOUND;
+#endif
+    return nus_packet_send(p_data, len);
 }
 
 
+/**@brief Function for checking whether a line can go straight to the NUS client, with nothing
+ *        buffered ahead of it and no layer in between that rewrites it.
+ */
+static bool uart_line_direct(void)
+{
+#if BLE_UART_C_REL_ENABLED
+    return false;
+#else
+#if LZSS_ENABLED
+    if (m_lzss_active)
+    {
+        return false;
+    }
+#endif
+#if STORE_FWD_ENABLED
+    if (!store_fwd_is_empty(&m_store_fwd))
+    {
+        return false;
+    }
+#endif
+    return true;
+#endif
+}
+
 
-/**@brief Function for handling the Application's BLE Stack events.
+/**@brief Function for choosing the buffer a new line is assembled in.
  *
- * @param[in]   p_ble_evt   Bluetooth stack event.
+ * @details A line that can go straight to the NUS client is assembled in a write buffer reserved
+ *          from it, so its bytes are copied once on their way to the SoftDevice. Otherwise, or if
+ *          no buffer is free, it is assembled in @ref m_uart_line.
  */
-static void on_ble_evt(ble_evt_t * p_ble_evt)
+static void uart_line_start(void)
 {
-    uint32_t                err_code;
-    const ble_gap_evt_t   * p_gap_evt = &p_ble_evt->evt.gap_evt;
+    uint8_t * p_buf;
 
-    switch (p_ble_evt->header.evt_id)
+    if (!uart_line_direct())
     {
-        case BLE_GAP_EVT_ADV_REPORT:
+        if (mp_uart_line != m_uart_line)
         {
-            data_t adv_data;
-            data_t type_data;
-            
-            // Initialize advertisement report for parsing.
-            adv_data.p_data = (uint8_t *)p_gap_evt->params.adv_report.data;
-            adv_data.data_len = p_gap_evt->params.adv_report.dlen;
+            ble_uart_c_write_cancel(mp_uart_line);
+            mp_uart_line = m_uart_line;
+        }
+        return;
+    }
 
-            err_code = adv_report_parse(BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE,
-                                        &adv_data,
-                                        &type_data);
-            if (err_code != NRF_SUCCESS)
+    // A buffer left from a dropped line is used again.
+    if (mp_uart_line == m_uart_line)
+    {
+        p_buf = ble_uart_c_write_reserve(&m_ble_uart_c);
+        if (p_buf != NULL)
+        {
+            mp_uart_line = p_buf;
+        }
+    }
+}
+
+
+/**@brief Function for passing the UART line towards the peer.
+ *
+ * @details While the link is up, the line is only accepted if the BLE TX queue can take it
+ *          without anything being buffered behind it, so that the BLE link rather than the
+ *          buffers sets the pace of the host.
+ *
+ * @return false if the line must be held until the BLE TX queue has room.
+ */
+static bool uart_line_forward(void)
+{
+    uint32_t err_code;
+
+    if (mp_uart_line != m_uart_line)
+    {
+        if (uart_line_direct())
+        {
+            err_code = ble_uart_c_write_commit(&m_ble_uart_c, mp_uart_line, m_uart_line_len,
+                                               BLE_UART_C_QOS_DATA);
+            if ((err_code == NRF_ERROR_NO_MEM) || (err_code == NRF_ERROR_BUSY))
             {
-                // Compare 128 UUID.
-                err_code = adv_report_parse(BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE,
-                                            &adv_data,
-                                            &type_data);
+                return false;
             }
-
-            // Verify if short or complete name matches target.
             if (err_code == NRF_SUCCESS)
             {
-               
-											
-                    if(!memcmp( nus_service_uuid,type_data.p_data,16))
-                    {
-                        // Stop scanning.
-                        err_code = sd_ble_gap_scan_stop();
-                        if (err_code != NRF_SUCCESS)
-                        {
-                            printf("[APPL]: Scan stop failed, reason %d\r\n", (int)err_code);
-                        }
-                        nrf_gpio_pin_clear(SCAN_LED_PIN_NO);
-                        
-                        m_scan_param.selective = 0; 
-
-                        // Initiate connection.
-                        err_code = sd_ble_gap_connect(&p_gap_evt->params.adv_report.\
-                                                       peer_addr,
-                                                       &m_scan_param,
-                                                       &m_connection_param);
-
-                        if (err_code != NRF_SUCCESS)
-                        {
-                            printf("[APPL]: Connection Request Failed, reason %d\r\n", (int)err_code);
-                        }
-                        break;
-                    }
-               // }
+                mp_uart_line    = m_uart_line;
+                m_uart_line_len = 0;
+                return true;
             }
-            break;
         }
-        case BLE_GAP_EVT_TIMEOUT:
-            if(p_gap_evt->params.timeout.src == BLE_GAP_TIMEOUT_SRC_SCAN)
-            {
+
+        // The link went down or something got buffered meanwhile, so the line takes the long way.
+        memcpy(m_uart_line, mp_uart_line, m_uart_line_len);
+        ble_uart_c_write_cancel(mp_uart_line);
+        mp_uart_line = m_uart_line;
+    }
+
+#if STORE_FWD_ENABLED
+    if (store_fwd_is_congested(&m_store_fwd))
+    {
+        return false;
+    }
+    err_code = store_fwd_write(&m_store_fwd, m_uart_line, m_uart_line_len);
+#else
+    err_code = nus_send(m_uart_line, m_uart_line_len);
+    if ((err_code == NRF_ERROR_NO_MEM) || (err_code == NRF_ERROR_BUSY))
+    {
+        return false;
+    }
+#endif
+    // Data that could not be sent or stored is dropped.
+    ERR_RECOVERY_CHECK(err_code, NULL, BLE_CONN_HANDLE_INVALID);
+
+    m_uart_line_len = 0;
+    return true;
+}
+
+
+/**@brief Function for getting the next data byte from the UART RX FIFO, passing command frames
+ *        to the command channel.
+ *
+ * @return true if a byte was returned, false if the FIFO is empty.
+ */
+static bool uart_data_get(uint8_t * p_byte)
+{
+#if UART_CMD_ENABLED
+    // Bytes held back as the start of a command that turned out to be data come first.
+    if (uart_cmd_held_get(p_byte))
+    {
+        return true;
+    }
+#endif
+    while (app_uart_get(p_byte) == NRF_SUCCESS)
+    {
+#if EVT_TRACE_ENABLED
+        evt_trace_uart_rx(*p_byte);
+#endif
+#if UART_CMD_ENABLED
+        if (!uart_cmd_on_rx(p_byte))
+        {
+            if (uart_cmd_held_get(p_byte))
+            {
+                return true;
+            }
+            continue;
+        }
+#endif
+        return true;
+    }
+    return false;
+}
+
+
+/**@brief Function for assembling lines from the bytes in the UART RX FIFO.
+ *
+ * @details Every byte in the FIFO is read in one pass, and a line is sent when it is full or,
+ *          once the FIFO is drained, if it holds a newline. While the BLE TX queue has no room,
+ *          a line that holds a newline stays open and the lines after it are added to the same
+ *          packet, which goes out with the next write completed. Short lines then share packets
+ *          instead of taking a GATT write each, and a line on an idle link still goes out at its
+ *          newline. This is done only with @ref bridge_cfg_t::line_coalesce on. Otherwise, the
+ *          default, every newline ends a packet.
+ *
+ *          A full line that cannot be forwarded stops the receiver, which deasserts RTS so that
+ *          the host stops sending. Bytes already in flight end up in the RX FIFO, and are left
+ *          there until @ref uart_rx_resume is called.
+ */
+static void uart_rx_process(void)
+{
+    uint8_t byte;
+
+    while (!m_uart_rx_held)
+    {
+        if (!uart_data_get(&byte))
+        {
+            if (m_uart_line_ended && uart_line_forward())
+            {
+                m_uart_line_ended = false;
+            }
+            break;
+        }
+        if (m_uart_rx_skip != 0)
+        {
+            m_uart_rx_skip = (byte == '\n') ? 0 : (m_uart_rx_skip - 1);
+            continue;
+        }
+        if (m_uart_line_len == 0)
+        {
+            uart_line_start();
+        }
+        mp_uart_line[m_uart_line_len++] = byte;
+
+        if (byte == '\n')
+        {
+            m_uart_line_ended = true;
+        }
+        if ((m_uart_line_ended && !m_cfg.line_coalesce) ||
+            (m_uart_line_len >= m_cfg.uart.line_len))
+        {
+            m_uart_line_ended = false;
+            if (!uart_line_forward())
+            {
+#if LINK_QUALITY_ENABLED
+                link_quality_tx_retried(m_ble_uart_c.conn_handle);
+#endif
+                m_uart_rx_held          = true;
+                NRF_UART0->TASKS_STOPRX = 1;
+            }
+        }
+    }
+}
+
+
+/**@brief Function for forwarding a held line and restarting the receiver, or forwarding a line
+ *        that ended while the BLE TX queue had no room.
+ *
+ * @details Call this whenever the BLE TX queue may have room again, or the link has gone down.
+ */
+static void uart_rx_resume(void)
+{
+    if (!m_uart_rx_held)
+    {
+        if (m_uart_line_ended && uart_line_forward())
+        {
+            m_uart_line_ended = false;
+        }
+        return;
+    }
+    if (!uart_line_forward())
+    {
+        return;
+    }
+
+    m_uart_rx_held           = false;
+    NRF_UART0->TASKS_STARTRX = 1;
+    uart_rx_process();
+}
+
+
+/**@brief Function for resynchronizing the UART input after a UART error.
+ *
+ * @details The error has cost bytes of the line being assembled, so that line and the rest of
+ *          it, up to the next newline or a full line, are dropped. A line held complete is kept.
+ */
+static void uart_resync(void)
+{
+    if (!m_uart_rx_held)
+    {
+        m_uart_line_len   = 0;
+        m_uart_line_ended = false;
+        m_uart_rx_skip    = m_cfg.uart.line_len;
+    }
+#if UART_CMD_ENABLED
+    uart_cmd_reset();
+#endif
+}
+
+
+/**@brief   Function for handling app_uart events.
+ *
+ * @details This function will receive characters from the app_uart module and append them to 
+ *          a string. The string will be be sent over BLE when the last character received was a 
+ *          'new line' i.e '\n' (hex 0x0D) or if the string has reached a length of 
+ *          @ref NUS_MAX_DATA_LENGTH.
+ */
+/**@snippet [Handling the data received over UART] */
+void uart_event_handle(app_uart_evt_t * p_event)
+{
+    uint32_t err_code;
+
+    switch (p_event->evt_type)
+    {
+        case APP_UART_DATA_READY:
+            uart_rx_process();
+            break;
+
+        case APP_UART_COMMUNICATION_ERROR:
+            err_recovery_uart_error(p_event->data.error_communication);
+            break;
+
+        case APP_UART_FIFO_ERROR:
+            err_recovery_uart_error(p_event->data.error_code);
+            break;
+
+        case APP_UART_TX_EMPTY:
+            if (m_uart_out_count != 0)
+            {
+                uart_out_drain();
+                break;
+            }
+            // A new rate is applied once the response that confirmed it has gone out.
+            if (m_cfg.uart.baudrate != m_uart_baudrate)
+            {
+                err_code = uart_baudrate_set(m_cfg.uart.baudrate);
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        default:
+            break;
+            }
+}
+/**@snippet [Handling the data received over UART] */
+
+
+/**
+ * @brief Parses advertisement data, providing length and location of the field in case
+ *        matching data is found.
+ *
+ * @param[in]  Type of data to be looked for in advertisement data.
+ * @param[in]  Advertisement report length and pointer to report.
+ * @param[out] If data type requested is found in the data report, type data length and
+ *             pointer to data will be populated here.
+ *
+ * @retval NRF_SUCCESS if the data type is found in the report.
+ * @retval NRF_ERROR_NOT_FOUND if the data type could not be found.
+ */
+static uint32_t adv_report_parse(uint8_t type, data_t * p_advdata, data_t * p_typedata)
+{
+    uint32_t index = 0;
+    uint8_t * p_data;
+
+    p_data = p_advdata->p_data;
+
+    while (index < p_advdata->data_len)
+    {
+        uint8_t field_length = p_data[index];
+        uint8_t field_type = p_data[index+1];
+
+        if (field_type == type)
+        {
+            p_typedata->p_data = &p_data[index+2];
+            p_typedata->data_len = field_length-1;
+            return NRF_SUCCESS;
+        }
+        index += field_length+1;
+    }
+    return NRF_ERROR_NOT_FOUND;
+}
+
+
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @param[in]   p_ble_evt   Bluetooth stack event.
+ */
+static void on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    uint32_t                err_code;
+    const ble_gap_evt_t   * p_gap_evt = &p_ble_evt->evt.gap_evt;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_ADV_REPORT:
+        {
+            data_t adv_data;
+            data_t type_data;
+
+#if SCAN_GW_ENABLED
+            if (m_cfg.gw.mode != 0)
+            {
+                scan_gw_on_adv_report(&p_gap_evt->params.adv_report);
+                break;
+            }
+#endif
+            
+            // Initialize advertisement report for parsing.
+            adv_data.p_data = (uint8_t *)p_gap_evt->params.adv_report.data;
+            adv_data.data_len = p_gap_evt->params.adv_report.dlen;
+
+            err_code = adv_report_parse(BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE,
+                                        &adv_data,
+                                        &type_data);
+            if (err_code != NRF_SUCCESS)
+            {
+                // Compare 128 UUID.
+                err_code = adv_report_parse(BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE,
+                                            &adv_data,
+                                            &type_data);
+            }
+
+            // Verify if short or complete name matches target.
+            if (err_code == NRF_SUCCESS)
+            {
+               
+											
+                    if(!memcmp( m_cfg.target_uuid,type_data.p_data,16))
+                    {
+                        // Stop scanning.
+                        err_code = sd_ble_gap_scan_stop();
+                        if (err_code != NRF_SUCCESS)
+                        {
+                            printf("[APPL]: Scan stop failed, reason %d\r\n", (int)err_code);
+                        }
+                        nrf_gpio_pin_clear(SCAN_LED_PIN_NO);
+                        
+                        m_scan_param.selective = 0; 
+
+                        // Initiate connection.
+                        err_code = sd_ble_gap_connect(&p_gap_evt->params.adv_report.\
+                                                       peer_addr,
+                                                       &m_scan_param,
+                                                       &m_cfg.link.conn_params);
+
+                        if (err_code != NRF_SUCCESS)
+                        {
+                            printf("[APPL]: Connection Request Failed, reason %d\r\n", (int)err_code);
+                        }
+                        break;
+                    }
+               // }
+            }
+            break;
+        }
+        case BLE_GAP_EVT_TIMEOUT:
+            if(p_gap_evt->params.timeout.src == BLE_GAP_TIMEOUT_SRC_SCAN)
+            {
                 if (m_scan_mode ==  BLE_WHITELIST_SCAN)
                 {
                     m_scan_mode = BLE_FAST_SCAN;
@@ -389,36 +1096,50 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
             }
             else if (p_gap_evt->params.timeout.src == BLE_GAP_TIMEOUT_SRC_CONN)
             {
-                //
+                if (m_scan_mode == BLE_RECONNECT_SCAN)
+                {
+                    // No recent peer is back, so look for any peer.
+                    m_scan_mode = BLE_FAST_SCAN;
+                    scan_start();
+                }
             }
             break;
         case BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST:
-            // Accepting parameters requested by peer.
+            // Accepting parameters requested by peer. If the SoftDevice is busy, the peer
+            // repeats its request.
             err_code = sd_ble_gap_conn_param_update(p_gap_evt->conn_handle,
                                                     &p_gap_evt->params.conn_param_update_request.conn_params);
-            APP_ERROR_CHECK(err_code);
+            ERR_RECOVERY_CHECK(err_code, NULL, p_gap_evt->conn_handle);
             break;
         default:
             break;
     }
 }
 
-/**@brief Function for handling the Application's system events.
+/**@brief Function for handling flash scheduler events.
+ *
+ * @details Scanning started while flash work was pending runs with a reduced window. Restart it
+ *          with the full window once flash is idle.
  *
- * @param[in]   sys_evt   system event.
+ * @param[in]   p_evt   Flash scheduler event.
  */
-static void on_sys_evt(uint32_t sys_evt)
+static void flash_sched_evt_handler(const flash_sched_evt_t * p_evt)
 {
-    switch(sys_evt)
+    switch (p_evt->evt_type)
     {
-        case NRF_EVT_FLASH_OPERATION_SUCCESS:
-        case NRF_EVT_FLASH_OPERATION_ERROR:
-            if (m_memory_access_in_progress)
+        case FLASH_SCHED_EVT_IDLE:
+            if (m_scan_reduced)
             {
-                m_memory_access_in_progress = false;
-                scan_start();
+                m_scan_reduced = false;
+
+                // Fails if scanning has already stopped, in which case there is nothing to restore.
+                if (sd_ble_gap_scan_stop() == NRF_SUCCESS)
+                {
+                    scan_start();
+                }
             }
             break;
+
         default:
             // No implementation needed.
             break;
@@ -426,6 +1147,104 @@ static void on_sys_evt(uint32_t sys_evt)
 }
 
 
+#if !BLE_UART_C_FAST_DISC_ENABLED
+/**@brief Function for passing a BLE stack event to the DB Discovery module.
+ */
+static void db_discovery_ble_evt_route(ble_evt_t * p_ble_evt)
+{
+    ble_db_discovery_on_ble_evt(&m_ble_db_discovery, p_ble_evt);
+}
+#endif
+
+
+/**@brief Function for passing a BLE stack event to the NUS client.
+ */
+static void uart_c_ble_evt_route(ble_evt_t * p_ble_evt)
+{
+    ble_uart_c_on_ble_evt(&m_ble_uart_c, p_ble_evt);
+}
+
+
+/**@brief Function for registering the modules with a BLE stack event handler with the router.
+ *
+ * @details Each module only gets the events it acts on, so the frequent advertising reports and
+ *          notifications skip the modules that would ignore them. The ranges must be kept in
+ *          line with the events the modules handle.
+ */
+static void ble_evt_router_init(void)
+{
+    uint32_t err_code;
+
+    // The device manager acts on connection and security events.
+    static const ble_evt_router_range_t dm_ranges[] =
+    {
+        {BLE_GAP_EVT_BASE,              BLE_GAP_EVT_ADV_REPORT - 1},
+        {BLE_GAP_EVT_ADV_REPORT + 1,    BLE_GAP_EVT_LAST}
+    };
+#if !BLE_UART_C_FAST_DISC_ENABLED
+    static const ble_evt_router_range_t db_discovery_ranges[] =
+    {
+        {BLE_GAP_EVT_DISCONNECTED,          BLE_GAP_EVT_DISCONNECTED},
+        {BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP,  BLE_GATTC_EVT_DESC_DISC_RSP}
+    };
+#endif
+    static const ble_evt_router_range_t uart_c_ranges[] =
+    {
+        {BLE_EVT_TX_COMPLETE,           BLE_EVT_TX_COMPLETE},
+        {BLE_GAP_EVT_CONNECTED,         BLE_GAP_EVT_DISCONNECTED},
+#if BLE_UART_C_FAST_DISC_ENABLED
+        {BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP, BLE_GATTC_EVT_DESC_DISC_RSP},
+#endif
+        {BLE_GATTC_EVT_HVX,             BLE_GATTC_EVT_HVX},
+        {BLE_GATTC_EVT_WRITE_RSP,       BLE_GATTC_EVT_WRITE_RSP},
+        {BLE_GATTC_EVT_TIMEOUT,         BLE_GATTC_EVT_TIMEOUT}
+    };
+#if LINK_QUALITY_ENABLED
+    static const ble_evt_router_range_t link_quality_ranges[] =
+    {
+        {BLE_GAP_EVT_CONNECTED,         BLE_GAP_EVT_DISCONNECTED},
+        {BLE_GAP_EVT_RSSI_CHANGED,      BLE_GAP_EVT_RSSI_CHANGED},
+        {BLE_GATTC_EVT_WRITE_RSP,       BLE_GATTC_EVT_WRITE_RSP}
+    };
+#endif
+    static const ble_evt_router_range_t app_ranges[] =
+    {
+        {BLE_GAP_EVT_ADV_REPORT,                BLE_GAP_EVT_ADV_REPORT},
+        {BLE_GAP_EVT_TIMEOUT,                   BLE_GAP_EVT_TIMEOUT},
+        {BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST}
+    };
+
+    err_code = ble_evt_router_register(dm_ble_evt_handler,
+                                       dm_ranges,
+                                       sizeof(dm_ranges) / sizeof(dm_ranges[0]));
+    APP_ERROR_CHECK(err_code);
+
+#if !BLE_UART_C_FAST_DISC_ENABLED
+    err_code = ble_evt_router_register(db_discovery_ble_evt_route,
+                                       db_discovery_ranges,
+                                       sizeof(db_discovery_ranges) / sizeof(db_discovery_ranges[0]));
+    APP_ERROR_CHECK(err_code);
+#endif
+
+    err_code = ble_evt_router_register(uart_c_ble_evt_route,
+                                       uart_c_ranges,
+                                       sizeof(uart_c_ranges) / sizeof(uart_c_ranges[0]));
+    APP_ERROR_CHECK(err_code);
+
+#if LINK_QUALITY_ENABLED
+    err_code = ble_evt_router_register(link_quality_on_ble_evt,
+                                       link_quality_ranges,
+                                       sizeof(link_quality_ranges) / sizeof(link_quality_ranges[0]));
+    APP_ERROR_CHECK(err_code);
+#endif
+
+    err_code = ble_evt_router_register(on_ble_evt,
+                                       app_ranges,
+                                       sizeof(app_ranges) / sizeof(app_ranges[0]));
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for dispatching a BLE stack event to all modules with a BLE stack event handler.
  *
  * @details This function is called from the scheduler in the main loop after a BLE stack event has
@@ -435,11 +1254,10 @@ static void on_sys_evt(uint32_t sys_evt)
  */
 static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
 {
-    dm_ble_evt_handler(p_ble_evt);
-    ble_db_discovery_on_ble_evt(&m_ble_db_discovery, p_ble_evt);
-    ble_uart_c_on_ble_evt(&m_ble_uart_c, p_ble_evt);
-
-    on_ble_evt(p_ble_evt);
+#if EVT_TRACE_ENABLED
+    evt_trace_ble(p_ble_evt);
+#endif
+    ble_evt_router_dispatch(p_ble_evt);
 }
 
 
@@ -452,8 +1270,11 @@ static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
  */
 static void sys_evt_dispatch(uint32_t sys_evt)
 {
+#if EVT_TRACE_ENABLED
+    evt_trace_sys(sys_evt);
+#endif
     pstorage_sys_event_handler(sys_evt);
-    on_sys_evt(sys_evt);
+    flash_sched_on_sys_evt(sys_evt);
 }
 
 
@@ -479,6 +1300,7 @@ static void ble_stack_init(void)
     APP_ERROR_CHECK(err_code);
 
     // Register with the SoftDevice handler module for BLE events.
+    ble_evt_router_init();
     err_code = softdevice_ble_evt_handler_set(ble_evt_dispatch);
     APP_ERROR_CHECK(err_code);
 
@@ -502,6 +1324,10 @@ static void device_manager_init(void)
     err_code = pstorage_init();
     APP_ERROR_CHECK(err_code);
 
+    err_code = flash_sched_init(flash_sched_evt_handler,
+                                APP_TIMER_TICKS(FLASH_SCHED_MAX_DEFER_MS, APP_TIMER_PRESCALER));
+    APP_ERROR_CHECK(err_code);
+
 //    // Clear all bonded devices if user requests to.
 //    init_param.clear_persistent_data =
 //        ((nrf_gpio_pin_read(BOND_DELETE_ALL_BUTTON_ID) == 0)? true: false);
@@ -557,6 +1383,192 @@ static void power_manage(void)
 }
 
 
+/**@brief Function for moving UART output waiting in blocks to the UART TX FIFO, as far as it
+ *        takes it.
+ */
+static void uart_out_drain(void)
+{
+    uint8_t * p_block;
+    uint8_t   end;
+
+    while (m_uart_out_count != 0)
+    {
+        p_block = m_uart_out[m_uart_out_head];
+        end     = (m_uart_out_count == 1) ? m_uart_out_wr : BUF_POOL_BLOCK_SIZE;
+        while (m_uart_out_rd < end)
+        {
+            if (app_uart_put(p_block[m_uart_out_rd]) != NRF_SUCCESS)
+            {
+                return;
+            }
+            m_uart_out_rd++;
+        }
+
+        buf_pool_free(BUF_POOL_USER_NUS_RX, p_block);
+        m_uart_out_head = (m_uart_out_head + 1) % BUF_POOL_QUOTA_NUS_RX;
+        m_uart_out_count--;
+        m_uart_out_rd   = 0;
+        if (m_uart_out_count == 0)
+        {
+            m_uart_out_wr = 0;
+        }
+    }
+}
+
+
+/**@brief Function for writing a byte to the UART, behind any output waiting for room.
+ *
+ * @details When the UART TX FIFO is full, the byte waits in a block of the @ref buf_pool until
+ *          @ref APP_UART_TX_EMPTY. Waiting for the FIFO here instead would never end, since the
+ *          UART interrupt that empties it has the same priority as the callers.
+ */
+static void uart_out_put(uint8_t byte)
+{
+    uint8_t * p_block;
+
+    if (m_uart_out_count != 0)
+    {
+        uart_out_drain();
+    }
+    if ((m_uart_out_count == 0) && (app_uart_put(byte) == NRF_SUCCESS))
+    {
+        return;
+    }
+
+    if ((m_uart_out_count == 0) || (m_uart_out_wr == BUF_POOL_BLOCK_SIZE))
+    {
+        p_block = NULL;
+        if (m_uart_out_count < BUF_POOL_QUOTA_NUS_RX)
+        {
+            p_block = buf_pool_alloc(BUF_POOL_USER_NUS_RX);
+        }
+        if (p_block == NULL)
+        {
+            m_uart_out_dropped++;
+            return;
+        }
+        m_uart_out[(m_uart_out_head + m_uart_out_count) % BUF_POOL_QUOTA_NUS_RX] = p_block;
+        m_uart_out_count++;
+        m_uart_out_wr = 0;
+    }
+
+    p_block                  = m_uart_out[(m_uart_out_head + m_uart_out_count - 1) % BUF_POOL_QUOTA_NUS_RX];
+    p_block[m_uart_out_wr++] = byte;
+}
+
+
+/**@brief Function for writing bytes to the UART as they are.
+ */
+static void uart_write(const uint8_t * p_data, uint16_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uart_out_put(p_data[i]);
+    }
+}
+
+
+#if SCAN_GW_ENABLED || RTT_PROBE_ENABLED || LINK_QUALITY_ENABLED
+/**@brief Function for writing a scanner gateway batch, or a probe or link quality report, to
+ *        the UART.
+ *
+ * @details Frames are only told apart from data while the command channel is open, so they are
+ *          dropped while it is closed.
+ */
+static void uart_frame_write(const uint8_t * p_data, uint16_t len)
+{
+#if UART_CMD_ENABLED
+    if (!uart_cmd_is_open())
+    {
+        return;
+    }
+#endif
+    uart_write(p_data, len);
+}
+#endif
+
+
+/**@brief Function for forwarding data received from the peer to the UART.
+ */
+static void uart_data_put(const uint8_t * p_data, uint16_t len)
+{
+#if UART_CMD_ENABLED
+    if (uart_cmd_is_open())
+    {
+        for (uint32_t i = 0; i < len; i++)
+        {
+            // Data bytes that look like the start of a response frame are doubled.
+            if (p_data[i] == UART_CMD_ESC)
+            {
+                uart_out_put(UART_CMD_ESC);
+            }
+            uart_out_put(p_data[i]);
+        }
+        return;
+    }
+#endif
+    uart_write(p_data, len);
+}
+
+
+/**@brief Function for handling data notified by the peer.
+ */
+static void nus_data_rx(const uint8_t * p_data, uint16_t len)
+{
+#if LZSS_ENABLED
+    uint32_t err_code;
+
+    if (m_lzss_active)
+    {
+        err_code = lzss_decode(&m_lzss_rx, p_data, len, m_lzss_rx_buf, sizeof(m_lzss_rx_buf), &len);
+        if (err_code != NRF_SUCCESS)
+        {
+            // The peer does not compress, or data went missing. A new link starts both ends over.
+            UNUSED_VARIABLE(sd_ble_gap_disconnect(m_ble_uart_c.conn_handle,
+                                                  BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION));
+            return;
+        }
+        p_data = m_lzss_rx_buf;
+    }
+#endif
+#if RTT_PROBE_ENABLED
+    if (rtt_probe_on_rx(p_data, len))
+    {
+        return;
+    }
+#endif
+    uart_data_put(p_data, len);
+}
+
+
+#if BLE_UART_C_REL_ENABLED
+/**@brief NUS Client reliability layer Event Handler.
+ */
+static void uart_c_rel_evt_handler(ble_uart_c_rel_t * p_rel, ble_uart_c_rel_evt_t * p_evt)
+{
+    switch (p_evt->evt_type)
+    {
+        case BLE_UART_C_REL_EVT_RX_DATA:
+            nus_data_rx(p_evt->params.rx_data.p_data, p_evt->params.rx_data.len);
+            break;
+
+        case BLE_UART_C_REL_EVT_TX_ACKED:
+#if LZSS_ENABLED
+            UNUSED_VARIABLE(lzss_tx_rest_send());
+#endif
+#if STORE_FWD_ENABLED
+            store_fwd_drain(&m_store_fwd);
+#endif
+            uart_rx_resume();
+            break;
+
+        default:
+            break;
+    }
+}
+#endif
+
+
 /**@brief Nordic UART Service (NUS) Client Event Handler.
  */
 static void uart_c_evt_handler(ble_uart_c_t * p_uart_c, ble_uart_c_evt_t * p_uart_c_evt)
@@ -566,24 +1578,70 @@ static void uart_c_evt_handler(ble_uart_c_t * p_uart_c, ble_uart_c_evt_t * p_uar
     switch (p_uart_c_evt->evt_type)
     {
         case BLE_UART_C_EVT_DISCOVERY_COMPLETE:
+#if LZSS_ENABLED
+            lzss_link_start();
+#endif
             // Initiate bonding.
-            err_code = dm_security_setup_req(&m_dm_device_handle);
-            APP_ERROR_CHECK(err_code);
+            err_code = security_setup(p_uart_c->conn_handle);
+            ERR_RECOVERY_CHECK(err_code, security_setup, p_uart_c->conn_handle);
             
             // Nordic UART service discovered. Enable notification of RX data channel.
-            err_code = ble_uart_c_rx_notif_enable(p_uart_c);
-            APP_ERROR_CHECK(err_code);
+            err_code = rx_notif_enable(p_uart_c->conn_handle);
+            ERR_RECOVERY_CHECK(err_code, rx_notif_enable, p_uart_c->conn_handle);
+#if BLE_UART_C_REL_ENABLED
+            ble_uart_c_rel_link_start(&m_ble_uart_c_rel);
+#endif
+            break;
+
+        case BLE_UART_C_EVT_DISCOVERY_FAILED:
+            // Without TX, RX and the CCCD of RX the link cannot carry data.
+            printf("NUS not found at the peer, disconnecting\r\n");
+            UNUSED_VARIABLE(sd_ble_gap_disconnect(p_uart_c->conn_handle,
+                                                  BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION));
             break;
 
         case BLE_UART_C_EVT_RX_DATA_NOTIFICATION:
-        {
-            for (uint32_t i = 0; i < p_uart_c_evt->params.uart.len; i++)
-            {
-                while(app_uart_put(p_uart_c_evt->params.uart.rx_data[i]) != NRF_SUCCESS);
-            }
-            
+#if BLE_UART_C_REL_ENABLED
+            ble_uart_c_rel_on_uart_c_evt(&m_ble_uart_c_rel, p_uart_c_evt);
+#else
+            nus_data_rx(p_uart_c_evt->params.uart.rx_data, p_uart_c_evt->params.uart.len);
+#endif
             break;
-        }
+
+        case BLE_UART_C_EVT_ATT_TIMEOUT:
+            printf("No response from the peer, disconnecting\r\n");
+#if LINK_QUALITY_ENABLED
+            link_quality_tx_failed(p_uart_c_evt->params.tx_error.conn_handle);
+#endif
+            break;
+
+        case BLE_UART_C_EVT_TX_ERROR:
+#if LINK_QUALITY_ENABLED
+            link_quality_tx_failed(p_uart_c_evt->params.tx_error.conn_handle);
+#endif
+            // The dropped request has made room in the queue.
+        case BLE_UART_C_EVT_TX_COMPLETE:
+#if BLE_UART_C_REL_ENABLED
+            ble_uart_c_rel_on_uart_c_evt(&m_ble_uart_c_rel, p_uart_c_evt);
+#endif
+#if LZSS_ENABLED
+            UNUSED_VARIABLE(lzss_tx_rest_send());
+#endif
+#if STORE_FWD_ENABLED
+            store_fwd_drain(&m_store_fwd);
+#endif
+            uart_rx_resume();
+            break;
+
+        case BLE_UART_C_EVT_RX_NOTIF_ENABLED:
+            // The link is up, so flash jobs no longer compete with reconnecting.
+            flash_sched_defer_set(false);
+#if STORE_FWD_ENABLED
+            // Replay data buffered while the link was down.
+            store_fwd_link_up(&m_store_fwd);
+#endif
+            break;
+
         default:
             break;
     }
@@ -594,22 +1652,103 @@ static void uart_c_evt_handler(ble_uart_c_t * p_uart_c, ble_uart_c_evt_t * p_uar
 
 
 /**
- * @brief UART service initialization.
+ * @brief UART service initialization.
+ */
+static void uart_c_init(void)
+{
+    ble_uart_c_init_t uart_c_init_obj;
+
+    uart_c_init_obj.evt_handler = uart_c_evt_handler;
+    uart_c_init_obj.prescaler   = APP_TIMER_PRESCALER;
+
+    uint32_t err_code = ble_uart_c_init(&m_ble_uart_c, &uart_c_init_obj);
+    APP_ERROR_CHECK(err_code);
+#if BLE_UART_C_QOS_ENABLED
+    err_code = ble_uart_c_qos_set(&m_ble_uart_c, &m_cfg.qos);
+    APP_ERROR_CHECK(err_code);
+#endif
+
+#if BLE_UART_C_REL_ENABLED
+    ble_uart_c_rel_init_t rel_init_obj;
+
+    rel_init_obj.p_ble_uart_c = &m_ble_uart_c;
+    rel_init_obj.evt_handler  = uart_c_rel_evt_handler;
+    rel_init_obj.window_size  = BLE_UART_C_REL_WINDOW_SIZE;
+    rel_init_obj.rto_ticks    = APP_TIMER_TICKS(BLE_UART_C_REL_RTO_MS, APP_TIMER_PRESCALER);
+
+    err_code = ble_uart_c_rel_init(&m_ble_uart_c_rel, &rel_init_obj);
+    APP_ERROR_CHECK(err_code);
+#endif
+}
+
+
+
+
+
+#if STORE_FWD_ENABLED
+/**
+ * @brief Store-and-forward buffer initialization.
  */
-static void uart_c_init(void)
+static void store_fwd_buffer_init(void)
 {
-    ble_uart_c_init_t uart_c_init_obj;
+    store_fwd_init_t store_fwd_init_obj;
 
-    uart_c_init_obj.evt_handler = uart_c_evt_handler;
+    store_fwd_init_obj.send   = nus_send;
+    store_fwd_init_obj.policy = (store_fwd_policy_t)m_cfg.uart.store_fwd_policy;
 
-    uint32_t err_code = ble_uart_c_init(&m_ble_uart_c, &uart_c_init_obj);
+    uint32_t err_code = store_fwd_init(&m_store_fwd, &store_fwd_init_obj);
     APP_ERROR_CHECK(err_code);
 }
+#endif
+
+
+#if KV_STORE_ENABLED
+/**@brief Function for reading a group of saved bridge parameters, if there is a valid one.
+ */
+static void bridge_cfg_load(uint8_t key, void * p_value, uint8_t size)
+{
+    uint8_t value[KV_STORE_MAX_VALUE_LEN];
+    uint8_t len = sizeof(value);
+
+    if ((kv_store_get(key, value, &len) == NRF_SUCCESS) && (len == size))
+    {
+        memcpy(p_value, value, size);
+    }
+}
+
+
+/**
+ * @brief Bridge state initialization. Restores the state saved before the last reset.
+ */
+static void bridge_state_init(void)
+{
+    uint8_t  len = sizeof(m_link_stats);
+    uint32_t err_code;
 
+    err_code = kv_store_init(NULL);
+    APP_ERROR_CHECK(err_code);
 
+    err_code = kv_store_get(APP_KV_KEY_LINK_STATS, &m_link_stats, &len);
+    if ((err_code != NRF_SUCCESS) || (len != sizeof(m_link_stats)))
+    {
+        memset(&m_link_stats, 0, sizeof(m_link_stats));
+    }
 
+    // Parameters saved through the UART command channel replace the defaults.
+    bridge_cfg_load(APP_KV_KEY_CFG_LINK, &m_cfg.link, sizeof(m_cfg.link));
+    bridge_cfg_load(APP_KV_KEY_CFG_TARGET_UUID, m_cfg.target_uuid, sizeof(m_cfg.target_uuid));
+    bridge_cfg_load(APP_KV_KEY_CFG_UART, &m_cfg.uart, sizeof(m_cfg.uart));
+    bridge_cfg_load(APP_KV_KEY_CFG_GW, &m_cfg.gw, sizeof(m_cfg.gw));
+    bridge_cfg_load(APP_KV_KEY_CFG_QOS, &m_cfg.qos, sizeof(m_cfg.qos));
+    bridge_cfg_load(APP_KV_KEY_CFG_PROBE, &m_cfg.probe, sizeof(m_cfg.probe));
+    bridge_cfg_load(APP_KV_KEY_CFG_LQ, &m_cfg.lq, sizeof(m_cfg.lq));
+    bridge_cfg_load(APP_KV_KEY_CFG_COMPRESS, &m_cfg.compress, sizeof(m_cfg.compress));
+    bridge_cfg_load(APP_KV_KEY_CFG_LINE_COALESCE, &m_cfg.line_coalesce, sizeof(m_cfg.line_coalesce));
+}
+#endif
 
 
+#if !BLE_UART_C_FAST_DISC_ENABLED
 /**
  * @brief Database discovery collector initialization.
  */
@@ -618,29 +1757,26 @@ static void db_discovery_init(void)
     uint32_t err_code = ble_db_discovery_init();
     APP_ERROR_CHECK(err_code);
 }
+#endif
 
 
-/**@breif Function to start scanning.
+/**@breif Function to start scanning. Retried by @ref err_recovery.
  */
-static void scan_start(void)
+static uint32_t scan_try(uint16_t conn_handle)
 {
     ble_gap_whitelist_t   whitelist;
     ble_gap_addr_t        * p_whitelist_addr[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
     ble_gap_irk_t         * p_whitelist_irk[BLE_GAP_WHITELIST_IRK_MAX_COUNT];
     uint32_t              err_code;
-    uint32_t              count;
 
-    // Verify if there is any flash access pending, if yes delay starting scanning until 
-    // it's complete.
-    err_code = pstorage_access_status_get(&count);
-    APP_ERROR_CHECK(err_code);
-    
-    if (count != 0)
+    UNUSED_PARAMETER(conn_handle);
+
+    if (m_peer_count >= MAX_PEER_COUNT)
     {
-        m_memory_access_in_progress = true;
-        return;
+        // A retry that is no longer needed.
+        return NRF_SUCCESS;
     }
-    
+
     // Initialize whitelist parameters.
     whitelist.addr_count = BLE_GAP_WHITELIST_ADDR_MAX_COUNT;
     whitelist.irk_count  = 0;
@@ -649,16 +1785,21 @@ static void scan_start(void)
 
     // Request creating of whitelist.
     err_code = dm_whitelist_create(&m_dm_app_id,&whitelist);
-    APP_ERROR_CHECK(err_code);
+    if (err_code != NRF_SUCCESS)
+    {
+        // Handled by the caller like a failed scan start.
+        return err_code;
+    }
 
     if (((whitelist.addr_count == 0) && (whitelist.irk_count == 0)) ||
-         (m_scan_mode != BLE_WHITELIST_SCAN))
+         (m_scan_mode != BLE_WHITELIST_SCAN) || (m_cfg.gw.mode != 0))
     {
-        // No devices in whitelist, hence non selective performed.
+        // No devices in whitelist, or all devices are of interest to the gateway, hence non
+        // selective performed.
         m_scan_param.active       = 1;            // Active scanning set.
         m_scan_param.selective    = 0;            // Selective scanning not set.
-        m_scan_param.interval     = SCAN_INTERVAL;// Scan interval.
-        m_scan_param.window       = SCAN_WINDOW;  // Scan window.
+        m_scan_param.interval     = m_cfg.link.scan_interval;// Scan interval.
+        m_scan_param.window       = m_cfg.link.scan_window;  // Scan window.
         m_scan_param.p_whitelist  = NULL;         // No whitelist provided.
         m_scan_param.timeout      = 0x0000;       // No timeout.
     }
@@ -667,8 +1808,8 @@ static void scan_start(void)
         // Selective scanning based on whitelist first.
         m_scan_param.active       = 1;            // Active scanning set.
         m_scan_param.selective    = 1;            // Selective scanning not set.
-        m_scan_param.interval     = SCAN_INTERVAL;// Scan interval.
-        m_scan_param.window       = SCAN_WINDOW;  // Scan window.
+        m_scan_param.interval     = m_cfg.link.scan_interval;// Scan interval.
+        m_scan_param.window       = m_cfg.link.scan_window;  // Scan window.
         m_scan_param.p_whitelist  = &whitelist;   // Provide whitelist.
         m_scan_param.timeout      = 0x001E;       // 30 seconds timeout.
 
@@ -676,24 +1817,122 @@ static void scan_start(void)
         m_scan_mode = BLE_WHITELIST_SCAN;
     }
 
+    // Scan right away, even if flash work is pending. The window is reduced to leave the
+    // SoftDevice time for flash, and deferrable flash jobs are held until the link is up.
+    m_scan_reduced = flash_sched_scan_params_adjust(&m_scan_param);
+    flash_sched_defer_set(true);
+
     err_code = sd_ble_gap_scan_start(&m_scan_param);
-    APP_ERROR_CHECK(err_code);
+    if (err_code == NRF_SUCCESS)
+    {
+        nrf_gpio_pin_set(SCAN_LED_PIN_NO);
+    }
+    return err_code;
+}
+
+
+/**@brief Function to start scanning, or to retry until the SoftDevice is done connecting.
+ */
+static void scan_start(void)
+{
+    ERR_RECOVERY_CHECK(scan_try(BLE_CONN_HANDLE_INVALID), scan_try, BLE_CONN_HANDLE_INVALID);
+}
+
+
+#if RECONNECT_PEER_COUNT > 0
+/**@brief Function to connect to whichever recent peer advertises first. Retried by
+ *        @ref err_recovery.
+ *
+ * @details The SoftDevice connects to the first advertiser in the whitelist, so no advertising
+ *          report has to be parsed. A connection timeout falls back to scanning for any peer.
+ */
+static uint32_t reconnect_try(uint16_t conn_handle)
+{
+    ble_gap_whitelist_t   whitelist;
+    ble_gap_addr_t        * p_whitelist_addr[RECONNECT_PEER_COUNT];
+    uint32_t              err_code;
+    uint8_t               i;
+
+    UNUSED_PARAMETER(conn_handle);
+
+    if (m_peer_count >= MAX_PEER_COUNT)
+    {
+        // A retry that is no longer needed.
+        return NRF_SUCCESS;
+    }
+
+    for (i = 0; i < m_recent_peer_count; i++)
+    {
+        p_whitelist_addr[i] = &m_recent_peers[i];
+    }
+    whitelist.addr_count = m_recent_peer_count;
+    whitelist.irk_count  = 0;
+    whitelist.pp_addrs   = p_whitelist_addr;
+    whitelist.pp_irks    = NULL;
+
+    m_scan_param.active      = 0;                       // Nothing to learn from scan responses.
+    m_scan_param.selective   = 1;                       // Only the recent peers.
+    m_scan_param.interval    = RECONNECT_SCAN_INTERVAL;
+    m_scan_param.window      = RECONNECT_SCAN_WINDOW;
+    m_scan_param.p_whitelist = &whitelist;
+    m_scan_param.timeout     = RECONNECT_TIMEOUT;
+
+    m_scan_reduced = flash_sched_scan_params_adjust(&m_scan_param);
+    flash_sched_defer_set(true);
+
+    err_code = sd_ble_gap_connect(NULL, &m_scan_param, &m_cfg.link.conn_params);
+    m_scan_param.p_whitelist = NULL;
+    if (err_code == NRF_SUCCESS)
+    {
+        m_scan_mode = BLE_RECONNECT_SCAN;
+        nrf_gpio_pin_set(SCAN_LED_PIN_NO);
+    }
+    return err_code;
+}
+#endif
 
-    nrf_gpio_pin_set(SCAN_LED_PIN_NO);
+
+/**@brief Function to reconnect after a link loss, or to scan when there is no peer to reconnect to.
+ */
+static void reconnect_start(void)
+{
+#if RECONNECT_PEER_COUNT > 0
+    if ((m_recent_peer_count != 0) && (m_cfg.gw.mode == 0))
+    {
+        ERR_RECOVERY_CHECK(reconnect_try(BLE_CONN_HANDLE_INVALID), reconnect_try, BLE_CONN_HANDLE_INVALID);
+        return;
+    }
+#endif
+    scan_start();
 }
 
 static void timers_init(void)
 {
-    // Initialize timer module.
-    APP_TIMER_INIT(APP_TIMER_PRESCALER, 1, 2, false);
-    
+    // The timer module is initialized at the start of main(). Initializing it again here would
+    // drop the timers created by the BSP.
+
     // Create timers.
 }
 
-/**@brief  Function for initializing the UART module.
+
+/**@brief Function for initializing the error recovery.
+ */
+static void error_recovery_init(void)
+{
+    err_recovery_init_t init;
+    uint32_t            err_code;
+
+    init.uart_resync = uart_resync;
+    init.prescaler   = APP_TIMER_PRESCALER;
+
+    err_code = err_recovery_init(&init);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief  Function for initializing the UART module at the rate in @ref m_uart_baudrate.
  */
 /**@snippet [UART Initialization] */
-static void uart_init(void)
+static uint32_t uart_init(void)
 {
     uint32_t err_code;
     const app_uart_comm_params_t comm_params =
@@ -704,7 +1943,7 @@ static void uart_init(void)
           CTS_PIN_NUMBER,
           APP_UART_FLOW_CONTROL_ENABLED,
           false,
-          UART_BAUDRATE_BAUDRATE_Baud38400
+          m_uart_baudrate
       };
 
 
@@ -714,26 +1953,407 @@ static void uart_init(void)
                         uart_event_handle,
                         APP_IRQ_PRIORITY_LOW,
                         err_code);
+    return err_code;
+}
+
+
+/**@brief Function for checking whether the UART supports a baud rate.
+ *
+ * @param[in] baudrate Value for the BAUDRATE register.
+ */
+static bool uart_baudrate_is_valid(uint32_t baudrate)
+{
+    static const uint32_t baudrates[] =
+    {
+        UART_BAUDRATE_BAUDRATE_Baud1200,   UART_BAUDRATE_BAUDRATE_Baud2400,
+        UART_BAUDRATE_BAUDRATE_Baud4800,   UART_BAUDRATE_BAUDRATE_Baud9600,
+        UART_BAUDRATE_BAUDRATE_Baud14400,  UART_BAUDRATE_BAUDRATE_Baud19200,
+        UART_BAUDRATE_BAUDRATE_Baud28800,  UART_BAUDRATE_BAUDRATE_Baud38400,
+        UART_BAUDRATE_BAUDRATE_Baud57600,  UART_BAUDRATE_BAUDRATE_Baud76800,
+        UART_BAUDRATE_BAUDRATE_Baud115200, UART_BAUDRATE_BAUDRATE_Baud230400,
+        UART_BAUDRATE_BAUDRATE_Baud250000, UART_BAUDRATE_BAUDRATE_Baud460800,
+        UART_BAUDRATE_BAUDRATE_Baud921600, UART_BAUDRATE_BAUDRATE_Baud1M
+    };
+    uint32_t i;
+
+    for (i = 0; i < sizeof(baudrates) / sizeof(baudrates[0]); i++)
+    {
+        if (baudrates[i] == baudrate)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**@brief Function for getting the data rate of the UART at a baud rate.
+ *
+ * @param[in] baudrate Value for the BAUDRATE register.
+ *
+ * @return Bytes per second, with one start and one stop bit.
+ */
+static uint32_t uart_bytes_per_sec(uint32_t baudrate)
+{
+    // The register holds the baud rate as a fraction of the 16 MHz clock, in units of 2^-32.
+    return (uint32_t)(((uint64_t)baudrate * 16000000UL) >> 32) / 10;
+}
+
+
+/**@brief Function for changing the UART baud rate at runtime.
+ *
+ * @details The UART is closed and opened again at the new rate. Bytes in its FIFOs are lost, and
+ *          a line held for the BLE TX queue is dropped. The host has to switch at the same time.
+ *
+ * @param[in] baudrate Value for the BAUDRATE register, from UART_BAUDRATE_BAUDRATE_Baud1200 up to
+ *                     UART_BAUDRATE_BAUDRATE_Baud1M.
+ *
+ * @retval NRF_SUCCESS             If the UART runs at the new rate.
+ * @retval NRF_ERROR_INVALID_PARAM If the rate is not one the UART supports.
+ */
+uint32_t uart_baudrate_set(uint32_t baudrate)
+{
+    uint32_t err_code;
+
+    if (!uart_baudrate_is_valid(baudrate))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    err_code = app_uart_close();
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_uart_baudrate = baudrate;
+    m_uart_line_len   = 0;
+    m_uart_line_ended = false;
+    m_uart_rx_held    = false;
+#if SCAN_GW_ENABLED
+    scan_gw_rate_set(uart_bytes_per_sec(baudrate));
+#endif
+    return uart_init();
+}
+
+
+/**@brief Function for setting the bridge parameters to their defaults.
+ */
+static void bridge_cfg_defaults_set(void)
+{
+    m_cfg.link.scan_interval     = SCAN_INTERVAL;
+    m_cfg.link.scan_window       = SCAN_WINDOW;
+    m_cfg.link.conn_params       = m_connection_param;
+    memcpy(m_cfg.target_uuid, nus_service_uuid, sizeof(m_cfg.target_uuid));
+    m_cfg.uart.baudrate          = UART_BAUDRATE_DEFAULT;
+    m_cfg.uart.line_len          = UART_LINE_MAX_LEN;
+    m_cfg.uart.store_fwd_policy  = STORE_FWD_DEFAULT_POLICY;
+    m_cfg.gw.mode                = 0;
+    m_cfg.gw.filter.ad_type      = 0;
+    m_cfg.gw.filter.rssi_min     = INT8_MIN;
+    m_cfg.gw.filter.dedup_ms     = SCAN_GW_DEDUP_MS;
+    m_cfg.qos.tx_rate            = BLE_UART_C_QOS_TX_RATE;
+    m_cfg.qos.tx_burst           = BLE_UART_C_QOS_TX_BURST;
+    m_cfg.qos.rx_rate            = BLE_UART_C_QOS_RX_RATE;
+    m_cfg.qos.rx_burst           = BLE_UART_C_QOS_RX_BURST;
+    m_cfg.qos.rx_qos             = BLE_UART_C_QOS_DATA;
+    m_cfg.qos.rx_drop            = BLE_UART_C_QOS_RX_DROP;
+    m_cfg.probe.mode             = 0;
+    m_cfg.probe.len              = BLE_NUS_MAX_DATA_LEN;
+    m_cfg.probe.interval_ms      = RTT_PROBE_INTERVAL_MS;
+    m_cfg.lq.report              = 0;
+    m_cfg.lq.tx_power            = LINK_QUALITY_TX_POWER_FIXED;
+    m_cfg.compress               = 0;
+    m_cfg.line_coalesce          = 0;
+}
+
+
+#if UART_CMD_ENABLED || KV_STORE_ENABLED
+/**@brief Function for checking that the bridge parameters are consistent with each other.
+ */
+static uint32_t bridge_cfg_check(void)
+{
+    const ble_gap_conn_params_t * p_conn = &m_cfg.link.conn_params;
+
+    if ((m_cfg.link.scan_window > m_cfg.link.scan_interval) ||
+        (p_conn->min_conn_interval > p_conn->max_conn_interval) ||
+        !uart_baudrate_is_valid(m_cfg.uart.baudrate) ||
+        (m_cfg.uart.line_len == 0) || (m_cfg.uart.line_len > UART_LINE_MAX_LEN) ||
+        (m_cfg.uart.store_fwd_policy > STORE_FWD_POLICY_DROP_NEWEST) ||
+        (m_cfg.gw.mode > 1) ||
+        (m_cfg.qos.tx_burst < (2 * BLE_NUS_MAX_DATA_LEN)) ||
+        (m_cfg.qos.rx_burst < (2 * BLE_NUS_MAX_DATA_LEN)) ||
+        (m_cfg.qos.rx_qos > BLE_UART_C_QOS_BULK) || (m_cfg.qos.rx_drop > 1) ||
+        (m_cfg.probe.mode > 1) ||
+        (m_cfg.probe.len < RTT_PROBE_HDR_LEN) || (m_cfg.probe.len > BLE_NUS_MAX_DATA_LEN) ||
+        (m_cfg.probe.interval_ms < RTT_PROBE_INTERVAL_MIN_MS) ||
+        (m_cfg.lq.report > 1) || (m_cfg.lq.tx_power > LINK_QUALITY_TX_POWER_ADAPTIVE) ||
+        (m_cfg.compress > 1) || (m_cfg.line_coalesce > 1))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // The supervision timeout (10 ms units) must exceed two maximum length connection events
+    // (1.25 ms units) of the peripheral.
+    if (((uint32_t)p_conn->conn_sup_timeout * 4) <=
+        ((1 + (uint32_t)p_conn->slave_latency) * p_conn->max_conn_interval))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    return NRF_SUCCESS;
+}
+#endif
+
+
+#if UART_CMD_ENABLED
+/**@brief Function for saving the bridge parameters, so that they are used after a reset.
+ */
+static uint32_t bridge_cfg_save(void)
+{
+#if KV_STORE_ENABLED
+    uint32_t err_code;
+
+    err_code = kv_store_set(APP_KV_KEY_CFG_LINK, &m_cfg.link, sizeof(m_cfg.link));
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = kv_store_set(APP_KV_KEY_CFG_TARGET_UUID, m_cfg.target_uuid, sizeof(m_cfg.target_uuid));
+    }
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = kv_store_set(APP_KV_KEY_CFG_UART, &m_cfg.uart, sizeof(m_cfg.uart));
+    }
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = kv_store_set(APP_KV_KEY_CFG_GW, &m_cfg.gw, sizeof(m_cfg.gw));
+    }
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = kv_store_set(APP_KV_KEY_CFG_QOS, &m_cfg.qos, sizeof(m_cfg.qos));
+    }
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = kv_store_set(APP_KV_KEY_CFG_PROBE, &m_cfg.probe, sizeof(m_cfg.probe));
+    }
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = kv_store_set(APP_KV_KEY_CFG_LQ, &m_cfg.lq, sizeof(m_cfg.lq));
+    }
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = kv_store_set(APP_KV_KEY_CFG_COMPRESS, &m_cfg.compress, sizeof(m_cfg.compress));
+    }
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = kv_store_set(APP_KV_KEY_CFG_LINE_COALESCE, &m_cfg.line_coalesce, sizeof(m_cfg.line_coalesce));
+    }
+    return err_code;
+#else
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+
+/**@brief UART command channel event handler.
+ *
+ * @details Scan and connection parameters are used from the next scan or connection on. The
+ *          baud rate changes once the response has been sent. Statistics are copied when the
+ *          host reads them, and cannot be set.
+ */
+static uint32_t uart_cmd_evt_handler(const uart_cmd_evt_t * p_evt)
+{
+    uint32_t err_code;
+
+    switch (p_evt->evt_type)
+    {
+        case UART_CMD_EVT_PARAM_GET:
+#if LZSS_ENABLED
+            lzss_stats_get(&m_lzss_tx, &m_lzss_tx_stats);
+            lzss_stats_get(&m_lzss_rx, &m_lzss_rx_stats);
+#endif
+            return NRF_SUCCESS;
+
+        case UART_CMD_EVT_PARAM_SET:
+#if LZSS_ENABLED
+            if ((p_evt->p_param->id == APP_CFG_ID_LZSS_TX_STATS) ||
+                (p_evt->p_param->id == APP_CFG_ID_LZSS_RX_STATS))
+            {
+                return NRF_ERROR_FORBIDDEN;
+            }
+#endif
+            err_code = bridge_cfg_check();
+            break;
+
+        case UART_CMD_EVT_SAVE:
+            return bridge_cfg_save();
+
+        case UART_CMD_EVT_DEFAULTS:
+            bridge_cfg_defaults_set();
+            err_code = NRF_SUCCESS;
+            break;
+
+        default:
+            return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+#if STORE_FWD_ENABLED
+    if (err_code == NRF_SUCCESS)
+    {
+        store_fwd_policy_set(&m_store_fwd, (store_fwd_policy_t)m_cfg.uart.store_fwd_policy);
+    }
+#endif
+#if BLE_UART_C_QOS_ENABLED
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = ble_uart_c_qos_set(&m_ble_uart_c, &m_cfg.qos);
+    }
+#endif
+#if RTT_PROBE_ENABLED
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = rtt_probe_cfg_set(&m_cfg.probe);
+    }
+#endif
+#if LINK_QUALITY_ENABLED
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = link_quality_cfg_set(&m_cfg.lq);
+    }
+#endif
+    return err_code;
+}
+
+
+/**@brief Function for initializing the UART command channel.
+ */
+static void uart_cmd_channel_init(void)
+{
+    uart_cmd_init_t uart_cmd_init_obj;
+
+    uart_cmd_init_obj.p_params    = m_cfg_params;
+    uart_cmd_init_obj.param_count = sizeof(m_cfg_params) / sizeof(m_cfg_params[0]);
+    uart_cmd_init_obj.evt_handler = uart_cmd_evt_handler;
+    uart_cmd_init_obj.write       = uart_write;
+    uart_cmd_init_obj.prescaler   = APP_TIMER_PRESCALER;
+
+    uint32_t err_code = uart_cmd_init(&uart_cmd_init_obj);
     APP_ERROR_CHECK(err_code);
 }
+#endif
 /**@snippet [UART Initialization] */
 
 
+#if SCAN_GW_ENABLED
+/**@brief Function for initializing the scanner gateway. It is used while @ref gw_cfg_t::mode is set.
+ */
+static void scan_gw_start(void)
+{
+    scan_gw_init_t scan_gw_init_obj;
+
+    scan_gw_init_obj.p_filter      = &m_cfg.gw.filter;
+    scan_gw_init_obj.write         = uart_frame_write;
+    scan_gw_init_obj.bytes_per_sec = uart_bytes_per_sec(m_uart_baudrate);
+    scan_gw_init_obj.prescaler     = APP_TIMER_PRESCALER;
+
+    uint32_t err_code = scan_gw_init(&scan_gw_init_obj);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
+#if RTT_PROBE_ENABLED
+/**@brief Function for initializing the round trip probe. It runs while @ref rtt_probe_cfg_t::mode is set.
+ */
+static void rtt_probe_start(void)
+{
+    rtt_probe_init_t rtt_probe_init_obj;
+    uint32_t         err_code;
+
+    rtt_probe_init_obj.send      = nus_send;
+    rtt_probe_init_obj.write     = uart_frame_write;
+    rtt_probe_init_obj.max_len   = BLE_NUS_MAX_DATA_LEN;
+    rtt_probe_init_obj.prescaler = APP_TIMER_PRESCALER;
+
+    err_code = rtt_probe_init(&rtt_probe_init_obj);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = rtt_probe_cfg_set(&m_cfg.probe);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
+
+#if LINK_QUALITY_ENABLED
+/**@brief Function for initializing the link quality telemetry and the TX power policy.
+ */
+static void link_quality_start(void)
+{
+    link_quality_init_t link_quality_init_obj;
+    uint32_t            err_code;
+
+    link_quality_init_obj.write     = uart_frame_write;
+    link_quality_init_obj.prescaler = APP_TIMER_PRESCALER;
+
+    err_code = link_quality_init(&link_quality_init_obj);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = link_quality_cfg_set(&m_cfg.lq);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
+
 int main(void)
 {
     uint32_t err_code;
     
     APP_TIMER_INIT(APP_TIMER_PRESCALER, APP_TIMER_MAX_TIMERS, APP_TIMER_OP_QUEUE_SIZE, NULL);
+    buf_pool_init();
+#if EVT_TRACE_ENABLED
+    evt_trace_init(APP_TIMER_PRESCALER);
+#endif
     err_code = bsp_init(BSP_INIT_LED | BSP_INIT_BUTTONS, APP_TIMER_TICKS(100, APP_TIMER_PRESCALER),NULL);
     APP_ERROR_CHECK(err_code);
     leds_init();
     timers_init();
-    uart_init();
+    error_recovery_init();
+    bridge_cfg_defaults_set();
+    err_code = uart_init();
+    APP_ERROR_CHECK(err_code);
    
     ble_stack_init();
     device_manager_init();
+#if KV_STORE_ENABLED
+    bridge_state_init();
+    // Parameters saved by another build may not suit this one.
+    if (bridge_cfg_check() != NRF_SUCCESS)
+    {
+        bridge_cfg_defaults_set();
+    }
+    if (m_cfg.uart.baudrate != m_uart_baudrate)
+    {
+        err_code = uart_baudrate_set(m_cfg.uart.baudrate);
+        APP_ERROR_CHECK(err_code);
+    }
+#endif
+#if UART_CMD_ENABLED
+    uart_cmd_channel_init();
+#endif
+#if SCAN_GW_ENABLED
+    scan_gw_start();
+#endif
+#if !BLE_UART_C_FAST_DISC_ENABLED
     db_discovery_init();
+#endif
     uart_c_init();
+#if STORE_FWD_ENABLED
+    store_fwd_buffer_init();
+#endif
+#if RTT_PROBE_ENABLED
+    rtt_probe_start();
+#endif
+#if LINK_QUALITY_ENABLED
+    link_quality_start();
+#endif
     
     printf("Scanning ...\r\n");
 	
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "rtt_probe.h"
+#include "uart_cmd.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+#define MAGIC_0            0xFE  /**< First byte of a probe. */
+#define MAGIC_1            0xA5  /**< Second byte of a probe. */
+#define FRAME_HEADER_LEN   5     /**< ESC, op, id, status and len of a report. */
+#define FILL_BYTE          0x55  /**< Byte the probe is filled up with. */
+#define WINDOW_MASK        (UINT32_MAX >> (32 - RTT_PROBE_WINDOW)) /**< Bits of m_in_flight in use. */
+
+STATIC_ASSERT((RTT_PROBE_WINDOW >= 1) && (RTT_PROBE_WINDOW <= 32));
+STATIC_ASSERT(RTT_PROBE_REPORT_LEN <= 0xFF);
+
+static rtt_probe_init_t  m_init;         /**< Copy of the initialization parameters. */
+static rtt_probe_cfg_t   m_cfg;          /**< Settings in use. */
+static rtt_probe_stats_t m_stats;        /**< Statistics, without the mean. */
+static uint64_t          m_rtt_sum_us;   /**< Sum of the round trip times received. */
+static app_timer_id_t    m_timer_id;     /**< Probe timer. */
+static uint32_t          m_tick_hz;      /**< app_timer tick rate. */
+static uint16_t          m_next_seq;     /**< Sequence number of the next probe. */
+static uint16_t          m_newest_seq;   /**< Newest probe echoed. */
+static bool              m_echoed;       /**< Whether a probe has been echoed since the start. */
+static uint32_t          m_in_flight;    /**< Bit i is set while probe m_next_seq - 1 - i waits for its echo. */
+static uint32_t          m_report_ms;    /**< Time since the last report. */
+
+
+static void report_write(void)
+{
+    uint8_t             frame[FRAME_HEADER_LEN + RTT_PROBE_REPORT_LEN];
+    rtt_probe_stats_t   stats;
+    uint8_t           * p_field = &frame[FRAME_HEADER_LEN];
+    uint8_t             i;
+
+    rtt_probe_stats_get(&stats);
+
+    frame[0] = UART_CMD_ESC;
+    frame[1] = RTT_PROBE_FRAME_OP;
+    frame[2] = 0;
+    frame[3] = NRF_SUCCESS;
+    frame[4] = RTT_PROBE_REPORT_LEN;
+
+    p_field += uint32_encode(stats.sent, p_field);
+    p_field += uint32_encode(stats.received, p_field);
+    p_field += uint32_encode(stats.lost, p_field);
+    p_field += uint32_encode(stats.reordered, p_field);
+    p_field += uint32_encode(stats.late, p_field);
+    p_field += uint32_encode(stats.busy, p_field);
+    p_field += uint32_encode(stats.rtt_min_us, p_field);
+    p_field += uint32_encode(stats.rtt_mean_us, p_field);
+    p_field += uint32_encode(stats.rtt_max_us, p_field);
+    for (i = 0; i < RTT_PROBE_BINS; i++)
+    {
+        p_field += uint16_encode((uint16_t)MIN(stats.hist[i], 0xFFFF), p_field);
+    }
+
+    m_init.write(frame, sizeof(frame));
+}
+
+
+static void probe_send(void)
+{
+    uint8_t  probe[UINT8_MAX];
+    uint32_t ticks;
+    uint32_t err_code;
+
+    UNUSED_VARIABLE(app_timer_cnt_get(&ticks));
+    probe[0] = MAGIC_0;
+    probe[1] = MAGIC_1;
+    UNUSED_VARIABLE(uint16_encode(m_next_seq, &probe[2]));
+    UNUSED_VARIABLE(uint32_encode(ticks, &probe[4]));
+    memset(&probe[RTT_PROBE_HDR_LEN], FILL_BYTE, m_cfg.len - RTT_PROBE_HDR_LEN);
+
+    err_code = m_init.send(probe, m_cfg.len);
+    if ((err_code == NRF_ERROR_NO_MEM) || (err_code == NRF_ERROR_BUSY))
+    {
+        m_stats.busy++;
+        return;
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        // No link to measure.
+        return;
+    }
+
+    // The oldest probe waited for leaves the window.
+    if ((m_in_flight & (1UL << (RTT_PROBE_WINDOW - 1))) != 0)
+    {
+        m_stats.lost++;
+    }
+    m_in_flight = ((m_in_flight << 1) | 1) & WINDOW_MASK;
+    m_next_seq++;
+    m_stats.sent++;
+}
+
+
+static void probe_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    probe_send();
+
+    m_report_ms += m_cfg.interval_ms;
+    if (m_report_ms >= RTT_PROBE_REPORT_MS)
+    {
+        m_report_ms = 0;
+        report_write();
+    }
+}
+
+
+static uint32_t timer_start(void)
+{
+    uint32_t ticks = APP_TIMER_TICKS(m_cfg.interval_ms, m_init.prescaler);
+
+    return app_timer_start(m_timer_id, MAX(ticks, APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+}
+
+
+uint32_t rtt_probe_init(const rtt_probe_init_t * p_init)
+{
+    if ((p_init->send == NULL) || (p_init->write == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (p_init->max_len < RTT_PROBE_HDR_LEN)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_init    = *p_init;
+    m_tick_hz = APP_TIMER_CLOCK_FREQ / (p_init->prescaler + 1);
+    memset(&m_cfg, 0, sizeof(m_cfg));
+
+    return app_timer_create(&m_timer_id, APP_TIMER_MODE_REPEATED, probe_timeout_handler);
+}
+
+
+uint32_t rtt_probe_cfg_set(const rtt_probe_cfg_t * p_cfg)
+{
+    rtt_probe_cfg_t old_cfg = m_cfg;
+
+    if ((p_cfg->mode > 1) ||
+        (p_cfg->len < RTT_PROBE_HDR_LEN) || (p_cfg->len > m_init.max_len) ||
+        (p_cfg->interval_ms < RTT_PROBE_INTERVAL_MIN_MS))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_cfg = *p_cfg;
+    if ((m_cfg.mode == old_cfg.mode) && (m_cfg.interval_ms == old_cfg.interval_ms))
+    {
+        return NRF_SUCCESS;
+    }
+
+    UNUSED_VARIABLE(app_timer_stop(m_timer_id));
+    if (m_cfg.mode == 0)
+    {
+        report_write();
+        return NRF_SUCCESS;
+    }
+    if (old_cfg.mode == 0)
+    {
+        // Echoes of an earlier run are late, as their probes are no longer waited for.
+        memset(&m_stats, 0, sizeof(m_stats));
+        m_rtt_sum_us = 0;
+        m_in_flight  = 0;
+        m_echoed     = false;
+        m_report_ms  = 0;
+    }
+    return timer_start();
+}
+
+
+bool rtt_probe_on_rx(const uint8_t * p_data, uint16_t len)
+{
+    uint16_t seq;
+    uint16_t age;
+    uint32_t ticks;
+    uint32_t diff;
+    uint32_t rtt_us;
+
+    if ((len < RTT_PROBE_HDR_LEN) || (p_data[0] != MAGIC_0) || (p_data[1] != MAGIC_1))
+    {
+        return false;
+    }
+
+    UNUSED_VARIABLE(app_timer_cnt_get(&ticks));
+    seq = uint16_decode(&p_data[2]);
+    age = (uint16_t)(m_next_seq - 1 - seq);
+    if ((m_cfg.mode == 0) || (age >= RTT_PROBE_WINDOW) || ((m_in_flight & (1UL << age)) == 0))
+    {
+        m_stats.late++;
+        return true;
+    }
+    m_in_flight &= ~(1UL << age);
+
+    if (m_echoed && ((int16_t)(seq - m_newest_seq) < 0))
+    {
+        m_stats.reordered++;
+    }
+    else
+    {
+        m_newest_seq = seq;
+        m_echoed     = true;
+    }
+
+    UNUSED_VARIABLE(app_timer_cnt_diff_compute(ticks, uint32_decode(&p_data[4]), &diff));
+    rtt_us = (uint32_t)(((uint64_t)diff * 1000000) / m_tick_hz);
+
+    if ((m_stats.received == 0) || (rtt_us < m_stats.rtt_min_us))
+    {
+        m_stats.rtt_min_us = rtt_us;
+    }
+    m_stats.rtt_max_us = MAX(m_stats.rtt_max_us, rtt_us);
+    m_rtt_sum_us      += rtt_us;
+    m_stats.hist[MIN(rtt_us / (RTT_PROBE_BIN_MS * 1000), RTT_PROBE_BINS - 1)]++;
+    m_stats.received++;
+    return true;
+}
+
+
+void rtt_probe_stats_get(rtt_probe_stats_t * p_stats)
+{
+    *p_stats             = m_stats;
+    p_stats->rtt_mean_us = (m_stats.received == 0) ? 0 : (uint32_t)(m_rtt_sum_us / m_stats.received);
+}
+
+/** @}
+ *  @endcond
+ */
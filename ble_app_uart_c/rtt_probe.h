@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup rtt_probe Round Trip Latency Probe
+ * @{
+ * @brief    Measures the round trip time of the NUS link with probes echoed by the peer.
+ *
+ * @details  While the probe runs, a probe is written to the peer at a fixed interval:
+ *
+ *           @code
+ *           0xFE 0xA5 seq[2] ticks[4] fill[len - 8]
+ *           @endcode
+ *
+ *           where seq counts probes and ticks is the app_timer counter when the probe was sent,
+ *           both little endian. A peer that echoes its RX characteristic on its TX characteristic
+ *           sends the probe back, and the time until the notification arrives is added to a
+ *           histogram. A probe without an echo by the time @ref RTT_PROBE_WINDOW newer probes
+ *           have been sent is lost, and an echo of a probe older than one already echoed is
+ *           reordered. A probe the TX queue or the rate limit refuses is counted as busy and not
+ *           sent, which measures the capacity left at the current connection parameters.
+ *
+ *           Every @ref RTT_PROBE_REPORT_MS, and when the probe is stopped, a report is written to
+ *           the UART framed like a @ref uart_cmd response:
+ *
+ *           @code
+ *           ESC 0xC1 0x00 0x00 len report[len]
+ *           @endcode
+ *
+ *           The report is @ref rtt_probe_stats_t, little endian, without padding: sent,
+ *           received, lost, reordered, late, busy, rtt_min_us, rtt_mean_us and rtt_max_us as
+ *           32 bit values followed by @ref RTT_PROBE_BINS 16 bit histogram counts, saturated
+ *           at 0xFFFF. Bin i counts round trips from i * @ref RTT_PROBE_BIN_MS up to the next
+ *           bin, and the last bin every longer one.
+ */
+
+#ifndef RTT_PROBE_H__
+#define RTT_PROBE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtt_probe_cnfg.h"
+
+#define RTT_PROBE_FRAME_OP       0xC1    /**< Op of a report frame, a response op no request uses. */
+#define RTT_PROBE_HDR_LEN        8       /**< Probe size without the fill. */
+#define RTT_PROBE_REPORT_LEN     (9 * 4 + RTT_PROBE_BINS * 2) /**< Length of a report. */
+
+/**@brief Probe settings. */
+typedef struct
+{
+    uint8_t  mode;                       /**< Whether the probe runs. */
+    uint8_t  len;                        /**< Probe length, from @ref RTT_PROBE_HDR_LEN up to the NUS payload size. */
+    uint16_t interval_ms;                /**< Time between two probes. */
+} rtt_probe_cfg_t;
+
+/**@brief Probe statistics since the probe was last started. */
+typedef struct
+{
+    uint32_t sent;                       /**< Probes sent. */
+    uint32_t received;                   /**< Echoes received in time. */
+    uint32_t lost;                       /**< Probes without an echo. */
+    uint32_t reordered;                  /**< Echoes received after the echo of a newer probe. */
+    uint32_t late;                       /**< Duplicate echoes, and echoes of probes already counted as lost. */
+    uint32_t busy;                       /**< Probes not sent because the TX queue or the rate limit refused them. */
+    uint32_t rtt_min_us;                 /**< Shortest round trip time. */
+    uint32_t rtt_mean_us;                /**< Mean round trip time. */
+    uint32_t rtt_max_us;                 /**< Longest round trip time. */
+    uint32_t hist[RTT_PROBE_BINS];       /**< Round trip time histogram. */
+} rtt_probe_stats_t;
+
+/**@brief Function for sending a probe to the peer.
+ *
+ * @return NRF_SUCCESS, NRF_ERROR_NO_MEM or NRF_ERROR_BUSY if it is refused for now, or another
+ *         error code if there is no link.
+ */
+typedef uint32_t (* rtt_probe_send_t) (const uint8_t * p_data, uint16_t len);
+
+/**@brief Function for writing a report to the UART, without escaping. */
+typedef void (* rtt_probe_write_t) (const uint8_t * p_data, uint16_t len);
+
+/**@brief Probe initialization structure. */
+typedef struct
+{
+    rtt_probe_send_t  send;              /**< Function for sending probes. */
+    rtt_probe_write_t write;             /**< Function for writing reports. */
+    uint16_t          max_len;           /**< Longest probe the link takes. */
+    uint32_t          prescaler;         /**< RTC1 prescaler of the app_timer module. */
+} rtt_probe_init_t;
+
+/**@brief     Function for initializing the probe. It does not run until it is switched on.
+ *
+ * @param[in] p_init Initialization parameters.
+ *
+ * @retval    NRF_SUCCESS             On success.
+ * @retval    NRF_ERROR_NULL          If a function is missing.
+ * @retval    NRF_ERROR_INVALID_PARAM If max_len is shorter than a probe header.
+ * @return    Otherwise an error code propagated from @ref app_timer_create.
+ */
+uint32_t rtt_probe_init(const rtt_probe_init_t * p_init);
+
+/**@brief     Function for changing the probe settings.
+ *
+ * @details   Switching the probe on clears the statistics. Switching it off writes a last report.
+ *            A new length or interval applies from the next probe.
+ *
+ * @param[in] p_cfg Probe settings.
+ *
+ * @retval    NRF_SUCCESS             On success.
+ * @retval    NRF_ERROR_INVALID_PARAM If the length or the interval is out of range.
+ * @return    Otherwise an error code propagated from @ref app_timer_start.
+ */
+uint32_t rtt_probe_cfg_set(const rtt_probe_cfg_t * p_cfg);
+
+/**@brief     Function for passing data notified by the peer to the probe.
+ *
+ * @param[in] p_data Notified data.
+ * @param[in] len    Length of the data.
+ *
+ * @return    true if the data was the echo of a probe, false if it is UART data.
+ */
+bool rtt_probe_on_rx(const uint8_t * p_data, uint16_t len);
+
+/**@brief     Function for getting the probe statistics.
+ *
+ * @param[out] p_stats Statistics since the probe was last started.
+ */
+void rtt_probe_stats_get(rtt_probe_stats_t * p_stats);
+
+#endif // RTT_PROBE_H__
+
+/** @} */
@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "scan_gw.h"
+#include "uart_cmd.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+#define FRAME_HEADER_LEN   5     /**< ESC, op, count, dropped and len of a batch. */
+#define DROPPED_MAX        0xFF  /**< Highest dropped count a batch header holds. */
+
+STATIC_ASSERT(SCAN_GW_BATCH_SIZE <= 0xFF);
+STATIC_ASSERT(SCAN_GW_BATCH_SIZE >= SCAN_GW_REC_HDR_LEN + BLE_GAP_ADV_MAX_SIZE);
+STATIC_ASSERT(SCAN_GW_BURST_BYTES >= FRAME_HEADER_LEN + SCAN_GW_BATCH_SIZE);
+
+/**@brief Device seen recently. */
+typedef struct
+{
+    uint8_t  addr[BLE_GAP_ADDR_LEN];     /**< Device address. */
+    uint16_t hash;                       /**< Hash of the address type and the advertising data last reported. */
+    uint32_t ticks;                      /**< When it was last reported. */
+} dedup_entry_t;
+
+static scan_gw_init_t  m_init;                                          /**< Copy of the initialization parameters. */
+static scan_gw_stats_t m_stats;                                         /**< Statistics. */
+static app_timer_id_t  m_timer_id;                                      /**< Batch flush timer. */
+static bool            m_timer_running;                                 /**< m_timer_id is started. */
+static uint32_t        m_tick_hz;                                       /**< app_timer tick rate. */
+static uint32_t        m_clock;                                         /**< Ticks since initialization, wider than the RTC counter. */
+static uint32_t        m_cnt_last;                                      /**< RTC counter when m_clock was last updated. */
+static uint32_t        m_credit;                                        /**< UART credit in bytes, scaled by m_tick_hz. */
+static uint32_t        m_credit_clock;                                  /**< When m_credit was last refilled. */
+static uint8_t         m_frame[FRAME_HEADER_LEN + SCAN_GW_BATCH_SIZE];  /**< Batch being filled, behind room for its header. */
+static uint8_t         m_len;                                           /**< Bytes of records in the batch. */
+static uint8_t         m_count;                                         /**< Records in the batch. */
+static uint8_t         m_dropped;                                       /**< Records dropped since the previous batch. */
+static dedup_entry_t   m_dedup[SCAN_GW_DEDUP_ENTRIES];                  /**< Devices seen recently. */
+static uint8_t         m_dedup_count;                                   /**< Entries of m_dedup in use. */
+
+
+static void clock_update(void)
+{
+    uint32_t cnt;
+    uint32_t diff;
+
+    UNUSED_VARIABLE(app_timer_cnt_get(&cnt));
+    UNUSED_VARIABLE(app_timer_cnt_diff_compute(cnt, m_cnt_last, &diff));
+    m_clock   += diff;
+    m_cnt_last = cnt;
+}
+
+
+static void credit_refill(void)
+{
+    uint32_t credit_max = SCAN_GW_BURST_BYTES * m_tick_hz;
+    uint32_t elapsed    = m_clock - m_credit_clock;
+
+    m_credit_clock = m_clock;
+    if (elapsed >= m_tick_hz)
+    {
+        m_credit = credit_max;
+    }
+    else
+    {
+        m_credit = (uint32_t)MIN((uint64_t)m_credit + (uint64_t)elapsed * m_init.bytes_per_sec,
+                                 credit_max);
+    }
+}
+
+
+/**@brief Function for writing the batch if there is credit for it.
+ *
+ * @return true if the batch is empty on return.
+ */
+static bool batch_flush(void)
+{
+    uint32_t need;
+
+    if (m_count == 0)
+    {
+        return true;
+    }
+
+    credit_refill();
+    need = (FRAME_HEADER_LEN + m_len) * m_tick_hz;
+    if (m_credit < need)
+    {
+        return false;
+    }
+    m_credit -= need;
+
+    m_frame[0] = UART_CMD_ESC;
+    m_frame[1] = SCAN_GW_FRAME_OP;
+    m_frame[2] = m_count;
+    m_frame[3] = m_dropped;
+    m_frame[4] = m_len;
+    m_init.write(m_frame, FRAME_HEADER_LEN + m_len);
+
+    m_stats.records_sent += m_count;
+    m_stats.batches_sent++;
+    m_len     = 0;
+    m_count   = 0;
+    m_dropped = 0;
+    return true;
+}
+
+
+static void flush_timer_start(void)
+{
+    uint32_t ticks = APP_TIMER_TICKS(SCAN_GW_FLUSH_MS, m_init.prescaler);
+    uint32_t need  = (FRAME_HEADER_LEN + m_len) * m_tick_hz;
+
+    if ((m_count != 0) && (m_credit < need) && (m_init.bytes_per_sec != 0))
+    {
+        // Wait just long enough for the held batch.
+        ticks = (need - m_credit) / m_init.bytes_per_sec + 1;
+    }
+    if (app_timer_start(m_timer_id, MAX(ticks, APP_TIMER_MIN_TIMEOUT_TICKS), NULL) == NRF_SUCCESS)
+    {
+        m_timer_running = true;
+    }
+}
+
+
+static void flush_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    m_timer_running = false;
+    clock_update();
+    if (!batch_flush())
+    {
+        flush_timer_start();
+    }
+}
+
+
+static uint16_t report_hash(const ble_gap_evt_adv_report_t * p_report)
+{
+    uint16_t hash = (uint16_t)(0x811C ^ p_report->peer_addr.addr_type ^ (p_report->scan_rsp << 2));
+    uint8_t  i;
+
+    for (i = 0; i < p_report->dlen; i++)
+    {
+        hash = (uint16_t)((hash ^ p_report->data[i]) * 0x0193);
+    }
+    return hash;
+}
+
+
+/**@brief Function for finding a device, or the entry to replace with it.
+ */
+static dedup_entry_t * dedup_find(const uint8_t * p_addr)
+{
+    dedup_entry_t * p_oldest = &m_dedup[0];
+    uint8_t         i;
+
+    for (i = 0; i < m_dedup_count; i++)
+    {
+        if (memcmp(m_dedup[i].addr, p_addr, BLE_GAP_ADDR_LEN) == 0)
+        {
+            return &m_dedup[i];
+        }
+        if ((m_clock - m_dedup[i].ticks) > (m_clock - p_oldest->ticks))
+        {
+            p_oldest = &m_dedup[i];
+        }
+    }
+    if (m_dedup_count < SCAN_GW_DEDUP_ENTRIES)
+    {
+        p_oldest = &m_dedup[m_dedup_count++];
+    }
+    memcpy(p_oldest->addr, p_addr, BLE_GAP_ADDR_LEN);
+    p_oldest->hash  = 0;
+    p_oldest->ticks = m_clock - UINT32_MAX / 2;
+    return p_oldest;
+}
+
+
+static bool ad_type_present(const ble_gap_evt_adv_report_t * p_report, uint8_t ad_type)
+{
+    uint8_t index = 0;
+
+    while ((index + 1) < p_report->dlen)
+    {
+        uint8_t field_length = p_report->data[index];
+
+        if (field_length == 0)
+        {
+            break;
+        }
+        if (p_report->data[index + 1] == ad_type)
+        {
+            return true;
+        }
+        index += field_length + 1;
+    }
+    return false;
+}
+
+
+static void record_put(const ble_gap_evt_adv_report_t * p_report)
+{
+    uint8_t * p_rec = &m_frame[FRAME_HEADER_LEN + m_len];
+
+    p_rec[0] = (uint8_t)(p_report->peer_addr.addr_type | (p_report->type << 2) | (p_report->scan_rsp << 4));
+    memcpy(&p_rec[1], p_report->peer_addr.addr, BLE_GAP_ADDR_LEN);
+    p_rec[7] = (uint8_t)p_report->rssi;
+    UNUSED_VARIABLE(uint32_encode(m_clock, &p_rec[8]));
+    p_rec[12] = p_report->dlen;
+    memcpy(&p_rec[SCAN_GW_REC_HDR_LEN], p_report->data, p_report->dlen);
+
+    m_len += SCAN_GW_REC_HDR_LEN + p_report->dlen;
+    m_count++;
+}
+
+
+uint32_t scan_gw_init(const scan_gw_init_t * p_init)
+{
+    if ((p_init->p_filter == NULL) || (p_init->write == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_init          = *p_init;
+    m_tick_hz       = APP_TIMER_CLOCK_FREQ / (p_init->prescaler + 1);
+    m_clock         = 0;
+    m_credit        = SCAN_GW_BURST_BYTES * m_tick_hz;
+    m_credit_clock  = 0;
+    m_len           = 0;
+    m_count         = 0;
+    m_dropped       = 0;
+    m_dedup_count   = 0;
+    m_timer_running = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+    UNUSED_VARIABLE(app_timer_cnt_get(&m_cnt_last));
+
+    return app_timer_create(&m_timer_id, APP_TIMER_MODE_SINGLE_SHOT, flush_timeout_handler);
+}
+
+
+void scan_gw_on_adv_report(const ble_gap_evt_adv_report_t * p_report)
+{
+    const scan_gw_filter_t * p_filter = m_init.p_filter;
+    dedup_entry_t          * p_entry  = NULL;
+    uint16_t                 hash     = 0;
+
+    if ((p_report->rssi < p_filter->rssi_min) ||
+        ((p_filter->ad_type != 0) && !ad_type_present(p_report, p_filter->ad_type)))
+    {
+        m_stats.filtered++;
+        return;
+    }
+
+    clock_update();
+    if (p_filter->dedup_ms != 0)
+    {
+        hash    = report_hash(p_report);
+        p_entry = dedup_find(p_report->peer_addr.addr);
+        if ((p_entry->hash == hash) &&
+            ((m_clock - p_entry->ticks) < APP_TIMER_TICKS(p_filter->dedup_ms, m_init.prescaler)))
+        {
+            m_stats.deduplicated++;
+            return;
+        }
+    }
+
+    if (((m_len + SCAN_GW_REC_HDR_LEN + p_report->dlen) > SCAN_GW_BATCH_SIZE) && !batch_flush())
+    {
+        m_stats.dropped++;
+        if (m_dropped < DROPPED_MAX)
+        {
+            m_dropped++;
+        }
+        return;
+    }
+
+    record_put(p_report);
+    if (p_entry != NULL)
+    {
+        p_entry->hash  = hash;
+        p_entry->ticks = m_clock;
+    }
+    if (!m_timer_running)
+    {
+        flush_timer_start();
+    }
+}
+
+
+void scan_gw_rate_set(uint32_t bytes_per_sec)
+{
+    clock_update();
+    credit_refill();
+    m_init.bytes_per_sec = bytes_per_sec;
+}
+
+
+void scan_gw_stats_get(scan_gw_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup scan_gw Scanner Gateway
+ * @{
+ * @brief    Streams advertising reports to the UART as batched binary records.
+ *
+ * @details  Reports that pass the filter are packed into records, and records are sent in
+ *           batches framed like a @ref uart_cmd response:
+ *
+ *           @code
+ *           ESC 0xC0 count dropped len records[len]
+ *           @endcode
+ *
+ *           where count is the number of records, and dropped is the number of records lost
+ *           since the previous batch because the UART could not keep up, saturated at 255.
+ *           Each record is:
+ *
+ *           @code
+ *           info addr[6] rssi ticks[4] dlen data[dlen]
+ *           @endcode
+ *
+ *           info holds the address type in bits 0-1 and the advertising type in bits 2-3, and
+ *           bit 4 is set for a scan response. ticks is the little endian time of the report in
+ *           app_timer ticks. It wraps after 2^32 ticks and loses time across gaps in reports
+ *           longer than the RTC counter period.
+ *
+ *           A device is reported again with unchanged data only once the deduplication window
+ *           has passed. Output is bounded to the UART rate: a batch is held until there is credit
+ *           for it, and records that do not fit while a batch is held are dropped and counted.
+ */
+
+#ifndef SCAN_GW_H__
+#define SCAN_GW_H__
+
+#include <stdint.h>
+#include "ble_gap.h"
+#include "scan_gw_cnfg.h"
+
+#define SCAN_GW_FRAME_OP         0xC0    /**< Op of a batch frame, a response op no request uses. */
+#define SCAN_GW_REC_HDR_LEN      13      /**< Record size without the advertising data. */
+
+/**@brief Filter and deduplication settings. Read on every report, so they can be changed at any time. */
+typedef struct
+{
+    uint8_t  ad_type;                    /**< Only report advertising data holding an AD structure of this type. 0 for any. */
+    int8_t   rssi_min;                   /**< Only report devices at least this strong, in dBm. */
+    uint16_t dedup_ms;                   /**< Deduplication window in milliseconds. 0 to report every advertisement. */
+} scan_gw_filter_t;
+
+/**@brief Function for writing a batch to the UART, without escaping. */
+typedef void (* scan_gw_write_t) (const uint8_t * p_data, uint16_t len);
+
+/**@brief Scanner gateway initialization structure. */
+typedef struct
+{
+    const scan_gw_filter_t * p_filter;      /**< Filter settings. Must stay valid. */
+    scan_gw_write_t          write;         /**< Function for writing batches. */
+    uint32_t                 bytes_per_sec; /**< UART rate. */
+    uint32_t                 prescaler;     /**< RTC1 prescaler of the app_timer module. */
+} scan_gw_init_t;
+
+/**@brief Scanner gateway statistics. */
+typedef struct
+{
+    uint32_t records_sent;               /**< Records written to the UART. */
+    uint32_t batches_sent;               /**< Batches written to the UART. */
+    uint32_t dropped;                    /**< Records lost because the UART could not keep up. */
+    uint32_t deduplicated;               /**< Reports suppressed by the deduplication window. */
+    uint32_t filtered;                   /**< Reports rejected by the filter. */
+} scan_gw_stats_t;
+
+/**@brief     Function for initializing the scanner gateway.
+ *
+ * @param[in] p_init Initialization parameters.
+ *
+ * @retval    NRF_SUCCESS    On success.
+ * @retval    NRF_ERROR_NULL If the filter or the write function is missing.
+ * @return    Otherwise an error code propagated from @ref app_timer_create.
+ */
+uint32_t scan_gw_init(const scan_gw_init_t * p_init);
+
+/**@brief     Function for passing an advertising report to the gateway.
+ *
+ * @param[in] p_report Advertising report from the SoftDevice.
+ */
+void scan_gw_on_adv_report(const ble_gap_evt_adv_report_t * p_report);
+
+/**@brief     Function for setting the UART rate after a baud rate change.
+ *
+ * @param[in] bytes_per_sec New UART rate.
+ */
+void scan_gw_rate_set(uint32_t bytes_per_sec);
+
+/**@brief     Function for getting the gateway statistics.
+ *
+ * @param[out] p_stats Statistics since initialization.
+ */
+void scan_gw_stats_get(scan_gw_stats_t * p_stats);
+
+#endif // SCAN_GW_H__
+
+/** @} */
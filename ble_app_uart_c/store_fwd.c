@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "store_fwd.h"
+#include "buf_pool.h"
+#include "flash_sched.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+#include "app_util.h"
+#include "app_trace.h"
+
+#define LOG                    app_trace_log         /**< Debug logger macro that will be used in this file to do logging of important information over UART. */
+
+#define RECORD_STATE_VALID     0xA5                  /**< State of a record that holds data. */
+#define RECORD_STATE_ERASED    0xFF                  /**< State of a record in erased flash. */
+
+STATIC_ASSERT((sizeof(store_fwd_record_t) % sizeof(uint32_t)) == 0);
+STATIC_ASSERT(STORE_FWD_SPILL_HEADROOM < STORE_FWD_RAM_RECORDS);
+STATIC_ASSERT(sizeof(store_fwd_record_t) <= BUF_POOL_BLOCK_SIZE);
+
+static store_fwd_t * mp_store_fwd;                   /**< Pointer to the instance, used from the pstorage callback. */
+
+
+/**@brief Function for getting the index in the RAM FIFO of a position counted from the oldest
+ *        record.
+ */
+static uint8_t ram_index(const store_fwd_t * p_sf, uint8_t pos)
+{
+    uint16_t index = (uint16_t)p_sf->ram_head + pos;
+
+    if (index >= STORE_FWD_RAM_RECORDS)
+    {
+        index -= STORE_FWD_RAM_RECORDS;
+    }
+    return (uint8_t)index;
+}
+
+
+/**@brief Function for getting the RAM record at a position counted from the oldest record.
+ */
+static store_fwd_record_t * ram_record_get(store_fwd_t * p_sf, uint8_t pos)
+{
+    return p_sf->ram[ram_index(p_sf, pos)];
+}
+
+
+/**@brief Function for removing the oldest RAM record, and giving its block back to the pool.
+ */
+static void ram_record_pop(store_fwd_t * p_sf)
+{
+    buf_pool_free(BUF_POOL_USER_STORE_FWD, p_sf->ram[p_sf->ram_head]);
+    p_sf->ram[p_sf->ram_head] = NULL;
+    p_sf->ram_head++;
+    if (p_sf->ram_head == STORE_FWD_RAM_RECORDS)
+    {
+        p_sf->ram_head = 0;
+    }
+    p_sf->ram_count--;
+}
+
+
+/**@brief Function for removing the RAM record at a position counted from the oldest record,
+ *        moving the newer records up, and giving its block back to the pool.
+ */
+static void ram_record_remove(store_fwd_t * p_sf, uint8_t pos)
+{
+    buf_pool_free(BUF_POOL_USER_STORE_FWD, ram_record_get(p_sf, pos));
+    for (; (pos + 1) < p_sf->ram_count; pos++)
+    {
+        p_sf->ram[ram_index(p_sf, pos)] = ram_record_get(p_sf, pos + 1);
+    }
+    p_sf->ram[ram_index(p_sf, pos)] = NULL;
+    p_sf->ram_count--;
+}
+
+
+/**@brief Function for finding the pstorage block and offset of a flash record.
+ */
+static uint32_t flash_record_locate(store_fwd_t       * p_sf,
+                                    uint16_t            index,
+                                    pstorage_handle_t * p_block,
+                                    pstorage_size_t   * p_offset)
+{
+    *p_offset = (pstorage_size_t)((index % p_sf->records_per_page) * sizeof(store_fwd_record_t));
+
+    return pstorage_block_identifier_get(&p_sf->flash_handle,
+                                         (pstorage_size_t)(index / p_sf->records_per_page),
+                                         p_block);
+}
+
+
+/**@brief Function for reading a flash record.
+ */
+static uint32_t flash_record_load(store_fwd_t * p_sf, uint16_t index, store_fwd_record_t * p_record)
+{
+    pstorage_handle_t block;
+    pstorage_size_t   offset;
+    uint32_t          err_code;
+
+    err_code = flash_record_locate(p_sf, index, &block, &offset);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return pstorage_load((uint8_t *)p_record, &block, sizeof(store_fwd_record_t), offset);
+}
+
+
+/**@brief Function for checking whether an error from the send function means "try again later".
+ */
+static bool send_retryable(uint32_t err_code)
+{
+    return ((err_code == NRF_ERROR_NO_MEM)        ||
+            (err_code == NRF_ERROR_INVALID_STATE) ||
+            (err_code == NRF_ERROR_BUSY)          ||
+            (err_code == BLE_ERROR_NO_TX_BUFFERS));
+}
+
+
+/**@brief Function for moving the oldest RAM record to flash when RAM runs low.
+ */
+static void spill_next(store_fwd_t * p_sf)
+{
+    pstorage_handle_t block;
+    pstorage_size_t   offset;
+    uint32_t          err_code;
+
+    if ((p_sf->flash_capacity == 0)                                             ||
+        p_sf->flash_busy                                                        ||
+        (p_sf->flash_wr >= p_sf->flash_capacity)                                ||
+        ((STORE_FWD_RAM_RECORDS - p_sf->ram_count) > STORE_FWD_SPILL_HEADROOM))
+    {
+        return;
+    }
+
+    err_code = flash_record_locate(p_sf, p_sf->flash_wr, &block, &offset);
+    if (err_code == NRF_SUCCESS)
+    {
+        // The record is written straight from RAM, so it must stay in place until pstorage
+        // reports completion.
+        err_code = flash_sched_store(&block,
+                                     (uint8_t *)p_sf->ram[p_sf->ram_head],
+                                     sizeof(store_fwd_record_t),
+                                     offset,
+                                     FLASH_SCHED_PRIO_URGENT);
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        p_sf->stats.flash_errors++;
+        return;
+    }
+
+    p_sf->flash_busy    = true;
+    p_sf->head_spilling = true;
+}
+
+
+/**@brief Function for erasing the flash area once every record in it has been replayed.
+ */
+static void flash_clear(store_fwd_t * p_sf)
+{
+    uint32_t err_code;
+
+    if (p_sf->flash_busy)
+    {
+        return;
+    }
+
+    // Spilling is held off until the erase is done, so it is not deferred either.
+    err_code = flash_sched_clear(&p_sf->flash_handle,
+                                 (pstorage_size_t)(STORE_FWD_FLASH_PAGES * PSTORAGE_FLASH_PAGE_SIZE),
+                                 FLASH_SCHED_PRIO_URGENT);
+    if (err_code != NRF_SUCCESS)
+    {
+        p_sf->stats.flash_errors++;
+        return;
+    }
+
+    p_sf->flash_busy = true;
+}
+
+
+/**@brief Function for handling pstorage events for the flash area.
+ */
+static void flash_cb_handler(pstorage_handle_t * p_handle,
+                             uint8_t             op_code,
+                             uint32_t            result,
+                             uint8_t           * p_data,
+                             uint32_t            data_len)
+{
+    store_fwd_t * p_sf = mp_store_fwd;
+
+    p_sf->flash_busy = false;
+    if (result != NRF_SUCCESS)
+    {
+        p_sf->stats.flash_errors++;
+    }
+
+    switch (op_code)
+    {
+        case PSTORAGE_STORE_OP_CODE:
+            if (!p_sf->head_spilling)
+            {
+                break;
+            }
+            p_sf->head_spilling = false;
+
+            // A failed write may have left the slot partially programmed, so it is skipped in
+            // any case. The record stays in RAM if it did not make it to flash.
+            p_sf->flash_wr++;
+            if (result == NRF_SUCCESS)
+            {
+                ram_record_pop(p_sf);
+                p_sf->stats.spilled++;
+                if ((p_sf->flash_wr - p_sf->flash_rd) > p_sf->stats.flash_high_water)
+                {
+                    p_sf->stats.flash_high_water = p_sf->flash_wr - p_sf->flash_rd;
+                }
+            }
+            break;
+
+        case PSTORAGE_CLEAR_OP_CODE:
+            if (result == NRF_SUCCESS)
+            {
+                p_sf->flash_rd = 0;
+                p_sf->flash_wr = 0;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    spill_next(p_sf);
+    store_fwd_drain(p_sf);
+}
+
+
+/**@brief Function for registering the flash area and finding records left from before a reset.
+ */
+static uint32_t flash_init(store_fwd_t * p_sf)
+{
+    pstorage_module_param_t param;
+    store_fwd_record_t      record;
+    uint32_t                err_code;
+
+    param.block_size  = PSTORAGE_FLASH_PAGE_SIZE;
+    param.block_count = STORE_FWD_FLASH_PAGES;
+    param.cb          = flash_cb_handler;
+
+    err_code = flash_sched_register(&param, &p_sf->flash_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    p_sf->records_per_page = PSTORAGE_FLASH_PAGE_SIZE / sizeof(store_fwd_record_t);
+    p_sf->flash_capacity   = p_sf->records_per_page * STORE_FWD_FLASH_PAGES;
+
+    for (p_sf->flash_wr = 0; p_sf->flash_wr < p_sf->flash_capacity; p_sf->flash_wr++)
+    {
+        err_code = flash_record_load(p_sf, p_sf->flash_wr, &record);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+        if (record.state == RECORD_STATE_ERASED)
+        {
+            break;
+        }
+        if (record.state != RECORD_STATE_VALID)
+        {
+            // Interrupted write. No more records can be appended until the area is erased.
+            p_sf->flash_wr = p_sf->flash_capacity;
+            break;
+        }
+    }
+
+    if (p_sf->flash_wr != 0)
+    {
+        LOG("[sf]: %d records found in flash.\r\n", p_sf->flash_wr);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t store_fwd_init(store_fwd_t * p_sf, const store_fwd_init_t * p_sf_init)
+{
+    if ((p_sf == NULL) || (p_sf_init == NULL) || (p_sf_init->send == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    memset(p_sf, 0, sizeof(*p_sf));
+
+    p_sf->send   = p_sf_init->send;
+    p_sf->policy = p_sf_init->policy;
+
+    mp_store_fwd = p_sf;
+
+    if (STORE_FWD_FLASH_PAGES == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    return flash_init(p_sf);
+}
+
+
+uint32_t store_fwd_write(store_fwd_t * p_sf, const uint8_t * p_data, uint16_t len)
+{
+    store_fwd_record_t * p_record;
+    uint32_t             err_code;
+    uint8_t              oldest;
+
+    if (len > BLE_NUS_MAX_DATA_LEN)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (p_sf->link_up && store_fwd_is_empty(p_sf))
+    {
+        err_code = p_sf->send(p_data, len);
+        if (err_code == NRF_SUCCESS)
+        {
+            p_sf->stats.sent_direct++;
+            return NRF_SUCCESS;
+        }
+        if (!send_retryable(err_code))
+        {
+            return err_code;
+        }
+    }
+
+    p_record = NULL;
+    if (p_sf->ram_count < STORE_FWD_RAM_RECORDS)
+    {
+        p_record = buf_pool_alloc(BUF_POOL_USER_STORE_FWD);
+    }
+    if (p_record == NULL)
+    {
+        // RAM is full, or the pool has no block to spare. The oldest record cannot be dropped
+        // while pstorage is reading it, so the one after it goes instead.
+        oldest = p_sf->head_spilling ? 1 : 0;
+        if ((p_sf->policy == STORE_FWD_POLICY_DROP_NEWEST) || (p_sf->ram_count <= oldest))
+        {
+            p_sf->stats.dropped_newest++;
+            return NRF_ERROR_NO_MEM;
+        }
+        ram_record_remove(p_sf, oldest);
+        p_sf->stats.dropped_oldest++;
+
+        // Takes the block just given back.
+        p_record = buf_pool_alloc(BUF_POOL_USER_STORE_FWD);
+        if (p_record == NULL)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+    }
+
+    p_sf->ram[ram_index(p_sf, p_sf->ram_count)] = p_record;
+    p_record->len   = (uint8_t)len;
+    p_record->state = RECORD_STATE_VALID;
+    memcpy(p_record->data, p_data, len);
+
+    p_sf->ram_count++;
+    p_sf->stats.stored++;
+    if (p_sf->ram_count > p_sf->stats.ram_high_water)
+    {
+        p_sf->stats.ram_high_water = p_sf->ram_count;
+    }
+
+    spill_next(p_sf);
+
+    return NRF_SUCCESS;
+}
+
+
+void store_fwd_drain(store_fwd_t * p_sf)
+{
+    store_fwd_record_t   record;
+    store_fwd_record_t * p_record;
+
+    while (p_sf->link_up)
+    {
+        // The oldest RAM record is on its way to flash. Wait for it to land to keep the order.
+        if (p_sf->head_spilling)
+        {
+            break;
+        }
+
+        if (p_sf->flash_rd < p_sf->flash_wr)
+        {
+            if ((flash_record_load(p_sf, p_sf->flash_rd, &record) != NRF_SUCCESS) ||
+                (record.state != RECORD_STATE_VALID) ||
+                (record.len > BLE_NUS_MAX_DATA_LEN))
+            {
+                p_sf->stats.flash_errors++;
+                p_sf->flash_rd++;
+                continue;
+            }
+            if (p_sf->send(record.data, record.len) != NRF_SUCCESS)
+            {
+                break;
+            }
+            p_sf->flash_rd++;
+            p_sf->stats.replayed++;
+            continue;
+        }
+
+        if (p_sf->flash_wr != 0)
+        {
+            flash_clear(p_sf);
+        }
+
+        if (p_sf->ram_count == 0)
+        {
+            break;
+        }
+
+        p_record = ram_record_get(p_sf, 0);
+        if (p_sf->send(p_record->data, p_record->len) != NRF_SUCCESS)
+        {
+            break;
+        }
+        ram_record_pop(p_sf);
+        p_sf->stats.replayed++;
+    }
+}
+
+
+void store_fwd_link_up(store_fwd_t * p_sf)
+{
+    p_sf->link_up = true;
+    store_fwd_drain(p_sf);
+}
+
+
+void store_fwd_link_down(store_fwd_t * p_sf)
+{
+    p_sf->link_up = false;
+}
+
+
+void store_fwd_policy_set(store_fwd_t * p_sf, store_fwd_policy_t policy)
+{
+    p_sf->policy = policy;
+}
+
+
+bool store_fwd_is_empty(const store_fwd_t * p_sf)
+{
+    return ((p_sf->ram_count == 0) && (p_sf->flash_rd == p_sf->flash_wr));
+}
+
+
+bool store_fwd_is_congested(const store_fwd_t * p_sf)
+{
+    return (p_sf->link_up && !store_fwd_is_empty(p_sf));
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup store_fwd UART Store-and-Forward Buffer
+ * @{
+ * @brief    Holds UART data while the link to the peer is down and replays it on reconnect.
+ *
+ * @details  Data written to this module is passed straight to the send function while the link
+ *           is up and nothing is buffered. Otherwise it is appended to a FIFO of records in RAM,
+ *           each in a block of the @ref buf_pool. If the pool has no block to spare, the policy
+ *           applies as if the FIFO were full. When RAM runs low, the oldest records are moved to
+ *           a flash area reserved through pstorage. Flash is only appended to, so a policy can
+ *           only make room in RAM: the records in flash are kept until they are replayed. When the link comes back up, flash records
+ *           are replayed first, then RAM records, as fast as the send function accepts them. The
+ *           flash area is erased once all of its records have been replayed.
+ *
+ *           Records in flash survive a reset and are replayed after the next connection. A
+ *           reset during replay may cause records to be sent twice.
+ *
+ * @note     Flash writes go through @ref flash_sched, so pstorage_init() and flash_sched_init()
+ *           must have been called, and system events must be passed to
+ *           pstorage_sys_event_handler().
+ */
+
+#ifndef STORE_FWD_H__
+#define STORE_FWD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_uart_c.h"
+#include "pstorage.h"
+#include "store_fwd_cnfg.h"
+
+/**@brief Policy when no space is left for a new record. */
+typedef enum
+{
+    STORE_FWD_POLICY_DROP_OLDEST_RAM, /**< Discard the oldest record held in RAM that is not being written to flash. Records already in flash are older, and are kept. */
+    STORE_FWD_POLICY_DROP_NEWEST      /**< Discard the record being written. */
+} store_fwd_policy_t;
+
+/**@brief Function for sending data to the peer.
+ *
+ * @return NRF_SUCCESS if the data was accepted. NRF_ERROR_NO_MEM, BLE_ERROR_NO_TX_BUFFERS or
+ *         NRF_ERROR_INVALID_STATE if it should be tried again later.
+ */
+typedef uint32_t (* store_fwd_send_t) (const uint8_t * p_data, uint16_t len);
+
+/**@brief Store-and-forward record. Matches the layout in flash. */
+typedef struct
+{
+    uint8_t  len;                             /**< Length of the data. */
+    uint8_t  state;                           /**< Record state. 0xFF when the flash word is erased. */
+    uint16_t reserved;                        /**< Reserved, keeps the data word aligned. */
+    uint8_t  data[BLE_NUS_MAX_DATA_LEN];      /**< UART data. */
+} store_fwd_record_t;
+
+/**@brief Store-and-forward statistics. */
+typedef struct
+{
+    uint32_t sent_direct;      /**< Packets passed straight to the send function. */
+    uint32_t stored;           /**< Packets stored while the link was down or busy. */
+    uint32_t replayed;         /**< Stored packets sent after reconnect. */
+    uint32_t spilled;          /**< Records moved from RAM to flash. */
+    uint32_t dropped_oldest;   /**< Records discarded by @ref STORE_FWD_POLICY_DROP_OLDEST_RAM. */
+    uint32_t dropped_newest;   /**< Records discarded by @ref STORE_FWD_POLICY_DROP_NEWEST. */
+    uint32_t flash_errors;     /**< Failed flash operations. */
+    uint16_t ram_high_water;   /**< Highest number of records held in RAM. */
+    uint16_t flash_high_water; /**< Highest number of records held in flash. */
+} store_fwd_stats_t;
+
+/**@brief Store-and-forward structure. The memory is provided by the application. */
+typedef struct
+{
+    store_fwd_send_t   send;                                  /**< Function for sending data to the peer. */
+    store_fwd_policy_t policy;                                /**< Policy when full. */
+    bool               link_up;                               /**< Whether data can be sent to the peer. */
+    bool               flash_busy;                            /**< Whether a flash operation is outstanding. */
+    bool               head_spilling;                         /**< Whether the oldest RAM record is being written to flash. */
+    uint8_t            ram_head;                              /**< Index of the oldest RAM record. */
+    uint8_t            ram_count;                             /**< Number of RAM records. */
+    uint16_t           flash_rd;                              /**< Index of the next flash record to replay. */
+    uint16_t           flash_wr;                              /**< Index of the next free flash record. */
+    uint16_t           flash_capacity;                        /**< Number of records that fit in flash. */
+    uint16_t           records_per_page;                      /**< Number of records per flash page. */
+    pstorage_handle_t  flash_handle;                          /**< pstorage handle of the flash area. */
+    store_fwd_record_t * ram[STORE_FWD_RAM_RECORDS];          /**< RAM records, in @ref buf_pool blocks. */
+    store_fwd_stats_t  stats;                                 /**< Statistics. */
+} store_fwd_t;
+
+/**@brief Store-and-forward initialization structure. */
+typedef struct
+{
+    store_fwd_send_t   send;     /**< Function for sending data to the peer. */
+    store_fwd_policy_t policy;   /**< Policy when full. */
+} store_fwd_init_t;
+
+/**@brief     Function for initializing the store-and-forward buffer.
+ *
+ * @details   Registers the flash area with the flash scheduler and finds records left from before a reset.
+ *
+ * @param[out] p_sf      Store-and-forward instance.
+ * @param[in]  p_sf_init Initialization parameters.
+ *
+ * @retval    NRF_SUCCESS On success. Otherwise an error code propagated from pstorage.
+ */
+uint32_t store_fwd_init(store_fwd_t * p_sf, const store_fwd_init_t * p_sf_init);
+
+/**@brief     Function for writing UART data towards the peer.
+ *
+ * @param[in] p_sf   Store-and-forward instance.
+ * @param[in] p_data Data to write.
+ * @param[in] len    Length of the data, at most @ref BLE_NUS_MAX_DATA_LEN.
+ *
+ * @retval    NRF_SUCCESS             If the data was sent or stored.
+ * @retval    NRF_ERROR_NO_MEM        If the data was dropped by @ref STORE_FWD_POLICY_DROP_NEWEST.
+ * @retval    NRF_ERROR_INVALID_PARAM If the data is too long.
+ *                                    Otherwise an error code returned by the send function.
+ *
+ * @note      With @ref STORE_FWD_POLICY_DROP_OLDEST_RAM and a single RAM record, which is being
+ *            written to flash, there is nothing the policy may discard, and the data is dropped
+ *            as with @ref STORE_FWD_POLICY_DROP_NEWEST.
+ */
+uint32_t store_fwd_write(store_fwd_t * p_sf, const uint8_t * p_data, uint16_t len);
+
+/**@brief     Function for replaying stored records.
+ *
+ * @details   Call this whenever the send function may accept more data.
+ *
+ * @param[in] p_sf Store-and-forward instance.
+ */
+void store_fwd_drain(store_fwd_t * p_sf);
+
+/**@brief     Function for signalling that the link to the peer is ready, and starting replay.
+ *
+ * @param[in] p_sf Store-and-forward instance.
+ */
+void store_fwd_link_up(store_fwd_t * p_sf);
+
+/**@brief     Function for signalling that the link to the peer has been lost.
+ *
+ * @param[in] p_sf Store-and-forward instance.
+ */
+void store_fwd_link_down(store_fwd_t * p_sf);
+
+/**@brief     Function for changing the policy when full.
+ *
+ * @param[in] p_sf   Store-and-forward instance.
+ * @param[in] policy New policy.
+ */
+void store_fwd_policy_set(store_fwd_t * p_sf, store_fwd_policy_t policy);
+
+/**@brief     Function for checking whether any records are held.
+ *
+ * @param[in] p_sf Store-and-forward instance.
+ *
+ * @return    true if no records are held in RAM or flash.
+ */
+bool store_fwd_is_empty(const store_fwd_t * p_sf);
+
+/**@brief     Function for checking whether the link is the bottleneck.
+ *
+ * @details   Data written while the link is up but records are waiting to be replayed is only
+ *            stored, so a writer that can be slowed down should wait for @ref store_fwd_drain
+ *            to empty the buffer instead.
+ *
+ * @param[in] p_sf Store-and-forward instance.
+ *
+ * @return    true if the link is up and records are held.
+ */
+bool store_fwd_is_congested(const store_fwd_t * p_sf);
+
+#endif // STORE_FWD_H__
+
+/** @} */
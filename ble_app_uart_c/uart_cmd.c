@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@cond To Make Doxygen skip documentation generation for this file.
+ * @{
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "uart_cmd.h"
+#include "app_timer.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+#define FRAME_HEADER_LEN   5     /**< ESC, op, id, status and len of a response. */
+#define OPEN_LEN           4     /**< ESC, op, id and len of an OPEN request. */
+
+/**@brief Request parser state, named after the field expected next. */
+typedef enum
+{
+    RX_STATE_DATA,               /**< Data, or ESC. */
+    RX_STATE_OP,                 /**< Op, or ESC for an escaped data byte. */
+    RX_STATE_ID,                 /**< Parameter ID. */
+    RX_STATE_LEN,                /**< Value length. */
+    RX_STATE_VALUE               /**< Value bytes. */
+} rx_state_t;
+
+static uart_cmd_init_t m_init;                               /**< Copy of the initialization parameters. */
+static rx_state_t      m_rx_state;                           /**< Request parser state. */
+static uint8_t         m_op;                                 /**< Op of the request. */
+static uint8_t         m_id;                                 /**< Parameter ID of the request. */
+static uint8_t         m_len;                                /**< Value length of the request. */
+static uint8_t         m_value_len;                          /**< Value bytes received. */
+static uint8_t         m_value[UART_CMD_MAX_VALUE_LEN];      /**< Value of the request. Bytes beyond its size are discarded. */
+static bool            m_open;                               /**< Whether the channel is open. */
+static bool            m_rx_seen;                            /**< Whether a byte has been received since reset. */
+static uint32_t        m_rx_ticks;                           /**< RTC counter when the last byte was received. */
+static uint8_t         m_held[OPEN_LEN];                     /**< Bytes held back as the possible start of an OPEN request. */
+static uint8_t         m_held_len;                           /**< Bytes in m_held. */
+static uint8_t         m_held_rd;                            /**< Next byte of m_held to give back as data, when it is not a match in progress. */
+static bool            m_held_data;                          /**< Whether m_held has turned out to be data. */
+
+static const uint8_t   m_open_req[OPEN_LEN] = {UART_CMD_ESC, UART_CMD_OP_OPEN, 0x00, 0x00}; /**< OPEN request. */
+
+
+static const uart_cmd_param_t * param_find(uint8_t id)
+{
+    uint8_t i;
+
+    for (i = 0; i < m_init.param_count; i++)
+    {
+        if (m_init.p_params[i].id == id)
+        {
+            return &m_init.p_params[i];
+        }
+    }
+    return NULL;
+}
+
+
+static void response_send(uint32_t status, const uint8_t * p_value, uint8_t len)
+{
+    uint8_t frame[FRAME_HEADER_LEN + UART_CMD_MAX_VALUE_LEN];
+
+    frame[0] = UART_CMD_ESC;
+    frame[1] = m_op | UART_CMD_OP_RESPONSE;
+    frame[2] = m_id;
+    frame[3] = (uint8_t)status;
+    frame[4] = len;
+    if (len != 0)
+    {
+        memcpy(&frame[FRAME_HEADER_LEN], p_value, len);
+    }
+
+    m_init.write(frame, FRAME_HEADER_LEN + len);
+}
+
+
+/**@brief Function for checking a new integer value against the range of its parameter.
+ */
+static bool int_in_range(const uart_cmd_param_t * p_param, const uint8_t * p_value)
+{
+    uint32_t value = 0;
+
+    memcpy(&value, p_value, p_param->len);
+    return ((value >= p_param->min) && (value <= p_param->max));
+}
+
+
+static uint32_t param_set(const uart_cmd_param_t * p_param)
+{
+    uint8_t        old_value[UART_CMD_MAX_VALUE_LEN];
+    uart_cmd_evt_t evt;
+    uint32_t       err_code;
+
+    if (m_len != p_param->len)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_param->is_int && !int_in_range(p_param, m_value))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    memcpy(old_value, p_param->p_value, p_param->len);
+    memcpy(p_param->p_value, m_value, p_param->len);
+
+    evt.evt_type = UART_CMD_EVT_PARAM_SET;
+    evt.p_param  = p_param;
+    err_code     = m_init.evt_handler(&evt);
+    if (err_code != NRF_SUCCESS)
+    {
+        memcpy(p_param->p_value, old_value, p_param->len);
+    }
+    return err_code;
+}
+
+
+/**@brief Function for running a complete request and answering it.
+ */
+static void request_run(void)
+{
+    const uart_cmd_param_t * p_param = param_find(m_id);
+    uart_cmd_evt_t           evt;
+    uint32_t                 err_code;
+
+    if (m_len > UART_CMD_MAX_VALUE_LEN)
+    {
+        response_send(NRF_ERROR_INVALID_LENGTH, NULL, 0);
+        return;
+    }
+
+    switch (m_op)
+    {
+        case UART_CMD_OP_GET:
+            if (p_param == NULL)
+            {
+                response_send(NRF_ERROR_NOT_FOUND, NULL, 0);
+                break;
+            }
+            evt.evt_type = UART_CMD_EVT_PARAM_GET;
+            evt.p_param  = p_param;
+            err_code     = m_init.evt_handler(&evt);
+            if (err_code != NRF_SUCCESS)
+            {
+                response_send(err_code, NULL, 0);
+            }
+            else
+            {
+                response_send(NRF_SUCCESS, p_param->p_value, p_param->len);
+            }
+            break;
+
+        case UART_CMD_OP_SET:
+            err_code = (p_param == NULL) ? NRF_ERROR_NOT_FOUND : param_set(p_param);
+            response_send(err_code, NULL, 0);
+            break;
+
+        case UART_CMD_OP_OPEN:
+            response_send(NRF_SUCCESS, NULL, 0);
+            break;
+
+        case UART_CMD_OP_CLOSE:
+            response_send(NRF_SUCCESS, NULL, 0);
+            m_open = false;
+            break;
+
+        case UART_CMD_OP_SAVE:
+        case UART_CMD_OP_DEFAULTS:
+            evt.evt_type = (m_op == UART_CMD_OP_SAVE) ? UART_CMD_EVT_SAVE : UART_CMD_EVT_DEFAULTS;
+            evt.p_param  = NULL;
+            response_send(m_init.evt_handler(&evt), NULL, 0);
+            break;
+
+        default:
+            response_send(NRF_ERROR_NOT_SUPPORTED, NULL, 0);
+            break;
+    }
+}
+
+
+uint32_t uart_cmd_init(const uart_cmd_init_t * p_init)
+{
+    uint8_t i;
+
+    if ((p_init->p_params == NULL) || (p_init->evt_handler == NULL) || (p_init->write == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    for (i = 0; i < p_init->param_count; i++)
+    {
+        if (p_init->p_params[i].len > UART_CMD_MAX_VALUE_LEN)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    m_init      = *p_init;
+    m_rx_state  = RX_STATE_DATA;
+    m_open      = false;
+    m_rx_seen   = false;
+    m_held_len  = 0;
+    m_held_data = false;
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for checking whether the UART has been silent long enough for an OPEN request.
+ */
+static bool guard_elapsed(uint32_t ticks)
+{
+    uint32_t diff;
+
+    if (!m_rx_seen)
+    {
+        return true;
+    }
+    UNUSED_VARIABLE(app_timer_cnt_diff_compute(ticks, m_rx_ticks, &diff));
+    return (diff >= APP_TIMER_TICKS(UART_CMD_GUARD_MS, m_init.prescaler));
+}
+
+
+/**@brief Function for matching a byte received while the channel is closed against an OPEN
+ *        request.
+ *
+ * @return true if the byte is data that was not held back.
+ */
+static bool closed_on_rx(uint8_t byte, uint32_t ticks)
+{
+    if (m_held_len == 0)
+    {
+        if ((byte != UART_CMD_ESC) || !guard_elapsed(ticks))
+        {
+            return true;
+        }
+    }
+    else if (byte != m_open_req[m_held_len])
+    {
+        // Not an OPEN request. The bytes held back and this one are data, in that order.
+        m_held[m_held_len++] = byte;
+        m_held_rd            = 0;
+        m_held_data          = true;
+        return false;
+    }
+
+    m_held[m_held_len++] = byte;
+    if (m_held_len == OPEN_LEN)
+    {
+        m_held_len = 0;
+        m_open     = true;
+        m_op       = UART_CMD_OP_OPEN;
+        m_id       = 0;
+        response_send(NRF_SUCCESS, NULL, 0);
+    }
+    return false;
+}
+
+
+/**@brief Function for parsing a byte received while the channel is open.
+ *
+ * @return true if the byte is data.
+ */
+static bool open_on_rx(uint8_t * p_byte)
+{
+    switch (m_rx_state)
+    {
+        case RX_STATE_DATA:
+            if (*p_byte != UART_CMD_ESC)
+            {
+                return true;
+            }
+            m_rx_state = RX_STATE_OP;
+            break;
+
+        case RX_STATE_OP:
+            if (*p_byte == UART_CMD_ESC)
+            {
+                // Escaped data byte.
+                m_rx_state = RX_STATE_DATA;
+                return true;
+            }
+            m_op       = *p_byte;
+            m_rx_state = RX_STATE_ID;
+            break;
+
+        case RX_STATE_ID:
+            m_id       = *p_byte;
+            m_rx_state = RX_STATE_LEN;
+            break;
+
+        case RX_STATE_LEN:
+            m_len       = *p_byte;
+            m_value_len = 0;
+            m_rx_state  = RX_STATE_VALUE;
+            if (m_len == 0)
+            {
+                m_rx_state = RX_STATE_DATA;
+                request_run();
+            }
+            break;
+
+        case RX_STATE_VALUE:
+            if (m_value_len < sizeof(m_value))
+            {
+                m_value[m_value_len] = *p_byte;
+            }
+            if (++m_value_len == m_len)
+            {
+                m_rx_state = RX_STATE_DATA;
+                request_run();
+            }
+            break;
+
+        default:
+            m_rx_state = RX_STATE_DATA;
+            break;
+    }
+
+    return false;
+}
+
+
+bool uart_cmd_on_rx(uint8_t * p_byte)
+{
+    uint32_t ticks;
+    bool     is_data;
+
+    UNUSED_VARIABLE(app_timer_cnt_get(&ticks));
+    is_data = m_open ? open_on_rx(p_byte) : closed_on_rx(*p_byte, ticks);
+
+    m_rx_seen  = true;
+    m_rx_ticks = ticks;
+    return is_data;
+}
+
+
+bool uart_cmd_held_get(uint8_t * p_byte)
+{
+    if (!m_held_data)
+    {
+        return false;
+    }
+
+    *p_byte = m_held[m_held_rd++];
+    if (m_held_rd == m_held_len)
+    {
+        m_held_len  = 0;
+        m_held_data = false;
+    }
+    return true;
+}
+
+
+bool uart_cmd_is_open(void)
+{
+    return m_open;
+}
+
+
+void uart_cmd_reset(void)
+{
+    m_rx_state  = RX_STATE_DATA;
+    m_held_len  = 0;
+    m_held_data = false;
+}
+
+/** @}
+ *  @endcond
+ */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is confidential property of Nordic Semiconductor. The use,
+ * copying, transfer or disclosure of such information is prohibited except by express written
+ * agreement with Nordic Semiconductor.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup uart_cmd UART Command Channel
+ * @{
+ * @brief    Reads and sets application parameters through escape frames on the data UART.
+ *
+ * @details  The channel starts closed, and every byte passes through it untouched in both
+ *           directions. The host opens it with an OPEN request sent after at least
+ *           @ref UART_CMD_GUARD_MS of silence on the UART:
+ *
+ *           @code
+ *           ESC 0x05 0x00 0x00
+ *           @endcode
+ *
+ *           Bytes that start like an OPEN request but are not one are passed on as data, in
+ *           order, once they differ from it. While the channel is open, the host sends request
+ *           frames anywhere in its data:
+ *
+ *           @code
+ *           ESC op id len value[len]
+ *           @endcode
+ *
+ *           and the application answers, in its UART output, with:
+ *
+ *           @code
+ *           ESC (op | 0x80) id status len value[len]
+ *           @endcode
+ *
+ *           where ESC is @ref UART_CMD_ESC and status is the low byte of an NRF_ERROR code.
+ *           A data byte equal to ESC is sent as ESC ESC in both directions while the channel is
+ *           open, see @ref uart_cmd_is_open. Integer values are little endian. GET returns the
+ *           value of parameter id, SET changes it, SAVE and DEFAULTS ignore id and value and are
+ *           passed to the application, which persists or restores its parameters. CLOSE is
+ *           answered, and then the channel is closed until the next OPEN.
+ *
+ *           The silence is measured on the RTC, so after an idle spell of a multiple of the
+ *           RTC period (512 seconds with prescaler 0) an OPEN request may be taken as data.
+ *           A host that gets no answer sends it again.
+ *
+ *           Parameters are described by a table of @ref uart_cmd_param_t, which points at the
+ *           application's own variables. Values are range checked before they are written, and
+ *           the application can reject a value that is in range but inconsistent, in which case
+ *           the old value is put back. The application is told before a value is read, so a
+ *           parameter can also hold a copy of state kept elsewhere, such as statistics.
+ */
+
+#ifndef UART_CMD_H__
+#define UART_CMD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart_cmd_cnfg.h"
+
+#define UART_CMD_OP_GET          0x01    /**< Read a parameter. */
+#define UART_CMD_OP_SET          0x02    /**< Change a parameter. */
+#define UART_CMD_OP_SAVE         0x03    /**< Persist all parameters. */
+#define UART_CMD_OP_DEFAULTS     0x04    /**< Restore the default parameters. */
+#define UART_CMD_OP_OPEN         0x05    /**< Open the channel. Only taken after @ref UART_CMD_GUARD_MS of silence. */
+#define UART_CMD_OP_CLOSE        0x06    /**< Close the channel, so that ESC is data again. */
+#define UART_CMD_OP_RESPONSE     0x80    /**< Set in the op of a response. */
+
+/**@brief Parameter that can be read and set. */
+typedef struct
+{
+    uint8_t   id;                        /**< Parameter ID used on the wire. */
+    uint8_t   len;                       /**< Size of the value. 1, 2 or 4 for integers, up to @ref UART_CMD_MAX_VALUE_LEN for byte strings. */
+    bool      is_int;                    /**< Whether the value is an integer checked against min and max. */
+    void    * p_value;                   /**< Application variable holding the value. */
+    uint32_t  min;                       /**< Lowest accepted integer value. */
+    uint32_t  max;                       /**< Highest accepted integer value. */
+} uart_cmd_param_t;
+
+/**@brief Command channel event type. */
+typedef enum
+{
+    UART_CMD_EVT_PARAM_GET,              /**< A parameter is about to be read, so the application can bring its value up to date. */
+    UART_CMD_EVT_PARAM_SET,              /**< A parameter has been changed. */
+    UART_CMD_EVT_SAVE,                   /**< The host asks for the parameters to be persisted. */
+    UART_CMD_EVT_DEFAULTS                /**< The host asks for the default parameters. */
+} uart_cmd_evt_type_t;
+
+/**@brief Command channel event. */
+typedef struct
+{
+    uart_cmd_evt_type_t      evt_type;   /**< Type of event. */
+    const uart_cmd_param_t * p_param;    /**< Parameter read or changed, for @ref UART_CMD_EVT_PARAM_GET and @ref UART_CMD_EVT_PARAM_SET. */
+} uart_cmd_evt_t;
+
+/**@brief Command channel event handler type.
+ *
+ * @return NRF_SUCCESS to accept the command. Any other code is returned to the host, for
+ *         @ref UART_CMD_EVT_PARAM_GET without the value, and for @ref UART_CMD_EVT_PARAM_SET
+ *         the old value is put back.
+ */
+typedef uint32_t (* uart_cmd_evt_handler_t) (const uart_cmd_evt_t * p_evt);
+
+/**@brief Function for writing a response to the UART, without escaping. */
+typedef void (* uart_cmd_write_t) (const uint8_t * p_data, uint16_t len);
+
+/**@brief Command channel initialization structure. */
+typedef struct
+{
+    const uart_cmd_param_t * p_params;   /**< Parameter table. Must stay valid. */
+    uint8_t                  param_count;/**< Number of parameters in the table. */
+    uart_cmd_evt_handler_t   evt_handler;/**< Event handler. */
+    uart_cmd_write_t         write;      /**< Function for writing responses. */
+    uint32_t                 prescaler;  /**< RTC1 prescaler of the app_timer, for measuring the silence before OPEN. */
+} uart_cmd_init_t;
+
+/**@brief     Function for initializing the command channel.
+ *
+ * @param[in] p_init Initialization parameters.
+ *
+ * @retval    NRF_SUCCESS             On success.
+ * @retval    NRF_ERROR_NULL          If the handler, the write function or the table is missing.
+ * @retval    NRF_ERROR_INVALID_PARAM If a parameter value is longer than @ref UART_CMD_MAX_VALUE_LEN.
+ */
+uint32_t uart_cmd_init(const uart_cmd_init_t * p_init);
+
+/**@brief     Function for passing a byte received on the UART through the command channel.
+ *
+ * @details   Bytes that belong to a frame are consumed, and the command is run once its frame
+ *            is complete. Call this for every byte before it is used as data, once
+ *            @ref uart_cmd_held_get has no byte left.
+ *
+ * @param[in,out] p_byte Byte received. Holds the data byte on return, when there is one.
+ *
+ * @return    true if *p_byte is data, false if it was consumed or held back.
+ */
+bool uart_cmd_on_rx(uint8_t * p_byte);
+
+/**@brief     Function for getting a data byte that was held back as the possible start of an
+ *            OPEN request.
+ *
+ * @details   Held bytes come before any byte still to be received, and are not passed to
+ *            @ref uart_cmd_on_rx again.
+ *
+ * @param[out] p_byte Data byte.
+ *
+ * @return    true if a byte was returned.
+ */
+bool uart_cmd_held_get(uint8_t * p_byte);
+
+/**@brief     Function for checking whether the channel is open.
+ *
+ * @details   Data written to the UART must have ESC doubled while it is, and only then.
+ *
+ * @return    true if the channel is open.
+ */
+bool uart_cmd_is_open(void);
+
+/**@brief     Function for dropping a partly received request, and bytes held back, after bytes
+ *            have been lost on the UART.
+ */
+void uart_cmd_reset(void);
+
+#endif // UART_CMD_H__
+
+/** @} */